@@ -0,0 +1,358 @@
+#ifndef ZYBO_BOARD
+#define _GNU_SOURCE // posix_openpt() and ptsname() for the loopback test.
+#endif
+#include <stdatomic.h>
+#include <stdio.h>
+#include "adcCapture.h"
+#include "adcCaptureCodec.h"
+#include "testUtils.h"
+#ifdef ZYBO_BOARD
+#include "xil_io.h"
+#include "xparameters.h"
+#include "xparameters_ps.h"
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define CHUNK_INDEX_MASK (ADC_CAPTURE_CHUNK_COUNT - 1)
+#define BITS_PER_BYTE 8
+#ifndef ZYBO_BOARD
+#define HOST_FILE_MODE 0644 // When the port is a new file.
+#endif
+
+#ifdef ZYBO_BOARD
+// PS UART registers and the bits used here.
+#define UART_BASEADDR XPS_UART1_BASEADDR
+#define UART_CONTROL_OFFSET 0x00
+#define UART_MODE_OFFSET 0x04
+#define UART_BAUD_GENERATOR_OFFSET 0x18
+#define UART_STATUS_OFFSET 0x2C
+#define UART_FIFO_OFFSET 0x30
+#define UART_BAUD_DIVIDER_OFFSET 0x34
+#define UART_CONTROL_RESET 0x03 // TXRES | RXRES
+#define UART_CONTROL_DISABLE 0x28 // TXDIS | RXDIS
+#define UART_CONTROL_ENABLE 0x14 // TXEN | RXEN
+#define UART_MODE_8N1 0x20 // No parity, 8 data bits, 1 stop bit.
+#define UART_STATUS_TX_FULL 0x10
+// baud = reference / (generator * (divider + 1)), 100 MHz / (10 * 5) on the Zybo.
+#ifdef XPAR_PS7_UART_1_UART_CLK_FREQ_HZ
+#define UART_REFERENCE_CLOCK_HZ XPAR_PS7_UART_1_UART_CLK_FREQ_HZ
+#else
+#define UART_REFERENCE_CLOCK_HZ 100000000 // The Zybo UART_REF_CLK, for a BSP built without the PS UART driver.
+#endif
+#define UART_BAUD_DIVIDER 4
+#define UART_BAUD_GENERATOR (UART_REFERENCE_CLOCK_HZ / (ADC_CAPTURE_BAUD_RATE * (UART_BAUD_DIVIDER + 1)))
+#endif
+
+// One packet's worth of samples.
+typedef struct {
+	uint32_t sampleIndex; // Index of samples[0] since adcCapture_start().
+	uint16_t sampleCount;
+	uint16_t samples[ADC_CAPTURE_CODEC_PACKET_SAMPLES];
+} adcCapture_chunk_t;
+
+static adcCapture_chunk_t chunks[ADC_CAPTURE_CHUNK_COUNT];
+static _Atomic uint32_t chunkHead; // Written by the ISR.
+static _Atomic uint32_t chunkTail; // Written by adcCapture_service().
+static atomic_bool running;
+static uint16_t chunkFill; // ISR-owned.
+static uint32_t nextSampleIndex; // ISR-owned.
+static _Atomic uint32_t capturedSamples;
+static _Atomic uint32_t droppedSamples;
+static uint32_t expectedSampleIndex; // Service-owned, to flag gaps.
+static uint16_t packetSequence;
+static uint32_t packetsSent;
+static uint32_t bytesSent;
+static uint32_t sentSamples;
+static uint8_t packet[ADC_CAPTURE_CODEC_MAX_PACKET_BYTES];
+#ifndef ZYBO_BOARD
+static int portFileDescriptor = -1;
+#endif
+
+// Writes length bytes to the capture port, waiting for room.
+static void adcCapture_writePort(const uint8_t *data, uint32_t length){
+#ifdef ZYBO_BOARD
+	for(uint32_t i = 0; i < length; ++i){
+		while(Xil_In32(UART_BASEADDR + UART_STATUS_OFFSET) & UART_STATUS_TX_FULL);
+		Xil_Out32(UART_BASEADDR + UART_FIFO_OFFSET, data[i]);
+	}
+#else
+	while(length > 0 && portFileDescriptor >= 0){
+		ssize_t written = write(portFileDescriptor, data, length);
+		if(written <= 0)
+			return;
+		data += written;
+		length -= written;
+	}
+#endif
+}
+
+// Opens the capture port.
+bool adcCapture_openPort(const char *path){
+#ifdef ZYBO_BOARD
+	(void)path;
+	Xil_Out32(UART_BASEADDR + UART_CONTROL_OFFSET, UART_CONTROL_DISABLE);	//The baud rate may only change while disabled
+	Xil_Out32(UART_BASEADDR + UART_MODE_OFFSET, UART_MODE_8N1);
+	Xil_Out32(UART_BASEADDR + UART_BAUD_GENERATOR_OFFSET, UART_BAUD_GENERATOR);
+	Xil_Out32(UART_BASEADDR + UART_BAUD_DIVIDER_OFFSET, UART_BAUD_DIVIDER);
+	Xil_Out32(UART_BASEADDR + UART_CONTROL_OFFSET, UART_CONTROL_RESET | UART_CONTROL_DISABLE);
+	Xil_Out32(UART_BASEADDR + UART_CONTROL_OFFSET, UART_CONTROL_ENABLE);
+	return true;
+#else
+	adcCapture_closePort();
+	portFileDescriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, HOST_FILE_MODE);
+	if(portFileDescriptor < 0){
+		printf("adcCapture: cannot open %s\n", path);
+		return false;
+	}
+	struct termios settings;
+	if(isatty(portFileDescriptor) && tcgetattr(portFileDescriptor, &settings) == 0){	//No newline translation on a pty
+		cfmakeraw(&settings);
+		tcsetattr(portFileDescriptor, TCSANOW, &settings);
+	}
+	return true;
+#endif
+}
+
+// Closes the capture port.
+void adcCapture_closePort(){
+#ifndef ZYBO_BOARD
+	if(portFileDescriptor >= 0)
+		close(portFileDescriptor);
+	portFileDescriptor = -1;
+#endif
+}
+
+// Empties the ring, clears the counters and starts capturing.
+void adcCapture_start(){
+	atomic_store(&running, false);
+	atomic_store(&chunkHead, 0);
+	atomic_store(&chunkTail, 0);
+	atomic_store(&capturedSamples, 0);
+	atomic_store(&droppedSamples, 0);
+	chunkFill = 0;
+	nextSampleIndex = 0;
+	expectedSampleIndex = 0;
+	packetSequence = 0;
+	packetsSent = 0;
+	bytesSent = 0;
+	sentSamples = 0;
+	atomic_store_explicit(&running, true, memory_order_release);
+}
+
+// Stops capturing and publishes the partly filled chunk.
+void adcCapture_stop(){
+	if(!atomic_exchange(&running, false))
+		return;
+	if(chunkFill > 0){
+		uint32_t head = atomic_load_explicit(&chunkHead, memory_order_relaxed);
+		chunks[head & CHUNK_INDEX_MASK].sampleCount = chunkFill;
+		chunkFill = 0;
+		atomic_store_explicit(&chunkHead, head + 1, memory_order_release);
+	}
+}
+
+// Returns true while samples are being captured.
+bool adcCapture_isRunning(){
+	return atomic_load_explicit(&running, memory_order_relaxed);
+}
+
+// Copies one sample into the ring. A chunk is only started when one is free,
+// otherwise the sample is dropped, so every chunk holds consecutive samples.
+void adcCapture_addSample(isr_AdcValue_t sample){
+	if(!atomic_load_explicit(&running, memory_order_relaxed))
+		return;
+	uint32_t head = atomic_load_explicit(&chunkHead, memory_order_relaxed);
+	adcCapture_chunk_t *chunk = &chunks[head & CHUNK_INDEX_MASK];
+	if(chunkFill == 0){
+		if(head - atomic_load_explicit(&chunkTail, memory_order_acquire) >= ADC_CAPTURE_CHUNK_COUNT){
+			atomic_fetch_add_explicit(&droppedSamples, 1, memory_order_relaxed);
+			nextSampleIndex++;
+			return;
+		}
+		chunk->sampleIndex = nextSampleIndex;
+	}
+	chunk->samples[chunkFill++] = sample;
+	nextSampleIndex++;
+	atomic_fetch_add_explicit(&capturedSamples, 1, memory_order_relaxed);
+	if(chunkFill == ADC_CAPTURE_CODEC_PACKET_SAMPLES){
+		chunk->sampleCount = chunkFill;
+		chunkFill = 0;
+		atomic_store_explicit(&chunkHead, head + 1, memory_order_release);	//Samples before the new head
+	}
+}
+
+// Encodes and writes every chunk waiting in the ring.
+uint32_t adcCapture_service(){
+	uint32_t sent = 0;
+	uint32_t tail = atomic_load_explicit(&chunkTail, memory_order_relaxed);
+	while(tail != atomic_load_explicit(&chunkHead, memory_order_acquire)){
+		adcCapture_chunk_t *chunk = &chunks[tail & CHUNK_INDEX_MASK];
+		uint8_t flags = (chunk->sampleIndex != expectedSampleIndex) ? ADC_CAPTURE_CODEC_FLAG_GAP : 0;
+		uint32_t length = adcCaptureCodec_encodePacket(packetSequence++, chunk->sampleIndex, flags,
+			chunk->samples, chunk->sampleCount, packet);
+		expectedSampleIndex = chunk->sampleIndex + chunk->sampleCount;
+		sentSamples += chunk->sampleCount;
+		atomic_store_explicit(&chunkTail, ++tail, memory_order_release);	//The chunk is encoded, the ISR may refill it
+		adcCapture_writePort(packet, length);
+		packetsSent++;
+		bytesSent += length;
+		sent++;
+	}
+	return sent;
+}
+
+// Copies the capture counters into stats.
+void adcCapture_getStats(adcCapture_stats_t *stats){
+	stats->capturedSamples = atomic_load_explicit(&capturedSamples, memory_order_relaxed);
+	stats->droppedSamples = atomic_load_explicit(&droppedSamples, memory_order_relaxed);
+	stats->packetsSent = packetsSent;
+	stats->bytesSent = bytesSent;
+	stats->bitsPerSample = (sentSamples == 0) ? 0.0 : (double)bytesSent * BITS_PER_BYTE / sentSamples;
+}
+
+/******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#ifndef ZYBO_BOARD
+#define LOOPBACK_TEST_SAMPLES 1000000 // 10 s of samples at 100 kHz.
+#define LOOPBACK_TEST_SERVICE_SAMPLES 1000 // adcCapture_service() every 10 ms of samples, like a game loop.
+#define LOOPBACK_TEST_FREQUENCY 3
+#define LOOPBACK_TEST_SEED 1
+#define LOOPBACK_TEST_READ_BYTES 4096
+#define LOOPBACK_TEST_POLL_MS 10
+#define LOOPBACK_TEST_TIMEOUT_MS 10000 // For the far end to catch up.
+#define SEQUENCE_MODULUS 65536
+
+// The far end of the pty, read by a thread of its own so the capture port
+// never blocks for long.
+typedef struct {
+	int master;
+	const uint16_t *samples;
+	atomic_bool stop;
+	_Atomic uint32_t receivedSamples;
+	uint32_t mismatchedSamples;
+	uint32_t lostPackets;
+	uint32_t packetCount;
+	adcCaptureCodec_parser_t parser;
+	adcCaptureCodec_packet_t packet;
+	pthread_t thread;
+} adcCapture_loopbackReader_t;
+
+// Parses everything that arrives at the far end and compares it with the
+// samples that were captured.
+static void *adcCapture_runLoopbackReader(void *argument){
+	adcCapture_loopbackReader_t *reader = argument;
+	uint8_t buffer[LOOPBACK_TEST_READ_BYTES];
+	struct pollfd request = {.fd = reader->master, .events = POLLIN};
+	adcCaptureCodec_parserInit(&reader->parser);
+	while(!atomic_load(&reader->stop)){
+		if(poll(&request, 1, LOOPBACK_TEST_POLL_MS) <= 0)
+			continue;
+		ssize_t length = read(reader->master, buffer, sizeof(buffer));
+		if(length <= 0)
+			break;
+		for(ssize_t i = 0; i < length; ++i){
+			if(!adcCaptureCodec_parseByte(&reader->parser, buffer[i], &reader->packet))
+				continue;
+			adcCaptureCodec_packet_t *packet = &reader->packet;
+			if(packet->sequence != reader->packetCount % SEQUENCE_MODULUS)
+				reader->lostPackets++;
+			reader->packetCount++;
+			uint32_t received = atomic_load_explicit(&reader->receivedSamples, memory_order_relaxed);
+			for(uint16_t j = 0; j < packet->sampleCount; ++j){
+				uint32_t index = packet->sampleIndex + j;
+				if(index != received + j || index >= LOOPBACK_TEST_SAMPLES || packet->samples[j] != reader->samples[index])
+					reader->mismatchedSamples++;
+			}
+			atomic_store_explicit(&reader->receivedSamples, received + packet->sampleCount, memory_order_release);
+		}
+	}
+	return NULL;
+}
+#endif
+
+// Captures LOOPBACK_TEST_SAMPLES square-wave samples into one end of a pty,
+// servicing the ring the way the main loop does, while a thread decodes the
+// other end. Checks that every sample arrives, in order and unchanged.
+void adcCapture_runLoopbackTest(){
+#ifdef ZYBO_BOARD
+	printf("adcCapture_runLoopbackTest() needs a pty, run it in the emulator build.\n");
+#else
+	printf("Starting adcCapture_runLoopbackTest()\n");
+	static adcCapture_loopbackReader_t reader;
+	uint16_t *samples = malloc(LOOPBACK_TEST_SAMPLES * sizeof(samples[0]));
+	if(samples == NULL){
+		printf("FAILED to allocate the samples\n");
+		return;
+	}
+	uint32_t seed = LOOPBACK_TEST_SEED;
+	for(uint32_t i = 0; i < LOOPBACK_TEST_SAMPLES; ++i)
+		samples[i] = testUtils_squareWaveSample(i, LOOPBACK_TEST_FREQUENCY, &seed);
+	reader.master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(reader.master < 0 || grantpt(reader.master) != 0 || unlockpt(reader.master) != 0
+		|| !adcCapture_openPort(ptsname(reader.master))){
+		printf("FAILED to open a pty\n");
+		if(reader.master >= 0)
+			close(reader.master);
+		free(samples);
+		return;
+	}
+	reader.samples = samples;
+	atomic_store(&reader.stop, false);
+	atomic_store(&reader.receivedSamples, 0);
+	reader.mismatchedSamples = 0;
+	reader.lostPackets = 0;
+	reader.packetCount = 0;
+	if(pthread_create(&reader.thread, NULL, adcCapture_runLoopbackReader, &reader) != 0){
+		printf("FAILED to start the reader thread\n");
+		adcCapture_closePort();
+		close(reader.master);
+		free(samples);
+		return;
+	}
+	struct timespec start, now;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	adcCapture_start();
+	for(uint32_t i = 0; i < LOOPBACK_TEST_SAMPLES; ++i){
+		adcCapture_addSample(samples[i]);
+		if((i + 1) % LOOPBACK_TEST_SERVICE_SAMPLES == 0)
+			adcCapture_service();
+	}
+	adcCapture_stop();
+	adcCapture_service();
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double sendSeconds = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) * 1e-9;
+	struct timespec deadline = start;
+	testUtils_addMilliseconds(&deadline, LOOPBACK_TEST_TIMEOUT_MS);
+	while(atomic_load_explicit(&reader.receivedSamples, memory_order_acquire) < LOOPBACK_TEST_SAMPLES
+		&& (now.tv_sec < deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec < deadline.tv_nsec))){
+		testUtils_addMilliseconds(&now, LOOPBACK_TEST_POLL_MS);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &now, NULL);
+	}
+	atomic_store(&reader.stop, true);
+	pthread_join(reader.thread, NULL);
+	adcCapture_closePort();
+	close(reader.master);
+	free(samples);
+	adcCapture_stats_t stats;
+	adcCapture_getStats(&stats);
+	uint32_t receivedSamples = atomic_load(&reader.receivedSamples);
+	printf("%u samples captured, %u dropped, sent in %u packets (%u bytes, %.2f bits per sample) in %.3f s\n",
+		stats.capturedSamples, stats.droppedSamples, stats.packetsSent, stats.bytesSent, stats.bitsPerSample, sendSeconds);
+	printf("%u samples received, %u mismatched, %u packet(s) lost, %u CRC error(s), %u byte(s) skipped\n",
+		receivedSamples, reader.mismatchedSamples, reader.lostPackets, reader.parser.crcErrorCount,
+		reader.parser.skippedByteCount);
+	bool passed = stats.droppedSamples == 0 && receivedSamples == LOOPBACK_TEST_SAMPLES && reader.mismatchedSamples == 0
+		&& reader.lostPackets == 0 && reader.parser.crcErrorCount == 0 && reader.parser.skippedByteCount == 0;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed adcCapture_runLoopbackTest()\n");
+#endif
+}
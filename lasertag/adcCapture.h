@@ -0,0 +1,77 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADCCAPTURE_H_
+#define ADCCAPTURE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "isr.h"
+
+// Raw ADC capture streaming. While capture is enabled, isr_function() copies
+// every sample it reads (the first sensor's) into a capture ring, one
+// packet-sized chunk at a time. The main loop calls adcCapture_service(),
+// which encodes each full chunk as an adcCaptureCodec packet (delta + Rice
+// coded, with a sequence number and CRC) and writes it to the capture port.
+// The detector keeps running on its own ADC buffer meanwhile, so field data
+// can be captured during a game.
+// On the board the port is PS UART1, the USB-UART, reprogrammed to
+// ADC_CAPTURE_BAUD_RATE; anything else printed to it afterwards arrives at
+// that rate too. On a host the port is any file or tty, e.g. one end of a
+// pty, so the link can be tested without a board. adcCaptureDecode turns the
+// stream back into a capture file.
+// If the port falls behind, whole chunks are dropped at the ISR and the gap
+// shows in the sampleIndex of the next packet.
+
+#define ADC_CAPTURE_CHUNK_COUNT 64 // Power of two; 164 ms of samples.
+#define ADC_CAPTURE_BAUD_RATE 2000000 // Exact from the 100 MHz UART clock.
+
+// Capture counters.
+typedef struct {
+  uint32_t capturedSamples; // Stored in the ring, including any not yet sent.
+  uint32_t droppedSamples;  // Found the ring full.
+  uint32_t packetsSent;
+  uint32_t bytesSent;
+  double bitsPerSample; // Of what was sent, framing included.
+} adcCapture_stats_t;
+
+// Opens the capture port: path is ignored on the board, which sets up the
+// UART, and names the file or tty to write to on a host. Returns false if it
+// cannot be opened.
+bool adcCapture_openPort(const char *path);
+
+// Closes the capture port (host only; the board UART stays set up).
+void adcCapture_closePort();
+
+// Empties the ring, clears the counters and starts capturing at sample 0.
+void adcCapture_start();
+
+// Stops capturing. The partly filled chunk is published, so the next
+// adcCapture_service() sends everything captured. Call it from the main loop;
+// on the board the ISR can't be part way through adcCapture_addSample() then.
+void adcCapture_stop();
+
+// Returns true while samples are being captured.
+bool adcCapture_isRunning();
+
+// Called by isr_function() with every sample it reads.
+void adcCapture_addSample(isr_AdcValue_t sample);
+
+// Encodes and writes every chunk waiting in the ring. Returns the number of
+// packets written.
+uint32_t adcCapture_service();
+
+// Copies the capture counters into stats.
+void adcCapture_getStats(adcCapture_stats_t *stats);
+
+// Captures a million samples into one end of a pty while a thread decodes the
+// other end, and checks that every sample arrives unchanged and in order.
+// Host (emulator) builds only.
+void adcCapture_runLoopbackTest();
+
+#endif /* ADCCAPTURE_H_ */
@@ -0,0 +1,461 @@
+#include <stdio.h>
+#include <string.h>
+#include "adcCaptureCodec.h"
+
+#define CRC_INITIAL_VALUE 0xFFFF
+#define CRC_POLYNOMIAL 0x1021
+#define CRC_TOP_BIT 0x8000
+#define BITS_PER_BYTE 8
+#define RAW_SAMPLE_BITS 16
+#define BYTE_MASK 0xFF
+
+// Header field offsets.
+#define SEQUENCE_OFFSET 2
+#define SAMPLE_INDEX_OFFSET 4
+#define SAMPLE_COUNT_OFFSET 8
+#define RICE_OFFSET 10
+#define FLAGS_OFFSET 11
+#define LENGTH_OFFSET 12
+
+// Packs bits MSB first.
+typedef struct {
+	uint8_t *data;
+	uint32_t byteCount;
+	uint32_t accumulator;
+	uint8_t bitCount;
+} adcCaptureCodec_bitWriter_t;
+
+// Unpacks bits MSB first, refusing to read past the end.
+typedef struct {
+	const uint8_t *data;
+	uint32_t length;
+	uint32_t bitPosition;
+} adcCaptureCodec_bitReader_t;
+
+// Appends the low bitCount (at most 16) bits of value.
+static void adcCaptureCodec_putBits(adcCaptureCodec_bitWriter_t *writer, uint32_t value, uint8_t bitCount){
+	writer->accumulator = (writer->accumulator << bitCount) | (value & ((1u << bitCount) - 1));
+	writer->bitCount += bitCount;
+	while(writer->bitCount >= BITS_PER_BYTE){
+		writer->bitCount -= BITS_PER_BYTE;
+		writer->data[writer->byteCount++] = writer->accumulator >> writer->bitCount;
+	}
+	writer->accumulator &= (1u << writer->bitCount) - 1;
+}
+
+// Pads the last byte with zeros.
+static void adcCaptureCodec_flushBits(adcCaptureCodec_bitWriter_t *writer){
+	if(writer->bitCount > 0)
+		adcCaptureCodec_putBits(writer, 0, BITS_PER_BYTE - writer->bitCount);
+}
+
+// Reads one bit into *bit. Returns false at the end of the data.
+static bool adcCaptureCodec_getBit(adcCaptureCodec_bitReader_t *reader, uint32_t *bit){
+	if(reader->bitPosition >= reader->length * BITS_PER_BYTE)
+		return false;
+	uint8_t byte = reader->data[reader->bitPosition / BITS_PER_BYTE];
+	*bit = (byte >> (BITS_PER_BYTE - 1 - reader->bitPosition % BITS_PER_BYTE)) & 1;
+	reader->bitPosition++;
+	return true;
+}
+
+// Reads bitCount bits into *value. Returns false at the end of the data.
+static bool adcCaptureCodec_getBits(adcCaptureCodec_bitReader_t *reader, uint8_t bitCount, uint32_t *value){
+	uint32_t bit;
+	*value = 0;
+	for(uint8_t i = 0; i < bitCount; ++i){
+		if(!adcCaptureCodec_getBit(reader, &bit))
+			return false;
+		*value = (*value << 1) | bit;
+	}
+	return true;
+}
+
+// Maps a signed difference to unsigned: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+static uint16_t adcCaptureCodec_zigZag(int16_t difference){
+	return ((uint16_t)difference << 1) ^ (uint16_t)(difference >> 15);
+}
+
+// Undoes adcCaptureCodec_zigZag().
+static int16_t adcCaptureCodec_unZigZag(uint16_t value){
+	return (int16_t)((value >> 1) ^ (uint16_t)-(int16_t)(value & 1));
+}
+
+// Stores a 16-bit or 32-bit field little-endian.
+static void adcCaptureCodec_put16(uint8_t *field, uint16_t value){
+	field[0] = value & BYTE_MASK;
+	field[1] = value >> BITS_PER_BYTE;
+}
+
+static void adcCaptureCodec_put32(uint8_t *field, uint32_t value){
+	adcCaptureCodec_put16(field, value & 0xFFFF);
+	adcCaptureCodec_put16(field + 2, value >> RAW_SAMPLE_BITS);
+}
+
+// Loads a 16-bit or 32-bit little-endian field.
+static uint16_t adcCaptureCodec_get16(const uint8_t *field){
+	return field[0] | (field[1] << BITS_PER_BYTE);
+}
+
+static uint32_t adcCaptureCodec_get32(const uint8_t *field){
+	return adcCaptureCodec_get16(field) | ((uint32_t)adcCaptureCodec_get16(field + 2) << RAW_SAMPLE_BITS);
+}
+
+// Returns the CRC-16/CCITT-FALSE of length bytes.
+uint16_t adcCaptureCodec_crc16(const uint8_t *data, uint32_t length){
+	uint16_t crc = CRC_INITIAL_VALUE;
+	for(uint32_t i = 0; i < length; ++i){
+		crc ^= (uint16_t)data[i] << BITS_PER_BYTE;
+		for(uint8_t bit = 0; bit < BITS_PER_BYTE; ++bit)
+			crc = (crc & CRC_TOP_BIT) ? (crc << 1) ^ CRC_POLYNOMIAL : crc << 1;
+	}
+	return crc;
+}
+
+// Returns the Rice parameter for the differences of a packet: the largest k
+// with 2^k no more than their mean.
+static uint8_t adcCaptureCodec_chooseRiceParameter(const uint16_t samples[], uint16_t sampleCount){
+	uint32_t sum = 0;
+	for(uint16_t i = 1; i < sampleCount; ++i)
+		sum += adcCaptureCodec_zigZag((int16_t)(samples[i] - samples[i - 1]));
+	uint32_t differenceCount = sampleCount - 1;
+	uint8_t k = 0;
+	while(k < ADC_CAPTURE_CODEC_MAX_RICE_PARAMETER && sampleCount > 1 && (differenceCount << (k + 1)) <= sum)
+		++k;
+	return k;
+}
+
+// Encodes samples into a framed packet and returns its length.
+uint32_t adcCaptureCodec_encodePacket(uint16_t sequence, uint32_t sampleIndex, uint8_t flags,
+		const uint16_t samples[], uint16_t sampleCount, uint8_t packet[]){
+	uint8_t k = adcCaptureCodec_chooseRiceParameter(samples, sampleCount);
+	adcCaptureCodec_bitWriter_t writer = {.data = packet + ADC_CAPTURE_CODEC_HEADER_BYTES};
+	if(sampleCount > 0)
+		adcCaptureCodec_putBits(&writer, samples[0], RAW_SAMPLE_BITS);
+	for(uint16_t i = 1; i < sampleCount; ++i){
+		uint16_t value = adcCaptureCodec_zigZag((int16_t)(samples[i] - samples[i - 1]));
+		uint32_t quotient = value >> k;
+		if(quotient < ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT){
+			adcCaptureCodec_putBits(&writer, ((1u << quotient) - 1) << 1, quotient + 1);	//quotient ones and a zero
+			adcCaptureCodec_putBits(&writer, value, k);
+		}
+		else{
+			adcCaptureCodec_putBits(&writer, (1u << ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT) - 1, ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT);
+			adcCaptureCodec_putBits(&writer, value, RAW_SAMPLE_BITS);
+		}
+	}
+	adcCaptureCodec_flushBits(&writer);
+	packet[0] = ADC_CAPTURE_CODEC_SYNC_0;
+	packet[1] = ADC_CAPTURE_CODEC_SYNC_1;
+	adcCaptureCodec_put16(packet + SEQUENCE_OFFSET, sequence);
+	adcCaptureCodec_put32(packet + SAMPLE_INDEX_OFFSET, sampleIndex);
+	adcCaptureCodec_put16(packet + SAMPLE_COUNT_OFFSET, sampleCount);
+	packet[RICE_OFFSET] = k;
+	packet[FLAGS_OFFSET] = flags;
+	adcCaptureCodec_put16(packet + LENGTH_OFFSET, writer.byteCount);
+	uint32_t crcOffset = ADC_CAPTURE_CODEC_HEADER_BYTES + writer.byteCount;
+	uint16_t crc = adcCaptureCodec_crc16(packet + SEQUENCE_OFFSET, crcOffset - SEQUENCE_OFFSET);
+	packet[crcOffset] = crc >> BITS_PER_BYTE;
+	packet[crcOffset + 1] = crc & BYTE_MASK;
+	return crcOffset + ADC_CAPTURE_CODEC_CRC_BYTES;
+}
+
+// Decodes a complete packet whose CRC has been checked.
+bool adcCaptureCodec_decodePacket(const uint8_t packet[], uint32_t length, adcCaptureCodec_packet_t *decoded){
+	if(length < ADC_CAPTURE_CODEC_HEADER_BYTES + ADC_CAPTURE_CODEC_CRC_BYTES)
+		return false;
+	decoded->sequence = adcCaptureCodec_get16(packet + SEQUENCE_OFFSET);
+	decoded->sampleIndex = adcCaptureCodec_get32(packet + SAMPLE_INDEX_OFFSET);
+	decoded->sampleCount = adcCaptureCodec_get16(packet + SAMPLE_COUNT_OFFSET);
+	decoded->riceParameter = packet[RICE_OFFSET];
+	decoded->flags = packet[FLAGS_OFFSET];
+	uint16_t payloadBytes = adcCaptureCodec_get16(packet + LENGTH_OFFSET);
+	if(decoded->sampleCount > ADC_CAPTURE_CODEC_PACKET_SAMPLES || decoded->riceParameter > ADC_CAPTURE_CODEC_MAX_RICE_PARAMETER
+		|| (uint32_t)ADC_CAPTURE_CODEC_HEADER_BYTES + payloadBytes + ADC_CAPTURE_CODEC_CRC_BYTES != length)
+		return false;
+	adcCaptureCodec_bitReader_t reader = {.data = packet + ADC_CAPTURE_CODEC_HEADER_BYTES, .length = payloadBytes};
+	uint32_t value;
+	if(decoded->sampleCount > 0){
+		if(!adcCaptureCodec_getBits(&reader, RAW_SAMPLE_BITS, &value))
+			return false;
+		decoded->samples[0] = value;
+	}
+	for(uint16_t i = 1; i < decoded->sampleCount; ++i){
+		uint32_t quotient = 0, bit = 1;
+		while(quotient < ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT){
+			if(!adcCaptureCodec_getBit(&reader, &bit))
+				return false;
+			if(bit == 0)
+				break;
+			++quotient;
+		}
+		if(bit == 0){
+			if(!adcCaptureCodec_getBits(&reader, decoded->riceParameter, &value))
+				return false;
+			value |= quotient << decoded->riceParameter;
+		}
+		else if(!adcCaptureCodec_getBits(&reader, RAW_SAMPLE_BITS, &value)){
+			return false;
+		}
+		decoded->samples[i] = decoded->samples[i - 1] + adcCaptureCodec_unZigZag(value);
+	}
+	return true;
+}
+
+// Empties a parser and clears its counters.
+void adcCaptureCodec_parserInit(adcCaptureCodec_parser_t *parser){
+	parser->length = 0;
+	parser->crcErrorCount = 0;
+	parser->skippedByteCount = 0;
+}
+
+// Drops at least count bytes from the front of the parser buffer, up to the
+// next possible sync byte. Counts them as skipped unless they were a packet.
+static void adcCaptureCodec_drop(adcCaptureCodec_parser_t *parser, uint32_t count, bool wasPacket){
+	while(count < parser->length && parser->buffer[count] != ADC_CAPTURE_CODEC_SYNC_0)
+		++count;
+	if(!wasPacket)
+		parser->skippedByteCount += count;
+	parser->length -= count;
+	memmove(parser->buffer, parser->buffer + count, parser->length);
+}
+
+// Feeds one received byte and returns true when it completes a good packet.
+bool adcCaptureCodec_parseByte(adcCaptureCodec_parser_t *parser, uint8_t byte, adcCaptureCodec_packet_t *decoded){
+	parser->buffer[parser->length++] = byte;
+	while(parser->length > 0){
+		if(parser->buffer[0] != ADC_CAPTURE_CODEC_SYNC_0 || (parser->length > 1 && parser->buffer[1] != ADC_CAPTURE_CODEC_SYNC_1)){
+			adcCaptureCodec_drop(parser, 1, false);
+			continue;
+		}
+		if(parser->length < ADC_CAPTURE_CODEC_HEADER_BYTES)
+			return false;
+		uint16_t payloadBytes = adcCaptureCodec_get16(parser->buffer + LENGTH_OFFSET);
+		if(payloadBytes > ADC_CAPTURE_CODEC_MAX_PAYLOAD_BYTES){	//Not a real header
+			adcCaptureCodec_drop(parser, 1, false);
+			continue;
+		}
+		uint32_t packetBytes = ADC_CAPTURE_CODEC_HEADER_BYTES + payloadBytes + ADC_CAPTURE_CODEC_CRC_BYTES;
+		if(parser->length < packetBytes)
+			return false;
+		uint16_t crc = (parser->buffer[packetBytes - 2] << BITS_PER_BYTE) | parser->buffer[packetBytes - 1];
+		if(adcCaptureCodec_crc16(parser->buffer + SEQUENCE_OFFSET, packetBytes - SEQUENCE_OFFSET - ADC_CAPTURE_CODEC_CRC_BYTES) == crc
+			&& adcCaptureCodec_decodePacket(parser->buffer, packetBytes, decoded)){
+			adcCaptureCodec_drop(parser, packetBytes, true);
+			return true;
+		}
+		parser->crcErrorCount++;
+		adcCaptureCodec_drop(parser, 1, false);
+	}
+	return false;
+}
+
+/******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#define TEST_RANDOM_MULTIPLIER 1103515245
+#define TEST_RANDOM_INCREMENT 12345
+#define TEST_RANDOM_SHIFT 16
+#define TEST_SEED 1
+#define TEST_HIGH_VALUE 3000 // A noisy square wave like the ADC sees.
+#define TEST_LOW_VALUE 1000
+#define TEST_NOISE 200
+#define TEST_SQUARE_WAVE_PERIOD 40
+// A spike every TEST_SPIKE_PERIOD samples puts about one difference in eight
+// at twice TEST_SPIKE_HEIGHT, about as many as can escape when the Rice
+// parameter comes from the mean.
+#define TEST_SPIKE_PERIOD 17
+#define TEST_SPIKE_HEIGHT 0x4004
+#define TEST_SPIKE_NOISE 4
+#define TEST_STREAM_PACKETS 8
+#define TEST_STREAM_SAMPLES 64
+#define TEST_FILLER_BYTE 0x11 // Junk that holds no sync byte.
+#define TEST_JUNK_TAIL_BYTES 20
+
+// The signals packets are made of.
+typedef enum {
+	adcCaptureCodec_testSquareWave_e,
+	adcCaptureCodec_testConstant_e,
+	adcCaptureCodec_testFullScale_e,	//Random 16-bit samples, the Rice parameter at its largest
+	adcCaptureCodec_testSpikes_e,	//Quiet with rare full-scale spikes, so the payload is escape-heavy
+	adcCaptureCodec_testSignalCount_e
+} adcCaptureCodec_testSignal_t;
+
+static const uint16_t testSampleCounts[] = {1, 2, 17, ADC_CAPTURE_CODEC_PACKET_SAMPLES};
+#define TEST_SAMPLE_COUNT_COUNT (sizeof(testSampleCounts) / sizeof(testSampleCounts[0]))
+
+static adcCaptureCodec_packet_t testPackets[TEST_STREAM_PACKETS];
+static uint8_t testStream[(TEST_STREAM_PACKETS + 2) * ADC_CAPTURE_CODEC_MAX_PACKET_BYTES];
+static adcCaptureCodec_parser_t testParser;
+static adcCaptureCodec_packet_t testDecoded;
+
+// Returns 16 pseudo-random bits. The codec is built on its own into
+// adcCaptureDecode, so it does not use testUtils.
+static uint32_t adcCaptureCodec_testRandom(uint32_t *seed){
+	*seed = *seed * TEST_RANDOM_MULTIPLIER + TEST_RANDOM_INCREMENT;
+	return *seed >> TEST_RANDOM_SHIFT;
+}
+
+// Fills in the samples and header of a test packet, encodes it into bytes and
+// returns its length.
+static uint32_t adcCaptureCodec_makeTestPacket(adcCaptureCodec_packet_t *packet, adcCaptureCodec_testSignal_t signal,
+		uint16_t sampleCount, uint16_t sequence, uint32_t *seed, uint8_t bytes[]){
+	for(uint16_t i = 0; i < sampleCount; ++i){
+		uint16_t noise = adcCaptureCodec_testRandom(seed);
+		switch(signal){
+		case adcCaptureCodec_testSquareWave_e:
+			packet->samples[i] = ((i % TEST_SQUARE_WAVE_PERIOD) < TEST_SQUARE_WAVE_PERIOD / 2 ? TEST_HIGH_VALUE : TEST_LOW_VALUE)
+				+ noise % TEST_NOISE;
+			break;
+		case adcCaptureCodec_testConstant_e:
+			packet->samples[i] = TEST_LOW_VALUE;
+			break;
+		case adcCaptureCodec_testFullScale_e:
+			packet->samples[i] = noise;
+			break;
+		default:
+			packet->samples[i] = TEST_LOW_VALUE + noise % TEST_SPIKE_NOISE + ((i % TEST_SPIKE_PERIOD == 0) ? TEST_SPIKE_HEIGHT : 0);
+			break;
+		}
+	}
+	packet->sequence = sequence;
+	packet->sampleIndex = (uint32_t)sequence * ADC_CAPTURE_CODEC_PACKET_SAMPLES;
+	packet->sampleCount = sampleCount;
+	packet->flags = sequence % 2 ? ADC_CAPTURE_CODEC_FLAG_GAP : 0;
+	uint32_t length = adcCaptureCodec_encodePacket(sequence, packet->sampleIndex, packet->flags, packet->samples,
+		sampleCount, bytes);
+	packet->riceParameter = bytes[RICE_OFFSET];
+	return length;
+}
+
+// Returns true if decoded holds the same packet as expected.
+static bool adcCaptureCodec_isSamePacket(const adcCaptureCodec_packet_t *decoded, const adcCaptureCodec_packet_t *expected){
+	return decoded->sequence == expected->sequence && decoded->sampleIndex == expected->sampleIndex
+		&& decoded->sampleCount == expected->sampleCount && decoded->riceParameter == expected->riceParameter
+		&& decoded->flags == expected->flags
+		&& memcmp(decoded->samples, expected->samples, expected->sampleCount * sizeof(expected->samples[0])) == 0;
+}
+
+// Returns the number of differences in a packet that are sent escaped.
+static uint16_t adcCaptureCodec_countEscapes(const adcCaptureCodec_packet_t *packet){
+	uint16_t count = 0;
+	for(uint16_t i = 1; i < packet->sampleCount; ++i)
+		if((adcCaptureCodec_zigZag((int16_t)(packet->samples[i] - packet->samples[i - 1])) >> packet->riceParameter)
+			>= ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT)
+			count++;
+	return count;
+}
+
+// Feeds length bytes to a fresh parser and checks that the packets it finds
+// are exactly testPackets[0] to testPackets[packetCount - 1], in order.
+static bool adcCaptureCodec_parseTestStream(uint32_t length, uint16_t packetCount){
+	uint16_t found = 0;
+	bool passed = true;
+	adcCaptureCodec_parserInit(&testParser);
+	for(uint32_t i = 0; i < length; ++i){
+		if(!adcCaptureCodec_parseByte(&testParser, testStream[i], &testDecoded))
+			continue;
+		if(found >= packetCount || !adcCaptureCodec_isSamePacket(&testDecoded, &testPackets[found]))
+			passed = false;
+		found++;
+	}
+	return passed && found == packetCount;
+}
+
+// Round-trips every signal at 1, 2, 17 and a full packet of samples.
+static bool adcCaptureCodec_runRoundTripTest(){
+	bool passed = true;
+	uint32_t seed = TEST_SEED;
+	for(uint16_t signal = 0; signal < adcCaptureCodec_testSignalCount_e; ++signal){
+		for(uint16_t n = 0; n < TEST_SAMPLE_COUNT_COUNT; ++n){
+			uint16_t sampleCount = testSampleCounts[n];
+			uint32_t length = adcCaptureCodec_makeTestPacket(&testPackets[0], signal, sampleCount, n, &seed, testStream);
+			uint16_t crc = (testStream[length - 2] << BITS_PER_BYTE) | testStream[length - 1];
+			if(length > ADC_CAPTURE_CODEC_MAX_PACKET_BYTES
+				|| adcCaptureCodec_crc16(testStream + SEQUENCE_OFFSET, length - SEQUENCE_OFFSET - ADC_CAPTURE_CODEC_CRC_BYTES) != crc
+				|| !adcCaptureCodec_decodePacket(testStream, length, &testDecoded)
+				|| !adcCaptureCodec_isSamePacket(&testDecoded, &testPackets[0])){
+				printf("signal %u with %u sample(s) did not round-trip\n", signal, sampleCount);
+				passed = false;
+			}
+			if(signal == adcCaptureCodec_testSpikes_e && sampleCount == ADC_CAPTURE_CODEC_PACKET_SAMPLES
+				&& adcCaptureCodec_countEscapes(&testPackets[0]) < 2 * (sampleCount / TEST_SPIKE_PERIOD)){	//Both edges of each spike
+				printf("the spikes were not escaped (Rice parameter %u)\n", testPackets[0].riceParameter);
+				passed = false;
+			}
+		}
+	}
+	return passed;
+}
+
+// Flips every bit after the sync of a packet in turn and sends it ahead of
+// enough good packets to cover the longest length a flipped header can
+// claim. The flipped packet must never be found, and every good one must.
+static bool adcCaptureCodec_runCorruptionTest(){
+	static uint8_t corrupted[ADC_CAPTURE_CODEC_MAX_PACKET_BYTES];
+	bool passed = true;
+	uint32_t seed = TEST_SEED;
+	adcCaptureCodec_packet_t sent;
+	uint32_t corruptedLength = adcCaptureCodec_makeTestPacket(&sent, adcCaptureCodec_testSquareWave_e, TEST_STREAM_SAMPLES,
+		0, &seed, corrupted);
+	uint32_t goodBytes = 0;
+	uint16_t goodCount = 0;
+	while(goodBytes <= ADC_CAPTURE_CODEC_MAX_PACKET_BYTES && goodCount < TEST_STREAM_PACKETS){
+		goodBytes += adcCaptureCodec_makeTestPacket(&testPackets[goodCount], goodCount % adcCaptureCodec_testSignalCount_e,
+			ADC_CAPTURE_CODEC_PACKET_SAMPLES, goodCount + 1, &seed, testStream + corruptedLength + goodBytes);
+		goodCount++;
+	}
+	for(uint32_t bit = SEQUENCE_OFFSET * BITS_PER_BYTE; bit < corruptedLength * BITS_PER_BYTE; ++bit){
+		memcpy(testStream, corrupted, corruptedLength);
+		testStream[bit / BITS_PER_BYTE] ^= 1 << (bit % BITS_PER_BYTE);
+		if(!adcCaptureCodec_parseTestStream(corruptedLength + goodBytes, goodCount)){
+			printf("flipping bit %u of a packet was not caught\n", bit);
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+// Sends junk with stray sync bytes and two false headers, one with an
+// impossible length and one whose length swallows the good packets behind
+// it. The parser must skip exactly the junk and find every good packet.
+static bool adcCaptureCodec_runResyncTest(){
+	static const uint8_t strayBytes[] = {0x00, ADC_CAPTURE_CODEC_SYNC_0, 0x00, ADC_CAPTURE_CODEC_SYNC_1, ADC_CAPTURE_CODEC_SYNC_0};
+	uint32_t length = sizeof(strayBytes);
+	memcpy(testStream, strayBytes, length);
+	for(uint16_t header = 0; header < 2; ++header){
+		uint8_t *falseHeader = testStream + length;
+		memset(falseHeader, TEST_FILLER_BYTE, ADC_CAPTURE_CODEC_HEADER_BYTES);
+		falseHeader[0] = ADC_CAPTURE_CODEC_SYNC_0;
+		falseHeader[1] = ADC_CAPTURE_CODEC_SYNC_1;
+		adcCaptureCodec_put16(falseHeader + LENGTH_OFFSET, header == 0 ? UINT16_MAX : ADC_CAPTURE_CODEC_MAX_PAYLOAD_BYTES);
+		length += ADC_CAPTURE_CODEC_HEADER_BYTES;
+	}
+	memset(testStream + length, TEST_FILLER_BYTE, TEST_JUNK_TAIL_BYTES);
+	length += TEST_JUNK_TAIL_BYTES;
+	uint32_t junkLength = length;
+	uint32_t seed = TEST_SEED;
+	for(uint16_t i = 0; i < TEST_STREAM_PACKETS; ++i)
+		length += adcCaptureCodec_makeTestPacket(&testPackets[i], i % adcCaptureCodec_testSignalCount_e,
+			ADC_CAPTURE_CODEC_PACKET_SAMPLES, i, &seed, testStream + length);
+	bool passed = adcCaptureCodec_parseTestStream(length, TEST_STREAM_PACKETS);
+	if(!passed || testParser.skippedByteCount != junkLength || testParser.crcErrorCount != 1){
+		printf("resync skipped %u of %u junk byte(s) with %u CRC error(s)\n", testParser.skippedByteCount, junkLength,
+			testParser.crcErrorCount);
+		passed = false;
+	}
+	return passed;
+}
+
+// Checks encoding and decoding, and that the parser rejects corrupted
+// packets and resynchronizes after junk and false sync patterns.
+bool adcCaptureCodec_runTest(){
+	printf("Starting adcCaptureCodec_runTest()\n");
+	bool passed = adcCaptureCodec_runRoundTripTest();
+	passed = adcCaptureCodec_runCorruptionTest() && passed;
+	passed = adcCaptureCodec_runResyncTest() && passed;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed adcCaptureCodec_runTest()\n");
+	return passed;
+}
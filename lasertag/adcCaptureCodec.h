@@ -0,0 +1,100 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADCCAPTURECODEC_H_
+#define ADCCAPTURECODEC_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// Packet format of the raw ADC capture stream. It is shared by adcCapture on
+// the board and the adcCaptureDecode host tool, so it uses no hardware.
+// A packet carries up to ADC_CAPTURE_CODEC_PACKET_SAMPLES consecutive
+// samples:
+//   sync        2 bytes  0xA5 0x5A
+//   sequence    2 bytes  packet counter, wraps
+//   sampleIndex 4 bytes  index of the first sample since capture started
+//   sampleCount 2 bytes
+//   rice        1 byte   Rice parameter k used by the payload
+//   flags       1 byte   ADC_CAPTURE_CODEC_FLAG_*
+//   length      2 bytes  payload length in bytes
+//   payload     the first sample in 16 bits, then each difference from the
+//               previous sample, zig-zag mapped to unsigned and Rice coded:
+//               value >> k in unary (ones ended by a zero), then the low k
+//               bits. A quotient of ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT or
+//               more is sent as that many ones and the value in 16 bits.
+//               Bits are packed MSB first, the last byte padded with zeros.
+//   crc         2 bytes  CRC-16/CCITT-FALSE of everything from sequence to
+//               the end of the payload
+// Multi-byte fields are little-endian, except the CRC, which is big-endian.
+// A gap in sampleIndex means the board dropped samples, and a gap in sequence
+// means packets were lost on the link.
+
+#define ADC_CAPTURE_CODEC_SYNC_0 0xA5
+#define ADC_CAPTURE_CODEC_SYNC_1 0x5A
+#define ADC_CAPTURE_CODEC_PACKET_SAMPLES 256
+#define ADC_CAPTURE_CODEC_HEADER_BYTES 14
+#define ADC_CAPTURE_CODEC_CRC_BYTES 2
+#define ADC_CAPTURE_CODEC_ESCAPE_QUOTIENT 16
+#define ADC_CAPTURE_CODEC_MAX_RICE_PARAMETER 15
+// Worst case: every difference escaped, 16 + 16 bits.
+#define ADC_CAPTURE_CODEC_MAX_PAYLOAD_BYTES (2 + (ADC_CAPTURE_CODEC_PACKET_SAMPLES - 1) * 4)
+#define ADC_CAPTURE_CODEC_MAX_PACKET_BYTES                                     \
+  (ADC_CAPTURE_CODEC_HEADER_BYTES + ADC_CAPTURE_CODEC_MAX_PAYLOAD_BYTES +      \
+   ADC_CAPTURE_CODEC_CRC_BYTES)
+
+#define ADC_CAPTURE_CODEC_FLAG_GAP 0x01 // Samples were dropped before this packet.
+
+// One decoded packet.
+typedef struct {
+  uint16_t sequence;
+  uint32_t sampleIndex;
+  uint16_t sampleCount;
+  uint8_t riceParameter;
+  uint8_t flags;
+  uint16_t samples[ADC_CAPTURE_CODEC_PACKET_SAMPLES];
+} adcCaptureCodec_packet_t;
+
+// Finds packets in a byte stream, skipping anything that is not one.
+typedef struct {
+  uint8_t buffer[ADC_CAPTURE_CODEC_MAX_PACKET_BYTES];
+  uint32_t length;
+  uint32_t crcErrorCount;
+  uint32_t skippedByteCount;
+} adcCaptureCodec_parser_t;
+
+// Returns the CRC-16/CCITT-FALSE of length bytes.
+uint16_t adcCaptureCodec_crc16(const uint8_t *data, uint32_t length);
+
+// Encodes sampleCount samples (at most ADC_CAPTURE_CODEC_PACKET_SAMPLES) into
+// packet, which must hold ADC_CAPTURE_CODEC_MAX_PACKET_BYTES. Picks the Rice
+// parameter from the mean difference. Returns the packet length in bytes.
+uint32_t adcCaptureCodec_encodePacket(uint16_t sequence, uint32_t sampleIndex, uint8_t flags,
+                                      const uint16_t samples[], uint16_t sampleCount,
+                                      uint8_t packet[]);
+
+// Decodes a complete packet whose CRC has been checked. Returns false if the
+// payload is malformed.
+bool adcCaptureCodec_decodePacket(const uint8_t packet[], uint32_t length,
+                                  adcCaptureCodec_packet_t *decoded);
+
+// Empties a parser and clears its counters.
+void adcCaptureCodec_parserInit(adcCaptureCodec_parser_t *parser);
+
+// Feeds one received byte. Returns true, with the packet in decoded, when the
+// byte completes a packet that passes its CRC.
+bool adcCaptureCodec_parseByte(adcCaptureCodec_parser_t *parser, uint8_t byte,
+                               adcCaptureCodec_packet_t *decoded);
+
+// Round-trips packets of 1 to ADC_CAPTURE_CODEC_PACKET_SAMPLES samples,
+// escape-heavy ones included, and checks that the parser rejects every
+// single-bit corruption and resynchronizes after junk and false sync
+// patterns. Returns true if everything passed.
+bool adcCaptureCodec_runTest();
+
+#endif /* ADCCAPTURECODEC_H_ */
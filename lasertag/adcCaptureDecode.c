@@ -0,0 +1,132 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host tool that turns the adcCapture stream back into samples.
+//   adcCaptureDecode <serial port, pty or file> <capture file> [sample count]
+// Reads packets until the input ends, sample count samples have been written,
+// or Ctrl-C. The capture file holds one little-endian 16-bit sample per
+// sample index, so sample i is at byte 2 * i; samples the board dropped are
+// written as zeros and reported. A serial port is set to raw mode at
+// ADC_CAPTURE_BAUD_RATE.
+// Built with the emulator build (cmake -DEMU=1), or on its own with
+//   gcc -O2 -o adcCaptureDecode adcCaptureDecode.c adcCaptureCodec.c
+
+#ifdef main
+#undef main // The emulator build renames main() for its own entry point.
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "adcCaptureCodec.h"
+
+#define ADC_CAPTURE_BAUD_RATE_CONSTANT B2000000 // Matches ADC_CAPTURE_BAUD_RATE.
+#define READ_BUFFER_BYTES 4096
+#define SEQUENCE_MODULUS 65536
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// Ends the capture loop on Ctrl-C.
+static void adcCaptureDecode_handleSignal(int signalNumber){
+	(void)signalNumber;
+	stopRequested = 1;
+}
+
+// Puts a serial port or pty into raw mode at the capture baud rate. Leaves
+// anything that is not a terminal alone.
+static void adcCaptureDecode_setupPort(int fileDescriptor){
+	struct termios settings;
+	if(!isatty(fileDescriptor) || tcgetattr(fileDescriptor, &settings) != 0)
+		return;
+	cfmakeraw(&settings);
+	cfsetispeed(&settings, ADC_CAPTURE_BAUD_RATE_CONSTANT);
+	cfsetospeed(&settings, ADC_CAPTURE_BAUD_RATE_CONSTANT);
+	settings.c_cc[VMIN] = 1;
+	settings.c_cc[VTIME] = 0;
+	tcsetattr(fileDescriptor, TCSANOW, &settings);
+}
+
+// Writes count little-endian samples to the capture file.
+static void adcCaptureDecode_writeSamples(FILE *output, const uint16_t samples[], uint32_t count){
+	for(uint32_t i = 0; i < count; ++i){
+		fputc(samples[i] & BYTE_MASK, output);
+		fputc(samples[i] >> BITS_PER_BYTE, output);
+	}
+}
+
+int main(int argc, char *argv[]){
+	if(argc < 3){
+		fprintf(stderr, "usage: %s <serial port, pty or file> <capture file> [sample count]\n", argv[0]);
+		return 1;
+	}
+	int input = open(argv[1], O_RDONLY | O_NOCTTY);
+	if(input < 0){
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+	FILE *output = fopen(argv[2], "wb");
+	if(output == NULL){
+		fprintf(stderr, "cannot create %s\n", argv[2]);
+		return 1;
+	}
+	uint32_t sampleLimit = (argc > 3) ? strtoul(argv[3], NULL, 0) : UINT32_MAX;
+	adcCaptureDecode_setupPort(input);
+	signal(SIGINT, adcCaptureDecode_handleSignal);
+
+	static adcCaptureCodec_parser_t parser;
+	static adcCaptureCodec_packet_t packet;
+	static const uint16_t zeros[ADC_CAPTURE_CODEC_PACKET_SAMPLES];
+	uint8_t buffer[READ_BUFFER_BYTES];
+	uint32_t samplesWritten = 0, packetCount = 0, droppedSamples = 0, lostPackets = 0, lateSamples = 0;
+	uint32_t nextSequence = 0;
+	adcCaptureCodec_parserInit(&parser);
+	while(!stopRequested && samplesWritten < sampleLimit){
+		ssize_t length = read(input, buffer, sizeof(buffer));
+		if(length < 0 && errno == EINTR)
+			continue;
+		if(length <= 0)	//End of file, or the other end of the pty closed
+			break;
+		for(ssize_t i = 0; i < length && samplesWritten < sampleLimit; ++i){
+			if(!adcCaptureCodec_parseByte(&parser, buffer[i], &packet))
+				continue;
+			if(packetCount > 0)
+				lostPackets += (packet.sequence - nextSequence) % SEQUENCE_MODULUS;
+			nextSequence = (packet.sequence + 1) % SEQUENCE_MODULUS;
+			packetCount++;
+			if(packet.sampleIndex < samplesWritten){	//Overlaps what is written already
+				lateSamples += packet.sampleCount;
+				continue;
+			}
+			while(samplesWritten < packet.sampleIndex){	//Zero-fill whatever never arrived
+				uint32_t gap = packet.sampleIndex - samplesWritten;
+				gap = (gap < ADC_CAPTURE_CODEC_PACKET_SAMPLES) ? gap : ADC_CAPTURE_CODEC_PACKET_SAMPLES;
+				adcCaptureDecode_writeSamples(output, zeros, gap);
+				samplesWritten += gap;
+				droppedSamples += gap;
+			}
+			uint32_t count = packet.sampleCount;
+			if(count > sampleLimit - samplesWritten)
+				count = sampleLimit - samplesWritten;
+			adcCaptureDecode_writeSamples(output, packet.samples, count);
+			samplesWritten += count;
+		}
+	}
+	fclose(output);
+	close(input);
+	printf("%u packets, %u samples written, %u zero-filled\n", packetCount, samplesWritten, droppedSamples);
+	printf("%u packet(s) lost on the link, %u CRC error(s), %u byte(s) skipped, %u out-of-order samples ignored\n",
+		lostPackets, parser.crcErrorCount, parser.skippedByteCount, lateSamples);
+	return 0;
+}
@@ -0,0 +1,339 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include "amp.h"
+#include "detector.h"
+#include "hitLedTimer.h"
+#include "interCore.h"
+#include "testUtils.h"
+#include "timebase.h"
+
+// States of the second core, kept in the shared memory.
+#define AMP_STATE_STOPPED 0
+#define AMP_STATE_STARTING 1
+#define AMP_STATE_RUNNING 2
+#define AMP_STATE_FAILED 3
+
+#define ADC_RING_INDEX_MASK (AMP_ADC_RING_BLOCKS - 1)
+#define MILLISECONDS_PER_SECOND 1000
+
+// Sensor 0 of one block published by isr_function().
+typedef struct {
+	uint32_t frameCount;
+	isr_AdcValue_t samples[ISR_ADC_BLOCK_FRAMES];
+} amp_adcBlock_t;
+
+// Single-producer single-consumer ring of ADC blocks, laid out like an
+// interCore_channel_t but with slots a block long. The head is written only
+// by amp_publishAdcBlock() and the tail only by the second core.
+typedef struct {
+	_Atomic uint32_t head __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+	_Atomic uint32_t droppedCount; // Producer-owned, blocks that found the ring full.
+	_Atomic uint32_t tail __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+	amp_adcBlock_t blocks[AMP_ADC_RING_BLOCKS] __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+} amp_adcRing_t;
+
+// Everything the two cores share. CPU0 fills in the settings before it starts
+// the second core and only touches the flags and the receiving ends after.
+typedef struct {
+	interCore_channel_t hitChannel;
+	interCore_channel_t powerChannel;
+	amp_adcRing_t adcRing;
+	_Atomic uint32_t state;
+	atomic_bool stopRequested;
+	_Atomic uint32_t detectorPasses;
+	bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+	uint32_t fudgeFactor;
+} amp_shared_t;
+
+_Static_assert(sizeof(amp_shared_t) <= INTERCORE_SHARED_BYTES, "amp_shared_t does not fit in the shared memory");
+_Static_assert(sizeof(amp_powerVector_t) <= INTERCORE_SLOT_BYTES, "amp_powerVector_t does not fit in a channel slot");
+
+static uint32_t ampFudgeFactor = 0;
+static bool ampIgnoreAll = false;
+
+// Sets the fudge-factor index used by the second core, 0 for the default.
+void amp_setFudgeFactorIndex(uint32_t factor){
+	ampFudgeFactor = factor;
+}
+
+// Empties the channels and the ADC ring, starts the detector on the second
+// core and hooks the ring into isr_function()'s buffer.
+bool amp_start(bool ignoredFrequencies[]){
+	interCore_init();
+	amp_shared_t *shared = interCore_getSharedMemory();
+	interCore_channelInit(&shared->hitChannel);
+	interCore_channelInit(&shared->powerChannel);
+	atomic_store(&shared->adcRing.head, 0);
+	atomic_store(&shared->adcRing.tail, 0);
+	atomic_store(&shared->adcRing.droppedCount, 0);
+	atomic_store(&shared->stopRequested, false);
+	atomic_store(&shared->detectorPasses, 0);
+	atomic_store(&shared->state, AMP_STATE_STARTING);
+	for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; ++i)
+		shared->ignoredFrequencies[i] = ignoredFrequencies[i];
+	shared->fudgeFactor = ampFudgeFactor;
+	ampIgnoreAll = false;
+	if(!interCore_startSecondCore(amp_runDetectorCore)){
+		atomic_store(&shared->state, AMP_STATE_STOPPED);
+		return false;
+	}
+	uint64_t deadline = timebase_readTicks() + (uint64_t)AMP_START_TIMEOUT_MS * TIMEBASE_TICKS_PER_SECOND / MILLISECONDS_PER_SECOND;
+	while(atomic_load(&shared->state) == AMP_STATE_STARTING){
+		uint32_t expected = AMP_STATE_STARTING;
+		if(timebase_readTicks() > deadline && atomic_compare_exchange_strong(&shared->state, &expected, AMP_STATE_FAILED)){
+			printf("amp_start(): the second core did not start within %d ms.\n", AMP_START_TIMEOUT_MS);	//It gives up if it starts later
+			break;
+		}
+		interCore_relax();
+	}
+	if(atomic_load(&shared->state) != AMP_STATE_RUNNING){
+		interCore_waitForSecondCore();
+		return false;
+	}
+	isr_ctxSetAdcBlockListener(isr_getDefault(), amp_publishAdcBlock);
+	return true;
+}
+
+// Unhooks the ADC ring, tells the second core to stop and waits for it.
+void amp_stop(){
+	amp_shared_t *shared = interCore_getSharedMemory();
+	isr_ctxSetAdcBlockListener(isr_getDefault(), NULL);
+	atomic_store(&shared->stopRequested, true);
+	while(atomic_load(&shared->state) == AMP_STATE_RUNNING)
+		interCore_relax();
+	interCore_waitForSecondCore();
+}
+
+// Copies sensor 0 of a block into the ADC ring, or counts a drop, and takes
+// the block.
+bool amp_publishAdcBlock(const isr_AdcBlock_t *block, uint16_t sensorCount){
+	amp_adcRing_t *ring = &((amp_shared_t *)interCore_getSharedMemory())->adcRing;
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if(head - tail >= AMP_ADC_RING_BLOCKS){
+		atomic_fetch_add_explicit(&ring->droppedCount, 1, memory_order_relaxed);
+		return true;
+	}
+	amp_adcBlock_t *slot = &ring->blocks[head & ADC_RING_INDEX_MASK];
+	for(uint32_t i = 0; i < block->frameCount; ++i)
+		slot->samples[i] = block->data[i * sensorCount];
+	slot->frameCount = block->frameCount;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);	//Samples before the new head
+	return true;
+}
+
+// Takes the oldest hit event that is not ignored and starts the hit LED.
+bool amp_receiveHit(amp_hitEvent_t *event){
+	amp_shared_t *shared = interCore_getSharedMemory();
+	while(interCore_receive(&shared->hitChannel, event, sizeof(*event))){
+		if(!ampIgnoreAll){
+			hitLedTimer_start();
+			return true;
+		}
+	}
+	return false;
+}
+
+// Ignores every hit event while flagValue is true.
+void amp_ignoreAllHits(bool flagValue){
+	ampIgnoreAll = flagValue;
+}
+
+// Takes the oldest power vector.
+bool amp_receivePowerVector(amp_powerVector_t *vector){
+	amp_shared_t *shared = interCore_getSharedMemory();
+	return interCore_receive(&shared->powerChannel, vector, sizeof(*vector));
+}
+
+// Copies the channel and detector counters into stats.
+void amp_getStats(amp_stats_t *stats){
+	amp_shared_t *shared = interCore_getSharedMemory();
+	uint32_t dropped = atomic_load_explicit(&shared->adcRing.droppedCount, memory_order_relaxed);
+	stats->adcBlocksSent = atomic_load_explicit(&shared->adcRing.head, memory_order_acquire) + dropped;
+	stats->adcBlocksDropped = dropped;
+	stats->hitEventsSent = interCore_getSentCount(&shared->hitChannel);
+	stats->hitEventsDropped = interCore_getDroppedCount(&shared->hitChannel);
+	stats->powerVectorsSent = interCore_getSentCount(&shared->powerChannel);
+	stats->powerVectorsDropped = interCore_getDroppedCount(&shared->powerChannel);
+	stats->detectorPasses = atomic_load(&shared->detectorPasses);
+}
+
+// Copies the oldest block in the ADC ring into adcSource and frees its slot.
+// Returns false if the ring is empty. Second core only.
+static bool amp_receiveAdcBlock(amp_adcRing_t *ring, isr_t *adcSource){
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if(atomic_load_explicit(&ring->head, memory_order_acquire) == tail){
+		return false;
+	}
+	amp_adcBlock_t *slot = &ring->blocks[tail & ADC_RING_INDEX_MASK];
+	for(uint32_t i = 0; i < slot->frameCount; ++i)
+		isr_ctxAddDataToAdcBuffer(adcSource, slot->samples[i]);
+	isr_ctxFlushAdcBuffer(adcSource);	//A short block stays one block
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);	//Done reading before the slot is reused
+	return true;
+}
+
+// Body of the second core: runs the detector on the blocks from the ADC ring
+// until amp_stop(), publishing a hit event for every hit and a power vector
+// every few blocks.
+void amp_runDetectorCore(){
+	interCore_init();
+	amp_shared_t *shared = interCore_getSharedMemory();
+	isr_t *adcSource = isr_create();
+	detector_t *d = (adcSource == NULL) ? NULL : detector_create(adcSource);
+	if(d == NULL){
+		isr_destroy(adcSource);
+		atomic_store(&shared->state, AMP_STATE_FAILED);
+		return;
+	}
+	detector_ctxInit(d, shared->ignoredFrequencies);
+	if(shared->fudgeFactor != 0)
+		detector_ctxSetFudgeFactorIndex(d, shared->fudgeFactor);
+	amp_hitEvent_t hit = {.sequence = 0};
+	amp_powerVector_t vector = {.sequence = 0};
+	uint32_t lockoutEnd = 0;
+	bool lockedOut = false;
+	uint32_t nextVector = AMP_POWER_VECTOR_PERIOD_BLOCKS;
+	uint32_t expected = AMP_STATE_STARTING;
+	if(!atomic_compare_exchange_strong(&shared->state, &expected, AMP_STATE_RUNNING)){	//amp_start() gave up on us
+		detector_destroy(d);
+		isr_destroy(adcSource);
+		return;
+	}
+	while(!atomic_load_explicit(&shared->stopRequested, memory_order_acquire)){
+		if(!amp_receiveAdcBlock(&shared->adcRing, adcSource)){
+			interCore_relax();
+			continue;
+		}
+		detector_ctxRun(d);
+		atomic_fetch_add_explicit(&shared->detectorPasses, 1, memory_order_relaxed);
+		uint32_t block = isr_ctxGetAdcBlocksPublished(adcSource);
+		if(lockedOut && (int32_t)(block - lockoutEnd) >= 0){	//The instance reports nothing more until cleared
+			detector_ctxClearHit(d);
+			lockedOut = false;
+		}
+		if(!lockedOut && detector_ctxHitDetected(d)){
+			hit.adcBlock = block;
+			hit.frequencyNumber = detector_ctxGetFrequencyNumberOfLastHit(d);
+			interCore_send(&shared->hitChannel, &hit, sizeof(hit));
+			hit.sequence++;
+			lockoutEnd = block + AMP_LOCKOUT_BLOCKS;
+			lockedOut = true;
+		}
+		if((int32_t)(block - nextVector) >= 0){
+			vector.adcBlock = block;
+			detector_ctxGetCurrentPowerValues(d, vector.power);
+			interCore_send(&shared->powerChannel, &vector, sizeof(vector));
+			vector.sequence++;
+			nextVector = block + AMP_POWER_VECTOR_PERIOD_BLOCKS;
+		}
+	}
+	detector_destroy(d);
+	isr_destroy(adcSource);
+	atomic_store(&shared->state, AMP_STATE_STOPPED);
+}
+
+// Runs the two-core split against a real-time producer thread feeding
+// amp_publishAdcBlock() while the main thread plays CPU0, stalling once, and
+// checks that nothing was lost.
+#define LOAD_TEST_MILLISECONDS 3000
+#define LOAD_TEST_STALL_START_MS 1000
+#define LOAD_TEST_STALL_MS 400 // Longer than the 256 ms the ADC blocks hold.
+#define LOAD_TEST_LOOP_MS 5 // Game-loop period when not stalled.
+#define LOAD_TEST_FREQUENCY 4
+#define LOAD_TEST_FUDGE_FACTOR 100
+void amp_runLoadTest(){
+#ifdef ZYBO_BOARD
+	printf("amp_runLoadTest() needs threads, run it in the emulator build.\n");
+#else
+	printf("Starting amp_runLoadTest()\n");
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	isr_t *adcSource = isr_create();	//Stands in for isr_function()'s buffer on CPU0
+	if(adcSource == NULL){
+		printf("FAILED to allocate the ADC buffer\n");
+		return;
+	}
+	isr_ctxSetAdcBlockListener(adcSource, amp_publishAdcBlock);
+	amp_setFudgeFactorIndex(LOAD_TEST_FUDGE_FACTOR);
+	if(!amp_start(ignored)){
+		printf("FAILED to start the second core\n");
+		amp_setFudgeFactorIndex(0);
+		isr_destroy(adcSource);
+		return;
+	}
+	testUtils_adcProducer_t producer;
+	if(!testUtils_startAdcProducer(&producer, adcSource, LOAD_TEST_FREQUENCY, LOAD_TEST_MILLISECONDS)){
+		printf("FAILED to start the producer thread\n");
+		amp_stop();
+		amp_setFudgeFactorIndex(0);
+		isr_destroy(adcSource);
+		return;
+	}
+	amp_shared_t *shared = interCore_getSharedMemory();
+	amp_hitEvent_t hit;
+	amp_powerVector_t vector;
+	uint32_t hitCount = 0, vectorCount = 0, outOfOrder = 0, wrongFrequency = 0, shortLockouts = 0;
+	uint32_t previousHitBlock = 0, maxQueuedVectors = 0;
+	uint32_t elapsedMs = 0;
+	bool stalled = false;
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while(!testUtils_adcProducerDone(&producer)){
+		uint32_t queued = interCore_channelElementCount(&shared->powerChannel);
+		if(queued > maxQueuedVectors)
+			maxQueuedVectors = queued;
+		while(amp_receiveHit(&hit)){
+			if(hit.sequence != hitCount)
+				outOfOrder++;
+			if(hit.frequencyNumber != LOAD_TEST_FREQUENCY)
+				wrongFrequency++;
+			if(hitCount > 0 && hit.adcBlock - previousHitBlock < AMP_LOCKOUT_BLOCKS)
+				shortLockouts++;
+			previousHitBlock = hit.adcBlock;
+			hitCount++;
+		}
+		while(amp_receivePowerVector(&vector)){
+			if(vector.sequence != vectorCount)
+				outOfOrder++;
+			vectorCount++;
+		}
+		uint32_t sleepMs = LOAD_TEST_LOOP_MS;
+		if(!stalled && elapsedMs >= LOAD_TEST_STALL_START_MS){	//Stand in for a long busy-wait on CPU0
+			sleepMs = LOAD_TEST_STALL_MS;
+			stalled = true;
+		}
+		elapsedMs += sleepMs;
+		testUtils_addMilliseconds(&next, sleepMs);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	testUtils_joinAdcProducer(&producer);
+	while(atomic_load(&shared->adcRing.tail) != atomic_load(&shared->adcRing.head))	//Let the second core catch up
+		interCore_relax();
+	amp_stop();
+	while(amp_receiveHit(&hit))
+		hitCount++;
+	while(amp_receivePowerVector(&vector))
+		vectorCount++;
+	amp_stats_t stats;
+	amp_getStats(&stats);
+	isr_AdcBlockStats_t adcStats;
+	isr_ctxGetAdcBlockStats(adcSource, &adcStats);
+	printf("%u ms of ADC blocks, CPU0 stalled %u ms: %u ADC overrun(s), %u blocks sent, %u dropped, %u detector passes\n",
+		LOAD_TEST_MILLISECONDS, LOAD_TEST_STALL_MS, adcStats.overrunCount, stats.adcBlocksSent, stats.adcBlocksDropped,
+		stats.detectorPasses);
+	printf("  hits: %u sent, %u dropped, %u received; power vectors: %u sent, %u dropped, %u received (at most %u queued)\n",
+		stats.hitEventsSent, stats.hitEventsDropped, hitCount, stats.powerVectorsSent, stats.powerVectorsDropped,
+		vectorCount, maxQueuedVectors);
+	printf("  %u out of order, %u on the wrong frequency, %u inside the lockout\n", outOfOrder, wrongFrequency, shortLockouts);
+	bool passed = adcStats.overrunCount == 0 && stats.adcBlocksSent == LOAD_TEST_MILLISECONDS
+		&& stats.adcBlocksDropped == 0 && stats.detectorPasses == LOAD_TEST_MILLISECONDS
+		&& stats.hitEventsDropped == 0 && stats.powerVectorsDropped == 0
+		&& hitCount == stats.hitEventsSent && vectorCount == stats.powerVectorsSent
+		&& hitCount >= LOAD_TEST_MILLISECONDS / AMP_LOCKOUT_BLOCKS - 1
+		&& outOfOrder == 0 && wrongFrequency == 0 && shortLockouts == 0;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	amp_setFudgeFactorIndex(0);
+	isr_destroy(adcSource);
+	printf("Completed amp_runLoadTest()\n");
+#endif
+}
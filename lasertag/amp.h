@@ -0,0 +1,125 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef AMP_H_
+#define AMP_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "filter.h"
+#include "isr.h"
+
+// Asymmetric dual-core mode. The second core (CPU1 on the board, a thread on
+// a host) runs a detector instance on the ADC blocks from isr_function() and
+// publishes what it finds to CPU0 over two interCore channels: a hit event
+// for every hit, and a power vector every AMP_POWER_VECTOR_PERIOD_BLOCKS
+// blocks for the histogram. CPU0 keeps the game logic, display and sound and
+// only polls the channels, so a long busy-wait on CPU0 no longer starves the
+// detector; the events simply wait in the channel.
+// The samples reach the second core through a ring of ADC blocks in the same
+// shared memory: amp_start() hooks amp_publishAdcBlock() into isr_function()'s
+// buffer, which copies sensor 0 of each block into the ring, and the second
+// core copies them into an ADC buffer of its own that its detector reads.
+// Nothing in the second core points into CPU0's memory.
+// The second core applies the lockout itself: after a hit it reports nothing
+// more for AMP_LOCKOUT_BLOCKS blocks, the 500 ms of lockoutTimer. Times in
+// the messages are ADC block counts, one per millisecond.
+// Status: host-only. The emulator build runs the second core as a thread and
+// amp_runLoadTest() passes there. The board side compiles, but this tree has
+// no CPU1 image (BSP, linker script at INTERCORE_CPU1_IMAGE_ENTRY, a main()
+// calling amp_runDetectorCore()), so on the board amp_start() times out and
+// returns false. It has never run on a ZYBO.
+
+#define AMP_LOCKOUT_BLOCKS 500
+#define AMP_POWER_VECTOR_PERIOD_BLOCKS 10 // 100 vectors per second.
+#define AMP_ADC_RING_BLOCKS 64 // Power of two, 64 ms of sensor-0 samples.
+#define AMP_START_TIMEOUT_MS 100 // How long amp_start() waits for the second core.
+
+// One hit, as seen by the second core.
+typedef struct {
+  uint32_t sequence; // Counts every hit published, a gap means one was dropped.
+  uint32_t adcBlock; // Blocks published when the hit was decided.
+  uint16_t frequencyNumber;
+} amp_hitEvent_t;
+
+// Power of every player frequency at one moment.
+typedef struct {
+  uint32_t sequence;
+  uint32_t adcBlock;
+  double power[FILTER_FREQUENCY_COUNT];
+} amp_powerVector_t;
+
+// Channel and detector counters.
+typedef struct {
+  uint32_t adcBlocksSent;
+  uint32_t adcBlocksDropped; // Found the ADC ring full.
+  uint32_t hitEventsSent;
+  uint32_t hitEventsDropped; // Found the hit channel full.
+  uint32_t powerVectorsSent;
+  uint32_t powerVectorsDropped; // Found the power channel full.
+  uint32_t detectorPasses; // detector_ctxRun() calls on the second core.
+} amp_stats_t;
+
+/*******************************************************
+ ****************** CPU0 side **************************
+ ******************************************************/
+
+// Sets the detector fudge-factor index used by the second core, 0 for the
+// detector's default. Takes effect at the next amp_start().
+void amp_setFudgeFactorIndex(uint32_t factor);
+
+// Empties the channels and the ADC ring, starts the detector on the second
+// core, ignoring the frequencies marked true, and hooks amp_publishAdcBlock()
+// into isr_getDefault(). Returns once it is running, or false if it could not
+// start or did not answer within AMP_START_TIMEOUT_MS.
+bool amp_start(bool ignoredFrequencies[]);
+
+// Unhooks amp_publishAdcBlock(), tells the second core to stop and waits for
+// it.
+void amp_stop();
+
+// The isr_AdcBlockListener_t that feeds the second core: copies sensor 0 of
+// the block into the ADC ring, or counts a drop if it is full, and takes the
+// block, since CPU0 runs no detector in this mode. amp_start() hooks it into
+// isr_getDefault(); tests hook it into an ADC buffer of their own.
+bool amp_publishAdcBlock(const isr_AdcBlock_t *block, uint16_t sensorCount);
+
+// Takes the oldest hit event. Returns false if there is none. Starts the hit
+// LED for every hit it returns. While hits are ignored the events are taken
+// and thrown away.
+bool amp_receiveHit(amp_hitEvent_t *event);
+
+// Ignores every hit event while flagValue is true, e.g. while invincible.
+void amp_ignoreAllHits(bool flagValue);
+
+// Takes the oldest power vector. Returns false if there is none.
+bool amp_receivePowerVector(amp_powerVector_t *vector);
+
+// Copies the channel and detector counters into stats.
+void amp_getStats(amp_stats_t *stats);
+
+/*******************************************************
+ ****************** Second-core side *******************
+ ******************************************************/
+
+// Body of the second core: runs the detector until amp_stop(). The CPU1
+// image's main() calls this.
+void amp_runDetectorCore();
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+// Runs the two-core split against a producer thread feeding real-time ADC
+// blocks through amp_publishAdcBlock() while the main thread plays CPU0,
+// stalling once for longer than the ADC blocks can hold. Prints the counters
+// and checks that no block, hit or power vector was lost. Host (emulator)
+// builds only.
+void amp_runLoadTest();
+
+#endif /* AMP_H_ */
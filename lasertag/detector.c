@@ -17,40 +17,121 @@
 #define ZERO_TO_NINE_ARRAY {0,1,2,3,4,5,6,7,8,9}
 #define DEFAULT_FUDGE_FACTOR 3000
 
-static uint32_t fudgeFactor;
-static bool ignoredFreq[NUM_PLAYERS];
 static bool interruptsNotEnabled = true;
-static bool ignoreSelf = false;
-static bool ignoreAll = false;
-static bool detectorTestMode = false;
-static uint8_t detectorInvocationCount = 0;
-static bool forceComputePower = true;
-static bool detector_hitDetectedFlag = false;
-static uint32_t detector_hitArray[NUM_PLAYERS];
-static uint16_t lastHitNumber;
-static double testPowerData[10];
+
+// Everything one detector remembers between calls.
+struct detector_t {
+	filter_t *filter;
+	isr_t *adcSource;
+	bool usesBoardTimers; // Only the default instance uses the lockout/hit-LED timers and transmitter.
+	uint32_t fudgeFactor;
+	bool ignoredFreq[NUM_PLAYERS];
+	bool ignoreSelf;
+	bool ignoreAll;
+	bool testMode;
+	double testPowerData[NUM_PLAYERS];
+	uint8_t invocationCount;
+	bool forceComputePower;
+	bool hitDetectedFlag;
+	uint32_t hitArray[NUM_PLAYERS];
+	uint16_t lastHitNumber;
+	uint16_t activeSensorCount;
+	bool sharedFilterState;
+	detector_sensorCombine_t sensorCombine;
+	uint16_t sensorVotesRequired;
+	bool lockoutSuspendEnabled;
+	bool filtersSuspended;
+	uint32_t resyncHoldoffCount; // Decimated samples before the next decision.
+	uint16_t decisionInterval;
+	uint16_t decisionPhase; // Decimated samples since the last decision.
+	bool shotCodeEnabled;
+	shotCode_status_t shotCodeStatus;
+	shotCode_payload_t shotPayload;
+	uint16_t shotWord;
+	uint16_t shotSnapshotsToWait; // Until the frame of the last hit is in.
+	uint16_t snapshotPhase; // Decimated samples since the last snapshot.
+	uint16_t snapshotNewest;
+	uint16_t snapshotCount;
+	double powerSnapshots[DETECTOR_SHOT_SNAPSHOT_COUNT][NUM_PLAYERS];
+};
+
+static detector_t defaultDetector = {
+	.usesBoardTimers = true,
+	.activeSensorCount = 1,
+	.sensorCombine = detector_combineMax_e,
+	.sensorVotesRequired = 1,
+	.decisionInterval = DETECTOR_DEFAULT_DECISION_INTERVAL};
+
+// Returns the default instance, attached to the default filter and ADC buffer.
+static detector_t *detector_default(){
+	defaultDetector.filter = filter_getDefault();
+	defaultDetector.adcSource = isr_getDefault();
+	return &defaultDetector;
+}
+
+// Allocates a detector with its own filter that reads from adcSource.
+detector_t *detector_create(isr_t *adcSource){
+	detector_t *d = calloc(1, sizeof(detector_t));
+	if(d == NULL){
+		return NULL;
+	}
+	d->filter = filter_create();
+	if(d->filter == NULL){
+		free(d);
+		return NULL;
+	}
+	d->adcSource = adcSource;
+	d->activeSensorCount = 1;
+	d->sensorCombine = detector_combineMax_e;
+	d->sensorVotesRequired = 1;
+	d->decisionInterval = DETECTOR_DEFAULT_DECISION_INTERVAL;
+	return d;
+}
+
+// Frees a detector returned by detector_create() and its filter.
+void detector_destroy(detector_t *d){
+	filter_destroy(d->filter);
+	free(d);
+}
+
+// Returns the instance used by the functions that take no detector_t.
+detector_t *detector_getDefault(){
+	return detector_default();
+}
 
 // Always have to init things.
 // bool array is indexed by frequency number, array location set for true to
 // ignore, false otherwise. This way you can ignore multiple frequencies.
-void detector_init(bool ignoredFrequencies[]){
-    hitLedTimer_enable();
-    filter_init();
-	for(uint8_t i = 0; i < NUM_PLAYERS; ++i){	//Initialize ignoredFrequencies and detector_hitArray
-		ignoredFreq[i] = ignoredFrequencies[i];
-		detector_hitArray[i] = 0;
+void detector_ctxInit(detector_t *d, bool ignoredFrequencies[]){
+	if(d->usesBoardTimers){
+		hitLedTimer_enable();
+	}
+	filter_ctxInit(d->filter);
+	d->activeSensorCount = isr_ctxGetSensorCount(d->adcSource);
+	if(d->activeSensorCount > 1 && !d->sharedFilterState){
+		filter_ctxInitSensors(d->filter, d->activeSensorCount);
 	}
-	detectorInvocationCount = 0;
-	forceComputePower = true;
-	detector_hitDetectedFlag = false;
-	fudgeFactor = DEFAULT_FUDGE_FACTOR;
-	ignoreSelf = true;
+	for(uint8_t i = 0; i < NUM_PLAYERS; ++i){	//Initialize ignoredFrequencies and the hit counts
+		d->ignoredFreq[i] = ignoredFrequencies[i];
+		d->hitArray[i] = 0;
+	}
+	d->invocationCount = 0;
+	d->forceComputePower = true;
+	d->filtersSuspended = false;
+	d->resyncHoldoffCount = 0;
+	d->decisionPhase = 0;
+	d->hitDetectedFlag = false;
+	d->shotCodeStatus = shotCode_none_e;
+	d->snapshotPhase = 0;
+	d->snapshotCount = 0;
+	d->fudgeFactor = DEFAULT_FUDGE_FACTOR;
+	d->ignoreSelf = d->usesBoardTimers;
 }
 
 // This function uses an insertion sort method to take the array of power values and sort them in descending order. It get input from the aray and the number of elements in that array.
 void insertion_sort(double powerValuesArray[], uint8_t indiciesArray[], uint8_t numElements){
     uint8_t i;
-	uint8_t j;
+	int16_t j; // Signed so the scan can stop below index 0.
 	for(i = 1; i < numElements; ++i){	//For each element, move it to the proper location
 		j = i - 1;
 		while(j >= 0 && powerValuesArray[indiciesArray[j]] < powerValuesArray[i]){	//Move backwards until the right spot is found
@@ -62,102 +143,414 @@ void insertion_sort(double powerValuesArray[], uint8_t indiciesArray[], uint8_t
 	}
 }
 
-// Runs the entire detector: decimating fir-filter, iir-filters,
-// power-computation, hit-detection. if interruptsNotEnabled = true, interrupts
-// are not running. If interruptsNotEnabled = true you can pop values from the
-// ADC queue without disabling interrupts. If interruptsNotEnabled = false, do
-// the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC queue.
-// 3. re-enable interrupts if interruptsNotEnabled was true.
-// if ignoreSelf == true, ignore hits that are detected on your frequency.
-// Your frequency is simply the frequency indicated by the slide switches
-void detector(bool interruptsCurrentlyEnabled){
-	uint32_t elementCount = isr_adcBufferElementCount();
-	for(uint32_t i = 0; i < elementCount; ++i){	//Process each element in the ADC buffer
-		if(interruptsCurrentlyEnabled){
-			interrupts_disableArmInts();
-		}
-		uint32_t rawAdcValue = isr_removeDataFromAdcBuffer();
-		if(interruptsCurrentlyEnabled){
-			interrupts_enableArmInts();
-		}
-        double scaledAdcValue = ADC_DOUBLE_SCALAR * ((double)rawAdcValue) / (ADC_MAX_VALUE) - 1;
-        detectorInvocationCount++;
-		filter_addNewInput(scaledAdcValue);
-		if(detectorInvocationCount == NUM_PLAYERS){	//If we have added 10 items, run the filters
-            detectorInvocationCount = 0;
-			filter_firFilter();            
+// Scales a raw ADC value into the range -1.0 to 1.0.
+static double detector_scaleAdcValue(uint32_t rawAdcValue){
+	return ADC_DOUBLE_SCALAR * ((double)rawAdcValue) / (ADC_MAX_VALUE) - 1;
+}
+
+// Runs the hit-detection algorithm on one set of power values. Returns true and
+// sets *frequencyNumber if the strongest frequency is a hit that is not ignored.
+static bool detector_decide(detector_t *d, double powerValues[], uint8_t *frequencyNumber){
+	uint8_t indicies[NUM_PLAYERS] = ZERO_TO_NINE_ARRAY;
+	insertion_sort(powerValues, indicies, NUM_PLAYERS);
+	double threshold = powerValues[indicies[MEDIAN_ELEMENT]] * d->fudgeFactor;
+
+	uint8_t maxIndex = indicies[0];
+	double max = powerValues[maxIndex];
+	*frequencyNumber = maxIndex;
+	return max > threshold && !d->ignoredFreq[maxIndex] && !d->ignoreAll && !(d->ignoreSelf && maxIndex == transmitter_getFrequencyNumber());
+}
+
+// Combines the per-sensor power values. Max-combining decides on the strongest
+// power any sensor saw on each frequency, voting needs sensorVotesRequired
+// sensors, or every active sensor if there are fewer, to detect a hit on the
+// same frequency.
+static bool detector_decideSensors(detector_t *d, uint8_t *frequencyNumber){
+	double powerValues[NUM_PLAYERS];
+	if(d->sensorCombine == detector_combineMax_e){
+		filter_ctxGetCurrentSensorPowerValues(d->filter, 0, powerValues);
+		for(uint16_t s = 1; s < d->activeSensorCount; ++s){
+			double sensorPower[NUM_PLAYERS];
+			filter_ctxGetCurrentSensorPowerValues(d->filter, s, sensorPower);
+			for(uint8_t k = 0; k < NUM_PLAYERS; ++k){
+				if(sensorPower[k] > powerValues[k])
+					powerValues[k] = sensorPower[k];
+			}
+		}
+		return detector_decide(d, powerValues, frequencyNumber);
+	}
+	uint16_t votesRequired = (d->sensorVotesRequired < d->activeSensorCount) ? d->sensorVotesRequired : d->activeSensorCount;
+	uint16_t votes[NUM_PLAYERS] = {0};
+	for(uint16_t s = 0; s < d->activeSensorCount; ++s){
+		uint8_t sensorHit;
+		filter_ctxGetCurrentSensorPowerValues(d->filter, s, powerValues);
+		if(detector_decide(d, powerValues, &sensorHit) && ++votes[sensorHit] >= votesRequired){
+			*frequencyNumber = sensorHit;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns the 100 kHz ticks left on the lockout and hit-LED timers, whichever
+// is longer. The timers count 1 kHz slow-lane ticks. Instances without the
+// board timers are never locked out by them.
+static uint32_t detector_getLockoutTicksRemaining(detector_t *d){
+	if(!d->usesBoardTimers){
+		return 0;
+	}
+	uint32_t remainingTicks = lockoutTimer_getRemainingTicks();
+	if(hitLedTimer_getRemainingTicks() > remainingTicks){
+		remainingTicks = hitLedTimer_getRemainingTicks();
+	}
+	return remainingTicks * ISR_SLOW_LANE_DIVIDER;
+}
+
+// Returns true if the filter stages can be skipped for this decimated sample
+// because no decision will be made before the lockout ends. When leaving the
+// suspended state the filters restart from rest, and if the timers will not
+// cover the resync time any more, decisions are held off until they do.
+static bool detector_filtersSuspended(detector_t *d){
+	if(!d->lockoutSuspendEnabled || d->shotCodeStatus == shotCode_pending_e){
+		return false;
+	}
+	uint32_t remainingTicks = detector_getLockoutTicksRemaining(d);
+	if(d->ignoreAll || remainingTicks > DETECTOR_RESYNC_TICKS){
+		d->filtersSuspended = true;
+		return true;
+	}
+	if(d->filtersSuspended){	//Resume: restart the IIR filters and refill the power window
+		d->filtersSuspended = false;
+		if(d->activeSensorCount > 1 && !d->sharedFilterState){
+			filter_ctxInitSensors(d->filter, d->activeSensorCount);
+		}
+		else{
+			filter_ctxResetIirState(d->filter);
+		}
+		d->forceComputePower = true;
+		d->snapshotCount = 0;
+		d->resyncHoldoffCount = (DETECTOR_RESYNC_TICKS - remainingTicks) / FILTER_FIR_DECIMATION_FACTOR;
+	}
+	return false;
+}
+
+// Restarts the filters from rest at a gap in the ADC stream so no filter or
+// power window mixes samples from both sides of it, and holds decisions off
+// until the power window holds only samples from after the gap.
+static void detector_restartAfterGap(detector_t *d){
+	filter_ctxInit(d->filter);
+	if(d->activeSensorCount > 1 && !d->sharedFilterState){
+		filter_ctxInitSensors(d->filter, d->activeSensorCount);
+	}
+	d->invocationCount = 0;
+	d->forceComputePower = true;
+	d->decisionPhase = 0;
+	d->resyncHoldoffCount = DETECTOR_RESYNC_TICKS / FILTER_FIR_DECIMATION_FACTOR;
+	d->snapshotCount = 0;	//The power restarts, so older snapshots no longer line up
+	if(d->shotCodeStatus == shotCode_pending_e){
+		d->shotCodeStatus = shotCode_invalid_e;
+	}
+}
+
+// Copies the last DETECTOR_SHOT_SNAPSHOT_COUNT power snapshots of one
+// frequency, oldest first. Slots from before the first snapshot repeat the
+// oldest one.
+void detector_ctxGetShotSnapshots(detector_t *d, uint16_t frequencyNumber, double powerSnapshots[]){
+	uint16_t index = d->snapshotNewest + DETECTOR_SHOT_SNAPSHOT_COUNT - d->snapshotCount + 1;
+	for(uint16_t i = 0; i < DETECTOR_SHOT_SNAPSHOT_COUNT; ++i){
+		uint16_t missing = DETECTOR_SHOT_SNAPSHOT_COUNT - d->snapshotCount;
+		uint16_t slot = (i < missing) ? index : index + i - missing;
+		powerSnapshots[i] = d->powerSnapshots[slot % DETECTOR_SHOT_SNAPSHOT_COUNT][frequencyNumber];
+	}
+}
+
+// Snapshots the power of every frequency once every
+// SHOTCODE_SNAPSHOT_DECIMATED_SAMPLES decimated samples, and decodes the
+// payload of the last hit once its frame is in. With the sensor bank, the
+// power of all sensors is added up, which keeps it an energy.
+static void detector_snapshotPower(detector_t *d, bool useSensorBank){
+	if(++d->snapshotPhase < SHOTCODE_SNAPSHOT_DECIMATED_SAMPLES){
+		return;
+	}
+	d->snapshotPhase = 0;
+	d->snapshotNewest = (d->snapshotNewest + 1) % DETECTOR_SHOT_SNAPSHOT_COUNT;
+	double *snapshot = d->powerSnapshots[d->snapshotNewest];
+	if(useSensorBank){
+		filter_ctxGetCurrentSensorPowerValues(d->filter, 0, snapshot);
+		for(uint16_t s = 1; s < d->activeSensorCount; ++s){
+			double sensorPower[NUM_PLAYERS];
+			filter_ctxGetCurrentSensorPowerValues(d->filter, s, sensorPower);
+			for(uint8_t k = 0; k < NUM_PLAYERS; ++k)
+				snapshot[k] += sensorPower[k];
+		}
+	}
+	else{
+		filter_ctxGetCurrentPowerValues(d->filter, snapshot);
+	}
+	if(d->snapshotCount < DETECTOR_SHOT_SNAPSHOT_COUNT){
+		d->snapshotCount++;
+	}
+	if(d->shotCodeStatus == shotCode_pending_e && --d->shotSnapshotsToWait == 0){
+		double powerSnapshots[DETECTOR_SHOT_SNAPSHOT_COUNT];
+		detector_ctxGetShotSnapshots(d, d->lastHitNumber, powerSnapshots);
+		d->shotCodeStatus = shotCode_decode(powerSnapshots, &d->shotWord, &d->shotPayload);
+	}
+}
+
+// Runs one ADC frame through the filters and, once every decimated sample,
+// the hit decision.
+static void detector_processFrame(detector_t *d, const isr_AdcValue_t frame[], bool useSensorBank){
+	if(useSensorBank){
+		double scaledAdcValues[ISR_MAX_SENSOR_COUNT];
+		for(uint16_t s = 0; s < d->activeSensorCount; ++s)
+			scaledAdcValues[s] = detector_scaleAdcValue(frame[s]);
+		filter_ctxAddNewSensorInputs(d->filter, scaledAdcValues);
+	}
+	else{
+		uint32_t frameSum = 0;
+		for(uint16_t s = 0; s < d->activeSensorCount; ++s)
+			frameSum += frame[s];
+		filter_ctxAddNewInput(d->filter, detector_scaleAdcValue(frameSum / d->activeSensorCount));
+	}
+    d->invocationCount++;
+	if(d->invocationCount == NUM_PLAYERS){	//If we have added 10 items, run the filters
+        d->invocationCount = 0;
+		if(detector_filtersSuspended(d)){	//Inputs still go into xQueue so the FIR is ready on resume
+			return;
+		}
+		if(useSensorBank){
+			filter_ctxFirFilterSensors(d->filter, NULL);
 			for(uint8_t j = 0; j < NUM_PLAYERS; ++j){
-				filter_iirFilter(j);
+				filter_ctxIirFilterSensors(d->filter, j);
 			}
 			for(uint8_t j = 0; j < NUM_PLAYERS; ++j){
-				filter_computePower(j, forceComputePower, false);
+				filter_ctxComputeSensorPower(d->filter, j, d->forceComputePower);
 			}
-            forceComputePower = false;
-            if(!lockoutTimer_running() && !hitLedTimer_running() && !detector_hitDetectedFlag) { // Checks if the timers are still running before checking for another hit.
-                //do hit-detection algorithm
-                double powerValues[NUM_PLAYERS];
-				if(!detectorTestMode){
-					filter_getCurrentPowerValues(powerValues);
+		}
+		else{
+			filter_ctxFirFilter(d->filter);
+			for(uint8_t j = 0; j < NUM_PLAYERS; ++j){
+				filter_ctxIirFilter(d->filter, j);
+			}
+			for(uint8_t j = 0; j < NUM_PLAYERS; ++j){
+				filter_ctxComputePower(d->filter, j, d->forceComputePower, false);
+			}
+		}
+        d->forceComputePower = false;
+		if(d->shotCodeEnabled){
+			detector_snapshotPower(d, useSensorBank);
+		}
+		if(d->resyncHoldoffCount > 0){
+			--d->resyncHoldoffCount;
+			return;
+		}
+		if(++d->decisionPhase < d->decisionInterval){	//Power stays exact, only the decision waits
+			return;
+		}
+		d->decisionPhase = 0;
+        if(detector_getLockoutTicksRemaining(d) == 0 && !d->hitDetectedFlag) { // Checks if the timers are still running before checking for another hit.
+            //do hit-detection algorithm
+			uint8_t hitFrequency;
+			bool hit;
+			if(useSensorBank && !d->testMode){
+				hit = detector_decideSensors(d, &hitFrequency);
+			}
+			else{
+				double powerValues[NUM_PLAYERS];	//The test power stands in for every sensor
+				if(!d->testMode){
+					filter_ctxGetCurrentPowerValues(d->filter, powerValues);
 				}
-				else{  
-                    for(uint8_t k = 0; k < NUM_PLAYERS; ++k)
-					    powerValues[k] = testPowerData[k];
+				else{
+					for(uint8_t k = 0; k < NUM_PLAYERS; ++k)
+						powerValues[k] = d->testPowerData[k];
 				}
-				uint8_t indicies[NUM_PLAYERS] = ZERO_TO_NINE_ARRAY;
-				insertion_sort(powerValues, indicies, NUM_PLAYERS);
-				double threshold = powerValues[indicies[MEDIAN_ELEMENT]] * fudgeFactor;
-
-				uint8_t maxIndex = indicies[0];
-				double max = powerValues[maxIndex];			
-                if(max > threshold && !ignoredFreq[maxIndex] && !ignoreAll && !(maxIndex == transmitter_getFrequencyNumber() && ignoreSelf)){	//If a hit was detected and not ignored, start timers and set flag   
-					lastHitNumber = maxIndex;
+				hit = detector_decide(d, powerValues, &hitFrequency);
+			}
+            if(hit){	//If a hit was detected and not ignored, start timers and set flag
+				d->lastHitNumber = hitFrequency;
+				if(d->usesBoardTimers){
 					lockoutTimer_start();
 					hitLedTimer_start();
-                    detector_hitArray[detector_getFrequencyNumberOfLastHit()]++;
-                    detector_hitDetectedFlag = true;
-				}                
-            }
-			
+				}
+                d->hitArray[hitFrequency]++;
+                d->hitDetectedFlag = true;
+				if(d->shotCodeEnabled){	//The frame started up to SHOTCODE_SEARCH_SNAPSHOTS ago
+					d->shotCodeStatus = shotCode_pending_e;
+					d->shotSnapshotsToWait = SHOTCODE_FRAME_SNAPSHOTS + SHOTCODE_TAIL_SNAPSHOTS;
+				}
+			}
+        }
+
+	}
+}
+
+// Runs the entire detector: decimating fir-filter, iir-filters,
+// power-computation, hit-detection. if ignoreSelf == true, ignore hits that
+// are detected on your frequency. Your frequency is simply the frequency
+// indicated by the slide switches
+// With more than one sensor, each ADC buffer element is a frame holding one
+// sample per sensor, which is either averaged into the single filter pipeline
+// (shared filter state) or run through the multi-sensor filter bank.
+// The ISR hands the ADC samples over in blocks, so the blocks published on
+// entry are read in place, whole, without masking interrupts, and each is
+// handed back to the ISR once it has been filtered.
+void detector_ctxRun(detector_t *d){
+	bool useSensorBank = d->activeSensorCount > 1 && !d->sharedFilterState;
+	uint32_t blockCount = isr_ctxAdcBlockCount(d->adcSource);	//Only the blocks published on entry
+	isr_AdcBlock_t block;
+	for(uint32_t b = 0; b < blockCount && isr_ctxPeekAdcBlock(d->adcSource, &block); ++b){	//Process each block in the ADC buffer
+		if(block.discontinuity){
+			detector_restartAfterGap(d);
+		}
+		const isr_AdcValue_t *frame = block.data;
+		for(uint32_t i = 0; i < block.frameCount; ++i){
+			detector_processFrame(d, frame, useSensorBank);
+			frame += d->activeSensorCount;
 		}
+		isr_ctxReleaseAdcBlock(d->adcSource);
 	}
 }
 
 // Returns true if a hit was detected.
-bool detector_hitDetected(){
-    return detector_hitDetectedFlag;
+bool detector_ctxHitDetected(detector_t *d){
+    return d->hitDetectedFlag;
 }
 
 // Returns the frequency number that caused the hit.
-uint16_t detector_getFrequencyNumberOfLastHit(){
-    return lastHitNumber;
+uint16_t detector_ctxGetFrequencyNumberOfLastHit(detector_t *d){
+    return d->lastHitNumber;
 }
 
 // Clear the detected hit once you have accounted for it.
-void detector_clearHit(){
-    detector_hitDetectedFlag = false;
+void detector_ctxClearHit(detector_t *d){
+    d->hitDetectedFlag = false;
 }
 
 // Ignore all hits. Used to provide some limited invincibility in some game
-// modes. The detector will ignore all hits i("%f ", f the flag is true, otherwise will
+// modes. The detector will ignore all hits if the flag is true, otherwise will
 // respond to hits normally.
-void detector_ignoreAllHits(bool flagValue){
-    ignoreAll = flagValue;
+void detector_ctxIgnoreAllHits(detector_t *d, bool flagValue){
+    d->ignoreAll = flagValue;
+}
+
+// Enables or disables lockout-aware duty cycling of the filter stages.
+void detector_ctxSetLockoutSuspend(detector_t *d, bool enable){
+	d->lockoutSuspendEnabled = enable;
+}
+
+// Sets how many decimated samples pass between hit decisions.
+void detector_ctxSetDecisionInterval(detector_t *d, uint16_t decimatedSamples){
+	d->decisionInterval = (decimatedSamples == 0) ? 1 : decimatedSamples;
+	d->decisionPhase = 0;
+}
+
+// Returns the most latency the decision interval can add to a hit, in microseconds.
+uint32_t detector_ctxGetMaxAddedLatencyInUs(detector_t *d){
+	return (d->decisionInterval - 1) * DETECTOR_DECIMATED_SAMPLE_PERIOD_IN_US;
 }
 
 // Get the current hit counts.
 // Copy the current hit counts into the user-provided hitArray
 // using a for-loop.
-void detector_getHitCounts(detector_hitCount_t hitArray[]){
+void detector_ctxGetHitCounts(detector_t *d, detector_hitCount_t hitArray[]){
     for(uint8_t i = 0; i < NUM_PLAYERS; i++)
-        hitArray[i] = detector_hitArray[i];
+        hitArray[i] = d->hitArray[i];
+}
+
+// Copies the power of every player frequency from the instance's filter_t.
+void detector_ctxGetCurrentPowerValues(detector_t *d, double powerValues[]){
+	filter_ctxGetCurrentPowerValues(d->filter, powerValues);
 }
 
 // Allows the fudge-factor index to be set externally from the detector.
 // The actual values for fudge-factors is stored in an array found in detector.c
+void detector_ctxSetFudgeFactorIndex(detector_t *d, uint32_t factor){
+    d->fudgeFactor = factor;
+}
+
+// Configures multi-sensor operation. Takes effect at the next detector_ctxInit().
+void detector_ctxSetSensorMode(detector_t *d, bool sharedFilter, detector_sensorCombine_t combine, uint16_t votesRequired){
+	d->sharedFilterState = sharedFilter;
+	d->sensorCombine = combine;
+	d->sensorVotesRequired = (votesRequired == 0) ? 1 : votesRequired;
+}
+
+// Enables or disables shot-code decoding.
+void detector_ctxSetShotCodeMode(detector_t *d, bool enable){
+	d->shotCodeEnabled = enable;
+	d->shotCodeStatus = shotCode_none_e;
+	d->snapshotCount = 0;
+}
+
+// Returns where the payload of the last hit stands, and the payload if valid.
+shotCode_status_t detector_ctxGetShotPayload(detector_t *d, shotCode_payload_t *payload){
+	if(d->shotCodeStatus == shotCode_valid_e){
+		*payload = d->shotPayload;
+	}
+	return d->shotCodeStatus;
+}
+
+// Returns the code word received with the last hit.
+uint16_t detector_ctxGetShotWord(detector_t *d){
+	return d->shotWord;
+}
+
+// Default-instance versions of the functions above.
+void detector_init(bool ignoredFrequencies[]){
+	detector_ctxInit(detector_default(), ignoredFrequencies);
+}
+
+void detector(bool interruptsCurrentlyEnabled){
+	(void)interruptsCurrentlyEnabled;	//Kept so the game code still builds, see detector.h
+	detector_ctxRun(detector_default());
+}
+
+bool detector_hitDetected(){
+    return defaultDetector.hitDetectedFlag;
+}
+
+uint16_t detector_getFrequencyNumberOfLastHit(){
+    return defaultDetector.lastHitNumber;
+}
+
+void detector_clearHit(){
+    detector_ctxClearHit(&defaultDetector);
+}
+
+void detector_ignoreAllHits(bool flagValue){
+    detector_ctxIgnoreAllHits(&defaultDetector, flagValue);
+}
+
+void detector_setLockoutSuspend(bool enable){
+	detector_ctxSetLockoutSuspend(&defaultDetector, enable);
+}
+
+void detector_setDecisionInterval(uint16_t decimatedSamples){
+	detector_ctxSetDecisionInterval(&defaultDetector, decimatedSamples);
+}
+
+uint32_t detector_getMaxAddedLatencyInUs(){
+	return detector_ctxGetMaxAddedLatencyInUs(&defaultDetector);
+}
+
+void detector_getHitCounts(detector_hitCount_t hitArray[]){
+    detector_ctxGetHitCounts(&defaultDetector, hitArray);
+}
+
 void detector_setFudgeFactorIndex(uint32_t factor){
-    fudgeFactor = factor;
+    detector_ctxSetFudgeFactorIndex(&defaultDetector, factor);
+}
+
+void detector_setSensorMode(bool sharedFilter, detector_sensorCombine_t combine, uint16_t votesRequired){
+	detector_ctxSetSensorMode(&defaultDetector, sharedFilter, combine, votesRequired);
+}
+
+void detector_setShotCodeMode(bool enable){
+	detector_ctxSetShotCodeMode(&defaultDetector, enable);
+}
+
+shotCode_status_t detector_getShotPayload(shotCode_payload_t *payload){
+	return detector_ctxGetShotPayload(&defaultDetector, payload);
 }
 
 // Encapsulate ADC scaling for easier testing.
@@ -171,14 +564,14 @@ double detector_getScaledAdcValue(isr_AdcValue_t adcValue){
 
 // Runs two tests of the detector code. One should register a hit and the other should not.
 void detector_runTest(){
-    detectorTestMode = true;
+    defaultDetector.testMode = true;
 
 	double testPowerData1[10] = {25, 17, 0, 18, 34, 23, 57, 11, 4600, 40};
 	double testPowerData2[10] = {25, 17, 0, 16, 34, 23, 57, 11, 46, 40};
 
 	srand(0);
 	for(uint8_t k = 0; k < NUM_PLAYERS; ++k)
-		testPowerData[k] = testPowerData1[k];
+		defaultDetector.testPowerData[k] = testPowerData1[k];
 	
 	bool ignored[NUM_PLAYERS] = {false, false, false, false, false,false, false, false, false, false};
 	detector_init(ignored);
@@ -206,7 +599,7 @@ void detector_runTest(){
 
 	printf("\nSecond test\n-----------");
 	for(uint8_t k = 0; k < NUM_PLAYERS; ++k)
-		testPowerData[k] = testPowerData2[k];
+		defaultDetector.testPowerData[k] = testPowerData2[k];
 	detector_init(ignored);
     for(uint32_t i = 0; i < 20000; ++i)
         isr_addDataToAdcBuffer(rand() % 2000);
@@ -219,5 +612,6 @@ void detector_runTest(){
 		printf("\nNo hit detected\n");
 	}
 	detector_clearHit();
+	defaultDetector.testMode = false;	//Leave the real filter output to the other tests
 	printf("\nCompleted Detector_RunTest\n");
 }
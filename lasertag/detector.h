@@ -13,24 +13,29 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include "isr.h"
 #include "queue.h"
+#include "shotCode.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 typedef uint16_t detector_hitCount_t;
 
+// How the per-sensor results are combined when more than one sensor is used.
+typedef enum {
+  detector_combineMax_e, // Decide on the strongest power seen by any sensor.
+  detector_combineVote_e // Each sensor decides, hit when enough sensors agree.
+} detector_sensorCombine_t;
+
 // Always have to init things.
 // bool array is indexed by frequency number, array location set for true to
 // ignore, false otherwise. This way you can ignore multiple frequencies.
 void detector_init(bool ignoredFrequencies[]);
 
 // Runs the entire detector: decimating fir-filter, iir-filters,
-// power-computation, hit-detection. if interruptsCurrentlyEnabled = true, interrupts
-// are running. If interruptsCurrentlyEnabled = false you can pop values from the
-// ADC buffer without disabling interrupts. If interruptsCurrentlyEnabled = true,
-// do the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC buffer.
-// 3. re-enable interrupts.
+// power-computation, hit-detection, on the frames in the ADC buffer on entry.
+// The ADC buffer is lock-free, so interrupts are never disabled and
+// interruptsCurrentlyEnabled no longer changes anything.
+// At a block flagged as a discontinuity (ISR_ADC_OVERFLOW_DISCONTINUITY) the
+// filters restart from rest and decisions wait DETECTOR_RESYNC_TICKS.
 // Ignore hits that are detected on the frequencies specified during detector_init().
 // Your own frequency (based on the switches) is a good choice to ignore.
 // Assumption: draining the ADC buffer occurs faster than it can fill.
@@ -50,6 +55,30 @@ void detector_clearHit();
 // respond to hits normally.
 void detector_ignoreAllHits(bool flagValue);
 
+// Lockout-aware duty cycling. When enabled, the FIR/IIR/power stages are
+// suspended while the lockout or hit-LED timers are running, and while all
+// hits are ignored. Processing resumes DETECTOR_RESYNC_TICKS before the timers
+// expire so the power window is refilled with fresh outputs by the time
+// decisions resume. After detector_ignoreAllHits(false) the detector waits the
+// same resync time before it decides again. Disabled by default.
+#define DETECTOR_RESYNC_TICKS                                                  \
+  30000 // 2000-sample power window (20000 ticks) plus IIR settling time.
+void detector_setLockoutSuspend(bool enable);
+
+// Hit decisions (threshold, sort, compare) normally run after every decimated
+// sample, 10,000 times a second. Power values change very little from one
+// decimated sample to the next, so the decision can run every N decimated
+// samples instead. The power values are still updated on every sample, so a
+// decision always sees exact power; a hit is reported at most N - 1 decimated
+// samples, (N - 1) * 100 us, later than with N = 1.
+#define DETECTOR_DEFAULT_DECISION_INTERVAL 1
+#define DETECTOR_DECIMATED_SAMPLE_PERIOD_IN_US 100 // 10 kHz after decimation.
+void detector_setDecisionInterval(uint16_t decimatedSamples);
+
+// Returns the most latency the decision interval can add to a hit, in
+// microseconds.
+uint32_t detector_getMaxAddedLatencyInUs();
+
 // Get the current hit counts.
 // Copy the current hit counts into the user-provided hitArray
 // using a for-loop.
@@ -59,9 +88,86 @@ void detector_getHitCounts(detector_hitCount_t hitArray[]);
 // The actual values for fudge-factors is stored in an array found in detector.c
 void detector_setFudgeFactorIndex(uint32_t factor);
 
+// Configures multi-sensor operation (see isr_setSensorCount()).
+// If sharedFilterState is true the sensors are averaged into one filter
+// pipeline, otherwise every sensor gets its own filter state and the results
+// are combined as selected by combine. votesRequired is only used by
+// detector_combineVote_e; more votes than active sensors means every sensor
+// must agree. Takes effect at the next detector_init().
+void detector_setSensorMode(bool sharedFilterState,
+                            detector_sensorCombine_t combine,
+                            uint16_t votesRequired);
+
+// Shot codes (see shotCode.h). When enabled, the detector snapshots the power
+// of every frequency SHOTCODE_SNAPSHOTS_PER_SLOT times a slot and, once the
+// frame of a hit is in, 200 ms after the hit is reported, decodes the
+// payload the shot carried. Hits are still reported as soon as they are
+// decided. While a payload is pending the filters keep running even if
+// lockout suspension is on. Works for single shots, not continuous
+// transmission. Disabled by default.
+#define DETECTOR_SHOT_SNAPSHOT_COUNT                                           \
+  (SHOTCODE_DECODE_SNAPSHOTS + 1) // Power snapshots kept for shot codes.
+void detector_setShotCodeMode(bool enable);
+
+// Returns where the payload of the last hit stands and, if it is
+// shotCode_valid_e, stores the payload. detector_clearHit() leaves it alone;
+// the next hit replaces it.
+shotCode_status_t detector_getShotPayload(shotCode_payload_t *payload);
+
 // Encapsulate ADC scaling for easier testing.
 double detector_getScaledAdcValue(isr_AdcValue_t adcValue);
 
+/*******************************************************
+ ****************** Detector Instances *****************
+ ******************************************************/
+
+// All detector state lives in a detector_t, so several detectors can run in
+// one process. The functions above use a default instance that reads the ADC
+// buffer filled by isr_function(), uses the default filter_t and drives the
+// lockout and hit-LED timers. Each has a detector_ctxXxx() version that takes
+// the instance to use; detector_ctxRun() leaves out the unused
+// interruptsCurrentlyEnabled argument. Instances made with detector_create()
+// get their own filter_t and never touch the timers or the transmitter, so any
+// number of them can run on different threads; they only stop reporting hits
+// until detector_ctxClearHit() is called.
+typedef struct detector_t detector_t;
+
+// Allocates a detector that reads from adcSource. Call detector_ctxInit()
+// before using it. Returns NULL if out of memory.
+detector_t *detector_create(isr_t *adcSource);
+
+// Frees an instance returned by detector_create().
+void detector_destroy(detector_t *d);
+
+// Returns the instance used by the functions that take no detector_t.
+detector_t *detector_getDefault();
+
+void detector_ctxInit(detector_t *d, bool ignoredFrequencies[]);
+void detector_ctxRun(detector_t *d);
+bool detector_ctxHitDetected(detector_t *d);
+uint16_t detector_ctxGetFrequencyNumberOfLastHit(detector_t *d);
+void detector_ctxClearHit(detector_t *d);
+void detector_ctxIgnoreAllHits(detector_t *d, bool flagValue);
+void detector_ctxSetLockoutSuspend(detector_t *d, bool enable);
+void detector_ctxSetDecisionInterval(detector_t *d, uint16_t decimatedSamples);
+uint32_t detector_ctxGetMaxAddedLatencyInUs(detector_t *d);
+void detector_ctxGetHitCounts(detector_t *d, detector_hitCount_t hitArray[]);
+// Copies the power of every player frequency from the instance's filter_t.
+void detector_ctxGetCurrentPowerValues(detector_t *d, double powerValues[]);
+void detector_ctxSetFudgeFactorIndex(detector_t *d, uint32_t factor);
+void detector_ctxSetSensorMode(detector_t *d, bool sharedFilterState,
+                               detector_sensorCombine_t combine,
+                               uint16_t votesRequired);
+void detector_ctxSetShotCodeMode(detector_t *d, bool enable);
+shotCode_status_t detector_ctxGetShotPayload(detector_t *d,
+                                             shotCode_payload_t *payload);
+// Returns the code word received with the last hit, valid or not.
+uint16_t detector_ctxGetShotWord(detector_t *d);
+// Copies the last DETECTOR_SHOT_SNAPSHOT_COUNT power snapshots of one
+// frequency, oldest first, the input shotCode_decode() gets after a hit.
+void detector_ctxGetShotSnapshots(detector_t *d, uint16_t frequencyNumber,
+                                  double powerSnapshots[]);
+
 /*******************************************************
  ****************** Test Routines **********************
  ******************************************************/
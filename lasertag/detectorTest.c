@@ -0,0 +1,720 @@
+#include "detectorTest.h"
+#include "detector.h"
+#include "filter.h"
+#include "hitLedTimer.h"
+#include "lockoutTimer.h"
+#include "interrupts.h"
+#include "intervalTimer.h"
+#include "transmitter.h"
+#include "isr.h"
+#include "testUtils.h"
+#include "timebase.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef ZYBO_BOARD
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#else
+#include <pthread.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+#define ADC_MAX_VALUE 4095.0
+
+// Measures detector throughput with 1, 2 and 4 sensors. Each sensor sees a
+// square wave at a different player frequency plus some noise. Interrupts are
+// expected to be off so the ADC buffer only contains the test frames.
+#define BENCHMARK_FRAME_COUNT 20000
+#define BENCHMARK_PASS_COUNT 5
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_2
+void detectorTest_runMultiSensorBenchmark(){
+	const uint16_t sensorCounts[] = {1, 2, 4};
+	double singleSensorSeconds = 0.0;
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	printf("Starting detectorTest_runMultiSensorBenchmark()\n");
+	intervalTimer_init(BENCHMARK_TIMER);
+	for(uint8_t k = 0; k < sizeof(sensorCounts) / sizeof(sensorCounts[0]); ++k){
+		isr_setSensorCount(sensorCounts[k]);
+		detector_init(ignored);
+		intervalTimer_reset(BENCHMARK_TIMER);
+		for(uint8_t pass = 0; pass < BENCHMARK_PASS_COUNT; ++pass){
+			for(uint32_t i = 0; i < BENCHMARK_FRAME_COUNT; ++i){	//Fill the ADC buffer with test frames
+				isr_AdcValue_t frame[ISR_MAX_SENSOR_COUNT];
+				for(uint16_t s = 0; s < sensorCounts[k]; ++s){
+					uint16_t period = filter_frequencyTickTable[s];
+					frame[s] = ((i % period) < period / 2) ? TEST_UTILS_HIGH_VALUE : TEST_UTILS_LOW_VALUE;
+					frame[s] += rand() % TEST_UTILS_NOISE;
+				}
+				isr_addFrameToAdcBuffer(frame);
+			}
+			intervalTimer_start(BENCHMARK_TIMER);
+			detector(false);
+			intervalTimer_stop(BENCHMARK_TIMER);
+			detector_clearHit();
+		}
+		double seconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+		if(sensorCounts[k] == 1){
+			singleSensorSeconds = seconds;
+		}
+		printf("%d sensor(s): %f seconds, %f frames/second, %f x single-sensor cost\n", sensorCounts[k], seconds,
+			BENCHMARK_FRAME_COUNT * BENCHMARK_PASS_COUNT / seconds, seconds / singleSensorSeconds);
+	}
+	isr_setSensorCount(ISR_DEFAULT_SENSOR_COUNT);
+	detector_init(ignored);
+	printf("Completed detectorTest_runMultiSensorBenchmark()\n");
+}
+
+// Plays a noisy square wave on one player frequency through the detector while
+// ticking the lockout and hit-LED timers by hand, the way isr_function() would.
+// A lockout is started at the beginning. Returns the power values right after
+// the lockout ends and the time spent in detector().
+#define LOCKOUT_TEST_TICK_COUNT 100000
+#define LOCKOUT_TEST_BATCH_SIZE 1000
+#define LOCKOUT_TEST_FREQUENCY 3
+#define LOCKOUT_TEST_SEED 390
+static double detectorTest_runLockoutScenario(bool suspend, double powerValues[]){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	bool captured = false;
+	uint16_t period = filter_frequencyTickTable[LOCKOUT_TEST_FREQUENCY];
+	srand(LOCKOUT_TEST_SEED);
+	detector_setLockoutSuspend(suspend);
+	detector_init(ignored);
+	isr_init();
+	intervalTimer_reset(BENCHMARK_TIMER);
+	lockoutTimer_start();
+	hitLedTimer_start();
+	for(uint32_t tick = 0; tick < LOCKOUT_TEST_TICK_COUNT; ++tick){
+		if(tick % ISR_SLOW_LANE_DIVIDER == 0){
+			lockoutTimer_tick();
+			hitLedTimer_tick();
+		}
+		isr_AdcValue_t sample = ((tick % period) < period / 2) ? TEST_UTILS_HIGH_VALUE : TEST_UTILS_LOW_VALUE;
+		isr_addDataToAdcBuffer(sample + rand() % TEST_UTILS_NOISE);
+		if(tick % LOCKOUT_TEST_BATCH_SIZE == LOCKOUT_TEST_BATCH_SIZE - 1){
+			intervalTimer_start(BENCHMARK_TIMER);
+			detector(false);
+			intervalTimer_stop(BENCHMARK_TIMER);
+			if(!captured && !lockoutTimer_running() && !hitLedTimer_running()){	//First batch after the lockout
+				filter_getCurrentPowerValues(powerValues);
+				captured = true;
+			}
+		}
+	}
+	detector_clearHit();
+	detector_setLockoutSuspend(false);
+	return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Compares lockout suspension against continuous processing.
+void detectorTest_runLockoutSuspendTest(){
+	double continuousPower[FILTER_FREQUENCY_COUNT];
+	double suspendedPower[FILTER_FREQUENCY_COUNT];
+	printf("Starting detectorTest_runLockoutSuspendTest()\n");
+	intervalTimer_init(BENCHMARK_TIMER);
+	double continuousSeconds = detectorTest_runLockoutScenario(false, continuousPower);
+	double suspendedSeconds = detectorTest_runLockoutScenario(true, suspendedPower);
+	double maxPower = 0.0;
+	double maxError = 0.0;
+	for(uint8_t k = 0; k < FILTER_FREQUENCY_COUNT; ++k){
+		if(continuousPower[k] > maxPower)
+			maxPower = continuousPower[k];
+	}
+	for(uint8_t k = 0; k < FILTER_FREQUENCY_COUNT; ++k){
+		double error = continuousPower[k] - suspendedPower[k];
+		if(error < 0)
+			error = -error;
+		if(error / maxPower > maxError)
+			maxError = error / maxPower;
+	}
+	printf("Continuous: %f seconds, suspended: %f seconds, saved %5.2f%%\n", continuousSeconds, suspendedSeconds,
+		100.0 * (continuousSeconds - suspendedSeconds) / continuousSeconds);
+	printf("Largest power difference after lockout: %f%% of the strongest channel\n", 100.0 * maxError);
+	printf("Completed detectorTest_runLockoutSuspendTest()\n");
+}
+
+// Plays noise, then a noisy square wave on one player frequency, feeding the
+// detector one decimated sample at a time and ticking the timers the way
+// isr_function() would. Returns the number of ticks from
+// the start of the pulse until the hit is reported.
+#define CADENCE_TEST_PULSE_START_TICK 50000
+#define CADENCE_TEST_TICK_COUNT 100000
+#define CADENCE_TEST_TIMING_TICK_COUNT 200000
+#define CADENCE_TEST_FREQUENCY 5
+#define CADENCE_TEST_FUDGE_FACTOR 100
+static uint32_t detectorTest_measureHitLatency(){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	uint16_t period = filter_frequencyTickTable[CADENCE_TEST_FREQUENCY];
+	srand(LOCKOUT_TEST_SEED);
+	while(lockoutTimer_running() || hitLedTimer_running()){	//Let a lockout left over from an earlier test expire
+		lockoutTimer_tick();
+		hitLedTimer_tick();
+	}
+	detector_init(ignored);
+	detector_setFudgeFactorIndex(CADENCE_TEST_FUDGE_FACTOR);
+	isr_init();
+	for(uint32_t tick = 0; tick < CADENCE_TEST_TICK_COUNT; ++tick){
+		if(tick % ISR_SLOW_LANE_DIVIDER == 0){
+			lockoutTimer_tick();
+			hitLedTimer_tick();
+		}
+		isr_AdcValue_t sample = TEST_UTILS_LOW_VALUE;
+		if(tick >= CADENCE_TEST_PULSE_START_TICK && (tick % period) < period / 2){
+			sample = TEST_UTILS_HIGH_VALUE;
+		}
+		isr_addDataToAdcBuffer(sample + rand() % TEST_UTILS_NOISE);
+		if(tick % FILTER_FIR_DECIMATION_FACTOR == FILTER_FIR_DECIMATION_FACTOR - 1){
+			isr_flushAdcBuffer();	//Hand over each decimation period, not each whole block
+			detector(false);
+			if(detector_hitDetected()){
+				detector_clearHit();
+				return tick - CADENCE_TEST_PULSE_START_TICK;
+			}
+		}
+	}
+	return CADENCE_TEST_TICK_COUNT;
+}
+
+// Measures detector run-time and hit latency at several decision intervals.
+// Run-time is measured with all hits ignored so every decision is made.
+void detectorTest_runDecisionIntervalBenchmark(){
+	const uint16_t intervals[] = {1, 2, 5, 10, 20, 50};
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	printf("Starting detectorTest_runDecisionIntervalBenchmark()\n");
+	intervalTimer_init(BENCHMARK_TIMER);
+	for(uint8_t k = 0; k < sizeof(intervals) / sizeof(intervals[0]); ++k){
+		detector_setDecisionInterval(intervals[k]);
+		uint32_t latencyTicks = detectorTest_measureHitLatency();
+		detector_init(ignored);
+		isr_init();
+		detector_ignoreAllHits(true);
+		intervalTimer_reset(BENCHMARK_TIMER);
+		for(uint32_t tick = 0; tick < CADENCE_TEST_TIMING_TICK_COUNT; ++tick){
+			isr_addDataToAdcBuffer(TEST_UTILS_LOW_VALUE + rand() % TEST_UTILS_NOISE);
+			if(tick % LOCKOUT_TEST_BATCH_SIZE == LOCKOUT_TEST_BATCH_SIZE - 1){
+				intervalTimer_start(BENCHMARK_TIMER);
+				detector(false);
+				intervalTimer_stop(BENCHMARK_TIMER);
+			}
+		}
+		detector_ignoreAllHits(false);
+		printf("Decision every %d samples: %f seconds, hit latency %d us (bound +%d us)\n", intervals[k],
+			intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER), latencyTicks * 10, detector_getMaxAddedLatencyInUs());
+	}
+	detector_setDecisionInterval(DETECTOR_DEFAULT_DECISION_INTERVAL);
+	printf("Completed detectorTest_runDecisionIntervalBenchmark()\n");
+}
+
+// Compares detector_init(), which now zeros the existing filter queues, with
+// pushing a zero into every queue slot the way filter_init() used to (that also
+// called queue_init() every time, which is not timed here).
+#define RESET_BENCHMARK_PASS_COUNT 100
+#define RESET_BENCHMARK_TICKS_PER_US 0.1 // ADC samples per microsecond at 100 kHz.
+void detectorTest_runResetBenchmark(){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	printf("Starting detectorTest_runResetBenchmark()\n");
+	intervalTimer_init(BENCHMARK_TIMER);
+	detector_init(ignored);
+	intervalTimer_reset(BENCHMARK_TIMER);
+	intervalTimer_start(BENCHMARK_TIMER);
+	for(uint16_t pass = 0; pass < RESET_BENCHMARK_PASS_COUNT; ++pass){
+		filter_fillQueue(filter_getXQueue(), 0.0);
+		filter_fillQueue(filter_getYQueue(), 0.0);
+		for(uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; ++j){
+			filter_fillQueue(filter_getZQueue(j), 0.0);
+			filter_fillQueue(filter_getIirOutputQueue(j), 0.0);
+		}
+	}
+	intervalTimer_stop(BENCHMARK_TIMER);
+	double fillUs = 1e6 * intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER) / RESET_BENCHMARK_PASS_COUNT;
+	intervalTimer_reset(BENCHMARK_TIMER);
+	intervalTimer_start(BENCHMARK_TIMER);
+	for(uint16_t pass = 0; pass < RESET_BENCHMARK_PASS_COUNT; ++pass){
+		detector_init(ignored);
+	}
+	intervalTimer_stop(BENCHMARK_TIMER);
+	double resetUs = 1e6 * intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER) / RESET_BENCHMARK_PASS_COUNT;
+	printf("Filling every queue slot: %f us (%d ADC samples arrive meanwhile)\n", fillUs, (int)(fillUs * RESET_BENCHMARK_TICKS_PER_US));
+	printf("detector_init(): %f us (%d ADC samples arrive meanwhile), %f x faster\n", resetUs,
+		(int)(resetUs * RESET_BENCHMARK_TICKS_PER_US), fillUs / resetUs);
+	printf("Completed detectorTest_runResetBenchmark()\n");
+}
+
+// Counts L1 data cache refills: PMU event counter 0 on the board,
+// perf_event_open() on a Linux host. Elsewhere, or where the host has no
+// hardware counters, detectorTest_openCacheCounter() returns false.
+#define CACHE_BENCHMARK_SAMPLE_COUNT 20000 // Decimated samples, two seconds of input.
+#define CACHE_BENCHMARK_EVICT_BYTES (64 * 1024) // Twice the Cortex-A9 L1 data cache.
+#define CACHE_BENCHMARK_EVICT_STRIDE 32
+#define CACHE_BENCHMARK_MAX_LINES 1024
+#define PMU_EVENT_L1D_REFILL 0x03
+#define PMU_EVENT_COUNTER 0
+#define PMCNTEN_EVENT_COUNTER_0 0x1
+static const uint16_t cacheBenchmarkLineSizes[] = {32, 64}; // Cortex-A9, most hosts.
+#define CACHE_BENCHMARK_LINE_SIZE_COUNT (sizeof(cacheBenchmarkLineSizes) / sizeof(cacheBenchmarkLineSizes[0]))
+static uint8_t cacheBenchmarkEvictBuffer[CACHE_BENCHMARK_EVICT_BYTES];
+#if !defined(ZYBO_BOARD) && defined(__linux__)
+static int cacheCounterFd = -1;
+#endif
+
+// Starts counting L1 data cache refills. Returns false if there is no counter.
+static bool detectorTest_openCacheCounter(){
+#ifdef ZYBO_BOARD
+	timebase_init();	//Enables the PMU without resetting the cycle counter
+	mtcp(XREG_CP15_EVENT_CNTR_SEL, PMU_EVENT_COUNTER);
+	mtcp(XREG_CP15_EVENT_TYPE_SEL, PMU_EVENT_L1D_REFILL);
+	mtcp(XREG_CP15_COUNT_ENABLE_SET, PMCNTEN_EVENT_COUNTER_0);
+	return true;
+#elif defined(__linux__)
+	struct perf_event_attr attr = {0};
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	cacheCounterFd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	return cacheCounterFd >= 0;
+#else
+	return false;
+#endif
+}
+
+// Returns the running L1 data cache refill count.
+static uint64_t detectorTest_readCacheCounter(){
+#ifdef ZYBO_BOARD
+	mtcp(XREG_CP15_EVENT_CNTR_SEL, PMU_EVENT_COUNTER);
+	return mfcp(XREG_CP15_PERF_MONITOR_COUNT);
+#elif defined(__linux__)
+	uint64_t count = 0;
+	if(read(cacheCounterFd, &count, sizeof(count)) != sizeof(count))
+		return 0;
+	return count;
+#else
+	return 0;
+#endif
+}
+
+// Stops counting.
+static void detectorTest_closeCacheCounter(){
+#if !defined(ZYBO_BOARD) && defined(__linux__)
+	close(cacheCounterFd);
+	cacheCounterFd = -1;
+#endif
+}
+
+// Adds the cache lines of lineBytes bytes that [start, start + byteCount)
+// covers to lines, unless already there. Returns the new line count.
+static uint32_t detectorTest_addCacheLines(uintptr_t lines[], uint32_t lineCount, const void *start, size_t byteCount, uint16_t lineBytes){
+	uintptr_t first = (uintptr_t)start / lineBytes;
+	uintptr_t last = ((uintptr_t)start + byteCount - 1) / lineBytes;
+	for(uintptr_t line = first; line <= last && lineCount < CACHE_BENCHMARK_MAX_LINES; ++line){
+		uint32_t i = 0;
+		while(i < lineCount && lines[i] != line)
+			i++;
+		if(i == lineCount)
+			lines[lineCount++] = line;
+	}
+	return lineCount;
+}
+
+// Returns how many cache lines of lineBytes bytes hold the state every
+// decimated sample reads: the control fields of each filter queue (everything
+// in queue_t before the name) and the x, y and z data.
+static uint32_t detectorTest_countHotCacheLines(uint16_t lineBytes){
+	static uintptr_t lines[CACHE_BENCHMARK_MAX_LINES];
+	uint32_t lineCount = 0;
+	queue_t *dataQueues[] = {filter_getXQueue(), filter_getYQueue()};
+	for(uint16_t i = 0; i < 2; ++i){
+		lineCount = detectorTest_addCacheLines(lines, lineCount, dataQueues[i], offsetof(queue_t, name), lineBytes);
+		lineCount = detectorTest_addCacheLines(lines, lineCount, dataQueues[i]->data, dataQueues[i]->size * sizeof(queue_data_t), lineBytes);
+	}
+	for(uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; ++j){
+		queue_t *z = filter_getZQueue(j);
+		lineCount = detectorTest_addCacheLines(lines, lineCount, z, offsetof(queue_t, name), lineBytes);
+		lineCount = detectorTest_addCacheLines(lines, lineCount, z->data, z->size * sizeof(queue_data_t), lineBytes);
+		lineCount = detectorTest_addCacheLines(lines, lineCount, filter_getIirOutputQueue(j), offsetof(queue_t, name), lineBytes);
+	}
+	return lineCount;
+}
+
+// Runs the filter pipeline on the default filter, with the caches cleared of
+// filter state before every decimated sample the way the rest of the game loop
+// clears them, and prints the cache lines its hot state spans and the L1 data
+// cache refills and time per decimated sample.
+void detectorTest_runCacheBenchmark(){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	printf("Starting detectorTest_runCacheBenchmark()\n");
+	detector_init(ignored);
+	for(uint16_t i = 0; i < CACHE_BENCHMARK_LINE_SIZE_COUNT; ++i)
+		printf("Hot filter state: %u lines of %u bytes\n", detectorTest_countHotCacheLines(cacheBenchmarkLineSizes[i]), cacheBenchmarkLineSizes[i]);
+	bool counting = detectorTest_openCacheCounter();
+	uint64_t refills = 0;
+	uint32_t seed = 1;
+	intervalTimer_init(BENCHMARK_TIMER);
+	intervalTimer_reset(BENCHMARK_TIMER);
+	for(uint32_t sample = 0; sample < CACHE_BENCHMARK_SAMPLE_COUNT; ++sample){
+		for(uint32_t i = 0; i < CACHE_BENCHMARK_EVICT_BYTES; i += CACHE_BENCHMARK_EVICT_STRIDE)
+			cacheBenchmarkEvictBuffer[i]++;
+		uint64_t startCount = detectorTest_readCacheCounter();
+		intervalTimer_start(BENCHMARK_TIMER);
+		for(uint16_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; ++i){
+			filter_addNewInput((double)(testUtils_random(&seed) % TEST_UTILS_NOISE) / ADC_MAX_VALUE);
+		}
+		filter_firFilter();
+		for(uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; ++j){
+			filter_iirFilter(j);
+			filter_computePower(j, false, false);
+		}
+		intervalTimer_stop(BENCHMARK_TIMER);
+		refills += detectorTest_readCacheCounter() - startCount;
+	}
+	double sampleUs = 1e6 * intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER) / CACHE_BENCHMARK_SAMPLE_COUNT;
+	if(counting){
+		printf("%f L1 data cache refills, %f us per decimated sample\n", (double)refills / CACHE_BENCHMARK_SAMPLE_COUNT, sampleUs);
+		detectorTest_closeCacheCounter();
+	}
+	else
+		printf("L1 data cache refills: unavailable, %f us per decimated sample\n", sampleUs);
+	detector_init(ignored);
+	printf("Completed detectorTest_runCacheBenchmark()\n");
+}
+
+// Each job drives one detector instance with a noisy square wave on its own
+// player frequency and counts the hits it reports.
+#define INSTANCE_BENCHMARK_MAX_INSTANCES 64
+#define INSTANCE_BENCHMARK_TICK_COUNT 400000
+#define INSTANCE_BENCHMARK_BATCH_SIZE 10000
+#define INSTANCE_BENCHMARK_FUDGE_FACTOR 100
+typedef struct {
+	detector_t *detector;
+	isr_t *adcSource;
+	uint16_t frequency;
+	uint32_t hitCount;
+	uint32_t wrongHitCount;
+} detectorTest_benchmarkJob_t;
+
+// Runs one job. rand() is not re-entrant, so each job has its own generator.
+static void *detectorTest_runBenchmarkJob(void *arg){
+	detectorTest_benchmarkJob_t *job = arg;
+	uint32_t seed = job->frequency + 1;
+	for(uint32_t tick = 0; tick < INSTANCE_BENCHMARK_TICK_COUNT; ++tick){
+		isr_ctxAddDataToAdcBuffer(job->adcSource, testUtils_squareWaveSample(tick, job->frequency, &seed));
+		if(tick % INSTANCE_BENCHMARK_BATCH_SIZE == INSTANCE_BENCHMARK_BATCH_SIZE - 1){
+			detector_ctxRun(job->detector);
+			if(detector_ctxHitDetected(job->detector)){
+				job->hitCount++;
+				if(detector_ctxGetFrequencyNumberOfLastHit(job->detector) != job->frequency)
+					job->wrongHitCount++;
+				detector_ctxClearHit(job->detector);
+			}
+		}
+	}
+	return NULL;
+}
+
+// Frees the instances of the first jobCount jobs, skipping any not allocated.
+static void detectorTest_freeBenchmarkJobs(detectorTest_benchmarkJob_t jobs[], uint16_t jobCount){
+	for(uint16_t i = 0; i < jobCount; ++i){
+		if(jobs[i].detector != NULL)
+			detector_destroy(jobs[i].detector);
+		isr_destroy(jobs[i].adcSource);
+	}
+}
+
+// Runs instanceCount jobs at once, one thread each (one after another on the
+// board, which has no threads). Returns the elapsed time in seconds and false
+// in *isolated if any instance reported a frequency it was not sent. Returns
+// a negative time if the instances could not be allocated.
+static double detectorTest_runBenchmarkJobs(uint16_t instanceCount, bool *isolated){
+	detectorTest_benchmarkJob_t jobs[INSTANCE_BENCHMARK_MAX_INSTANCES];
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	for(uint16_t i = 0; i < instanceCount; ++i){
+		jobs[i].adcSource = isr_create();
+		jobs[i].detector = (jobs[i].adcSource == NULL) ? NULL : detector_create(jobs[i].adcSource);
+		if(jobs[i].detector == NULL){
+			detectorTest_freeBenchmarkJobs(jobs, i + 1);
+			return -1;
+		}
+		detector_ctxInit(jobs[i].detector, ignored);
+		detector_ctxSetFudgeFactorIndex(jobs[i].detector, INSTANCE_BENCHMARK_FUDGE_FACTOR);
+		jobs[i].frequency = i % FILTER_FREQUENCY_COUNT;
+		jobs[i].hitCount = 0;
+		jobs[i].wrongHitCount = 0;
+	}
+	intervalTimer_reset(BENCHMARK_TIMER);
+	intervalTimer_start(BENCHMARK_TIMER);
+#ifdef ZYBO_BOARD
+	for(uint16_t i = 0; i < instanceCount; ++i)
+		detectorTest_runBenchmarkJob(&jobs[i]);
+#else
+	pthread_t threads[INSTANCE_BENCHMARK_MAX_INSTANCES];
+	for(uint16_t i = 0; i < instanceCount; ++i)
+		pthread_create(&threads[i], NULL, detectorTest_runBenchmarkJob, &jobs[i]);
+	for(uint16_t i = 0; i < instanceCount; ++i)
+		pthread_join(threads[i], NULL);
+#endif
+	intervalTimer_stop(BENCHMARK_TIMER);
+	*isolated = true;
+	for(uint16_t i = 0; i < instanceCount; ++i){
+		if(jobs[i].hitCount == 0 || jobs[i].wrongHitCount != 0)
+			*isolated = false;
+	}
+	detectorTest_freeBenchmarkJobs(jobs, instanceCount);
+	return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Runs one detector instance, then instanceCount instances on as many threads,
+// and prints the throughput of each and whether every instance only heard its
+// own frequency.
+void detectorTest_runInstanceBenchmark(uint16_t instanceCount){
+	bool isolated;
+	if(instanceCount < 1 || instanceCount > INSTANCE_BENCHMARK_MAX_INSTANCES){
+		printf("detectorTest_runInstanceBenchmark(): %d instances is not supported.\n", instanceCount);
+		return;
+	}
+	printf("Starting detectorTest_runInstanceBenchmark()\n");
+	intervalTimer_init(BENCHMARK_TIMER);
+	double singleSeconds = detectorTest_runBenchmarkJobs(1, &isolated);
+	if(singleSeconds < 0){
+		printf("detectorTest_runInstanceBenchmark(): out of memory for 1 instance.\n");
+		return;
+	}
+	printf("1 instance: %f seconds, %f samples/second, isolated: %s\n", singleSeconds,
+		INSTANCE_BENCHMARK_TICK_COUNT / singleSeconds, isolated ? "yes" : "no");
+	double seconds = detectorTest_runBenchmarkJobs(instanceCount, &isolated);
+	if(seconds < 0){
+		printf("detectorTest_runInstanceBenchmark(): out of memory for %d instances.\n", instanceCount);
+		return;
+	}
+	printf("%d instances: %f seconds, %f samples/second, %f x single-instance throughput, isolated: %s\n",
+		instanceCount, seconds, (double)INSTANCE_BENCHMARK_TICK_COUNT * instanceCount / seconds,
+		singleSeconds * instanceCount / seconds, isolated ? "yes" : "no");
+	printf("Completed detectorTest_runInstanceBenchmark()\n");
+}
+
+#ifndef ZYBO_BOARD
+// Runs the game loop against a producer thread under one overflow policy,
+// stalling once for longer than the blocks can hold. Prints the handoff
+// counters and whether they match the stall.
+#define HANDOFF_TEST_MILLISECONDS 2000
+#define HANDOFF_TEST_STALL_START_MS 1000
+#define HANDOFF_TEST_STALL_MS 400 // Longer than the 256 ms the blocks hold.
+#define HANDOFF_TEST_LOOP_MS 5 // Game-loop period when not stalled.
+#define HANDOFF_TEST_FREQUENCY 4
+static void detectorTest_runHandoffScenario(isr_AdcOverflowPolicy_t policy, const char *policyName){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	isr_t *adcSource = isr_create();
+	detector_t *d = (adcSource == NULL) ? NULL : detector_create(adcSource);
+	if(d == NULL){
+		printf("%s: FAILED to allocate the ADC buffer and detector\n", policyName);
+		isr_destroy(adcSource);
+		return;
+	}
+	isr_ctxSetAdcOverflowPolicy(adcSource, policy);
+	uint32_t hitCount = 0;
+	uint32_t elapsedMs = 0;
+	bool stalled = false;
+	detector_ctxInit(d, ignored);
+	detector_ctxSetFudgeFactorIndex(d, INSTANCE_BENCHMARK_FUDGE_FACTOR);
+	testUtils_adcProducer_t producer;
+	if(!testUtils_startAdcProducer(&producer, adcSource, HANDOFF_TEST_FREQUENCY, HANDOFF_TEST_MILLISECONDS)){
+		printf("%s: FAILED to start the producer thread\n", policyName);
+		detector_destroy(d);
+		isr_destroy(adcSource);
+		return;
+	}
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while(!testUtils_adcProducerDone(&producer)){
+		detector_ctxRun(d);
+		if(detector_ctxHitDetected(d)){
+			hitCount++;
+			detector_ctxClearHit(d);
+		}
+		uint32_t sleepMs = HANDOFF_TEST_LOOP_MS;
+		if(!stalled && elapsedMs >= HANDOFF_TEST_STALL_START_MS){	//Stand in for a long busy-wait
+			sleepMs = HANDOFF_TEST_STALL_MS;
+			stalled = true;
+		}
+		elapsedMs += sleepMs;
+		testUtils_addMilliseconds(&next, sleepMs);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	testUtils_joinAdcProducer(&producer);
+	isr_ctxFlushAdcBuffer(adcSource);
+	detector_ctxRun(d);
+	isr_AdcBlockStats_t stats;
+	isr_ctxGetAdcBlockStats(adcSource, &stats);
+	uint32_t stallFrames = HANDOFF_TEST_STALL_MS * ISR_ADC_BLOCK_FRAMES;
+	printf("%s: %u blocks published, %u overrun(s), %u frames dropped (about %u expected), %u discontinuities, %u hits\n",
+		policyName, stats.blocksPublished, stats.overrunCount, stats.droppedFrameCount,
+		(HANDOFF_TEST_STALL_MS - ISR_ADC_BLOCK_COUNT) * ISR_ADC_BLOCK_FRAMES, stats.discontinuityCount, hitCount);
+	printf("  high-water mark %u of %u blocks, longest stall %u ms\n", stats.highWaterBlocks, ISR_ADC_BLOCK_COUNT,
+		stats.longestStallFrames / ISR_ADC_BLOCK_FRAMES);
+	bool passed = stats.overrunCount == 1 && hitCount > 0 && isr_ctxAdcBufferElementCount(adcSource) == 0
+		&& stats.highWaterBlocks == ISR_ADC_BLOCK_COUNT && stats.longestStallFrames >= stallFrames * 9 / 10
+		&& stats.discontinuityCount == ((policy == ISR_ADC_OVERFLOW_DISCONTINUITY) ? 1 : 0);
+	printf("  %s\n", passed ? "passed" : "FAILED");
+	detector_destroy(d);
+	isr_destroy(adcSource);
+}
+#endif
+
+// Feeds blocks to a detector at the real sample rate from a producer thread
+// while the main thread runs the detector like the game loop, stalling once
+// for longer than the blocks can hold, under each overflow policy. Prints the
+// handoff counters. Host (emulator) builds only.
+void detectorTest_runBlockHandoffTest(){
+#ifdef ZYBO_BOARD
+	printf("detectorTest_runBlockHandoffTest() needs threads, run it in the emulator build.\n");
+#else
+	printf("Starting detectorTest_runBlockHandoffTest()\n");
+	detectorTest_runHandoffScenario(ISR_ADC_OVERFLOW_DROP_NEWEST, "drop-newest");
+	detectorTest_runHandoffScenario(ISR_ADC_OVERFLOW_DROP_OLDEST, "drop-oldest");
+	detectorTest_runHandoffScenario(ISR_ADC_OVERFLOW_DISCONTINUITY, "discontinuity");
+	printf("Completed detectorTest_runBlockHandoffTest()\n");
+#endif
+}
+
+#ifndef ZYBO_BOARD
+// Sends SHOTCODE_TEST_SHOTS single coded shots per signal level from the
+// transmitter state machine into a detector instance. Each ADC sample is the
+// transmitter pin scaled to the signal level plus uniform noise. A shot is
+// preceded by enough silence to empty the power window and followed by
+// enough to decode it.
+#define SHOTCODE_TEST_SHOTS 128
+#define SHOTCODE_TEST_FREQUENCY 6
+#define SHOTCODE_TEST_OFFSET 1000
+#define SHOTCODE_TEST_NOISE TEST_UTILS_NOISE
+#define SHOTCODE_TEST_QUIET_TICKS 30000 // Before each shot.
+#define SHOTCODE_TEST_TAIL_TICKS 30000 // After each shot.
+#define SHOTCODE_TEST_DECODE_PASSES 10000
+typedef struct {
+	uint32_t hits;
+	uint32_t valid;
+	uint32_t invalid;
+	uint32_t wrong; // Passed the CRC with the wrong payload.
+	uint32_t bitErrors;
+	double detectorSeconds;
+} detectorTest_shotCodeResult_t;
+
+// Runs one detector tick's worth of the transmitter and ADC.
+static void detectorTest_sendShotCodeSample(isr_t *adcSource, uint16_t amplitude, uint32_t *seed){
+	transmitter_tick();
+	isr_AdcValue_t sample = SHOTCODE_TEST_OFFSET + amplitude * transmitter_getPinLevel();
+	isr_ctxAddDataToAdcBuffer(adcSource, sample + testUtils_random(seed) % SHOTCODE_TEST_NOISE);
+}
+
+// Sends the shots at one signal level into d and tallies what it received.
+static void detectorTest_runShotCodeLevel(detector_t *d, isr_t *adcSource, uint16_t amplitude, detectorTest_shotCodeResult_t *result){
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	uint32_t seed = amplitude + 1;
+	*result = (detectorTest_shotCodeResult_t){0};
+	isr_ctxInit(adcSource);
+	detector_ctxInit(d, ignored);
+	detector_ctxSetFudgeFactorIndex(d, INSTANCE_BENCHMARK_FUDGE_FACTOR);
+	intervalTimer_reset(BENCHMARK_TIMER);
+	for(uint32_t shot = 0; shot < SHOTCODE_TEST_SHOTS; ++shot){
+		shotCode_payload_t sent = {shot % (1 << SHOTCODE_PLAYER_ID_BITS), (shot * 7) % (1 << SHOTCODE_DAMAGE_BITS)};
+		transmitter_setShotPayload(sent.playerId, sent.damage);
+		uint32_t tick = 0;
+		while(tick < SHOTCODE_TEST_QUIET_TICKS || transmitter_running() || tick < SHOTCODE_TEST_QUIET_TICKS + TRANSMITTER_PULSE_WIDTH + SHOTCODE_TEST_TAIL_TICKS){
+			if(tick == SHOTCODE_TEST_QUIET_TICKS){
+				transmitter_run();
+			}
+			detectorTest_sendShotCodeSample(adcSource, amplitude, &seed);
+			if(++tick % LOCKOUT_TEST_BATCH_SIZE == 0){
+				intervalTimer_start(BENCHMARK_TIMER);
+				detector_ctxRun(d);
+				intervalTimer_stop(BENCHMARK_TIMER);
+			}
+		}
+		if(!detector_ctxHitDetected(d) || detector_ctxGetFrequencyNumberOfLastHit(d) != SHOTCODE_TEST_FREQUENCY){
+			detector_ctxClearHit(d);
+			continue;
+		}
+		detector_ctxClearHit(d);
+		result->hits++;
+		shotCode_payload_t received;
+		shotCode_status_t status = detector_ctxGetShotPayload(d, &received);
+		uint16_t errors = detector_ctxGetShotWord(d) ^ shotCode_encode(sent);
+		for(; errors != 0; errors &= errors - 1)
+			result->bitErrors++;
+		if(status == shotCode_valid_e && (received.playerId != sent.playerId || received.damage != sent.damage))
+			result->wrong++;
+		else if(status == shotCode_valid_e)
+			result->valid++;
+		else
+			result->invalid++;
+	}
+	result->detectorSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+#endif
+
+// Sends coded shots through a simulated ADC into a detector instance at
+// several signal levels and prints how the payloads were received, and what
+// decoding costs. Host (emulator) builds only.
+void detectorTest_runShotCodeTest(){
+#ifdef ZYBO_BOARD
+	printf("detectorTest_runShotCodeTest() needs a simulated ADC, run it in the emulator build.\n");
+#else
+	const uint16_t amplitudes[] = {2000, 500, 200, 140, 100, 70, 50};
+	printf("Starting detectorTest_runShotCodeTest()\n");
+	interrupts_disableTimerGlobalInts();
+	intervalTimer_init(BENCHMARK_TIMER);
+	isr_t *adcSource = isr_create();
+	detector_t *d = (adcSource == NULL) ? NULL : detector_create(adcSource);
+	if(d == NULL){
+		printf("FAILED to allocate the ADC buffer and detector\n");
+		isr_destroy(adcSource);
+		interrupts_enableTimerGlobalInts();
+		return;
+	}
+	transmitter_init();
+	transmitter_setFrequencyNumber(SHOTCODE_TEST_FREQUENCY);
+	transmitter_setContinuousMode(false);
+	transmitter_setShotCodeMode(true);
+	detector_ctxSetShotCodeMode(d, true);
+	bool passed = true;
+	detectorTest_shotCodeResult_t result;
+	double codedSeconds = 0.0;
+	double powerSnapshots[DETECTOR_SHOT_SNAPSHOT_COUNT];
+	uint16_t word;
+	shotCode_payload_t payload;
+	printf("Noise up to %d, %d shots per amplitude\n", SHOTCODE_TEST_NOISE, SHOTCODE_TEST_SHOTS);
+	printf("%9s %6s %6s %8s %6s %10s\n", "amplitude", "hits", "valid", "bad CRC", "wrong", "bit errors");
+	for(uint8_t k = 0; k < sizeof(amplitudes) / sizeof(amplitudes[0]); ++k){
+		detectorTest_runShotCodeLevel(d, adcSource, amplitudes[k], &result);
+		printf("%9u %6u %6u %8u %6u %10.2e\n", amplitudes[k], result.hits, result.valid, result.invalid, result.wrong,
+			result.hits ? (double)result.bitErrors / (result.hits * SHOTCODE_WORD_BITS) : 0.0);
+		if(k == 0){	//A strong signal must always decode
+			passed = result.hits == SHOTCODE_TEST_SHOTS && result.valid == SHOTCODE_TEST_SHOTS;
+			codedSeconds = result.detectorSeconds;
+			detector_ctxGetShotSnapshots(d, SHOTCODE_TEST_FREQUENCY, powerSnapshots);
+		}
+	}
+	detector_ctxSetShotCodeMode(d, false);
+	detectorTest_runShotCodeLevel(d, adcSource, amplitudes[0], &result);
+	double uncodedSeconds = result.detectorSeconds;
+	intervalTimer_reset(BENCHMARK_TIMER);
+	intervalTimer_start(BENCHMARK_TIMER);
+	for(uint32_t pass = 0; pass < SHOTCODE_TEST_DECODE_PASSES; ++pass){
+		shotCode_decode(powerSnapshots, &word, &payload);
+	}
+	intervalTimer_stop(BENCHMARK_TIMER);
+	printf("shotCode_decode(): %f us per shot\n", 1e6 * intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER) / SHOTCODE_TEST_DECODE_PASSES);
+	printf("Detector time with snapshots and decoding %f s, without %f s (%+5.2f%%)\n", codedSeconds, uncodedSeconds,
+		100.0 * (codedSeconds - uncodedSeconds) / uncodedSeconds);
+	transmitter_setShotCodeMode(false);
+	detector_destroy(d);
+	isr_destroy(adcSource);
+	interrupts_enableTimerGlobalInts();
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed detectorTest_runShotCodeTest()\n");
+#endif
+}
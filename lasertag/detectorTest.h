@@ -0,0 +1,58 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef DETECTORTEST_H_
+#define DETECTORTEST_H_
+#include <stdint.h>
+
+// Benchmarks and tests of the detector beyond detector_runTest(). Unless noted
+// otherwise they feed the ADC buffer themselves, so run them with interrupts
+// disabled.
+
+// Measures detector throughput with 1, 2 and 4 sensors and prints the results.
+void detectorTest_runMultiSensorBenchmark();
+
+// Measures detector run-time and hit latency at several decision intervals
+// and prints the results.
+void detectorTest_runDecisionIntervalBenchmark();
+
+// Times detector_init() against refilling every filter queue one slot at a
+// time, and prints both with the number of ADC samples that arrive meanwhile.
+void detectorTest_runResetBenchmark();
+
+// Prints how many cache lines the per-sample filter state spans and the L1
+// data cache refills and time per decimated sample, with the caches cleared
+// of filter state before each sample. Refills are counted by the PMU on the
+// board and by perf_event_open() on a Linux host, where available.
+void detectorTest_runCacheBenchmark();
+
+// Runs one detector instance, then instanceCount instances on as many threads
+// (sequentially on the board), and prints the throughput and whether every
+// instance only detected the frequency it was sent. Up to 64 instances.
+void detectorTest_runInstanceBenchmark(uint16_t instanceCount);
+
+// Feeds ADC blocks to a detector at the real sample rate from a producer
+// thread while the detector runs like the game loop, with one stall longer
+// than the blocks can hold, under each overflow policy, and prints the block
+// handoff counters. Host (emulator) builds only.
+void detectorTest_runBlockHandoffTest();
+
+// Sends single coded shots from the transmitter state machine through a
+// simulated ADC into a detector instance at several signal levels, and prints
+// the hit rate, how many payloads decoded, failed the CRC or were wrong, the
+// raw bit error rate, and the time the decode and the snapshots cost. Host
+// (emulator) builds only.
+void detectorTest_runShotCodeTest();
+
+// Runs the same input with and without lockout suspension, then prints the
+// detector time saved and how far the power values after the lockout differ
+// from continuous processing.
+void detectorTest_runLockoutSuspendTest();
+
+#endif /* DETECTORTEST_H_ */
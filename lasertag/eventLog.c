@@ -0,0 +1,155 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include "eventLog.h"
+#include "timebase.h"
+
+#define RECORD_INDEX_MASK (EVENTLOG_RECORD_COUNT - 1)
+#define TICKS_PER_MICROSECOND (EVENTLOG_TICKS_PER_SECOND / 1000000)
+
+#define TEST_EXTRA_WRITES 10 // Writes past a full log, all of which must drop.
+#define TEST_PRINTF_COUNT 20
+#ifdef ZYBO_BOARD
+#define TEST_MAX_WRITE_TICKS 48 // A few dozen cycles.
+#else
+#define TEST_MAX_WRITE_TICKS 200 // Nanoseconds; clock_gettime() dominates.
+#endif
+
+// Text printed for each event. arg0 and arg1 are passed to printf() after it.
+static const char *eventFormats[EVENTLOG_EVENT_COUNT] = {
+	[EVENTLOG_TRANSMITTER_WAITING] = "Waiting to start",
+	[EVENTLOG_TRANSMITTER_HIGH_ST] = "\nhigh_st\n",
+	[EVENTLOG_TRANSMITTER_LOW_ST] = "\nlow_st\n",
+	[EVENTLOG_TRANSMITTER_OUTPUT] = "%u",
+	[EVENTLOG_TRIGGER_PRESSED] = " D \n",
+	[EVENTLOG_TRIGGER_RELEASED] = " U \n",
+	[EVENTLOG_SOUND_INIT_ST] = "sound_init_st\n",
+	[EVENTLOG_SOUND_WAIT_ST] = "sound_wait_st\n",
+	[EVENTLOG_SOUND_PLAY_ST] = "sound_play_st\n",
+	[EVENTLOG_SOUND_ARRAY_NOT_SET] = "ERROR, sound_tick: sound array has not been set.\n",
+};
+
+static eventLog_record_t records[EVENTLOG_RECORD_COUNT];
+static _Atomic uint32_t recordHead; // Written by eventLog_write().
+static _Atomic uint32_t recordTail; // Written by eventLog_read().
+static _Atomic uint32_t droppedCount;
+static uint32_t lastTimestamp; // Of the last record printed.
+static uint64_t elapsedTicks; // Since eventLog_init(), at the last record printed.
+
+// Empties the log, clears the dropped count and makes sure the clock runs.
+void eventLog_init(){
+	timebase_init();
+	atomic_store(&recordHead, 0);
+	atomic_store(&recordTail, 0);
+	atomic_store(&droppedCount, 0);
+	elapsedTicks = 0;
+	lastTimestamp = timebase_readCycles();
+}
+
+// Adds a record to the log, or counts it as dropped if the log is full.
+void eventLog_write(eventLog_event_t event, uint16_t arg0, uint32_t arg1){
+	uint32_t head = atomic_load_explicit(&recordHead, memory_order_relaxed);
+	if(head - atomic_load_explicit(&recordTail, memory_order_acquire) >= EVENTLOG_RECORD_COUNT){
+		atomic_fetch_add_explicit(&droppedCount, 1, memory_order_relaxed);
+		return;
+	}
+	eventLog_record_t *record = &records[head & RECORD_INDEX_MASK];
+	record->timestamp = timebase_readCycles();
+	record->event = event;
+	record->arg0 = arg0;
+	record->arg1 = arg1;
+	atomic_store_explicit(&recordHead, head + 1, memory_order_release);	//Record before the new head
+}
+
+// Removes the oldest record into record. Returns false if the log is empty.
+bool eventLog_read(eventLog_record_t *record){
+	uint32_t tail = atomic_load_explicit(&recordTail, memory_order_relaxed);
+	if(tail == atomic_load_explicit(&recordHead, memory_order_acquire))
+		return false;
+	*record = records[tail & RECORD_INDEX_MASK];
+	atomic_store_explicit(&recordTail, tail + 1, memory_order_release);	//The slot is copied, the ISR may reuse it
+	return true;
+}
+
+// Prints every record waiting in the log.
+uint32_t eventLog_flush(bool withTimestamps){
+	eventLog_record_t record;
+	uint32_t printed = 0;
+	while(eventLog_read(&record)){
+		elapsedTicks += (uint32_t)(record.timestamp - lastTimestamp);	//Handles the clock wrapping between records
+		lastTimestamp = record.timestamp;
+		if(withTimestamps)
+			printf("[%10llu us] ", (unsigned long long)(elapsedTicks / TICKS_PER_MICROSECOND));
+		if(record.event < EVENTLOG_EVENT_COUNT)
+			printf(eventFormats[record.event], record.arg0, record.arg1);
+		else
+			printf("unknown event %u (%u, %u)\n", record.event, record.arg0, record.arg1);
+		printed++;
+	}
+	fflush(stdout);
+	return printed;
+}
+
+// Returns the number of records waiting in the log.
+uint32_t eventLog_elementCount(){
+	return atomic_load_explicit(&recordHead, memory_order_acquire) - atomic_load_explicit(&recordTail, memory_order_relaxed);
+}
+
+// Returns the number of records dropped because the log was full.
+uint32_t eventLog_getDroppedCount(){
+	return atomic_load_explicit(&droppedCount, memory_order_relaxed);
+}
+
+// Fills the log and returns the ticks taken per eventLog_write().
+static uint32_t eventLog_timeWrites(){
+	uint32_t start = timebase_readCycles();
+	for(uint32_t i = 0; i < EVENTLOG_RECORD_COUNT; ++i)
+		eventLog_write(EVENTLOG_TRIGGER_PRESSED, (uint16_t)i, i);
+	return (timebase_readCycles() - start) / EVENTLOG_RECORD_COUNT;
+}
+
+// Measures the cost of eventLog_write() against printf() and checks that
+// records come back in order and that a full log drops and counts. Nothing
+// else may log while it runs.
+void eventLog_runTest(){
+	printf("Starting eventLog_runTest()\n");
+	eventLog_record_t record;
+	bool passed = true;
+	eventLog_init();
+	eventLog_timeWrites();	//Warms the caches
+	while(eventLog_read(&record));
+	uint32_t writeTicks = eventLog_timeWrites();
+
+	for(uint32_t i = 0; i < TEST_EXTRA_WRITES; ++i)
+		eventLog_write(EVENTLOG_TRIGGER_RELEASED, 0, 0);
+	if(eventLog_getDroppedCount() != TEST_EXTRA_WRITES){
+		printf("%u records dropped by a full log, expected %u\n", eventLog_getDroppedCount(), TEST_EXTRA_WRITES);
+		passed = false;
+	}
+	for(uint32_t i = 0; i < EVENTLOG_RECORD_COUNT; ++i){
+		if(!eventLog_read(&record) || record.event != EVENTLOG_TRIGGER_PRESSED || record.arg0 != (uint16_t)i || record.arg1 != i){
+			printf("record %u is missing or wrong\n", i);
+			passed = false;
+			break;
+		}
+	}
+	if(eventLog_read(&record)){
+		printf("the log holds more than %u records\n", EVENTLOG_RECORD_COUNT);
+		passed = false;
+	}
+
+	uint32_t start = timebase_readCycles();
+	for(uint32_t i = 0; i < TEST_PRINTF_COUNT; ++i)
+		printf(" D \n");
+	fflush(stdout);
+	uint32_t printfTicks = (timebase_readCycles() - start) / TEST_PRINTF_COUNT;
+
+	printf("eventLog_write(): %u ticks per record, printf(): %u ticks per call (%u ticks per second)\n",
+		writeTicks, printfTicks, EVENTLOG_TICKS_PER_SECOND);
+	if(writeTicks > TEST_MAX_WRITE_TICKS){
+		printf("eventLog_write() takes more than %u ticks\n", TEST_MAX_WRITE_TICKS);
+		passed = false;
+	}
+	printf("%s\n", passed ? "passed" : "FAILED");
+	eventLog_init();
+	printf("Completed eventLog_runTest()\n");
+}
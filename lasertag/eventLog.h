@@ -0,0 +1,78 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "timebase.h"
+
+// Deferred debug logging for code that runs inside isr_function(). A printf()
+// there takes far longer than the 10 us tick, so the state machines call
+// eventLog_write() instead. It stores a small binary record (event, timestamp,
+// two arguments) in a lock-free ring, and the main loop prints the records
+// later with eventLog_flush(). Only the ISR writes and only the main loop
+// reads. If the main loop falls behind, new records are dropped and counted.
+// Timestamps are CPU cycles on the board (the Cortex-A9 PMU cycle counter,
+// started by isr_init()) and nanoseconds on the host.
+
+#define EVENTLOG_TICKS_PER_SECOND TIMEBASE_CYCLES_PER_SECOND
+
+#define EVENTLOG_RECORD_COUNT 1024 // Power of two.
+
+// Every event that can be logged. eventLog_flush() prints each one with the
+// text its printf() used to print.
+typedef enum {
+  EVENTLOG_TRANSMITTER_WAITING,  // The transmitter went to off_st.
+  EVENTLOG_TRANSMITTER_HIGH_ST,  // The transmitter went to high_st.
+  EVENTLOG_TRANSMITTER_LOW_ST,   // The transmitter went to low_st.
+  EVENTLOG_TRANSMITTER_OUTPUT,   // arg0: the output level this tick.
+  EVENTLOG_TRIGGER_PRESSED,      // arg0: shots remaining.
+  EVENTLOG_TRIGGER_RELEASED,     // arg0: shots remaining.
+  EVENTLOG_SOUND_INIT_ST,        // debugStatePrint() saw sound_init_st.
+  EVENTLOG_SOUND_WAIT_ST,        // debugStatePrint() saw sound_wait_st.
+  EVENTLOG_SOUND_PLAY_ST,        // debugStatePrint() saw sound_play_st.
+  EVENTLOG_SOUND_ARRAY_NOT_SET,  // sound_tick() had no sound to play.
+  EVENTLOG_EVENT_COUNT
+} eventLog_event_t;
+
+// One logged event.
+typedef struct {
+  uint32_t timestamp;
+  uint16_t event;
+  uint16_t arg0;
+  uint32_t arg1;
+} eventLog_record_t;
+
+// Empties the log and clears the dropped count. Also starts the timestamp
+// clock, for tests that log without calling isr_init().
+void eventLog_init();
+
+// Adds a record to the log. Called from the ISR; never blocks.
+void eventLog_write(eventLog_event_t event, uint16_t arg0, uint32_t arg1);
+
+// Removes the oldest record into record. Returns false if the log is empty.
+bool eventLog_read(eventLog_record_t *record);
+
+// Prints every record waiting in the log, each prefixed with its time in
+// microseconds if withTimestamps. Call it from the main loop. Returns the
+// number of records printed.
+uint32_t eventLog_flush(bool withTimestamps);
+
+// Returns the number of records waiting in the log.
+uint32_t eventLog_elementCount();
+
+// Returns the number of records dropped because the log was full.
+uint32_t eventLog_getDroppedCount();
+
+// Measures the cost of eventLog_write() against printf() and checks that
+// records come back in order and that a full log drops and counts.
+void eventLog_runTest();
+
+#endif /* EVENTLOG_H_ */
@@ -1,25 +1,10 @@
-#ifndef FILTER_H_
-#define FILTER_H_
-
-#include "queue.h"
+#include "filter.h"
 #include "filterCoefficients.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
-#define FILTER_FREQUENCY_COUNT 10
-#define FILTER_FIR_DECIMATION_FACTOR                                           \
-  10 // FIR-filter needs this many new inputs to compute a new output.
-#define FILTER_INPUT_PULSE_WIDTH                                               \
-  2000 // This is the width of the pulse you are looking for, in terms of
-       // decimated sample count.
-// These are the tick counts that are used to generate the user frequencies.
-// Not used in filter.h but are used to TEST the filter code.
-// Placed here for general access as they are essentially constant throughout
-// the code. The transmitter will also use these.
-static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
-    68, 58, 50, 44, 38, 34, 30, 28, 26, 24};
-
-#define IIR_A_COEFFICIENT_COUNT 10
 #define QUEUE_INIT_VALUE 0.0
 #define X_QUEUE_SIZE 81
 #define Y_QUEUE_SIZE IIR_B_COEFFICIENT_COUNT
@@ -27,11 +12,70 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 #define OUTPUT_QUEUE_SIZE 2000
 #define FILTER_IIR_FILTER_COUNT 10
 
-//Queue declarations
-static queue_t xQueue;
-static queue_t yQueue;
-static queue_t zQueue[FILTER_IIR_FILTER_COUNT];
-static queue_t outputQueue[FILTER_IIR_FILTER_COUNT];
+// Layout unit of the filter_t arena. The Cortex-A9 L1 line is 32 bytes; 64
+// keeps the same layout from splitting lines on hosts as well.
+#define FILTER_CACHE_LINE_BYTES 64
+#define FILTER_CACHE_ALIGNED __attribute__((aligned(FILTER_CACHE_LINE_BYTES)))
+
+// A queue control block that starts a cache line. queue_t keeps everything the
+// filter touches per sample (indices, size, data pointer, flags) in its first
+// 22 bytes and the name after them, so the hot fields of each queue share one
+// line and the name only occupies lines that debug printing reads.
+typedef struct {
+    queue_t queue;
+} FILTER_CACHE_ALIGNED filter_queueBlock_t;
+
+// Each history is a circular buffer of slots and each slot holds one value per
+// sensor lane. All lanes are always computed: the lanes share every index
+// computation and coefficient load, and the fixed-width inner loops vectorize,
+// so unused lanes cost far less than running the pipeline once per sensor.
+typedef double filter_sensorLanes_t[FILTER_MAX_SENSOR_COUNT];
+
+// The multi-sensor filter bank. It is several times the size of the rest of
+// a filter_t and only the sensor-bank functions touch it, so it lives outside
+// the filter_t arena and a single-sensor filter never has it in its address
+// range.
+typedef struct {
+    filter_sensorLanes_t sensorXHistory[X_QUEUE_SIZE];
+    filter_sensorLanes_t sensorYHistory[Y_QUEUE_SIZE];
+    filter_sensorLanes_t sensorZHistory[FILTER_IIR_FILTER_COUNT][Z_QUEUE_SIZE];
+    filter_sensorLanes_t sensorOutputHistory[FILTER_IIR_FILTER_COUNT][OUTPUT_QUEUE_SIZE];
+    // Next slot to be written in each history (which is also the oldest slot).
+    uint32_t sensorXIndex;
+    uint32_t sensorYIndex;
+    uint32_t sensorZIndex[FILTER_IIR_FILTER_COUNT];
+    uint32_t sensorOutputIndex[FILTER_IIR_FILTER_COUNT];
+    // Output value that the last IIR run pushed out of the power window.
+    filter_sensorLanes_t sensorOldestOutput[FILTER_IIR_FILTER_COUNT];
+    filter_sensorLanes_t sensorPowerValue[FILTER_IIR_FILTER_COUNT];
+} filter_sensorBank_t;
+
+// Everything one filter pipeline remembers between calls. A filter_t is also
+// the arena its queues live in: nothing is allocated, so the default instance
+// needs no heap and filter_ctxInit() can run any number of times. What every
+// decimated sample touches comes first (control blocks, power state, then the
+// x, y and z data packed back to back); the long output histories follow.
+struct filter_t {
+    //Queue declarations
+    filter_queueBlock_t xQueue;
+    filter_queueBlock_t yQueue;
+    filter_queueBlock_t zQueue[FILTER_IIR_FILTER_COUNT];
+    filter_queueBlock_t outputQueue[FILTER_IIR_FILTER_COUNT];
+    double currentPowerValue[FILTER_FREQUENCY_COUNT];
+    double oldestValue[FILTER_FREQUENCY_COUNT]; // Oldest output used by the last power computation.
+    filter_sensorBank_t *sensorBank; // Multi-sensor filter bank, see above.
+    uint16_t sensorCount;
+
+    // Queue storage.
+    queue_data_t xStorage[X_QUEUE_SIZE] FILTER_CACHE_ALIGNED;
+    queue_data_t yStorage[Y_QUEUE_SIZE];
+    queue_data_t zStorage[FILTER_IIR_FILTER_COUNT][Z_QUEUE_SIZE];
+    queue_data_t outputStorage[FILTER_IIR_FILTER_COUNT][OUTPUT_QUEUE_SIZE] FILTER_CACHE_ALIGNED;
+};
+
+// The instance used by the filter_xxx() functions that take no filter_t.
+static filter_sensorBank_t defaultSensorBank;
+static filter_t defaultFilter = {.sensorBank = &defaultSensorBank, .sensorCount = 1};
 
 // Filtering routines for the laser-tag project.
 // Filtering is performed by a two-stage filter, as described below.
@@ -46,52 +90,97 @@ static queue_t outputQueue[FILTER_IIR_FILTER_COUNT];
 ******************************************
 **********************************************************************************************************/
 
+// Zeros the first count slots of a queue of capacity count and leaves it full,
+// the same state that pushing count zeros leaves it in, with one memset instead
+// of a push per slot. count is the filter's own size constant, so the fill
+// never depends on what queue_size() reports. Relies on the queue_t layout
+// documented in queue.h: the oldest element is at indexOut and both indices
+// wrap at q->size.
+static void filter_zeroQueue(queue_t *q, queue_size_t count){
+    memset(q->data, 0, count * sizeof(queue_data_t));
+    q->elementCount = count;
+    q->indexOut = 0;
+    q->indexIn = count % q->size;
+    q->underflowFlag = false;
+    q->overflowFlag = false;
+}
+
 //Initializes the xQueue and fills it with zeros
-void initXQueue(){
-    queue_init(&xQueue, X_QUEUE_SIZE, "xQueue");
-    for (uint32_t j=0; j<X_QUEUE_SIZE; j++)
-        queue_overwritePush(&(xQueue), QUEUE_INIT_VALUE);
+void initXQueue(filter_t *filter){
+    queue_initStatic(&filter->xQueue.queue, filter->xStorage, X_QUEUE_SIZE, "xQueue");
+    filter_zeroQueue(&filter->xQueue.queue, X_QUEUE_SIZE);
 }
 
 // Initializes and fills the yQueue with all zeros.
-void initYQueue(){
-    queue_init(&yQueue, Y_QUEUE_SIZE, "yQueue");
-    for (uint32_t j=0; j<Y_QUEUE_SIZE; j++)
-        queue_overwritePush(&(yQueue), QUEUE_INIT_VALUE);
+void initYQueue(filter_t *filter){
+    queue_initStatic(&filter->yQueue.queue, filter->yStorage, Y_QUEUE_SIZE, "yQueue");
+    filter_zeroQueue(&filter->yQueue.queue, Y_QUEUE_SIZE);
 }
 
-// Call queue_init() on all of the zQueues and fill each z queue with zeros.
-void initZQueues(){
+// Call queue_initStatic() on all of the zQueues and fill each z queue with zeros.
+void initZQueues(filter_t *filter){
     //Loop through each queue and initialize
     for (uint32_t i=0; i<FILTER_IIR_FILTER_COUNT; i++) {
-        queue_init(&(zQueue[i]), Z_QUEUE_SIZE, "zQueue");
-        for (uint32_t j=0; j<Z_QUEUE_SIZE; j++)
-            queue_overwritePush(&(zQueue[i]), QUEUE_INIT_VALUE);
+        queue_initStatic(&(filter->zQueue[i].queue), filter->zStorage[i], Z_QUEUE_SIZE, "zQueue");
+        filter_zeroQueue(&(filter->zQueue[i].queue), Z_QUEUE_SIZE);
     }
 }
 
-// Call queue_init() on all of the outputQueues and fill each output queue with zeros.
-void initOutputQueues(){
+// Call queue_initStatic() on all of the outputQueues and fill each output queue with zeros.
+void initOutputQueues(filter_t *filter){
   //Loop through each queue and initialize
     for (uint32_t i=0; i<FILTER_IIR_FILTER_COUNT; i++) {
-        queue_init(&(outputQueue[i]), OUTPUT_QUEUE_SIZE, "outputQueue");
-        for (uint32_t j=0; j<OUTPUT_QUEUE_SIZE; j++)
-            queue_overwritePush(&(outputQueue[i]), QUEUE_INIT_VALUE);
+        queue_initStatic(&(filter->outputQueue[i].queue), filter->outputStorage[i], OUTPUT_QUEUE_SIZE, "outputQueue");
+        filter_zeroQueue(&(filter->outputQueue[i].queue), OUTPUT_QUEUE_SIZE);
+    }
+}
+
+// Allocates a new filter instance and initializes it. The queues live inside
+// the instance; the sensor bank is the only other allocation.
+filter_t *filter_create(){
+    filter_t *filter = aligned_alloc(FILTER_CACHE_LINE_BYTES, sizeof(filter_t));
+    if (filter == NULL)
+        return NULL;
+    memset(filter, 0, sizeof(filter_t));
+    filter->sensorBank = calloc(1, sizeof(filter_sensorBank_t));
+    if (filter->sensorBank == NULL) {
+        free(filter);
+        return NULL;
     }
+    filter->sensorCount = 1;
+    filter_ctxInit(filter);
+    return filter;
+}
+
+// Frees a filter instance allocated by filter_create().
+void filter_destroy(filter_t *filter){
+    free(filter->sensorBank);
+    free(filter);
+}
+
+// Returns the instance used by the functions that take no filter_t.
+filter_t *filter_getDefault(){
+    return &defaultFilter;
 }
 
 // Must call this prior to using any filter functions.
-void filter_init(){
+// The queues use storage inside the filter_t, so every call, such as
+// detector_init() after a lost life, just resets them: nothing is allocated or
+// leaked and the reset takes a few memsets.
+void filter_ctxInit(filter_t *filter){
     // Init queues and fill them with 0s.
-    initXQueue();  // Call queue_init() on xQueue and fill it with zeros.
-    initYQueue();  // Call queue_init() on yQueue and fill it with zeros.
-    initZQueues(); // Call queue_init() on all of the zQueues and fill each z queue with zeros.
-    initOutputQueues();  // Call queue_init() all of the outputQueues and fill each outputQueue with zeros.
+    initXQueue(filter);  // Call queue_initStatic() on xQueue and fill it with zeros.
+    initYQueue(filter);  // Call queue_initStatic() on yQueue and fill it with zeros.
+    initZQueues(filter); // Call queue_initStatic() on all of the zQueues and fill each z queue with zeros.
+    initOutputQueues(filter);  // Call queue_initStatic() all of the outputQueues and fill each outputQueue with zeros.
+    // All-zero outputs have zero power, so incremental power updates stay valid.
+    memset(filter->currentPowerValue, 0, sizeof(filter->currentPowerValue));
+    memset(filter->oldestValue, 0, sizeof(filter->oldestValue));
 }
 
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
-void filter_addNewInput(double x){
-    queue_overwritePush(&(xQueue), x);
+void filter_ctxAddNewInput(filter_t *filter, double x){
+    queue_overwritePushFullUnchecked(&(filter->xQueue.queue), x);	//Every filter queue is kept full
 }
 
 // Fills a queue with the given fillValue. For example,
@@ -103,33 +192,55 @@ void filter_fillQueue(queue_t *q, double fillValue){
         queue_overwritePush((q), fillValue);
 }
 
+// Zeros everything downstream of the FIR input so the IIR filters restart from rest.
+void filter_ctxResetIirState(filter_t *filter){
+    filter_zeroQueue(&filter->yQueue.queue, Y_QUEUE_SIZE);
+    for (uint32_t i=0; i<FILTER_IIR_FILTER_COUNT; i++) {
+        filter_zeroQueue(&(filter->zQueue[i].queue), Z_QUEUE_SIZE);
+        filter_zeroQueue(&(filter->outputQueue[i].queue), OUTPUT_QUEUE_SIZE);
+        filter->currentPowerValue[i] = 0.0;
+        filter->oldestValue[i] = 0.0;
+    }
+}
+
+// Returns the sum of coefficients[i] times the i-th newest element of q, for i
+// from 0 to coefficientCount - 1, or fewer if q holds fewer. Walks the queue's
+// spans newest first, so the sum is added in the same order as a
+// queue_readElementAt(q, count-1-i) loop.
+static double filter_dotProductNewestFirst(queue_t *q, const double coefficients[], uint32_t coefficientCount){
+    queue_view_t view;
+    queue_view(q, &view);
+    uint32_t secondCount = (coefficientCount < view.second.count) ? coefficientCount : view.second.count;
+    uint32_t firstCount = coefficientCount - secondCount;
+    if (firstCount > view.first.count)
+        firstCount = view.first.count;
+    double sum = 0.0;
+    const double *coefficient = coefficients;
+    for (uint32_t i=0; i<secondCount; i++)
+        sum += view.second.data[view.second.count-1-i] * *coefficient++;
+    for (uint32_t i=0; i<firstCount; i++)
+        sum += view.first.data[view.first.count-1-i] * *coefficient++;
+    return sum;
+}
+
 // Invokes the FIR-filter. Input is contents of xQueue.
 // Output is returned and is also pushed on to yQueue.
-double filter_firFilter(){
-    double y = 0.0;
-    for (uint32_t i=0; i<FIR_FILTER_TAP_COUNT; i++)
-        y += queue_readElementAt(&xQueue, FIR_FILTER_TAP_COUNT-1-i) * firCoefficients[i];
-    queue_overwritePush(&yQueue, y);
+double filter_ctxFirFilter(filter_t *filter){
+    double y = filter_dotProductNewestFirst(&filter->xQueue.queue, firCoefficients, FIR_FILTER_TAP_COUNT);
+    queue_overwritePushFullUnchecked(&filter->yQueue.queue, y);
     return y;
 }
 
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
-double filter_iirFilter(uint16_t filterNumber){
-    double z = 0.0;
-    double y = 0.0;
-
-    for (uint32_t i=0; i<IIR_B_COEFFICIENT_COUNT; i++)
-      y += queue_readElementAt(&yQueue, (IIR_B_COEFFICIENT_COUNT-1)-i) * iirBCoefficientConstants[filterNumber][i];
-    for (uint32_t i=0; i<IIR_A_COEFFICIENT_COUNT; i++)
-      z += queue_readElementAt(&zQueue[filterNumber], (IIR_A_COEFFICIENT_COUNT-1)-i) * iirACoefficientConstants[filterNumber][i];
-    queue_overwritePush(&zQueue[filterNumber], y - z);
-    queue_overwritePush(&outputQueue[filterNumber], y - z);
+double filter_ctxIirFilter(filter_t *filter, uint16_t filterNumber){
+    double y = filter_dotProductNewestFirst(&filter->yQueue.queue, iirBCoefficientConstants[filterNumber], IIR_B_COEFFICIENT_COUNT);
+    double z = filter_dotProductNewestFirst(&filter->zQueue[filterNumber].queue, iirACoefficientConstants[filterNumber], IIR_A_COEFFICIENT_COUNT);
+    queue_overwritePushFullUnchecked(&filter->zQueue[filterNumber].queue, y - z);
+    queue_overwritePushFullUnchecked(&filter->outputQueue[filterNumber].queue, y - z);
 	return y-z;
 }
 
-static double currentPowerValue[FILTER_FREQUENCY_COUNT];
-
 // Use this to compute the power for values contained in an outputQueue.
 // If force == true, then recompute power by using all values in the
 // outputQueue. This option is necessary so that you can correctly compute power
@@ -143,33 +254,36 @@ static double currentPowerValue[FILTER_FREQUENCY_COUNT];
 // 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
 // (newest-value * newest-value). Note that this function will probably need an
 // array to keep track of these values for each of the 10 output queues.
-double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch, bool debugPrint){
-	static double oldestValue[FILTER_FREQUENCY_COUNT];
+double filter_ctxComputePower(filter_t *filter, uint16_t filterNumber, bool forceComputeFromScratch, bool debugPrint){
+	queue_t *outputQueue = &filter->outputQueue[filterNumber].queue;
 	double sum = 0.0;
+	(void)debugPrint;	//Part of the filter_computePower() interface, nothing to print here
 
 	//Recompute all power values from scratch if forceComputeFromScratch == true
     if(forceComputeFromScratch){
-		//Loop through all queue values and sum up the power
-        for(uint32_t i = 0; i < OUTPUT_QUEUE_SIZE; ++i){
-            double elementVal = queue_readElementAt(&outputQueue[filterNumber], i);
-            sum += elementVal * elementVal;
-        }
-        currentPowerValue[filterNumber] = sum;
+		//Loop through all queue values, oldest first, and sum up the power
+        queue_view_t view;
+        queue_view(outputQueue, &view);
+        for(uint32_t i = 0; i < view.first.count; ++i)
+            sum += view.first.data[i] * view.first.data[i];
+        for(uint32_t i = 0; i < view.second.count; ++i)
+            sum += view.second.data[i] * view.second.data[i];
+        filter->currentPowerValue[filterNumber] = sum;
     }
     else{	//If forceComputefromScratch == false, remove the oldest value from the previous sum and add the newest value
-      	sum = currentPowerValue[filterNumber] - (oldestValue[filterNumber] * oldestValue[filterNumber]) + (queue_readElementAt(&outputQueue[filterNumber],
-        	OUTPUT_QUEUE_SIZE - 1) * queue_readElementAt(&outputQueue[filterNumber], OUTPUT_QUEUE_SIZE - 1));
-    	currentPowerValue[filterNumber] = sum;
+      	sum = filter->currentPowerValue[filterNumber] - (filter->oldestValue[filterNumber] * filter->oldestValue[filterNumber]) + (queue_readElementAtUnchecked(outputQueue,
+        	OUTPUT_QUEUE_SIZE - 1) * queue_readElementAtUnchecked(outputQueue, OUTPUT_QUEUE_SIZE - 1));
+    	filter->currentPowerValue[filterNumber] = sum;
 	}
 
-    oldestValue[filterNumber] = queue_readElementAt(&outputQueue[filterNumber], 0);
-    return currentPowerValue[filterNumber];
+    filter->oldestValue[filterNumber] = queue_readElementAtUnchecked(outputQueue, 0);
+    return filter->currentPowerValue[filterNumber];
 }
 
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
-double filter_getCurrentPowerValue(uint16_t filterNumber){
-	return currentPowerValue[filterNumber];
+double filter_ctxGetCurrentPowerValue(filter_t *filter, uint16_t filterNumber){
+	return filter->currentPowerValue[filterNumber];
 }
 
 // Get a copy of the current power values.
@@ -177,17 +291,18 @@ double filter_getCurrentPowerValue(uint16_t filterNumber){
 // array so that they can be accessed from outside the filter software by the
 // detector. Remember that when you pass an array into a C function, changes to
 // the array within that function are reflected in the returned array.
-void filter_getCurrentPowerValues(double powerValues[]){
+void filter_ctxGetCurrentPowerValues(filter_t *filter, double powerValues[]){
     for(uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
-        powerValues[i] = currentPowerValue[i];
+        powerValues[i] = filter->currentPowerValue[i];
 }
 
 // Using the previously-computed power values that are current stored in
 // currentPowerValue[] array, Copy these values into the normalizedArray[]
 // argument and then normalize them by dividing all of the values in
 // normalizedArray by the maximum power value contained in currentPowerValue[].
-void filter_getNormalizedPowerValues(double normalizedArray[],
-                                     uint16_t *indexOfMaxValue){		
+void filter_ctxGetNormalizedPowerValues(filter_t *filter, double normalizedArray[],
+                                        uint16_t *indexOfMaxValue){
+    const double *currentPowerValue = filter->currentPowerValue;
     double max = currentPowerValue[0];
 	//Loop through all filters to find which filter had the make power
     for(uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
@@ -202,6 +317,181 @@ void filter_getNormalizedPowerValues(double normalizedArray[],
         normalizedArray[i] = currentPowerValue[i] / max;
 }
 
+// Default-instance versions of the functions above.
+void filter_init(){
+    filter_ctxInit(&defaultFilter);
+}
+
+void filter_addNewInput(double x){
+    filter_ctxAddNewInput(&defaultFilter, x);
+}
+
+void filter_resetIirState(){
+    filter_ctxResetIirState(&defaultFilter);
+}
+
+double filter_firFilter(){
+    return filter_ctxFirFilter(&defaultFilter);
+}
+
+double filter_iirFilter(uint16_t filterNumber){
+    return filter_ctxIirFilter(&defaultFilter, filterNumber);
+}
+
+double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch, bool debugPrint){
+    return filter_ctxComputePower(&defaultFilter, filterNumber, forceComputeFromScratch, debugPrint);
+}
+
+double filter_getCurrentPowerValue(uint16_t filterNumber){
+    return filter_ctxGetCurrentPowerValue(&defaultFilter, filterNumber);
+}
+
+void filter_getCurrentPowerValues(double powerValues[]){
+    filter_ctxGetCurrentPowerValues(&defaultFilter, powerValues);
+}
+
+void filter_getNormalizedPowerValues(double normalizedArray[],
+                                     uint16_t *indexOfMaxValue){
+    filter_ctxGetNormalizedPowerValues(&defaultFilter, normalizedArray, indexOfMaxValue);
+}
+
+/*********************************************************************************************************
+*************************************** Multi-sensor Filter Bank
+*****************************************
+**********************************************************************************************************/
+
+// Sums history[age] * coefficients[age] for every lane, where age 0 is the
+// newest slot. The newest slot is the one just before nextIndex.
+static void filter_sensorDotProduct(filter_sensorLanes_t history[], uint32_t historySize,
+                                    uint32_t nextIndex, const double coefficients[],
+                                    uint32_t coefficientCount, filter_sensorLanes_t result){
+    uint32_t slot = (nextIndex == 0) ? historySize - 1 : nextIndex - 1;
+    for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++)
+        result[s] = 0.0;
+    for (uint32_t i=0; i<coefficientCount; i++) {
+        double coefficient = coefficients[i];
+        for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++)
+            result[s] += history[slot][s] * coefficient;
+        slot = (slot == 0) ? historySize - 1 : slot - 1;
+    }
+}
+
+// Must call this prior to using the sensor-bank functions. Zeros all state.
+void filter_ctxInitSensors(filter_t *filter, uint16_t count){
+    filter->sensorCount = (count > FILTER_MAX_SENSOR_COUNT) ? FILTER_MAX_SENSOR_COUNT : count;
+    memset(filter->sensorBank->sensorXHistory, 0, sizeof(filter->sensorBank->sensorXHistory));
+    memset(filter->sensorBank->sensorYHistory, 0, sizeof(filter->sensorBank->sensorYHistory));
+    memset(filter->sensorBank->sensorZHistory, 0, sizeof(filter->sensorBank->sensorZHistory));
+    memset(filter->sensorBank->sensorOutputHistory, 0, sizeof(filter->sensorBank->sensorOutputHistory));
+    memset(filter->sensorBank->sensorOldestOutput, 0, sizeof(filter->sensorBank->sensorOldestOutput));
+    memset(filter->sensorBank->sensorPowerValue, 0, sizeof(filter->sensorBank->sensorPowerValue));
+    filter->sensorBank->sensorXIndex = 0;
+    filter->sensorBank->sensorYIndex = 0;
+    for (uint32_t i=0; i<FILTER_IIR_FILTER_COUNT; i++) {
+        filter->sensorBank->sensorZIndex[i] = 0;
+        filter->sensorBank->sensorOutputIndex[i] = 0;
+    }
+}
+
+// Returns the number of sensors the bank was initialized with.
+uint16_t filter_ctxGetSensorCount(filter_t *filter){
+    return filter->sensorCount;
+}
+
+// Copies one input per sensor into the FIR input history.
+void filter_ctxAddNewSensorInputs(filter_t *filter, const double x[]){
+    for (uint32_t s=0; s<filter->sensorCount; s++)
+        filter->sensorBank->sensorXHistory[filter->sensorBank->sensorXIndex][s] = x[s];
+    filter->sensorBank->sensorXIndex = (filter->sensorBank->sensorXIndex + 1) % X_QUEUE_SIZE;
+}
+
+// Runs the FIR-filter on every sensor and pushes the outputs into the IIR input history.
+void filter_ctxFirFilterSensors(filter_t *filter, double y[]){
+    filter_sensorDotProduct(filter->sensorBank->sensorXHistory, X_QUEUE_SIZE, filter->sensorBank->sensorXIndex, firCoefficients,
+                            FIR_FILTER_TAP_COUNT, filter->sensorBank->sensorYHistory[filter->sensorBank->sensorYIndex]);
+    if (y != NULL) {
+        for (uint32_t s=0; s<filter->sensorCount; s++)
+            y[s] = filter->sensorBank->sensorYHistory[filter->sensorBank->sensorYIndex][s];
+    }
+    filter->sensorBank->sensorYIndex = (filter->sensorBank->sensorYIndex + 1) % Y_QUEUE_SIZE;
+}
+
+// Runs IIR filter [filterNumber] on every sensor.
+void filter_ctxIirFilterSensors(filter_t *filter, uint16_t filterNumber){
+    filter_sensorLanes_t y;
+    filter_sensorLanes_t z;
+    filter_sensorDotProduct(filter->sensorBank->sensorYHistory, Y_QUEUE_SIZE, filter->sensorBank->sensorYIndex,
+                            iirBCoefficientConstants[filterNumber], IIR_B_COEFFICIENT_COUNT, y);
+    filter_sensorDotProduct(filter->sensorBank->sensorZHistory[filterNumber], Z_QUEUE_SIZE, filter->sensorBank->sensorZIndex[filterNumber],
+                            iirACoefficientConstants[filterNumber], IIR_A_COEFFICIENT_COUNT, z);
+    double *zSlot = filter->sensorBank->sensorZHistory[filterNumber][filter->sensorBank->sensorZIndex[filterNumber]];
+    double *outputSlot = filter->sensorBank->sensorOutputHistory[filterNumber][filter->sensorBank->sensorOutputIndex[filterNumber]];
+    for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++) {
+        filter->sensorBank->sensorOldestOutput[filterNumber][s] = outputSlot[s];
+        zSlot[s] = y[s] - z[s];
+        outputSlot[s] = y[s] - z[s];
+    }
+    filter->sensorBank->sensorZIndex[filterNumber] = (filter->sensorBank->sensorZIndex[filterNumber] + 1) % Z_QUEUE_SIZE;
+    filter->sensorBank->sensorOutputIndex[filterNumber] = (filter->sensorBank->sensorOutputIndex[filterNumber] + 1) % OUTPUT_QUEUE_SIZE;
+}
+
+// Updates the running power of IIR filter [filterNumber] on every sensor.
+void filter_ctxComputeSensorPower(filter_t *filter, uint16_t filterNumber, bool forceComputeFromScratch){
+    double *power = filter->sensorBank->sensorPowerValue[filterNumber];
+    filter_sensorLanes_t *outputHistory = filter->sensorBank->sensorOutputHistory[filterNumber];
+    if (forceComputeFromScratch) {
+        for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++)
+            power[s] = 0.0;
+        for (uint32_t i=0; i<OUTPUT_QUEUE_SIZE; i++) {
+            for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++)
+                power[s] += outputHistory[i][s] * outputHistory[i][s];
+        }
+        return;
+    }
+    // The newest value is the slot just written by filter_ctxIirFilterSensors().
+    uint32_t outputIndex = filter->sensorBank->sensorOutputIndex[filterNumber];
+    uint32_t newestIndex = (outputIndex == 0) ? OUTPUT_QUEUE_SIZE - 1 : outputIndex - 1;
+    const double *newest = outputHistory[newestIndex];
+    const double *oldest = filter->sensorBank->sensorOldestOutput[filterNumber];
+    for (uint32_t s=0; s<FILTER_MAX_SENSOR_COUNT; s++)
+        power[s] += (newest[s] * newest[s]) - (oldest[s] * oldest[s]);
+}
+
+// Copies the current power values of one sensor into powerValues[].
+void filter_ctxGetCurrentSensorPowerValues(filter_t *filter, uint16_t sensor, double powerValues[]){
+    for (uint32_t i=0; i<FILTER_FREQUENCY_COUNT; i++)
+        powerValues[i] = filter->sensorBank->sensorPowerValue[i][sensor];
+}
+
+// Default-instance versions of the sensor-bank functions.
+void filter_initSensors(uint16_t count){
+    filter_ctxInitSensors(&defaultFilter, count);
+}
+
+uint16_t filter_getSensorCount(){
+    return filter_ctxGetSensorCount(&defaultFilter);
+}
+
+void filter_addNewSensorInputs(const double x[]){
+    filter_ctxAddNewSensorInputs(&defaultFilter, x);
+}
+
+void filter_firFilterSensors(double y[]){
+    filter_ctxFirFilterSensors(&defaultFilter, y);
+}
+
+void filter_iirFilterSensors(uint16_t filterNumber){
+    filter_ctxIirFilterSensors(&defaultFilter, filterNumber);
+}
+
+void filter_computeSensorPower(uint16_t filterNumber, bool forceComputeFromScratch){
+    filter_ctxComputeSensorPower(&defaultFilter, filterNumber, forceComputeFromScratch);
+}
+
+void filter_getCurrentSensorPowerValues(uint16_t sensor, double powerValues[]){
+    filter_ctxGetCurrentSensorPowerValues(&defaultFilter, sensor, powerValues);
+}
+
 /*********************************************************************************************************
 ********************************** Verification-assisting functions.
 **************************************
@@ -243,7 +533,7 @@ uint32_t filter_getIirBCoefficientCount(){
 
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize(){
-  return queue_size(&yQueue);
+  return queue_size(&defaultFilter.yQueue.queue);
 }
 
 // Returns the decimation value.
@@ -253,24 +543,22 @@ uint16_t filter_getDecimationValue(){
 
 // Returns the address of xQueue.
 queue_t *filter_getXQueue(){
-  return &xQueue;
+  return &defaultFilter.xQueue.queue;
 }
 
 // Returns the address of yQueue.
 queue_t *filter_getYQueue(){
-  return &yQueue;
+  return &defaultFilter.yQueue.queue;
 }
 
 // Returns the address of zQueue for a specific filter number.
 queue_t *filter_getZQueue(uint16_t filterNumber){
-  return &zQueue[filterNumber];
+  return &defaultFilter.zQueue[filterNumber].queue;
 }
 
 // Returns the address of the IIR output-queue for a specific filter-number.
 queue_t *filter_getIirOutputQueue(uint16_t filterNumber){
-  return &outputQueue[filterNumber];
+  return &defaultFilter.outputQueue[filterNumber].queue;
 }
 
 // void filter_runTest();
-
-#endif /* FILTER_H_ */
\ No newline at end of file
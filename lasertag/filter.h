@@ -11,6 +11,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define FILTER_H_
 
 #include "queue.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
@@ -26,6 +27,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // the code. The transmitter will also use these.
 static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
     68, 58, 50, 44, 38, 34, 30, 28, 26, 24};
+#define FILTER_MAX_SENSOR_COUNT                                                \
+  4 // Sensor lanes in the multi-sensor filter bank (see ISR_MAX_SENSOR_COUNT).
 
 // Filtering routines for the laser-tag project.
 // Filtering is performed by a two-stage filter, as described below.
@@ -41,11 +44,18 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 **********************************************************************************************************/
 
 // Must call this prior to using any filter functions.
+// Calling it again resets the filter in place: the queues allocated by the
+// first call are reused and zeroed, and the power values are zeroed to match.
 void filter_init();
 
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
 void filter_addNewInput(double x);
 
+// Zeros everything downstream of the FIR input (yQueue, zQueues, outputQueues
+// and the power values) so the IIR filters restart from rest. xQueue is left
+// alone. Call filter_computePower() with force == true afterwards.
+void filter_resetIirState();
+
 // Fills a queue with the given fillValue. For example,
 // if the queue is of size 10, and the fillValue = 1.0,
 // after executing this function, the queue will contain 10 values
@@ -94,6 +104,84 @@ void filter_getCurrentPowerValues(double powerValues[]);
 void filter_getNormalizedPowerValues(double normalizedArray[],
                                      uint16_t *indexOfMaxValue);
 
+/*********************************************************************************************************
+*************************************** Multi-sensor Filter Bank
+*****************************************
+**********************************************************************************************************/
+
+// The same FIR/IIR/power pipeline, run on up to FILTER_MAX_SENSOR_COUNT sensors
+// at once. Histories are interleaved by sensor so each coefficient is loaded
+// once and applied to every sensor lane in a tight inner loop.
+
+// Must call this prior to using the sensor-bank functions. Zeros all state.
+void filter_initSensors(uint16_t sensorCount);
+
+// Returns the number of sensors the bank was initialized with.
+uint16_t filter_getSensorCount();
+
+// Copies one input per sensor into the FIR input history.
+void filter_addNewSensorInputs(const double x[]);
+
+// Runs the FIR-filter on every sensor. Outputs are pushed into the IIR input
+// history and also copied into y[] if y is not NULL.
+void filter_firFilterSensors(double y[]);
+
+// Runs IIR filter [filterNumber] on every sensor.
+void filter_iirFilterSensors(uint16_t filterNumber);
+
+// Updates the running power of IIR filter [filterNumber] on every sensor. If
+// forceComputeFromScratch is true, the power is summed over the whole window.
+void filter_computeSensorPower(uint16_t filterNumber,
+                               bool forceComputeFromScratch);
+
+// Copies the current power values of one sensor into powerValues[].
+void filter_getCurrentSensorPowerValues(uint16_t sensor, double powerValues[]);
+
+/*********************************************************************************************************
+****************************************** Filter Instances
+*******************************************
+**********************************************************************************************************/
+
+// All filter state lives in a filter_t, so several pipelines can run in one
+// process (one per simulated gun, one per test thread). The functions above
+// and the sensor-bank functions operate on a default instance; every one of
+// them has a filter_ctxXxx() version that takes the instance to use. Two
+// threads may run filters concurrently as long as they use different
+// instances.
+typedef struct filter_t filter_t;
+
+// Allocates and initializes a new instance. Returns NULL if out of memory.
+filter_t *filter_create();
+
+// Frees an instance returned by filter_create().
+void filter_destroy(filter_t *filter);
+
+// Returns the instance used by the functions that take no filter_t.
+filter_t *filter_getDefault();
+
+void filter_ctxInit(filter_t *filter);
+void filter_ctxAddNewInput(filter_t *filter, double x);
+void filter_ctxResetIirState(filter_t *filter);
+double filter_ctxFirFilter(filter_t *filter);
+double filter_ctxIirFilter(filter_t *filter, uint16_t filterNumber);
+double filter_ctxComputePower(filter_t *filter, uint16_t filterNumber,
+                              bool forceComputeFromScratch, bool debugPrint);
+double filter_ctxGetCurrentPowerValue(filter_t *filter, uint16_t filterNumber);
+void filter_ctxGetCurrentPowerValues(filter_t *filter, double powerValues[]);
+void filter_ctxGetNormalizedPowerValues(filter_t *filter,
+                                        double normalizedArray[],
+                                        uint16_t *indexOfMaxValue);
+
+void filter_ctxInitSensors(filter_t *filter, uint16_t sensorCount);
+uint16_t filter_ctxGetSensorCount(filter_t *filter);
+void filter_ctxAddNewSensorInputs(filter_t *filter, const double x[]);
+void filter_ctxFirFilterSensors(filter_t *filter, double y[]);
+void filter_ctxIirFilterSensors(filter_t *filter, uint16_t filterNumber);
+void filter_ctxComputeSensorPower(filter_t *filter, uint16_t filterNumber,
+                                  bool forceComputeFromScratch);
+void filter_ctxGetCurrentSensorPowerValues(filter_t *filter, uint16_t sensor,
+                                           double powerValues[]);
+
 /*********************************************************************************************************
 ********************************** Verification-assisting functions.
 **************************************
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include "fsm.h"
+#include "virtualTimer.h"
+
+// One traced transition.
+typedef struct {
+	const fsm_machine_t *machine;
+	uint32_t millisecond;
+	uint8_t from;
+	uint8_t to;
+} fsm_traceEntry_t;
+
+static fsm_traceEntry_t trace[FSM_TRACE_LENGTH];
+static uint32_t traceCount; // Transitions recorded since the trace was emptied.
+
+// Records a transition in the trace.
+void fsm_traceTransition(const fsm_machine_t *machine, uint8_t from, uint8_t to){
+	fsm_traceEntry_t *entry = &trace[traceCount % FSM_TRACE_LENGTH];
+	entry->machine = machine;
+	entry->millisecond = virtualTimer_getMilliseconds();
+	entry->from = from;
+	entry->to = to;
+	++traceCount;
+}
+
+// Prints the traced transitions, oldest first, and empties the trace.
+void fsm_printTrace(){
+	uint32_t count = traceCount;
+	uint32_t first = (count > FSM_TRACE_LENGTH) ? count - FSM_TRACE_LENGTH : 0;
+	if(first > 0)
+		printf("fsm trace: %lu older transitions dropped\n", (unsigned long)first);
+	for(uint32_t i = first; i < count; ++i){
+		const fsm_traceEntry_t *entry = &trace[i % FSM_TRACE_LENGTH];
+		printf("%8lu ms %s: %s -> %s\n", (unsigned long)entry->millisecond, entry->machine->name,
+			entry->machine->states[entry->from].name, entry->machine->states[entry->to].name);
+	}
+	fsm_clearTrace();
+}
+
+// Empties the trace.
+void fsm_clearTrace(){
+	traceCount = 0;
+}
@@ -0,0 +1,163 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FSM_H_
+#define FSM_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// fsm turns a state machine written as two tables into its tick function. The
+// tables are X-macro lists in the machine's .c file, an entry a line (the
+// backslashes continuing the lines are left out here):
+//
+//   #define LOCKOUT_TIMER_STATES(S)
+//     S(init_st, fsm_noAction)
+//     S(timer_running_st, lockoutTimer_count)
+//   #define LOCKOUT_TIMER_TRANSITIONS(T)
+//     T(timer_running_st, lockoutTimer_expired, init_st, fsm_noAction)
+//
+// S(state, action) is a state and the action run on every tick that ends in
+// it. T(from, guard, to, action) is a transition: on a tick that starts in
+// from, if guard() returns true the machine goes to to and action() runs.
+// Only the first transition out of a state whose guard is true is taken, in
+// the order of the list. A transition from FSM_ANY_STATE leaves every state,
+// itself included. Guards and actions are functions without arguments,
+// usually static ones next to the tables.
+//
+// FSM_DEFINE_MACHINE() expands the lists into const tables of the states and
+// transitions, which the trace and fsm_interpret() read. FSM_TICK() expands
+// them at compile time into the tick itself, a chain of guarded transitions
+// and a switch over the state actions, so the guards and actions are direct
+// calls the compiler inlines, the same code as a hand-written pair of
+// switches.
+//
+// Build with FSM_TRACE_ENABLED defined (cmake -DFSM_TRACE=1) to record every
+// transition of every machine in a ring buffer, see fsm_printTrace(). Without
+// it FSM_TRACE() generates no code and the tick does not change.
+
+#define FSM_TRACE_LENGTH 256 // Transitions kept, the newest ones.
+#define FSM_ANY_STATE 0xFF    // From state of a transition out of every state.
+
+typedef bool (*fsm_guard_t)();
+typedef void (*fsm_action_t)();
+
+// One state in the const tables.
+typedef struct {
+  const char *name;
+  fsm_action_t action;
+} fsm_stateInfo_t;
+
+// One transition in the const tables.
+typedef struct {
+  uint8_t from;
+  uint8_t to;
+  fsm_guard_t guard;
+  fsm_action_t action;
+} fsm_transition_t;
+
+// The const tables of a machine.
+typedef struct {
+  const char *name;
+  const fsm_stateInfo_t *states;
+  uint8_t stateCount;
+  const fsm_transition_t *transitions;
+  uint8_t transitionCount;
+} fsm_machine_t;
+
+// Guard of a transition taken on the first tick in its state.
+static inline bool fsm_always() { return true; }
+
+// Action of a state or transition that does nothing.
+static inline void fsm_noAction() {}
+
+// Records a transition in the trace. Invoked by FSM_TRACE().
+void fsm_traceTransition(const fsm_machine_t *machine, uint8_t from,
+                         uint8_t to);
+
+#ifdef FSM_TRACE_ENABLED
+#define FSM_TRACE(machine, from, to) fsm_traceTransition(machine, from, to)
+#else
+#define FSM_TRACE(machine, from, to) ((void)(machine)) // Keeps the tables used.
+#endif
+
+#define FSM_STATE_ENUM(state, action) state,
+#define FSM_STATE_INFO(state, action) {#state, action},
+#define FSM_TRANSITION_INFO(from, guard, to, action) {from, to, guard, action},
+#define FSM_TRANSITION_IF(from, guard, to, action)                             \
+  if (((from) == FSM_ANY_STATE || fsmFrom == (from)) && guard()) {             \
+    fsmTo = (to);                                                              \
+    action();                                                                  \
+    break;                                                                     \
+  }
+#define FSM_STATE_ACTION_CASE(state, action)                                   \
+  case state:                                                                  \
+    action();                                                                  \
+    break;
+
+// Declares the enum type of the states, in list order.
+#define FSM_DECLARE_STATES(type, STATES)                                       \
+  typedef enum { STATES(FSM_STATE_ENUM) } type
+
+// Defines the const tables of a machine as a static fsm_machine_t. The guards
+// and actions must be declared first.
+#define FSM_DEFINE_MACHINE(machine, name, STATES, TRANSITIONS)                 \
+  static const fsm_stateInfo_t machine##States[] = {STATES(FSM_STATE_INFO)};   \
+  static const fsm_transition_t machine##Transitions[] = {                     \
+      TRANSITIONS(FSM_TRANSITION_INFO)};                                       \
+  static const fsm_machine_t machine = {                                       \
+      name, machine##States,                                                   \
+      sizeof(machine##States) / sizeof(machine##States[0]),                    \
+      machine##Transitions,                                                    \
+      sizeof(machine##Transitions) / sizeof(machine##Transitions[0])}
+
+// Runs one tick of a machine on stateVariable: the first transition out of
+// the current state whose guard is true, then the action of the state the
+// tick ends in. The transition action runs before stateVariable changes.
+#define FSM_TICK(machine, STATES, TRANSITIONS, stateVariable)                  \
+  do {                                                                         \
+    uint8_t fsmFrom = (stateVariable);                                         \
+    uint8_t fsmTo = fsmFrom;                                                   \
+    do {                                                                       \
+      TRANSITIONS(FSM_TRANSITION_IF)                                           \
+    } while (0);                                                               \
+    if (fsmTo != fsmFrom) {                                                    \
+      FSM_TRACE(&(machine), fsmFrom, fsmTo);                                   \
+      (stateVariable) = fsmTo;                                                 \
+    }                                                                          \
+    switch (fsmTo) { STATES(FSM_STATE_ACTION_CASE) }                           \
+  } while (0)
+
+// Runs one tick of a machine from its const tables instead of generated code,
+// with the same rules as FSM_TICK(). Returns the new state. Used to check and
+// time the generated ticks against the tables they came from.
+static inline uint8_t fsm_interpret(const fsm_machine_t *machine,
+                                    uint8_t state) {
+  for (uint8_t i = 0; i < machine->transitionCount; ++i) {
+    const fsm_transition_t *transition = &machine->transitions[i];
+    if ((transition->from == FSM_ANY_STATE || transition->from == state) &&
+        transition->guard()) {
+      transition->action();
+      FSM_TRACE(machine, state, transition->to);
+      state = transition->to;
+      break;
+    }
+  }
+  machine->states[state].action();
+  return state;
+}
+
+// Prints the traced transitions, oldest first, with the virtualTimer
+// millisecond each was taken in, and empties the trace. The machines keep
+// running from the ISR, so a transition taken while printing may be torn.
+void fsm_printTrace();
+
+// Empties the trace.
+void fsm_clearTrace();
+
+#endif /* FSM_H_ */
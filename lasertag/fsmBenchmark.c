@@ -0,0 +1,519 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host benchmark of the fsm engine against hand-written state machines.
+//   fsmBenchmark [JSON file]
+// Rebuilds three lasertag machines on plain variables, so only the dispatch
+// differs, and times a tick of each:
+//   lockoutTimer  started again every 700 ticks
+//   transmitter   tick-table mode, a 200 ms shot every 500 ms, cycling through
+//                 the player frequencies
+//   trigger       the shift-register debounce, a bouncing press every 300
+//                 ticks, disabled for a while every 20000
+// Implementations:
+//   switch     the pair of switches the machines were written as by hand
+//   fsmTick    FSM_TICK() code generated from the tables
+//   interpret  fsm_interpret() walking the const tables
+// Every implementation must produce the same outputs, which the JSON reports
+// as checksumsMatch. Each time is the fastest of BENCHMARK_REPEAT_COUNT runs
+// and includes the per-tick stimulus, the same for all three.
+// Built with the emulator build (cmake -DEMU=1).
+
+#ifdef main
+#undef main // The emulator build renames main() for its own entry point.
+#endif
+
+#include <stdio.h>
+#include <time.h>
+#include "filter.h"
+#include "fsm.h"
+
+#define BENCHMARK_TICK_COUNT 10000000 // Per measurement.
+#define BENCHMARK_REPEAT_COUNT 9
+#define NANOSECONDS_PER_SECOND 1000000000.0
+
+typedef enum {
+	IMPLEMENTATION_SWITCH,
+	IMPLEMENTATION_FSM_TICK,
+	IMPLEMENTATION_INTERPRET,
+	IMPLEMENTATION_COUNT
+} fsmBenchmark_implementation_t;
+
+static const char *implementationNames[IMPLEMENTATION_COUNT] = {
+	[IMPLEMENTATION_SWITCH] = "switch",
+	[IMPLEMENTATION_FSM_TICK] = "fsmTick",
+	[IMPLEMENTATION_INTERPRET] = "interpret",
+};
+
+static uint32_t outputs; // What the machines did, read into the checksum every tick.
+
+/************************** lockoutTimer **************************/
+
+#define LOCKOUT_EXPIRE_VALUE 500
+#define LOCKOUT_RESTART_TICKS 700
+#define LOCKOUT_STATES(S) \
+	S(lockoutIdle_st, fsm_noAction) \
+	S(lockoutRunning_st, lockout_count)
+#define LOCKOUT_TRANSITIONS(T) \
+	T(lockoutRunning_st, lockout_expired, lockoutIdle_st, fsm_noAction)
+
+FSM_DECLARE_STATES(lockout_st_t, LOCKOUT_STATES);
+static lockout_st_t lockoutState;
+static uint32_t lockoutTicks;
+
+// Returns true once the timer has run out.
+static bool lockout_expired(){
+	return lockoutTicks >= LOCKOUT_EXPIRE_VALUE;
+}
+
+// Counts a tick while running.
+static void lockout_count(){
+	++lockoutTicks;
+}
+
+FSM_DEFINE_MACHINE(lockoutMachine, "lockoutTimer", LOCKOUT_STATES, LOCKOUT_TRANSITIONS);
+
+// Hand-written tick.
+static void lockout_switchTick(){
+	switch(lockoutState){
+		case lockoutIdle_st:
+			break;
+		case lockoutRunning_st:
+			if(lockoutTicks >= LOCKOUT_EXPIRE_VALUE){
+				lockoutState = lockoutIdle_st;
+			}
+			break;
+	}
+	switch(lockoutState){
+		case lockoutIdle_st:
+			break;
+		case lockoutRunning_st:
+			++lockoutTicks;
+			break;
+	}
+}
+
+// Generated tick.
+static void lockout_fsmTick(){
+	FSM_TICK(lockoutMachine, LOCKOUT_STATES, LOCKOUT_TRANSITIONS, lockoutState);
+}
+
+// Interpreted tick.
+static void lockout_interpretTick(){
+	lockoutState = fsm_interpret(&lockoutMachine, lockoutState);
+}
+
+// Stops the timer.
+static void lockout_reset(){
+	lockoutState = lockoutIdle_st;
+	lockoutTicks = 0;
+}
+
+// Starts the timer every LOCKOUT_RESTART_TICKS.
+static void lockout_stimulate(uint32_t tick){
+	if(tick % LOCKOUT_RESTART_TICKS == 0){
+		lockoutTicks = 0;
+		lockoutState = lockoutRunning_st;
+	}
+}
+
+// Returns what the rest of the program could see of the timer.
+static uint32_t lockout_observe(){
+	return lockoutState + lockoutTicks;
+}
+
+/************************** transmitter **************************/
+
+#define TRANSMITTER_SHOT_TICKS 20000
+#define TRANSMITTER_SHOT_PERIOD 50000
+#define TRANSMITTER_STATES(S) \
+	S(transmitterInit_st, fsm_noAction) \
+	S(transmitterOff_st, fsm_noAction) \
+	S(transmitterHigh_st, transmitter_count) \
+	S(transmitterLow_st, transmitter_count)
+#define TRANSMITTER_TRANSITIONS(T) \
+	T(transmitterInit_st, fsm_always, transmitterOff_st, transmitter_goLow) \
+	T(transmitterOff_st, transmitter_startRequested, transmitterHigh_st, transmitter_startShot) \
+	T(transmitterHigh_st, transmitter_shotOver, transmitterOff_st, transmitter_goLow) \
+	T(transmitterHigh_st, transmitter_halfOver, transmitterLow_st, transmitter_goLow) \
+	T(transmitterLow_st, transmitter_shotOver, transmitterOff_st, fsm_noAction) \
+	T(transmitterLow_st, transmitter_halfOver, transmitterHigh_st, transmitter_goHigh)
+
+FSM_DECLARE_STATES(transmitter_st_t, TRANSMITTER_STATES);
+static transmitter_st_t transmitterState;
+static bool startRunning;
+static uint32_t counter, timeCounter, halfPeriodTicks;
+static uint32_t pin, pinWrites;
+
+// Returns true if a shot was asked for.
+static bool transmitter_startRequested(){
+	return startRunning;
+}
+
+// Returns true once the shot is over.
+static bool transmitter_shotOver(){
+	return timeCounter > TRANSMITTER_SHOT_TICKS;
+}
+
+// Returns true if half a period has elapsed.
+static bool transmitter_halfOver(){
+	return counter >= halfPeriodTicks;
+}
+
+// Writes the output pin.
+static void transmitter_writePin(uint32_t level){
+	pin = level;
+	++pinWrites;
+}
+
+// Starts the low half of a period, or stops the output.
+static void transmitter_goLow(){
+	counter = 0;
+	transmitter_writePin(0);
+}
+
+// Starts the high half of a period.
+static void transmitter_goHigh(){
+	counter = 0;
+	transmitter_writePin(1);
+}
+
+// Starts a shot.
+static void transmitter_startShot(){
+	startRunning = false;
+	counter = 0;
+	timeCounter = 0;
+	transmitter_writePin(1);
+}
+
+// Counts a tick of the shot.
+static void transmitter_count(){
+	++counter;
+	++timeCounter;
+}
+
+FSM_DEFINE_MACHINE(transmitterMachine, "transmitter", TRANSMITTER_STATES, TRANSMITTER_TRANSITIONS);
+
+// Hand-written tick.
+static void transmitter_switchTick(){
+	switch(transmitterState){
+		case transmitterInit_st:
+			transmitterState = transmitterOff_st;
+			counter = 0;
+			transmitter_writePin(0);
+			break;
+		case transmitterOff_st:
+			if(startRunning){
+				transmitterState = transmitterHigh_st;
+				startRunning = false;
+				counter = 0;
+				timeCounter = 0;
+				transmitter_writePin(1);
+			}
+			break;
+		case transmitterHigh_st:
+			if(timeCounter > TRANSMITTER_SHOT_TICKS){
+				transmitterState = transmitterOff_st;
+				counter = 0;
+				transmitter_writePin(0);
+			}
+			else if(counter >= halfPeriodTicks){
+				transmitterState = transmitterLow_st;
+				counter = 0;
+				transmitter_writePin(0);
+			}
+			break;
+		case transmitterLow_st:
+			if(timeCounter > TRANSMITTER_SHOT_TICKS){
+				transmitterState = transmitterOff_st;
+			}
+			else if(counter >= halfPeriodTicks){
+				transmitterState = transmitterHigh_st;
+				counter = 0;
+				transmitter_writePin(1);
+			}
+			break;
+	}
+	switch(transmitterState){
+		case transmitterInit_st:
+			break;
+		case transmitterOff_st:
+			break;
+		case transmitterHigh_st:
+			++counter;
+			++timeCounter;
+			break;
+		case transmitterLow_st:
+			++counter;
+			++timeCounter;
+			break;
+	}
+}
+
+// Generated tick.
+static void transmitter_fsmTick(){
+	FSM_TICK(transmitterMachine, TRANSMITTER_STATES, TRANSMITTER_TRANSITIONS, transmitterState);
+}
+
+// Interpreted tick.
+static void transmitter_interpretTick(){
+	transmitterState = fsm_interpret(&transmitterMachine, transmitterState);
+}
+
+// Puts the transmitter back in init.
+static void transmitter_reset(){
+	transmitterState = transmitterInit_st;
+	startRunning = false;
+	counter = 0;
+	timeCounter = 0;
+	pin = 0;
+	pinWrites = 0;
+}
+
+// Fires a shot every TRANSMITTER_SHOT_PERIOD ticks at the next frequency.
+static void transmitter_stimulate(uint32_t tick){
+	if(tick % TRANSMITTER_SHOT_PERIOD == 0){
+		halfPeriodTicks = filter_frequencyTickTable[(tick / TRANSMITTER_SHOT_PERIOD) % FILTER_FREQUENCY_COUNT] / 2;
+		startRunning = true;
+	}
+}
+
+// Returns what the rest of the program could see of the transmitter.
+static uint32_t transmitter_observe(){
+	return transmitterState + pin + pinWrites;
+}
+
+/**************************** trigger ****************************/
+
+#define TRIGGER_PRESS_MASK 0x3 // Two samples.
+#define TRIGGER_RELEASE_MASK 0xFFFFF // Twenty samples.
+#define TRIGGER_PRESS_PERIOD 300
+#define TRIGGER_PRESS_TICKS 120
+#define TRIGGER_BOUNCE_TICKS 6
+#define TRIGGER_DISABLE_PERIOD 20000
+#define TRIGGER_DISABLE_TICKS 1000
+#define TRIGGER_SHOTS 10
+#define TRIGGER_STATES(S) \
+	S(triggerInit_st, trigger_clearShotFired) \
+	S(triggerReleased_st, fsm_noAction) \
+	S(triggerPressed_st, trigger_fire)
+#define TRIGGER_TRANSITIONS(T) \
+	T(FSM_ANY_STATE, trigger_disabled, triggerInit_st, fsm_noAction) \
+	T(triggerInit_st, fsm_always, triggerReleased_st, trigger_clearShotFired) \
+	T(triggerReleased_st, trigger_pressSettled, triggerPressed_st, trigger_startPress) \
+	T(triggerPressed_st, trigger_releaseSettled, triggerReleased_st, trigger_clearShotFired)
+
+FSM_DECLARE_STATES(trigger_st_t, TRIGGER_STATES);
+static trigger_st_t triggerState;
+static bool enabled, shotFired, pressed;
+static uint32_t sampleHistory, shotsRemaining, pressShotsLeft, shots;
+static uint32_t noise = 1; // Bounce of the contacts, a linear congruential generator.
+
+// Returns true if the trigger is disabled.
+static bool trigger_disabled(){
+	return !enabled;
+}
+
+// Returns true if the press has settled and there are shots left.
+static bool trigger_pressSettled(){
+	return (sampleHistory & TRIGGER_PRESS_MASK) == TRIGGER_PRESS_MASK && shotsRemaining > 0;
+}
+
+// Returns true if the release has settled.
+static bool trigger_releaseSettled(){
+	return (sampleHistory & TRIGGER_RELEASE_MASK) == 0;
+}
+
+// Clears the pressed flag.
+static void trigger_clearShotFired(){
+	shotFired = false;
+}
+
+// Starts a press.
+static void trigger_startPress(){
+	shotFired = true;
+	pressShotsLeft = 1;
+}
+
+// Fires the shot of the press.
+static void trigger_fire(){
+	if(pressShotsLeft > 0 && shotsRemaining > 0){
+		--pressShotsLeft;
+		--shotsRemaining;
+		++shots;
+	}
+}
+
+FSM_DEFINE_MACHINE(triggerMachine, "trigger", TRIGGER_STATES, TRIGGER_TRANSITIONS);
+
+// Samples the trigger, as every implementation does before its machine.
+static void trigger_sample(){
+	sampleHistory = (sampleHistory << 1) | pressed;
+}
+
+// Hand-written tick.
+static void trigger_switchTick(){
+	trigger_sample();
+	if(!enabled){
+		triggerState = triggerInit_st;
+	}
+	switch(triggerState){
+		case triggerInit_st:
+			shotFired = false;
+			if(enabled){
+				triggerState = triggerReleased_st;
+			}
+			break;
+		case triggerReleased_st:
+			if((sampleHistory & TRIGGER_PRESS_MASK) == TRIGGER_PRESS_MASK && shotsRemaining > 0){
+				triggerState = triggerPressed_st;
+				shotFired = true;
+				pressShotsLeft = 1;
+			}
+			break;
+		case triggerPressed_st:
+			if((sampleHistory & TRIGGER_RELEASE_MASK) == 0){
+				triggerState = triggerReleased_st;
+				shotFired = false;
+			}
+			break;
+	}
+	switch(triggerState){
+		case triggerInit_st:
+			break;
+		case triggerReleased_st:
+			break;
+		case triggerPressed_st:
+			trigger_fire();
+			break;
+	}
+}
+
+// Generated tick.
+static void trigger_fsmTick(){
+	trigger_sample();
+	FSM_TICK(triggerMachine, TRIGGER_STATES, TRIGGER_TRANSITIONS, triggerState);
+}
+
+// Interpreted tick.
+static void trigger_interpretTick(){
+	trigger_sample();
+	triggerState = fsm_interpret(&triggerMachine, triggerState);
+}
+
+// Puts the trigger back in init, enabled and loaded.
+static void trigger_reset(){
+	triggerState = triggerInit_st;
+	enabled = true;
+	shotFired = false;
+	pressed = false;
+	sampleHistory = 0;
+	shotsRemaining = TRIGGER_SHOTS;
+	pressShotsLeft = 0;
+	shots = 0;
+	noise = 1;
+}
+
+// Presses the trigger every TRIGGER_PRESS_PERIOD ticks with bouncing contacts,
+// reloads when it runs dry and disables it for a while now and then.
+static void trigger_stimulate(uint32_t tick){
+	uint32_t phase = tick % TRIGGER_PRESS_PERIOD;
+	noise = noise * 1664525 + 1013904223;
+	if(phase < TRIGGER_BOUNCE_TICKS || (phase >= TRIGGER_PRESS_TICKS && phase < TRIGGER_PRESS_TICKS + TRIGGER_BOUNCE_TICKS))
+		pressed = noise >> 31;
+	else
+		pressed = phase < TRIGGER_PRESS_TICKS;
+	if(shotsRemaining == 0 && phase == 0)
+		shotsRemaining = TRIGGER_SHOTS;
+	enabled = tick % TRIGGER_DISABLE_PERIOD >= TRIGGER_DISABLE_TICKS;
+}
+
+// Returns what the rest of the program could see of the trigger.
+static uint32_t trigger_observe(){
+	return triggerState + shotFired + shotsRemaining + shots;
+}
+
+/**************************** driver ****************************/
+
+// One machine and its three ticks.
+typedef struct {
+	const char *name;
+	void (*reset)();
+	void (*stimulate)(uint32_t tick);
+	uint32_t (*observe)();
+	void (*tick[IMPLEMENTATION_COUNT])();
+} fsmBenchmark_machine_t;
+
+static const fsmBenchmark_machine_t machines[] = {
+	{"lockoutTimer", lockout_reset, lockout_stimulate, lockout_observe,
+		{lockout_switchTick, lockout_fsmTick, lockout_interpretTick}},
+	{"transmitter", transmitter_reset, transmitter_stimulate, transmitter_observe,
+		{transmitter_switchTick, transmitter_fsmTick, transmitter_interpretTick}},
+	{"trigger", trigger_reset, trigger_stimulate, trigger_observe,
+		{trigger_switchTick, trigger_fsmTick, trigger_interpretTick}},
+};
+#define MACHINE_COUNT (sizeof(machines) / sizeof(machines[0]))
+
+// Returns a monotonic time in seconds.
+static double fsmBenchmark_now(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// Runs BENCHMARK_TICK_COUNT ticks of one implementation of a machine and
+// returns the seconds they took. Stores the sum of the observed outputs.
+static double fsmBenchmark_run(const fsmBenchmark_machine_t *machine, fsmBenchmark_implementation_t implementation, uint64_t *checksum){
+	void (*tick)() = machine->tick[implementation];
+	uint64_t sum = 0;
+	machine->reset();
+	double start = fsmBenchmark_now();
+	for(uint32_t i = 0; i < BENCHMARK_TICK_COUNT; ++i){
+		machine->stimulate(i);
+		tick();
+		sum += machine->observe();
+	}
+	double seconds = fsmBenchmark_now() - start;
+	*checksum = sum;
+	outputs += (uint32_t)sum;
+	return seconds;
+}
+
+int main(int argc, char *argv[]){
+	FILE *out = stdout;
+	if(argc > 1 && (out = fopen(argv[1], "w")) == NULL){
+		fprintf(stderr, "fsmBenchmark: cannot open %s\n", argv[1]);
+		return 1;
+	}
+	bool checksumsMatch = true;
+	fprintf(out, "{\n  \"benchmark\": \"fsm\",\n  \"ticksPerMeasurement\": %u,\n  \"repeats\": %u,\n  \"results\": [",
+		BENCHMARK_TICK_COUNT, BENCHMARK_REPEAT_COUNT);
+	for(uint16_t m = 0; m < MACHINE_COUNT; ++m){
+		double fastest[IMPLEMENTATION_COUNT];
+		uint64_t checksums[IMPLEMENTATION_COUNT];
+		for(uint16_t repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; ++repeat){	//Interleaved, so drift hits all alike
+			for(uint16_t implementation = 0; implementation < IMPLEMENTATION_COUNT; ++implementation){
+				double seconds = fsmBenchmark_run(&machines[m], implementation, &checksums[implementation]);
+				if(repeat == 0 || seconds < fastest[implementation])
+					fastest[implementation] = seconds;
+			}
+		}
+		for(uint16_t implementation = 0; implementation < IMPLEMENTATION_COUNT; ++implementation){
+			if(checksums[implementation] != checksums[IMPLEMENTATION_SWITCH])
+				checksumsMatch = false;
+			fprintf(out, "%s\n    {\"machine\": \"%s\", \"implementation\": \"%s\", \"nsPerTick\": %.3f, \"checksum\": %llu}",
+				(m == 0 && implementation == 0) ? "" : ",", machines[m].name, implementationNames[implementation],
+				fastest[implementation] * NANOSECONDS_PER_SECOND / BENCHMARK_TICK_COUNT, (unsigned long long)checksums[implementation]);
+		}
+	}
+	fprintf(out, "\n  ],\n  \"checksumsMatch\": %s\n}\n", checksumsMatch ? "true" : "false");
+	if(out != stdout)
+		fclose(out);
+	return checksumsMatch ? 0 : 1;
+}
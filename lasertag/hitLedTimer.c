@@ -5,20 +5,32 @@
 #include "mio.h"
 #include "hitLedTimer.h"
 #include "buttons.h"
+#include "fsm.h"
 
 // The lockouttimer_HLT is active for 1/2 second once it is started.
 // It is used to lock-out the detector once a hit has been detected.
 // This ensure that only one hit is detected per 1/2-second interval.
 
-#define HIT_LED_TIMER_EXPIRE_VALUE 50000 // Defined in terms of 100 kHz ticks.
+#define HIT_LED_TIMER_EXPIRE_VALUE 500 // Defined in terms of 1 kHz slow-lane ticks.
 #define HIT_LED_TIMER_OUTPUT_PIN 11      // JF-3
 #define LED_HIGH_VALUE 1
 #define LED_LOW_VALUE 0
 #define TEST_DELAY 500
 
+// The LED is lit while the timer runs. Nothing enters disabled_st; it is
+// kept so a disabled timer could show as its own state.
+#define HIT_LED_TIMER_STATES(S) \
+	S(init_st, hitLedTimer_showOff) \
+	S(timer_running_st, hitLedTimer_showOnAndCount) \
+	S(disabled_st, hitLedTimer_showOff)
+#define HIT_LED_TIMER_TRANSITIONS(T) \
+	T(timer_running_st, hitLedTimer_expired, init_st, fsm_noAction) \
+	T(disabled_st, hitLedTimer_enabled, init_st, fsm_noAction)
+
 static uint32_t timer_HLT;
 volatile static bool enabled = false;
-enum hitLed_st {init_st, timer_running_st, disabled_st} currentState_HLT = init_st;
+FSM_DECLARE_STATES(hitLedTimer_st_t, HIT_LED_TIMER_STATES);
+static hitLedTimer_st_t currentState_HLT = init_st;
 
 // Calling this starts the timer.
 void hitLedTimer_start(){
@@ -33,6 +45,15 @@ bool hitLedTimer_running(){
 	return currentState_HLT == timer_running_st;
 }
 
+// Returns the number of 1 kHz ticks until the timer expires, 0 if it is not
+// running.
+uint32_t hitLedTimer_getRemainingTicks(){
+	uint32_t ticks = timer_HLT;
+	if(!hitLedTimer_running() || ticks >= HIT_LED_TIMER_EXPIRE_VALUE)
+		return 0;
+	return HIT_LED_TIMER_EXPIRE_VALUE - ticks;
+}
+
 // Need to init things.
 void hitLedTimer_init(){
 	leds_init(false);
@@ -61,38 +82,34 @@ void hitLedTimer_enable(){
     enabled = true;
 }
 
+// Returns true once the LED has been lit for HIT_LED_TIMER_EXPIRE_VALUE ticks.
+static bool hitLedTimer_expired(){
+	return timer_HLT >= HIT_LED_TIMER_EXPIRE_VALUE;
+}
+
+// Returns true if the timer is enabled.
+static bool hitLedTimer_enabled(){
+	return enabled;
+}
+
+// Turns the gun's hit-LED and LD0 off.
+static void hitLedTimer_showOff(){
+	hitLedTimer_turnLedOff();
+	leds_write(0);
+}
+
+// Turns the gun's hit-LED and LD0 on and counts a tick.
+static void hitLedTimer_showOnAndCount(){
+	hitLedTimer_turnLedOn();
+	leds_write(1);
+	++timer_HLT;
+}
+
+FSM_DEFINE_MACHINE(hitLedTimerMachine, "hitLedTimer", HIT_LED_TIMER_STATES, HIT_LED_TIMER_TRANSITIONS);
+
 // Standard tick function.
 void hitLedTimer_tick(){
-	//State updates
-    switch (currentState_HLT){
-        case init_st:
-            break;
-        case timer_running_st:
-		
-            if(timer_HLT >= HIT_LED_TIMER_EXPIRE_VALUE){
-				currentState_HLT = init_st;
-			}
-			break;
-        case disabled_st:
-            if(enabled)
-                currentState_HLT = init_st;
-    }
-
-	//State actions
-    switch (currentState_HLT){
-        case init_st:
-            hitLedTimer_turnLedOff();
-            leds_write(0);
-			break;
-        case timer_running_st:
-            hitLedTimer_turnLedOn();
-            leds_write(1);
-            ++timer_HLT;
-			break;
-        case disabled_st:
-            hitLedTimer_turnLedOff();
-            leds_write(0);           
-    }
+	FSM_TICK(hitLedTimerMachine, HIT_LED_TIMER_STATES, HIT_LED_TIMER_TRANSITIONS, currentState_HLT);
 }
 
 // Runs a visual test of the hit LED.
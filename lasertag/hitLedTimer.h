@@ -11,12 +11,13 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define HITLEDTIMER_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // The lockoutTimer is active for 1/2 second once it is started.
 // It is used to lock-out the detector once a hit has been detected.
 // This ensure that only one hit is detected per 1/2-second interval.
 
-#define HIT_LED_TIMER_EXPIRE_VALUE 50000 // Defined in terms of 100 kHz ticks.
+#define HIT_LED_TIMER_EXPIRE_VALUE 500 // Defined in terms of 1 kHz slow-lane ticks.
 #define HIT_LED_TIMER_OUTPUT_PIN 11      // JF-3
 
 // Calling this starts the timer.
@@ -25,7 +26,11 @@ void hitLedTimer_start();
 // Returns true if the timer is currently running.
 bool hitLedTimer_running();
 
-// Standard tick function.
+// Returns the number of 1 kHz ticks until the timer expires, 0 if it is not
+// running.
+uint32_t hitLedTimer_getRemainingTicks();
+
+// Standard tick function. Invoked from the 1 kHz slow lane of isr_function().
 void hitLedTimer_tick();
 
 // Need to init things.
@@ -0,0 +1,245 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host stand-ins for the board drivers, so that host tools can link the ISR
+// and the state machines it runs without the emulator (see isrWcetHost.c).
+// Inputs read as released, outputs (the display too) go nowhere, and the
+// interval timers read the host clock through timebase. The sound stand-in
+// keeps the work sound_tick() does on the board: it refills a
+// HOST_SOUND_FIFO_WORDS deep TX FIFO one stereo sample at a time, and the FIFO
+// drains at the 48 kHz stereo rate between calls.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "buttons.h"
+#include "display.h"
+#include "interrupts.h"
+#include "intervalTimer.h"
+#include "leds.h"
+#include "mio.h"
+#include "sound.h"
+#include "switches.h"
+#include "timebase.h"
+#include "utils.h"
+
+#define HOST_TIMER_COUNT 3
+#define HOST_SOUND_FIFO_WORDS 1024 // Assumed depth of the axi_i2s TX FIFO.
+#define HOST_SOUND_WORDS_PER_SECOND 96000 // 48 kHz, left and right.
+#define HOST_SOUND_TICKS_PER_SECOND 100000 // sound_tick() runs on every isr_function() tick.
+#define HOST_SOUND_SAMPLE_COUNT 24000 // Half a second, about the gun-fire sound.
+#define HOST_ADC_STEP 37 // Walks the ADC value through the 12-bit range.
+#define HOST_ADC_MASK 0xFFF
+
+static uint64_t timerStart[HOST_TIMER_COUNT];
+static uint64_t timerTotal[HOST_TIMER_COUNT];
+static bool timerRunning[HOST_TIMER_COUNT];
+
+static bool soundPlaying = false;
+static uint32_t soundSampleIndex;
+static uint32_t soundFifoWords; // Words waiting in the TX FIFO.
+static uint32_t soundDrainRemainder; // Words per second not yet drained, times ticks.
+static volatile uint32_t soundTxFifoRegister; // Where the samples are written.
+
+static uint32_t adcValue;
+
+/*********************** intervalTimer ***********************/
+
+intervalTimer_status_t intervalTimer_init(uint32_t timerNumber){
+	if(timerNumber >= HOST_TIMER_COUNT)
+		return INTERVAL_TIMER_STATUS_FAIL;
+	timebase_init();
+	intervalTimer_reset(timerNumber);
+	return INTERVAL_TIMER_STATUS_OK;
+}
+
+intervalTimer_status_t intervalTimer_initAll(){
+	for(uint32_t i = 0; i < HOST_TIMER_COUNT; ++i)
+		intervalTimer_init(i);
+	return INTERVAL_TIMER_STATUS_OK;
+}
+
+void intervalTimer_start(uint32_t timerNumber){
+	if(timerNumber < HOST_TIMER_COUNT && !timerRunning[timerNumber]){
+		timerStart[timerNumber] = timebase_readTicks();
+		timerRunning[timerNumber] = true;
+	}
+}
+
+void intervalTimer_stop(uint32_t timerNumber){
+	if(timerNumber < HOST_TIMER_COUNT && timerRunning[timerNumber]){
+		timerTotal[timerNumber] += timebase_readTicks() - timerStart[timerNumber];
+		timerRunning[timerNumber] = false;
+	}
+}
+
+void intervalTimer_reset(uint32_t timerNumber){
+	if(timerNumber < HOST_TIMER_COUNT){
+		timerTotal[timerNumber] = 0;
+		timerRunning[timerNumber] = false;
+	}
+}
+
+void intervalTimer_resetAll(){
+	for(uint32_t i = 0; i < HOST_TIMER_COUNT; ++i)
+		intervalTimer_reset(i);
+}
+
+double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber){
+	if(timerNumber >= HOST_TIMER_COUNT)
+		return 0;
+	uint64_t total = timerTotal[timerNumber];
+	if(timerRunning[timerNumber])
+		total += timebase_readTicks() - timerStart[timerNumber];
+	return (double)total / TIMEBASE_TICKS_PER_SECOND;
+}
+
+/*********************** interrupts ***********************/
+
+int interrupts_enableArmInts(){
+	return 0;
+}
+
+int interrupts_disableArmInts(){
+	return 0;
+}
+
+void interrupts_enableTimerGlobalInts(){
+}
+
+void interrupts_disableTimerGlobalInts(){
+}
+
+// Not declared by the emulator's interrupts.h; isr.c reads the ADC with it.
+uint32_t interrupts_getAdcData(){
+	adcValue = (adcValue + HOST_ADC_STEP) & HOST_ADC_MASK;
+	return adcValue;
+}
+
+/*********************** buttons, switches, leds, mio, utils ***********************/
+
+int32_t buttons_init(){
+	return 0;
+}
+
+int32_t buttons_read(){
+	return 0;
+}
+
+int32_t switches_init(){
+	return 0;
+}
+
+int32_t switches_read(){
+	return 0;
+}
+
+int leds_init(bool printFailedStatusFlag){
+	(void)printFailedStatusFlag;
+	return 0;
+}
+
+void leds_write(int ledValue){
+	(void)ledValue;
+}
+
+int mio_init(bool printFailedStatusFlag){
+	(void)printFailedStatusFlag;
+	return 0;
+}
+
+u8 mio_readPin(u8 mioPinNumber){
+	(void)mioPinNumber;
+	return 0;
+}
+
+void mio_writePin(u8 mioPinNumber, u8 value){
+	(void)mioPinNumber;
+	(void)value;
+}
+
+void mio_setPinAsInput(u8 mioPinNo){
+	(void)mioPinNo;
+}
+
+void mio_setPinAsOutput(u8 mioPinNo){
+	(void)mioPinNo;
+}
+
+void utils_msDelay(long ms){
+	(void)ms;
+}
+
+/*********************** display ***********************/
+
+// Only what isrProfile_displayReport() draws with, for ISR_PROFILE builds.
+void display_fillScreen(uint16_t color){
+	(void)color;
+}
+
+void display_setCursor(int16_t x, int16_t y){
+	(void)x;
+	(void)y;
+}
+
+void display_setTextColor(uint16_t c){
+	(void)c;
+}
+
+void display_setTextSize(uint8_t s){
+	(void)s;
+}
+
+size_t display_println(const char str[]){
+	(void)str;
+	return 0;
+}
+
+/*********************** sound ***********************/
+
+sound_status_t sound_init(){
+	return SOUND_STATUS_OK;
+}
+
+// Drains what the codec played since the last call, then refills the FIFO
+// until it is full or the sound ends, as sound_fifoFilledToEnd() does.
+void sound_tick(){
+	if(!soundPlaying)
+		return;
+	soundDrainRemainder += HOST_SOUND_WORDS_PER_SECOND;
+	uint32_t drained = soundDrainRemainder / HOST_SOUND_TICKS_PER_SECOND;
+	soundDrainRemainder %= HOST_SOUND_TICKS_PER_SECOND;
+	soundFifoWords = (drained < soundFifoWords) ? soundFifoWords - drained : 0;
+	while(soundFifoWords + 2 <= HOST_SOUND_FIFO_WORDS){
+		soundTxFifoRegister = soundSampleIndex;	//Left
+		soundTxFifoRegister = soundSampleIndex;	//Right
+		soundFifoWords += 2;
+		if(++soundSampleIndex == HOST_SOUND_SAMPLE_COUNT){
+			soundPlaying = false;
+			return;
+		}
+	}
+}
+
+bool sound_isBusy(){
+	return soundPlaying;
+}
+
+void sound_stopSound(){
+	soundPlaying = false;
+}
+
+// Every sound is HOST_SOUND_SAMPLE_COUNT samples long and starts from an
+// empty FIFO.
+void sound_playSound(sound_sounds_t sound){
+	(void)sound;
+	soundSampleIndex = 0;
+	soundFifoWords = 0;
+	soundDrainRemainder = 0;
+	soundPlaying = true;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include "idle.h"
+#include "detector.h"
+#include "filter.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "timebase.h"
+#ifndef ZYBO_BOARD
+#include <time.h>
+#endif
+
+#define HOST_SLEEP_NANOSECONDS 10000 // One ISR period.
+#define PERCENT 100.0
+#define TEST_SECONDS 2
+
+static uint32_t thresholdSamples = IDLE_DEFAULT_THRESHOLD_SAMPLES;
+static uint64_t startTicks;
+static uint64_t sleptTicks;
+static uint32_t sleepCount;
+
+// Waits for the next interrupt and accounts the time asleep. On the board
+// interrupts must be masked; the pending interrupt runs once they are enabled,
+// so its time is counted as awake.
+static void idle_waitForInterrupt(){
+	uint64_t before = timebase_readTicks();
+#ifdef ZYBO_BOARD
+	__asm__ __volatile__("dsb\n\twfi" : : : "memory");
+#else
+	struct timespec nap = {0, HOST_SLEEP_NANOSECONDS};
+	nanosleep(&nap, NULL);
+#endif
+	sleptTicks += timebase_readTicks() - before;
+	++sleepCount;
+}
+
+// Clears the accounting and starts the clock.
+void idle_init(){
+	sleptTicks = 0;
+	sleepCount = 0;
+	startTicks = timebase_readTicks();
+}
+
+// Sets the ADC buffer threshold used by idle_sleepIfIdle().
+void idle_setThreshold(uint32_t samples){
+	thresholdSamples = samples;
+}
+
+// Sleeps until the next interrupt if too few samples are waiting.
+bool idle_sleepIfIdle(){
+	bool slept = false;
+	bool wereEnabled = isr_maskArmInts();	//A block published after the check must still wake the WFI
+	if(isr_adcBufferElementCount() < thresholdSamples){
+		idle_waitForInterrupt();
+		slept = true;
+	}
+	isr_restoreArmInts(wereEnabled);
+	return slept;
+}
+
+// Sleeps until the next interrupt.
+void idle_sleepUntilInterrupt(){
+	bool wereEnabled = isr_maskArmInts();	//A block published after the check must still wake the WFI
+	idle_waitForInterrupt();
+	isr_restoreArmInts(wereEnabled);
+}
+
+// Copies the accounting into stats.
+void idle_getStats(idle_stats_t *stats){
+	uint64_t total = timebase_readTicks() - startTicks;
+	stats->sleepCount = sleepCount;
+	stats->totalSeconds = (double)total / TIMEBASE_TICKS_PER_SECOND;
+	stats->sleptSeconds = (double)sleptTicks / TIMEBASE_TICKS_PER_SECOND;
+	stats->dutyCyclePercent = (total == 0) ? PERCENT : PERCENT * (total - sleptTicks) / total;
+}
+
+// Prints the duty cycle to the console.
+void idle_printReport(){
+	idle_stats_t stats;
+	idle_getStats(&stats);
+	printf("CPU duty cycle: %5.2f%% (asleep %f of %f seconds, %u sleeps)\n", stats.dutyCyclePercent,
+		stats.sleptSeconds, stats.totalSeconds, stats.sleepCount);
+}
+
+// Runs the detector loop for TEST_SECONDS, sleeping when idle if sleepWhenIdle.
+// Returns the most samples that waited in the ADC buffer before a detector call.
+static uint32_t idle_runTestLoop(bool sleepWhenIdle, idle_stats_t *stats){
+	uint32_t maxDepth = 0;
+	uint32_t invocations = 0;
+	idle_init();
+	uint64_t end = startTicks + (uint64_t)TEST_SECONDS * TIMEBASE_TICKS_PER_SECOND;
+	while(timebase_readTicks() < end){
+		uint32_t depth = isr_adcBufferElementCount();
+		if(depth > maxDepth)
+			maxDepth = depth;
+		detector(true);
+		++invocations;
+		if(sleepWhenIdle)
+			idle_sleepIfIdle();
+	}
+	idle_getStats(stats);
+	printf("%s: duty cycle %5.2f%%, %u detector invocations, %u sleeps, at most %u samples waiting\n",
+		sleepWhenIdle ? "sleep when idle" : "spin", stats->dutyCyclePercent, invocations, stats->sleepCount, maxDepth);
+	return maxDepth;
+}
+
+// Compares spinning with sleeping when idle in the continuous-mode loop.
+void idle_runTest(){
+	printf("Starting idle_runTest()\n");
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	idle_stats_t spinStats, idleStats;
+	detector_init(ignored);
+	uint32_t spinDepth = idle_runTestLoop(false, &spinStats);
+	uint32_t idleDepth = idle_runTestLoop(true, &idleStats);
+	uint32_t allowedDepth = (spinDepth > ISR_ADC_BLOCK_FRAMES) ? spinDepth : ISR_ADC_BLOCK_FRAMES;
+	bool passed = idleDepth <= allowedDepth && idleStats.dutyCyclePercent < spinStats.dutyCyclePercent;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed idle_runTest()\n");
+}
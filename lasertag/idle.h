@@ -0,0 +1,68 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef IDLE_H_
+#define IDLE_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// Main-loop idle policy. Instead of spinning, a main loop that has nothing to
+// do sleeps on WFI until the next interrupt, at most one 10 us ISR period.
+// isr_function() publishes ADC samples a whole 1 ms block at a time, and the
+// interrupt that publishes a block is the one that wakes the core, so the
+// detector still sees every block on the tick it arrives: hit latency does
+// not change. The check and the WFI run with ARM interrupts masked, so an
+// interrupt that lands between them is still pending at the WFI and wakes it
+// at once. Afterwards the mask is put back as the caller had it; a caller
+// with interrupts masked is woken, but the interrupt only runs once it
+// unmasks them.
+// On a host there is no interrupt to wait for and a sleep stands in for WFI.
+// Time spent asleep is accounted so the CPU duty cycle can be reported.
+
+// Sleep when fewer samples than this wait in the ADC buffer. Blocks are
+// published whole, so the default sleeps only when the buffer is empty.
+#define IDLE_DEFAULT_THRESHOLD_SAMPLES 1
+
+// Idle accounting since idle_init().
+typedef struct {
+  uint32_t sleepCount;
+  double totalSeconds;
+  double sleptSeconds;
+  double dutyCyclePercent; // Time awake, as a percentage of the total.
+} idle_stats_t;
+
+// Clears the accounting and starts the clock. Keeps the threshold.
+void idle_init();
+
+// Sets the ADC buffer threshold used by idle_sleepIfIdle().
+void idle_setThreshold(uint32_t samples);
+
+// Sleeps until the next interrupt if the ADC buffer holds fewer than the
+// threshold number of samples. Returns true if it slept. Call it at the end
+// of a main-loop pass, once everything else has been done.
+bool idle_sleepIfIdle();
+
+// Sleeps until the next interrupt. For busy-waits that poll something the
+// ISR changes, e.g. sound_isBusy() or an interval timer.
+void idle_sleepUntilInterrupt();
+
+// Copies the accounting into stats.
+void idle_getStats(idle_stats_t *stats);
+
+// Prints the duty cycle to the console.
+void idle_printReport();
+
+// Runs the continuous-mode detector loop for a while spinning and then for
+// the same time sleeping when idle, and prints the duty cycle, detector
+// invocations and the deepest the ADC buffer got in each. Passes if idling
+// never let more samples wait than spinning did. Needs live interrupts, so
+// it is meant for the board; call it with interrupts running.
+void idle_runTest();
+
+#endif /* IDLE_H_ */
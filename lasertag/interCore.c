@@ -0,0 +1,125 @@
+#include <string.h>
+#include "interCore.h"
+#ifdef ZYBO_BOARD
+#include "xil_io.h"
+#include "xil_mmu.h"
+#include "xpseudo_asm.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define SLOT_INDEX_MASK (INTERCORE_SLOT_COUNT - 1)
+
+#ifndef ZYBO_BOARD
+static uint8_t sharedMemory[INTERCORE_SHARED_BYTES] __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+static pthread_t secondCoreThread;
+static bool secondCoreStarted = false;
+
+// Thread body standing in for CPU1.
+static void *interCore_runSecondCore(void *arg){
+	interCore_entry_t entry = (interCore_entry_t)arg;
+	entry();
+	return NULL;
+}
+#endif
+
+// Maps the shared memory. Both cores call it before touching a channel.
+void interCore_init(){
+#ifdef ZYBO_BOARD
+	Xil_SetTlbAttributes(INTERCORE_SHARED_BASEADDR, NORM_NONCACHE);	//Each core's L1 would otherwise hide the other's writes
+#endif
+}
+
+// Returns memory both cores see.
+void *interCore_getSharedMemory(){
+#ifdef ZYBO_BOARD
+	return (void *)INTERCORE_SHARED_BASEADDR;
+#else
+	return sharedMemory;
+#endif
+}
+
+// Empties a channel. Call it before the other core is started.
+void interCore_channelInit(interCore_channel_t *channel){
+	atomic_store(&channel->head, 0);
+	atomic_store(&channel->tail, 0);
+	atomic_store(&channel->sentCount, 0);
+	atomic_store(&channel->droppedCount, 0);
+}
+
+// Copies a message into the next free slot, or counts a drop if there is none.
+bool interCore_send(interCore_channel_t *channel, const void *message, uint32_t size){
+	uint32_t head = atomic_load_explicit(&channel->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&channel->tail, memory_order_acquire);
+	atomic_fetch_add_explicit(&channel->sentCount, 1, memory_order_relaxed);
+	if(head - tail >= INTERCORE_SLOT_COUNT || size > INTERCORE_SLOT_BYTES){
+		atomic_fetch_add_explicit(&channel->droppedCount, 1, memory_order_relaxed);
+		return false;
+	}
+	memcpy(channel->slots[head & SLOT_INDEX_MASK], message, size);
+	atomic_store_explicit(&channel->head, head + 1, memory_order_release);	//Slot contents before the new head
+	return true;
+}
+
+// Copies the oldest message out and frees its slot.
+bool interCore_receive(interCore_channel_t *channel, void *message, uint32_t size){
+	uint32_t tail = atomic_load_explicit(&channel->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&channel->head, memory_order_acquire);
+	if(head == tail){
+		return false;
+	}
+	memcpy(message, channel->slots[tail & SLOT_INDEX_MASK], size <= INTERCORE_SLOT_BYTES ? size : INTERCORE_SLOT_BYTES);
+	atomic_store_explicit(&channel->tail, tail + 1, memory_order_release);	//Done reading before the sender reuses the slot
+	return true;
+}
+
+// Returns the number of messages waiting.
+uint32_t interCore_channelElementCount(interCore_channel_t *channel){
+	uint32_t tail = atomic_load_explicit(&channel->tail, memory_order_acquire);
+	return atomic_load_explicit(&channel->head, memory_order_acquire) - tail;
+}
+
+// Returns how many sends were made.
+uint32_t interCore_getSentCount(interCore_channel_t *channel){
+	return atomic_load_explicit(&channel->sentCount, memory_order_relaxed);
+}
+
+// Returns how many sends found the channel full.
+uint32_t interCore_getDroppedCount(interCore_channel_t *channel){
+	return atomic_load_explicit(&channel->droppedCount, memory_order_relaxed);
+}
+
+// Starts the second core running entry (a thread on a host, CPU1's image on the board).
+bool interCore_startSecondCore(interCore_entry_t entry){
+#ifdef ZYBO_BOARD
+	(void)entry;
+	Xil_Out32(INTERCORE_CPU1_START_ADDRESS, INTERCORE_CPU1_IMAGE_ENTRY);
+	dmb();	//The address must land before CPU1 wakes and reads it
+	__asm__ __volatile__("sev");
+	return true;
+#else
+	if(secondCoreStarted){
+		return false;
+	}
+	secondCoreStarted = pthread_create(&secondCoreThread, NULL, interCore_runSecondCore, (void *)entry) == 0;
+	return secondCoreStarted;
+#endif
+}
+
+// Waits for the second core's entry function to return (host only).
+void interCore_waitForSecondCore(){
+#ifndef ZYBO_BOARD
+	if(secondCoreStarted){
+		pthread_join(secondCoreThread, NULL);
+		secondCoreStarted = false;
+	}
+#endif
+}
+
+// Lets the other core (or thread) run.
+void interCore_relax(){
+#ifndef ZYBO_BOARD
+	sched_yield();
+#endif
+}
@@ -0,0 +1,95 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef INTERCORE_H_
+#define INTERCORE_H_
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free channels between the two Cortex-A9 cores, and starting the second
+// core. A channel is a single-producer single-consumer ring of fixed-size
+// message slots: one core only sends, the other only receives, and neither
+// ever waits for the other. A send into a full channel is dropped and
+// counted rather than blocking the sender.
+// Channels live in memory both cores see. On the board that is the top of
+// on-chip memory, mapped non-cacheable by interCore_init(), and the second
+// core is CPU1 running its own image. On a host both come from this process
+// and the second core is a pthread, so the two-core design can be built and
+// load-tested in the emulator build.
+
+#define INTERCORE_SLOT_COUNT 64 // Power of two.
+#define INTERCORE_SLOT_BYTES 96 // Largest message a channel carries.
+#define INTERCORE_CACHE_LINE_BYTES 32 // Cortex-A9 L1 line.
+
+#ifdef ZYBO_BOARD
+#define INTERCORE_SHARED_BASEADDR 0xFFFF0000 // OCM mapped high.
+#define INTERCORE_SHARED_BYTES 0xFE00 // The boot ROM keeps the last 512 bytes.
+#define INTERCORE_CPU1_START_ADDRESS 0xFFFFFFF0 // CPU1 jumps here after a sev.
+#define INTERCORE_CPU1_IMAGE_ENTRY 0x02000000 // Where the CPU1 image is linked.
+#else
+#define INTERCORE_SHARED_BYTES 0x10000
+#endif
+
+// One channel. The head is written only by the sender and the tail only by
+// the receiver; they sit on separate cache lines so the cores don't fight
+// over one line on every message.
+typedef struct {
+  _Atomic uint32_t head __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+  _Atomic uint32_t sentCount;    // Sender-owned.
+  _Atomic uint32_t droppedCount; // Sender-owned, sends that found the channel full.
+  _Atomic uint32_t tail __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+  uint8_t slots[INTERCORE_SLOT_COUNT][INTERCORE_SLOT_BYTES]
+      __attribute__((aligned(INTERCORE_CACHE_LINE_BYTES)));
+} interCore_channel_t;
+
+// Body of the second core. Must return once its stop flag is seen.
+typedef void (*interCore_entry_t)();
+
+// Maps the shared memory. Both cores call it before touching a channel.
+void interCore_init();
+
+// Returns INTERCORE_SHARED_BYTES of memory both cores see, aligned to a cache
+// line. Its contents are undefined until a core writes them.
+void *interCore_getSharedMemory();
+
+// Empties a channel. Call it before the other core is started.
+void interCore_channelInit(interCore_channel_t *channel);
+
+// Copies size bytes (at most INTERCORE_SLOT_BYTES) from message into the next
+// free slot. Returns false, and counts a drop, if the channel is full.
+// Sender only.
+bool interCore_send(interCore_channel_t *channel, const void *message, uint32_t size);
+
+// Copies the oldest message into message. Returns false if the channel is
+// empty. Receiver only.
+bool interCore_receive(interCore_channel_t *channel, void *message, uint32_t size);
+
+// Returns the number of messages waiting. Either core may call it.
+uint32_t interCore_channelElementCount(interCore_channel_t *channel);
+
+// Returns how many sends were made and how many were dropped.
+uint32_t interCore_getSentCount(interCore_channel_t *channel);
+uint32_t interCore_getDroppedCount(interCore_channel_t *channel);
+
+// Starts the second core. On a host entry runs on a new thread. On the board
+// CPU1 is released into INTERCORE_CPU1_IMAGE_ENTRY, whose main() must call
+// the same entry function.
+bool interCore_startSecondCore(interCore_entry_t entry);
+
+// Waits for the second core's entry function to return. On the board there
+// is nothing to join, so it returns at once; wait on a flag in the shared
+// memory instead.
+void interCore_waitForSecondCore();
+
+// Called from polling loops that have nothing to do, lets the other core (or
+// thread) run.
+void interCore_relax();
+
+#endif /* INTERCORE_H_ */
@@ -1,5 +1,10 @@
 
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adcCapture.h"
 #include "lockoutTimer.h"
 #include "hitLedTimer.h"
 #include "trigger.h"
@@ -7,17 +12,85 @@
 #include "interrupts.h"
 #include "detector.h"
 #include "sound.h"
+#include "isr.h"
+#include "intervalTimer.h"
+#include "isrProfile.h"
+#include "timebase.h"
+#include "virtualTimer.h"
+#ifdef ZYBO_BOARD
+#include "xparameters.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#include "xsysmon.h"
+#include "xsysmon_hw.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
 
-typedef uint32_t
-    isr_AdcValue_t; // Used to represent ADC values in the ADC buffer.
-
-#define ADC_BUFFER_SIZE 20001
+#define ADC_BLOCK_INDEX_MASK (ISR_ADC_BLOCK_COUNT - 1)
+#define ADC_BLOCK_SAMPLES (ISR_ADC_BLOCK_FRAMES * ISR_MAX_SENSOR_COUNT)
 #define NUM_PLAYERS 10
 
-static isr_AdcValue_t adcBuffer[ADC_BUFFER_SIZE];
-static uint32_t frontIndex = 0;
-static uint32_t backIndex = 0;
-static uint32_t elementCount = 0;
+#define XADC_DATA_SHIFT 4 // XADC results are 12 bits, MSB-justified in 16.
+#define XADC_AUX_CHANNEL_BIT(channel) (1 << ((channel) - XSM_CH_AUX_MIN))
+
+// The ADC buffer is a pool of fixed-size blocks handed from the ISR to the
+// detector through a single-producer/single-consumer queue of block
+// descriptors. Frames are stored interleaved, sensorCount samples each.
+// blockHead and blockTail run freely and are only masked to index the pool:
+// the producer fills block (blockHead & mask) and publishes it by advancing
+// blockHead, the consumer claims the oldest block by advancing blockTail and
+// marks it in heldBlock until it releases it. Only the producer writes the
+// first group of fields and only the consumer writes the last. blockTail is
+// also advanced by the producer, with a compare-and-swap, when the
+// drop-oldest policy takes back an unclaimed block, so neither side has to
+// mask interrupts or take a lock.
+struct isr_t {
+	isr_AdcValue_t adcBlocks[ISR_ADC_BLOCK_COUNT][ADC_BLOCK_SAMPLES];
+	isr_AdcBlock_t descriptors[ISR_ADC_BLOCK_COUNT];
+	uint16_t sensorCount;
+	volatile isr_AdcOverflowPolicy_t overflowPolicy;
+	volatile isr_AdcBlockListener_t blockListener; // Set from outside the ISR.
+
+	// Producer side.
+	_Atomic uint32_t blockHead; // Blocks ever published.
+	_Atomic uint32_t framesPublished;
+	_Atomic uint32_t framesDiscarded; // Frames in blocks taken back under drop-oldest.
+	uint32_t fillFrameCount; // Frames in the block being filled.
+	uint32_t pendingDroppedFrames; // Frames lost since the last published block.
+	bool inOverrun;
+	uint32_t overrunCount; // Times the producer found no free block.
+	uint32_t droppedFrameCount;
+	uint32_t discontinuityCount;
+	uint32_t highWaterBlocks; // Most blocks waiting at once.
+	uint32_t producedFrameCount; // Frames offered, kept or not.
+	uint32_t lastSeenConsumed; // framesConsumed when last checked.
+	uint32_t stallStartFrame; // producedFrameCount when the consumer last moved.
+	uint32_t longestStallFrames;
+
+	// Both sides.
+	_Atomic uint32_t blockTail; // Blocks ever claimed or taken back.
+	_Atomic uint32_t heldBlock; // Sequence + 1 of the claimed block, 0 if none.
+
+	// Consumer side.
+	_Atomic uint32_t framesConsumed;
+	bool holding; // A claimed block is in heldBlock.
+	uint32_t readFrameOffset; // Frames already removed from the claimed block.
+};
+
+// The ADC buffer filled by isr_function().
+static isr_t defaultIsr = {.sensorCount = ISR_DEFAULT_SENSOR_COUNT};
+
+// Fast tick within the current millisecond, picks the slow-lane machine to run.
+static uint16_t slowLanePhase = 0;
+
+#ifdef ZYBO_BOARD
+// Sensor 0 is the laser-tag channel, the rest are the other JA aux channels.
+static const uint8_t sensorChannels[ISR_MAX_SENSOR_COUNT] = {
+    SELECTED_XADC_CHANNEL, XADC_AUX_CHANNEL_15, XADC_AUX_CHANNEL_7,
+    XADC_AUX_CHANNEL_6};
+#endif
 
 
 // isr provides the isr_function() where you will place functions that require
@@ -26,61 +99,707 @@ static uint32_t elementCount = 0;
 // the code in isr.c. Values are removed from this queue by code in detector.c
 
 //this initializes the ADC buffer much like queue_init() does. It would make sense to have isr_init() invoke this function.
-void adcBufferInit(){
-    for(uint32_t i = 0; i < ADC_BUFFER_SIZE; i++)
-        adcBuffer[i] = 0;
-	frontIndex = 0;
-	backIndex = 0;
-	elementCount = 0;
+//Only call this while nothing is adding to or removing from the buffer.
+void adcBufferInit(isr_t *isr){
+	memset(isr->adcBlocks, 0, sizeof(isr->adcBlocks));
+	memset(isr->descriptors, 0, sizeof(isr->descriptors));
+	atomic_store(&isr->blockHead, 0);
+	atomic_store(&isr->framesPublished, 0);
+	atomic_store(&isr->framesDiscarded, 0);
+	isr->fillFrameCount = 0;
+	isr->pendingDroppedFrames = 0;
+	isr->inOverrun = false;
+	isr->overrunCount = 0;
+	isr->droppedFrameCount = 0;
+	isr->discontinuityCount = 0;
+	isr->highWaterBlocks = 0;
+	isr->producedFrameCount = 0;
+	isr->lastSeenConsumed = 0;
+	isr->stallStartFrame = 0;
+	isr->longestStallFrames = 0;
+	atomic_store(&isr->blockTail, 0);
+	atomic_store(&isr->heldBlock, 0);
+	atomic_store(&isr->framesConsumed, 0);
+	isr->holding = false;
+	isr->readFrameOffset = 0;
+}
+
+// Allocates a new ADC buffer instance with a single sensor.
+isr_t *isr_create(){
+	isr_t *isr = malloc(sizeof(isr_t));
+	if(isr == NULL){
+		return NULL;
+	}
+	isr->sensorCount = ISR_DEFAULT_SENSOR_COUNT;
+	isr->overflowPolicy = ISR_ADC_OVERFLOW_DROP_NEWEST;
+	isr->blockListener = NULL;
+	adcBufferInit(isr);
+	return isr;
+}
+
+// Frees an instance returned by isr_create().
+void isr_destroy(isr_t *isr){
+	free(isr);
+}
+
+// Returns the instance filled by isr_function().
+isr_t *isr_getDefault(){
+	return &defaultIsr;
+}
+
+// Empties the ADC buffer of an instance.
+void isr_ctxInit(isr_t *isr){
+	adcBufferInit(isr);
+}
+
+// Masks ARM interrupts and returns true if they were enabled before.
+bool isr_maskArmInts(){
+#ifdef ZYBO_BOARD
+	bool wereEnabled = (mfcpsr() & XREG_CPSR_IRQ_ENABLE) == 0;	//The CPSR bit is set while IRQs are masked
+	interrupts_disableArmInts();
+	return wereEnabled;
+#else
+	return false;
+#endif
+}
+
+// Unmasks ARM interrupts again if isr_maskArmInts() found them enabled.
+void isr_restoreArmInts(bool wereEnabled){
+#ifdef ZYBO_BOARD
+	if(wereEnabled)
+		interrupts_enableArmInts();
+#else
+	(void)wereEnabled;
+#endif
 }
 
 // Performs inits for anything in isr.c
 void isr_init(){
+	timebase_init();	//The state machines timestamp their event log records from the first tick
 	lockoutTimer_init();
     hitLedTimer_init();
 	trigger_init();
 	transmitter_init();
-    adcBufferInit();
+    adcBufferInit(&defaultIsr);
+	slowLanePhase = 0;
+#ifdef ISR_PROFILE_ENABLED
+	isrProfile_init();
+#endif
     
 }
 
+// Adds the extra aux channels to the XADC sequencer so every sensor is
+// converted continuously. Sensor 0 is already set up by interrupts_initAll().
+static void isr_initSensorChannels(){
+#ifdef ZYBO_BOARD
+	uint32_t channelMask = 0;
+	for(uint16_t i = 0; i < defaultIsr.sensorCount; ++i)
+		channelMask |= XADC_AUX_CHANNEL_BIT(sensorChannels[i]);
+	XSysMon_WriteReg(XPAR_SYSMON_0_BASEADDR, XSM_SEQ01_OFFSET, channelMask);
+	uint32_t config = XSysMon_ReadReg(XPAR_SYSMON_0_BASEADDR, XSM_CFR1_OFFSET);
+	config &= ~XSM_CFR1_SEQ_VALID_MASK;
+	config |= (defaultIsr.sensorCount > 1) ? XSM_CFR1_SEQ_CONTINPASS_MASK : XSM_CFR1_SEQ_SINGCHAN_MASK;
+	XSysMon_WriteReg(XPAR_SYSMON_0_BASEADDR, XSM_CFR1_OFFSET, config);
+#endif
+}
+
+// Reads the latest conversion for one sensor.
+static isr_AdcValue_t isr_readSensorAdcData(uint16_t sensor){
+#ifdef ZYBO_BOARD
+	if(sensor == 0)
+		return interrupts_getAdcData();
+	uint32_t offset = XSM_AUX00_OFFSET + ((sensorChannels[sensor] - XSM_CH_AUX_MIN) << 2);
+	return XSysMon_ReadReg(XPAR_SYSMON_0_BASEADDR, offset) >> XADC_DATA_SHIFT;
+#else
+	(void)sensor;
+	return interrupts_getAdcData(); // The emulator only has one ADC input.
+#endif
+}
+
+// Sets how many samples each frame in the buffer holds and empties it.
+void isr_ctxSetSensorCount(isr_t *isr, uint16_t count){
+	if(count < 1 || count > ISR_MAX_SENSOR_COUNT){
+		printf("isr_setSensorCount(): %d sensors is not supported.\n", count);
+		return;
+	}
+	isr->sensorCount = count;
+	adcBufferInit(isr);
+}
+
+// Sets how many sensor channels the ISR samples each tick.
+void isr_setSensorCount(uint16_t count){
+	isr_ctxSetSensorCount(&defaultIsr, count);
+	isr_initSensorChannels();
+}
+
+// Returns the number of samples in each frame.
+uint16_t isr_ctxGetSensorCount(isr_t *isr){
+	return isr->sensorCount;
+}
+
+// Returns the number of sensor channels sampled each tick.
+uint16_t isr_getSensorCount(){
+	return defaultIsr.sensorCount;
+}
+
+// Counts an overrun the first time a frame or block is lost in a row.
+static void isr_noteOverrun(isr_t *isr){
+	if(!isr->inOverrun){
+		isr->inOverrun = true;
+		isr->overrunCount++;
+	}
+}
+
+// Returns true if block head can be started. The block in its pool slot must
+// have been claimed and released, or taken back. When every block is waiting
+// for the consumer the drop-oldest policy takes the oldest one back, unless
+// the consumer claims it first. Producer side only.
+static bool isr_startBlock(isr_t *isr, uint32_t head){
+	uint32_t tail = atomic_load(&isr->blockTail);	//Sequentially consistent with the claim in isr_ctxPeekAdcBlock()
+	if(head - tail < ISR_ADC_BLOCK_COUNT){
+		uint32_t held = atomic_load(&isr->heldBlock);
+		if(held != 0 && held - 1 == head - ISR_ADC_BLOCK_COUNT){	//The consumer is still reading it
+			return false;
+		}
+		isr->inOverrun = false;
+		return true;
+	}
+	if(isr->overflowPolicy != ISR_ADC_OVERFLOW_DROP_OLDEST || !atomic_compare_exchange_strong(&isr->blockTail, &tail, tail + 1)){
+		return false;
+	}
+	uint32_t frameCount = isr->descriptors[tail & ADC_BLOCK_INDEX_MASK].frameCount;
+	atomic_fetch_add_explicit(&isr->framesDiscarded, frameCount, memory_order_relaxed);
+	isr_noteOverrun(isr);
+	isr->droppedFrameCount += frameCount;
+	return true;
+}
+
+// Tracks the longest run of frames during which data were waiting and the
+// consumer took none. Checked once per block, and on every frame while no
+// block can be started. Producer side only.
+static void isr_trackStall(isr_t *isr){
+	uint32_t consumed = atomic_load_explicit(&isr->framesConsumed, memory_order_relaxed);
+	if(consumed != isr->lastSeenConsumed || isr_ctxAdcBufferElementCount(isr) == 0){
+		isr->lastSeenConsumed = consumed;
+		isr->stallStartFrame = isr->producedFrameCount;
+		return;
+	}
+	uint32_t stall = isr->producedFrameCount - isr->stallStartFrame;
+	if(stall > isr->longestStallFrames){
+		isr->longestStallFrames = stall;
+	}
+}
+
+// Returns where the next frame goes, or NULL if there is no free block to
+// start. Producer side only. Frames that find no free block are dropped and
+// counted, and the next block published records how many frames are missing
+// before it.
+static isr_AdcValue_t *isr_nextFrameSlot(isr_t *isr){
+	uint32_t head = atomic_load_explicit(&isr->blockHead, memory_order_relaxed);
+	isr->producedFrameCount++;
+	if(isr->fillFrameCount == 0){
+		isr_trackStall(isr);
+		if(!isr_startBlock(isr, head)){
+			isr_noteOverrun(isr);
+			isr->pendingDroppedFrames++;
+			isr->droppedFrameCount++;
+			return NULL;
+		}
+	}
+	return &isr->adcBlocks[head & ADC_BLOCK_INDEX_MASK][isr->fillFrameCount * isr->sensorCount];
+}
+
+// Publishes the block being filled, however many frames it holds.
+static void isr_publishBlock(isr_t *isr){
+	uint32_t head = atomic_load_explicit(&isr->blockHead, memory_order_relaxed);
+	isr_AdcBlock_t *descriptor = &isr->descriptors[head & ADC_BLOCK_INDEX_MASK];
+	descriptor->data = isr->adcBlocks[head & ADC_BLOCK_INDEX_MASK];
+	descriptor->frameCount = isr->fillFrameCount;
+	descriptor->sequence = head;
+	descriptor->framesDroppedBefore = isr->pendingDroppedFrames;
+	descriptor->discontinuity = isr->pendingDroppedFrames > 0 && isr->overflowPolicy == ISR_ADC_OVERFLOW_DISCONTINUITY;
+	if(descriptor->discontinuity){
+		isr->discontinuityCount++;
+	}
+	isr->pendingDroppedFrames = 0;
+	isr_AdcBlockListener_t listener = isr->blockListener;
+	if(listener != NULL && listener(descriptor, isr->sensorCount)){	//Taken, so the slot is free again
+		isr->fillFrameCount = 0;
+		return;
+	}
+	atomic_fetch_add_explicit(&isr->framesPublished, isr->fillFrameCount, memory_order_relaxed);
+	isr->fillFrameCount = 0;
+	atomic_store_explicit(&isr->blockHead, head + 1, memory_order_release);	//Publish the block and its descriptor
+	uint32_t waiting = isr_ctxAdcBlockCount(isr);
+	if(waiting > isr->highWaterBlocks){
+		isr->highWaterBlocks = waiting;
+	}
+}
+
+// Counts a frame written by isr_nextFrameSlot() and publishes a full block.
+static inline void isr_frameAdded(isr_t *isr){
+	if(++isr->fillFrameCount == ISR_ADC_BLOCK_FRAMES){
+		isr_publishBlock(isr);
+	}
+}
+
+// Adds one frame (a sample per sensor) to the ADC buffer. Producer side only.
+void isr_ctxAddFrameToAdcBuffer(isr_t *isr, const isr_AdcValue_t frame[]){
+	isr_AdcValue_t *slot = isr_nextFrameSlot(isr);
+	if(slot == NULL){
+		return;
+	}
+	for(uint16_t i = 0; i < isr->sensorCount; ++i)
+		slot[i] = frame[i];
+	isr_frameAdded(isr);
+}
+
 // This adds data to the ADC queue. Data are removed from this queue and used by
-// the detector.
-//this is similar to queue_overwritePush() with an uint32_t argument instead of a double. If the circular buffer is full, overwrite the oldest value.
+// the detector. Producer side only.
+void isr_ctxAddDataToAdcBuffer(isr_t *isr, uint32_t adcData){
+	isr_AdcValue_t *slot = isr_nextFrameSlot(isr);
+	if(slot == NULL){
+		return;
+	}
+	*slot = adcData;
+	isr_frameAdded(isr);
+}
+
+// Publishes the partly filled block now instead of when it is full.
+void isr_ctxFlushAdcBuffer(isr_t *isr){
+	if(isr->fillFrameCount > 0){
+		isr_publishBlock(isr);
+	}
+}
+
+// Claims the oldest published block, unless one is already claimed, and
+// describes it less any frames already removed from it one at a time.
+// Returns false if no block is waiting. Consumer side only.
+bool isr_ctxPeekAdcBlock(isr_t *isr, isr_AdcBlock_t *block){
+	while(!isr->holding){
+		uint32_t tail = atomic_load(&isr->blockTail);
+		if(atomic_load_explicit(&isr->blockHead, memory_order_acquire) == tail){
+			return false;
+		}
+		atomic_store(&isr->heldBlock, tail + 1);	//Mark it before claiming so the producer never reuses it
+		if(atomic_compare_exchange_strong(&isr->blockTail, &tail, tail + 1)){
+			isr->holding = true;
+		}
+		else{	//The producer took it back under drop-oldest, try the next one
+			atomic_store(&isr->heldBlock, 0);
+		}
+	}
+	uint32_t sequence = atomic_load_explicit(&isr->heldBlock, memory_order_relaxed) - 1;
+	*block = isr->descriptors[sequence & ADC_BLOCK_INDEX_MASK];
+	block->data += isr->readFrameOffset * isr->sensorCount;
+	block->frameCount -= isr->readFrameOffset;
+	if(isr->readFrameOffset > 0){
+		block->framesDroppedBefore = 0;
+		block->discontinuity = false;
+	}
+	return true;
+}
+
+// Hands the claimed block back to the producer. Consumer side only.
+void isr_ctxReleaseAdcBlock(isr_t *isr){
+	if(!isr->holding){
+		return;
+	}
+	uint32_t sequence = atomic_load_explicit(&isr->heldBlock, memory_order_relaxed) - 1;
+	uint32_t remaining = isr->descriptors[sequence & ADC_BLOCK_INDEX_MASK].frameCount - isr->readFrameOffset;
+	atomic_fetch_add_explicit(&isr->framesConsumed, remaining, memory_order_relaxed);
+	isr->readFrameOffset = 0;
+	isr->holding = false;
+	atomic_store_explicit(&isr->heldBlock, 0, memory_order_release);
+}
+
+// Removes up to maxFrames frames from the front of the buffer, copying them to
+// dst[] unless it is NULL. Returns the number removed.
+static uint32_t isr_removeFrames(isr_t *isr, isr_AdcValue_t dst[], uint32_t maxFrames){
+	uint32_t removed = 0;
+	isr_AdcBlock_t block;
+	while(removed < maxFrames && isr_ctxPeekAdcBlock(isr, &block)){
+		uint32_t count = block.frameCount;
+		if(count > maxFrames - removed){
+			count = maxFrames - removed;
+		}
+		if(dst != NULL){
+			memcpy(&dst[removed * isr->sensorCount], block.data, count * isr->sensorCount * sizeof(isr_AdcValue_t));
+		}
+		removed += count;
+		if(count == block.frameCount){
+			isr_ctxReleaseAdcBlock(isr);
+		}
+		else{
+			isr->readFrameOffset += count;
+			atomic_fetch_add_explicit(&isr->framesConsumed, count, memory_order_relaxed);
+		}
+	}
+	return removed;
+}
+
+// Removes the oldest frame from the ADC buffer. Returns false if it was empty.
+bool isr_ctxRemoveFrameFromAdcBuffer(isr_t *isr, isr_AdcValue_t frame[]){
+	return isr_removeFrames(isr, frame, 1) == 1;
+}
+
+// This removes a value from the ADC buffer. Returns 0 if it was empty.
+uint32_t isr_ctxRemoveDataFromAdcBuffer(isr_t *isr){
+	isr_AdcValue_t adcData = 0;
+	isr_removeFrames(isr, &adcData, 1);
+    return adcData;
+}
+
+// Copies up to maxFrames of the oldest frames into dst[] and removes them.
+uint32_t isr_ctxDrainAdcBuffer(isr_t *isr, isr_AdcValue_t dst[], uint32_t maxFrames){
+	return isr_removeFrames(isr, dst, maxFrames);
+}
+
+// This returns the number of frames in published blocks.
+uint32_t isr_ctxAdcBufferElementCount(isr_t *isr){
+	return atomic_load_explicit(&isr->framesPublished, memory_order_acquire) - atomic_load_explicit(&isr->framesConsumed, memory_order_acquire)
+		- atomic_load_explicit(&isr->framesDiscarded, memory_order_acquire);
+}
+
+// Returns how many published blocks are waiting for the consumer, counting
+// the one it has claimed.
+uint32_t isr_ctxAdcBlockCount(isr_t *isr){
+	uint32_t held = (atomic_load_explicit(&isr->heldBlock, memory_order_acquire) != 0) ? 1 : 0;
+	return atomic_load_explicit(&isr->blockHead, memory_order_acquire) - atomic_load_explicit(&isr->blockTail, memory_order_acquire) + held;
+}
+
+// Returns how many frames were dropped because no block was free.
+uint32_t isr_ctxGetAdcOverflowCount(isr_t *isr){
+	return isr->droppedFrameCount;
+}
+
+// Copies the block-handoff counters into stats.
+void isr_ctxGetAdcBlockStats(isr_t *isr, isr_AdcBlockStats_t *stats){
+	stats->blocksPublished = atomic_load_explicit(&isr->blockHead, memory_order_acquire);
+	stats->overrunCount = isr->overrunCount;
+	stats->droppedFrameCount = isr->droppedFrameCount;
+	stats->discontinuityCount = isr->discontinuityCount;
+	stats->highWaterBlocks = isr->highWaterBlocks;
+	stats->longestStallFrames = isr->longestStallFrames;
+}
+
+// Returns how many blocks have been published.
+uint32_t isr_ctxGetAdcBlocksPublished(isr_t *isr){
+	return atomic_load_explicit(&isr->blockHead, memory_order_acquire);
+}
+
+// Chooses what happens to frames that arrive while every block is waiting.
+void isr_ctxSetAdcOverflowPolicy(isr_t *isr, isr_AdcOverflowPolicy_t policy){
+	isr->overflowPolicy = policy;
+}
+
+// Returns the overflow policy in use.
+isr_AdcOverflowPolicy_t isr_ctxGetAdcOverflowPolicy(isr_t *isr){
+	return isr->overflowPolicy;
+}
+
+// Sets the function handed every block as it is published, NULL for none.
+void isr_ctxSetAdcBlockListener(isr_t *isr, isr_AdcBlockListener_t listener){
+	isr->blockListener = listener;
+}
+
+// Default-instance versions of the buffer functions.
+void isr_addFrameToAdcBuffer(const isr_AdcValue_t frame[]){
+	isr_ctxAddFrameToAdcBuffer(&defaultIsr, frame);
+}
+
+bool isr_removeFrameFromAdcBuffer(isr_AdcValue_t frame[]){
+	return isr_ctxRemoveFrameFromAdcBuffer(&defaultIsr, frame);
+}
+
 void isr_addDataToAdcBuffer(uint32_t adcData){
-	adcBuffer[backIndex] = adcData;
-	backIndex = (backIndex + 1) % ADC_BUFFER_SIZE;
-	if(elementCount == ADC_BUFFER_SIZE){
-		frontIndex = (frontIndex + 1) % ADC_BUFFER_SIZE;
+	isr_ctxAddDataToAdcBuffer(&defaultIsr, adcData);
+}
+
+uint32_t isr_removeDataFromAdcBuffer(){
+	return isr_ctxRemoveDataFromAdcBuffer(&defaultIsr);
+}
+
+uint32_t isr_adcBufferElementCount(){
+	return isr_ctxAdcBufferElementCount(&defaultIsr);
+}
+
+uint32_t isr_drainAdcBuffer(isr_AdcValue_t dst[], uint32_t maxFrames){
+	return isr_ctxDrainAdcBuffer(&defaultIsr, dst, maxFrames);
+}
+
+uint32_t isr_getAdcOverflowCount(){
+	return isr_ctxGetAdcOverflowCount(&defaultIsr);
+}
+
+void isr_flushAdcBuffer(){
+	bool wereEnabled = isr_maskArmInts();	//isr_function() fills the same block
+	isr_ctxFlushAdcBuffer(&defaultIsr);
+	isr_restoreArmInts(wereEnabled);
+}
+
+void isr_getAdcBlockStats(isr_AdcBlockStats_t *stats){
+	isr_ctxGetAdcBlockStats(&defaultIsr, stats);
+}
+
+void isr_setAdcOverflowPolicy(isr_AdcOverflowPolicy_t policy){
+	isr_ctxSetAdcOverflowPolicy(&defaultIsr, policy);
+}
+
+isr_AdcOverflowPolicy_t isr_getAdcOverflowPolicy(){
+	return isr_ctxGetAdcOverflowPolicy(&defaultIsr);
+}
+
+// Reads one sample per sensor, adds the frame to an ADC buffer and hands the
+// first sensor's sample to adcCapture.
+static void isr_captureAdc(isr_t *isr){
+	if(isr->sensorCount == 1){
+		isr_AdcValue_t sample = interrupts_getAdcData();
+		isr_ctxAddDataToAdcBuffer(isr, sample);
+		adcCapture_addSample(sample);
 	}
 	else{
-		++elementCount;
+		isr_AdcValue_t frame[ISR_MAX_SENSOR_COUNT];
+		for(uint16_t i = 0; i < isr->sensorCount; ++i)
+			frame[i] = isr_readSensorAdcData(i);
+		isr_ctxAddFrameToAdcBuffer(isr, frame);
+		adcCapture_addSample(frame[0]);
+	}
+}
+
+// Runs the slow-lane machine, if any, that owns this fast tick of the
+// millisecond. Each one runs once every ISR_SLOW_LANE_DIVIDER fast ticks.
+static void isr_slowLaneTick(){
+	switch(slowLanePhase){
+		case ISR_SLOW_LANE_LOCKOUT_PHASE:
+			ISR_PROFILE_CALL(ISR_PROFILE_LOCKOUT_TIMER, lockoutTimer_tick());
+			break;
+		case ISR_SLOW_LANE_HIT_LED_PHASE:
+			ISR_PROFILE_CALL(ISR_PROFILE_HIT_LED_TIMER, hitLedTimer_tick());
+			break;
+		case ISR_SLOW_LANE_TRIGGER_PHASE:
+			ISR_PROFILE_CALL(ISR_PROFILE_TRIGGER, trigger_tick());
+			break;
+	}
+	if(++slowLanePhase == ISR_SLOW_LANE_DIVIDER){
+		slowLanePhase = 0;
+		virtualTimer_tick();	//Just a counter, the timers expire in virtualTimer_service()
 	}
 }
 
+// Returns the fast tick of the millisecond the next isr_function() runs.
+uint16_t isr_getSlowLanePhase(){
+	return slowLanePhase;
+}
+
 // This function is invoked by the timer interrupt at 100 kHz.
 void isr_function(){
+	ISR_PROFILE_ENTER();
+	//Fast lane
+	ISR_PROFILE_CALL(ISR_PROFILE_TRANSMITTER, transmitter_tick());
+	ISR_PROFILE_CALL(ISR_PROFILE_SOUND, sound_tick());
+	ISR_PROFILE_CALL(ISR_PROFILE_ADC_CAPTURE, isr_captureAdc(&defaultIsr));
+	//Slow lane
+	isr_slowLaneTick();
+	ISR_PROFILE_EXIT();
+}
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#define STRESS_TEST_SAMPLE_COUNT 20000000
+#define STRESS_TEST_LEGACY_BUFFER_SIZE 20001
+#define STRESS_TEST_TIMER INTERVAL_TIMER_TIMER_2
+#define LANE_BENCHMARK_TICK_COUNT 100000 // One second of interrupts.
+
+#ifndef ZYBO_BOARD
+// State shared by the producer and consumer threads of one stress run.
+typedef struct {
+	isr_t *buffer;
+	atomic_bool producerDone;
+	uint32_t received;
+	bool inOrder;
+} isr_stressTest_t;
+
+// Producer: adds 1, 2, 3 ... as fast as the consumer takes them. It waits
+// while every block is taken so every value is delivered and timed.
+static void *isr_stressProducer(void *arg){
+	isr_stressTest_t *test = arg;
+	for(uint32_t i = 1; i <= STRESS_TEST_SAMPLE_COUNT; ++i){
+		while(isr_ctxAdcBlockCount(test->buffer) == ISR_ADC_BLOCK_COUNT)
+			sched_yield();
+		isr_ctxAddDataToAdcBuffer(test->buffer, i);
+	}
+	isr_ctxFlushAdcBuffer(test->buffer);
+	atomic_store(&test->producerDone, true);
+	return NULL;
+}
+
+// Consumer: takes whole blocks in place and checks that the values arrive in
+// order.
+static void *isr_stressConsumer(void *arg){
+	isr_stressTest_t *test = arg;
+	uint32_t last = 0;
+	while(true){
+		bool done = atomic_load(&test->producerDone);	//Read before the peek so no block is missed
+		isr_AdcBlock_t block;
+		if(!isr_ctxPeekAdcBlock(test->buffer, &block)){
+			if(done){
+				break;
+			}
+			continue;
+		}
+		for(uint32_t i = 0; i < block.frameCount; ++i){
+			if(block.data[i] != last + 1)
+				test->inOrder = false;
+			last = block.data[i];
+		}
+		isr_ctxReleaseAdcBlock(test->buffer);
+		test->received += block.frameCount;
+	}
+	return NULL;
+}
+
+// The buffer as it was before the block queue: % indexing and a shared element count,
+// so every access has to be locked, the way the detector masked interrupts.
+static uint32_t legacyBuffer[STRESS_TEST_LEGACY_BUFFER_SIZE];
+static uint32_t legacyFrontIndex, legacyBackIndex, legacyElementCount;
+static pthread_mutex_t legacyLock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool legacyProducerDone;
+
+// Legacy producer, waits while the buffer is full like the block producer.
+static void *isr_legacyProducer(void *arg){
+	(void)arg;
+	for(uint32_t i = 1; i <= STRESS_TEST_SAMPLE_COUNT; ++i){
+		pthread_mutex_lock(&legacyLock);
+		while(legacyElementCount == STRESS_TEST_LEGACY_BUFFER_SIZE){
+			pthread_mutex_unlock(&legacyLock);
+			sched_yield();
+			pthread_mutex_lock(&legacyLock);
+		}
+		legacyBuffer[legacyBackIndex] = i;
+		legacyBackIndex = (legacyBackIndex + 1) % STRESS_TEST_LEGACY_BUFFER_SIZE;
+		++legacyElementCount;
+		pthread_mutex_unlock(&legacyLock);
+	}
+	atomic_store(&legacyProducerDone, true);
+	return NULL;
+}
+
+// Legacy consumer, one locked pop per value like the old detector().
+static void *isr_legacyConsumer(void *arg){
+	(void)arg;
+	while(true){
+		bool done = atomic_load(&legacyProducerDone);
+		pthread_mutex_lock(&legacyLock);
+		bool empty = (legacyElementCount == 0);
+		if(!empty){
+			--legacyElementCount;
+			volatile uint32_t value = legacyBuffer[legacyFrontIndex];
+			(void)value;
+			legacyFrontIndex = (legacyFrontIndex + 1) % STRESS_TEST_LEGACY_BUFFER_SIZE;
+		}
+		pthread_mutex_unlock(&legacyLock);
+		if(empty && done){
+			break;
+		}
+	}
+	return NULL;
+}
+
+// Runs a producer and a consumer thread and returns the elapsed seconds.
+static double isr_runStressThreads(void *(*producer)(void *), void *(*consumer)(void *), void *arg){
+	pthread_t producerThread, consumerThread;
+	intervalTimer_reset(STRESS_TEST_TIMER);
+	intervalTimer_start(STRESS_TEST_TIMER);
+	pthread_create(&consumerThread, NULL, consumer, arg);
+	pthread_create(&producerThread, NULL, producer, arg);
+	pthread_join(producerThread, NULL);
+	pthread_join(consumerThread, NULL);
+	intervalTimer_stop(STRESS_TEST_TIMER);
+	return intervalTimer_getTotalDurationInSeconds(STRESS_TEST_TIMER);
+}
+#endif
+
+// Pushes STRESS_TEST_SAMPLE_COUNT values through the block queue from a
+// producer thread to a consumer thread, checks each arrives once and in order, and
+// compares the throughput with the old locked buffer. Host builds only.
+void isr_runAdcBufferStressTest(){
+#ifdef ZYBO_BOARD
+	printf("isr_runAdcBufferStressTest() needs threads, run it in the emulator build.\n");
+#else
+	printf("Starting isr_runAdcBufferStressTest()\n");
+	intervalTimer_init(STRESS_TEST_TIMER);
+	isr_stressTest_t test = {.buffer = isr_create(), .received = 0, .inOrder = true};
+	if(test.buffer == NULL){
+		printf("FAILED to allocate the ADC buffer\n");
+		return;
+	}
+	atomic_init(&test.producerDone, false);
+	double blockSeconds = isr_runStressThreads(isr_stressProducer, isr_stressConsumer, &test);
+	bool passed = test.inOrder && test.received == STRESS_TEST_SAMPLE_COUNT && isr_ctxGetAdcOverflowCount(test.buffer) == 0;
+	printf("Blocks: %f seconds, %f samples/second, %u received, %s\n", blockSeconds,
+		STRESS_TEST_SAMPLE_COUNT / blockSeconds, test.received, passed ? "passed" : "FAILED");
+	isr_destroy(test.buffer);
+	atomic_init(&legacyProducerDone, false);
+	double legacySeconds = isr_runStressThreads(isr_legacyProducer, isr_legacyConsumer, NULL);
+	printf("Locked %% buffer: %f seconds, %f samples/second\n", legacySeconds, STRESS_TEST_SAMPLE_COUNT / legacySeconds);
+	printf("Blocks are %f x faster\n", legacySeconds / blockSeconds);
+	printf("Completed isr_runAdcBufferStressTest()\n");
+#endif
+}
+
+// The ISR body as it was before the slow lane: every machine at 100 kHz.
+static void isr_singleLaneTick(isr_t *isr){
     lockoutTimer_tick();
 	hitLedTimer_tick();
 	trigger_tick();
     transmitter_tick();
 	sound_tick();
-	isr_addDataToAdcBuffer(interrupts_getAdcData());
+	isr_captureAdc(isr);
 }
 
-// This removes a value from the ADC buffer.
-uint32_t isr_removeDataFromAdcBuffer(){
-	if(elementCount == 0){
-		return 0;
+// Runs one second's worth of ISR bodies (100,000 ticks) with every machine at
+// 100 kHz and then with the two-lane split, timing each with the interval
+// timer, and prints the ISR time per second of each. Interrupts must be off;
+// samples go to a scratch buffer so the detector never sees them.
+void isr_runLaneBenchmark(){
+	printf("Starting isr_runLaneBenchmark()\n");
+	isr_t *scratch = isr_create();
+	if(scratch == NULL){
+		printf("FAILED to allocate the scratch ADC buffer\n");
+		return;
 	}
-	--elementCount;
-	uint16_t indexToRemove = frontIndex;
-	frontIndex = (frontIndex + 1) % ADC_BUFFER_SIZE;
-    return adcBuffer[indexToRemove];
-}
-
-// This returns the number of values in the ADC buffer.
-uint32_t isr_adcBufferElementCount(){
-	return elementCount;
+	intervalTimer_init(STRESS_TEST_TIMER);
+	intervalTimer_reset(STRESS_TEST_TIMER);
+	intervalTimer_start(STRESS_TEST_TIMER);
+	for(uint32_t tick = 0; tick < LANE_BENCHMARK_TICK_COUNT; ++tick){
+		isr_singleLaneTick(scratch);
+		if(isr_ctxAdcBlockCount(scratch) == ISR_ADC_BLOCK_COUNT)
+			isr_ctxInit(scratch);	//Keep the buffer from overrunning
+	}
+	intervalTimer_stop(STRESS_TEST_TIMER);
+	double singleLaneSeconds = intervalTimer_getTotalDurationInSeconds(STRESS_TEST_TIMER);
+	isr_ctxInit(scratch);
+	slowLanePhase = 0;
+	intervalTimer_reset(STRESS_TEST_TIMER);
+	intervalTimer_start(STRESS_TEST_TIMER);
+	for(uint32_t tick = 0; tick < LANE_BENCHMARK_TICK_COUNT; ++tick){
+		transmitter_tick();
+		sound_tick();
+		isr_captureAdc(scratch);
+		isr_slowLaneTick();
+		if(isr_ctxAdcBlockCount(scratch) == ISR_ADC_BLOCK_COUNT)
+			isr_ctxInit(scratch);
+	}
+	intervalTimer_stop(STRESS_TEST_TIMER);
+	double twoLaneSeconds = intervalTimer_getTotalDurationInSeconds(STRESS_TEST_TIMER);
+	isr_destroy(scratch);
+	printf("Every machine at 100 kHz: %f ms of ISR time per second (%5.2f%% of the CPU)\n",
+		singleLaneSeconds * 1000, singleLaneSeconds * 100);
+	printf("Fast lane + 1 kHz slow lane: %f ms of ISR time per second (%5.2f%% of the CPU)\n",
+		twoLaneSeconds * 1000, twoLaneSeconds * 100);
+	printf("ISR time reduced %5.2f%%\n", 100.0 * (singleLaneSeconds - twoLaneSeconds) / singleLaneSeconds);
+	printf("Completed isr_runLaneBenchmark()\n");
 }
-
@@ -9,11 +9,15 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #ifndef ISR_H_
 #define ISR_H_
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef uint32_t
     isr_AdcValue_t; // Used to represent ADC values in the ADC buffer.
 
+#define ISR_MAX_SENSOR_COUNT 4 // Up to four XADC aux channels (JA pmod).
+#define ISR_DEFAULT_SENSOR_COUNT 1 // Only the SELECTED_XADC_CHANNEL by default.
+
 // isr provides the isr_function() where you will place functions that require
 // accurate timing. A buffer for storing values from the Analog to Digital
 // Converter (ADC) is implemented in isr.c Values are added to this buffer by
@@ -23,16 +27,199 @@ typedef uint32_t
 void isr_init();
 
 // This function is invoked by the timer interrupt at 100 kHz.
+// It runs two lanes. The fast lane runs every tick and does what needs
+// 100 kHz timing: ADC capture, the transmitter edges and sound, which keeps
+// the I2S TX FIFO topped up (see sound.h). The slow lane runs the
+// millisecond-scale machines (lockoutTimer, hitLedTimer, trigger) at 1 kHz.
+// Each slow machine gets its own fast tick within the millisecond, so no
+// single interrupt pays for all of them. The last tick of the millisecond
+// also advances the virtualTimer counter.
+#define ISR_SLOW_LANE_DIVIDER 100 // 100 kHz / 100 = 1 kHz slow lane.
 void isr_function();
 
+// Fast tick of the millisecond on which each slow-lane machine runs.
+#define ISR_SLOW_LANE_LOCKOUT_PHASE 0
+#define ISR_SLOW_LANE_HIT_LED_PHASE 1
+#define ISR_SLOW_LANE_TRIGGER_PHASE 2
+
+// Returns the fast tick of the millisecond, 0 to ISR_SLOW_LANE_DIVIDER - 1,
+// that the next isr_function() call runs.
+uint16_t isr_getSlowLanePhase();
+
+// The ADC buffer is a pool of ISR_ADC_BLOCK_COUNT blocks of
+// ISR_ADC_BLOCK_FRAMES frames. isr_function() fills one block at a time and
+// publishes it when it is full through a lock-free single-producer/
+// single-consumer queue of block descriptors, and the detector takes whole
+// blocks, so neither side masks interrupts or pays a handoff per sample.
+// A block is 1 ms of samples, a whole number of FIR decimation periods.
+// What happens when every block is still waiting for the detector is set by
+// the overflow policy below. Values added by the functions below become
+// visible to the detector once their block is full or flushed.
+#define ISR_ADC_BLOCK_FRAMES 100 // Multiple of FILTER_FIR_DECIMATION_FACTOR.
+#define ISR_ADC_BLOCK_COUNT 256  // Power of two, 256 ms of samples in all.
+
+// Overflow policies, for when the ISR finds every block waiting.
+typedef enum {
+  // New frames are dropped and counted, and the next block published reports
+  // how many frames are missing before it. The detector runs straight across
+  // the gap. This is the default.
+  ISR_ADC_OVERFLOW_DROP_NEWEST,
+  // The oldest unclaimed block is taken back and refilled, so the detector
+  // sees the newest 256 ms when it catches up. The missing blocks show as a
+  // jump in sequence.
+  ISR_ADC_OVERFLOW_DROP_OLDEST,
+  // Like drop-newest, but the block after the gap is flagged as a
+  // discontinuity and the detector restarts its filters and power windows
+  // there instead of mixing samples from both sides of the gap.
+  ISR_ADC_OVERFLOW_DISCONTINUITY
+} isr_AdcOverflowPolicy_t;
+
+// Describes one published block. frameCount frames of isr_getSensorCount()
+// interleaved samples each start at data.
+typedef struct {
+  const isr_AdcValue_t *data;
+  uint32_t frameCount;
+  uint32_t sequence; // Counts up by one per published block.
+  uint32_t framesDroppedBefore; // Frames lost to an overrun just before this block.
+  bool discontinuity; // Frames were dropped before this block under ISR_ADC_OVERFLOW_DISCONTINUITY.
+} isr_AdcBlock_t;
+
+// Block handoff counters.
+typedef struct {
+  uint32_t blocksPublished;
+  uint32_t overrunCount; // Runs of ticks that found every block taken.
+  uint32_t droppedFrameCount; // Frames dropped or taken back.
+  uint32_t discontinuityCount; // Blocks flagged as discontinuities.
+  uint32_t highWaterBlocks; // Most blocks waiting at once.
+  uint32_t longestStallFrames; // Longest run of ticks with data waiting and none taken.
+} isr_AdcBlockStats_t;
+
 // This adds data to the ADC queue. Data are removed from this queue and used by
-// the detector.
+// the detector. Single-sensor operation only, see isr_addFrameToAdcBuffer().
 void isr_addDataToAdcBuffer(uint32_t adcData);
 
-// This removes a value from the ADC buffer.
+// This removes a value from the ADC buffer. Single-sensor operation only.
 uint32_t isr_removeDataFromAdcBuffer();
 
 // This returns the number of values in the ADC buffer.
+// When more than one sensor is sampled, this is the number of frames.
 uint32_t isr_adcBufferElementCount();
 
+// Copies up to maxFrames of the oldest frames into dst[], which must hold
+// maxFrames * isr_getSensorCount() values, and removes them from the buffer.
+// Returns the number of frames copied.
+uint32_t isr_drainAdcBuffer(isr_AdcValue_t dst[], uint32_t maxFrames);
+
+// Publishes the block being filled now, even though it is not full. Test code
+// that adds a few samples at a time calls this before running the detector.
+// isr_function() fills the same block, so ARM interrupts are masked while it
+// is published and then restored.
+void isr_flushAdcBuffer();
+
+// Mask ARM interrupts around a few lines that share state with
+// isr_function(), and put the mask back the way the caller had it.
+// isr_maskArmInts() returns true if interrupts were enabled before. The
+// emulator cannot read the mask, so there both do nothing.
+bool isr_maskArmInts();
+void isr_restoreArmInts(bool wereEnabled);
+
+// Returns how many frames were dropped because no block was free.
+uint32_t isr_getAdcOverflowCount();
+
+// Copies the block handoff counters into stats.
+void isr_getAdcBlockStats(isr_AdcBlockStats_t *stats);
+
+// Sets and returns the overflow policy. Changing it while the ISR runs takes
+// effect from the next block.
+void isr_setAdcOverflowPolicy(isr_AdcOverflowPolicy_t policy);
+isr_AdcOverflowPolicy_t isr_getAdcOverflowPolicy();
+
+// Sets how many sensor channels the ISR samples each tick (1 to
+// ISR_MAX_SENSOR_COUNT). Sensor 0 is always SELECTED_XADC_CHANNEL, the others
+// are the remaining JA aux channels. Empties the ADC buffer, so call this
+// before the detector starts.
+void isr_setSensorCount(uint16_t sensorCount);
+
+// Returns the number of sensor channels sampled each tick.
+uint16_t isr_getSensorCount();
+
+// Adds one frame, a sample for each sensor, to the ADC buffer. The samples are
+// stored interleaved: sensor 0, sensor 1, ... sensor K-1 for each tick.
+void isr_addFrameToAdcBuffer(const isr_AdcValue_t frame[]);
+
+// Removes the oldest frame from the ADC buffer into frame[].
+// Returns false if the buffer was empty.
+bool isr_removeFrameFromAdcBuffer(isr_AdcValue_t frame[]);
+
+// The ADC buffer state lives in an isr_t so the detector can also be fed from
+// buffers that no interrupt fills (simulated guns, test threads). The buffer
+// functions above use the default instance, which isr_function() fills; each
+// has an isr_ctxXxx() version that takes the instance to use.
+typedef struct isr_t isr_t;
+
+// Allocates a new, empty, single-sensor ADC buffer. Returns NULL if out of
+// memory.
+isr_t *isr_create();
+
+// Frees an instance returned by isr_create().
+void isr_destroy(isr_t *isr);
+
+// Returns the instance filled by isr_function().
+isr_t *isr_getDefault();
+
+// Empties the ADC buffer. Unlike isr_init() this touches nothing else.
+void isr_ctxInit(isr_t *isr);
+
+// Sets the samples per frame and empties the buffer. Only
+// isr_setSensorCount() also reconfigures the XADC.
+void isr_ctxSetSensorCount(isr_t *isr, uint16_t sensorCount);
+
+// Zero-copy consumer side. Claims the oldest published block and describes
+// it, less any frames already removed one at a time, and returns false if
+// none is waiting. Peeking again before the release describes the same
+// block. The block stays in place, untouched by the producer, until
+// isr_ctxReleaseAdcBlock() hands it back.
+bool isr_ctxPeekAdcBlock(isr_t *isr, isr_AdcBlock_t *block);
+void isr_ctxReleaseAdcBlock(isr_t *isr);
+
+// Returns how many published blocks are waiting.
+uint32_t isr_ctxAdcBlockCount(isr_t *isr);
+
+// Publishes the block being filled now. Producer side only: the thread that
+// adds to the instance, or one that has stopped it.
+void isr_ctxFlushAdcBuffer(isr_t *isr);
+void isr_ctxGetAdcBlockStats(isr_t *isr, isr_AdcBlockStats_t *stats);
+// Returns how many blocks have been published, safe to call from another core
+// or thread while the producer runs. One block is one millisecond of samples.
+uint32_t isr_ctxGetAdcBlocksPublished(isr_t *isr);
+
+// Called by the producer with every block it publishes, before the block is
+// queued, with the samples per frame. Returning true takes the block: it is
+// not queued for the consumer and its slot is refilled at once, so the data
+// are only valid during the call. Runs in the ISR for the default instance,
+// so it must be short. NULL removes it.
+typedef bool (*isr_AdcBlockListener_t)(const isr_AdcBlock_t *block, uint16_t sensorCount);
+void isr_ctxSetAdcBlockListener(isr_t *isr, isr_AdcBlockListener_t listener);
+void isr_ctxSetAdcOverflowPolicy(isr_t *isr, isr_AdcOverflowPolicy_t policy);
+isr_AdcOverflowPolicy_t isr_ctxGetAdcOverflowPolicy(isr_t *isr);
+uint32_t isr_ctxDrainAdcBuffer(isr_t *isr, isr_AdcValue_t dst[],
+                               uint32_t maxFrames);
+uint32_t isr_ctxGetAdcOverflowCount(isr_t *isr);
+uint16_t isr_ctxGetSensorCount(isr_t *isr);
+void isr_ctxAddDataToAdcBuffer(isr_t *isr, uint32_t adcData);
+uint32_t isr_ctxRemoveDataFromAdcBuffer(isr_t *isr);
+uint32_t isr_ctxAdcBufferElementCount(isr_t *isr);
+void isr_ctxAddFrameToAdcBuffer(isr_t *isr, const isr_AdcValue_t frame[]);
+bool isr_ctxRemoveFrameFromAdcBuffer(isr_t *isr, isr_AdcValue_t frame[]);
+
+// Runs a producer and a consumer thread through an ADC block queue, checks
+// that no value is lost or reordered, and compares the throughput with a
+// locked buffer like the one the block queue replaced. Host (emulator) builds only.
+void isr_runAdcBufferStressTest();
+
+// Times one second's worth of ISR bodies with every state machine at 100 kHz
+// and with the fast/slow lane split, and prints the ISR time per second of
+// each. Run it with interrupts disabled.
+void isr_runLaneBenchmark();
+
 #endif /* ISR_H_ */
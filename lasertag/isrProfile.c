@@ -0,0 +1,194 @@
+#include "isrProfile.h"
+
+#ifdef ISR_PROFILE_ENABLED
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "display.h"
+#include "isr.h"
+
+// Call lengths are binned in CYCLE_BIN_WIDTH steps up to two nominal ISR
+// periods to find the 99th percentile without sorting. The last bin holds
+// every longer call.
+#define CYCLE_BIN_COUNT 257
+#define CYCLE_BIN_WIDTH (ISR_PROFILE_NOMINAL_PERIOD_CYCLES / 128)
+#define PERCENTILE 99
+#define PERCENT 100
+
+#define TEST_TICK_COUNT 100000 // One second of interrupts.
+#define DISPLAY_BUFFER_SIZE 80
+
+// Everything recorded for one slot.
+typedef struct {
+	uint32_t callCount;
+	uint32_t minCycles;
+	uint32_t maxCycles;
+	uint64_t totalCycles;
+	uint32_t bins[CYCLE_BIN_COUNT];
+} isrProfile_slotRecord_t;
+
+static isrProfile_slotRecord_t slotRecords[ISR_PROFILE_SLOT_COUNT];
+static isrProfile_periodStats_t periodRecord;
+static bool havePreviousEntry;
+static uint32_t previousEntryCycles;
+
+static const char *slotNames[ISR_PROFILE_SLOT_COUNT] = {
+	"transmitter", "ADC capture", "lockoutTimer", "hitLedTimer", "trigger", "sound", "isr_function"};
+
+// Clears every statistic. The next ISR entry starts a new period measurement.
+void isrProfile_reset(){
+	memset(slotRecords, 0, sizeof(slotRecords));
+	for(uint16_t i = 0; i < ISR_PROFILE_SLOT_COUNT; ++i)
+		slotRecords[i].minCycles = UINT32_MAX;
+	memset(&periodRecord, 0, sizeof(periodRecord));
+	periodRecord.minCycles = UINT32_MAX;
+	havePreviousEntry = false;
+}
+
+// Starts the cycle counter and clears every statistic.
+void isrProfile_init(){
+	timebase_init();
+	isrProfile_reset();
+}
+
+// Records one call of cycles length against slot.
+void isrProfile_record(isrProfile_slot_t slot, uint32_t cycles){
+	isrProfile_slotRecord_t *record = &slotRecords[slot];
+	++record->callCount;
+	record->totalCycles += cycles;
+	if(cycles < record->minCycles)
+		record->minCycles = cycles;
+	if(cycles > record->maxCycles)
+		record->maxCycles = cycles;
+	uint32_t bin = cycles / CYCLE_BIN_WIDTH;
+	++record->bins[bin < CYCLE_BIN_COUNT ? bin : CYCLE_BIN_COUNT - 1];
+}
+
+// Records an ISR entry for the period histogram and returns the entry time.
+uint32_t isrProfile_enterIsr(){
+	uint32_t now = timebase_readCycles();
+	if(havePreviousEntry){
+		uint32_t period = now - previousEntryCycles;
+		++periodRecord.periodCount;
+		if(period < periodRecord.minCycles)
+			periodRecord.minCycles = period;
+		if(period > periodRecord.maxCycles)
+			periodRecord.maxCycles = period;
+		uint32_t bin = period / ISR_PROFILE_PERIOD_BIN_CYCLES;
+		++periodRecord.bins[bin < ISR_PROFILE_PERIOD_BIN_COUNT ? bin : ISR_PROFILE_PERIOD_BIN_COUNT - 1];
+	}
+	previousEntryCycles = now;
+	havePreviousEntry = true;
+	return now;
+}
+
+// Fills stats with a snapshot of one slot.
+void isrProfile_getStats(isrProfile_slot_t slot, isrProfile_stats_t *stats){
+	const isrProfile_slotRecord_t *record = &slotRecords[slot];
+	memset(stats, 0, sizeof(*stats));
+	stats->callCount = record->callCount;
+	if(record->callCount == 0){
+		return;
+	}
+	stats->minCycles = record->minCycles;
+	stats->maxCycles = record->maxCycles;
+	stats->meanCycles = record->totalCycles / record->callCount;
+	uint32_t needed = ((uint64_t)record->callCount * PERCENTILE + PERCENT - 1) / PERCENT;
+	uint32_t seen = 0;
+	for(uint32_t bin = 0; bin < CYCLE_BIN_COUNT; ++bin){
+		seen += record->bins[bin];
+		if(seen >= needed){
+			stats->p99Cycles = (bin == CYCLE_BIN_COUNT - 1) ? record->maxCycles : (bin + 1) * CYCLE_BIN_WIDTH;
+			break;
+		}
+	}
+	if(stats->p99Cycles > stats->maxCycles)	//The bin edge can lie past the longest call
+		stats->p99Cycles = stats->maxCycles;
+}
+
+// Fills stats with a snapshot of the ISR period histogram.
+void isrProfile_getPeriodStats(isrProfile_periodStats_t *stats){
+	*stats = periodRecord;
+	if(stats->periodCount == 0){
+		stats->minCycles = 0;
+	}
+}
+
+// Returns the printable name of a slot.
+const char *isrProfile_getSlotName(isrProfile_slot_t slot){
+	return slotNames[slot];
+}
+
+// Prints every slot and the period histogram to the console.
+void isrProfile_printReport(){
+	isrProfile_stats_t stats;
+	isrProfile_periodStats_t period;
+	printf("ISR profile (%" PRIu32 " cycles per second)\n", (uint32_t)ISR_PROFILE_CYCLES_PER_SECOND);
+	printf("%-13s %10s %8s %8s %8s %8s\n", "function", "calls", "min", "mean", "p99", "max");
+	for(uint16_t i = 0; i < ISR_PROFILE_SLOT_COUNT; ++i){
+		isrProfile_getStats(i, &stats);
+		printf("%-13s %10" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", slotNames[i], stats.callCount, stats.minCycles,
+			stats.meanCycles, stats.p99Cycles, stats.maxCycles);
+	}
+	isrProfile_getPeriodStats(&period);
+	printf("ISR period: %" PRIu32 " periods, nominal %" PRIu32 ", min %" PRIu32 ", max %" PRIu32 " cycles\n",
+		period.periodCount, (uint32_t)ISR_PROFILE_NOMINAL_PERIOD_CYCLES, period.minCycles, period.maxCycles);
+	for(uint32_t bin = 0; bin < ISR_PROFILE_PERIOD_BIN_COUNT; ++bin){
+		if(period.bins[bin] == 0){
+			continue;
+		}
+		if(bin == ISR_PROFILE_PERIOD_BIN_COUNT - 1){
+			printf("  >= %6" PRIu32 ": %" PRIu32 " (missed interrupts)\n", (uint32_t)(bin * ISR_PROFILE_PERIOD_BIN_CYCLES),
+				period.bins[bin]);
+		}
+		else{
+			printf("  %6" PRIu32 "-%6" PRIu32 ": %" PRIu32 "\n", (uint32_t)(bin * ISR_PROFILE_PERIOD_BIN_CYCLES),
+				(uint32_t)((bin + 1) * ISR_PROFILE_PERIOD_BIN_CYCLES - 1), period.bins[bin]);
+		}
+	}
+}
+
+// Shows every slot and the period extremes on the TFT display.
+void isrProfile_displayReport(){
+	char buffer[DISPLAY_BUFFER_SIZE];
+	isrProfile_stats_t stats;
+	isrProfile_periodStats_t period;
+	display_fillScreen(DISPLAY_BLACK);
+	display_setTextColor(DISPLAY_WHITE);
+	display_setTextSize(1);
+	display_setCursor(0, 0);
+	display_println("ISR cycles: min/mean/p99/max\n");
+	for(uint16_t i = 0; i < ISR_PROFILE_SLOT_COUNT; ++i){
+		isrProfile_getStats(i, &stats);
+		snprintf(buffer, DISPLAY_BUFFER_SIZE, "%-13s %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, slotNames[i], stats.minCycles,
+			stats.meanCycles, stats.p99Cycles, stats.maxCycles);
+		display_println(buffer);
+	}
+	isrProfile_getPeriodStats(&period);
+	snprintf(buffer, DISPLAY_BUFFER_SIZE, "\nISR period: min %" PRIu32 ", max %" PRIu32 " (nominal %" PRIu32 ")",
+		period.minCycles, period.maxCycles, (uint32_t)ISR_PROFILE_NOMINAL_PERIOD_CYCLES);
+	display_println(buffer);
+	snprintf(buffer, DISPLAY_BUFFER_SIZE, "Missed interrupts: %" PRIu32, period.bins[ISR_PROFILE_PERIOD_BIN_COUNT - 1]);
+	display_println(buffer);
+}
+
+// Runs isr_function() on a software-paced 10 us schedule for one second and
+// prints the report. Run it with interrupts disabled.
+void isrProfile_runTest(){
+	printf("Starting isrProfile_runTest()\n");
+	isrProfile_init();
+	uint32_t nextEntry = timebase_readCycles();
+	for(uint32_t tick = 0; tick < TEST_TICK_COUNT; ++tick){
+		while((int32_t)(timebase_readCycles() - nextEntry) < 0);
+		isr_function();
+		nextEntry += ISR_PROFILE_NOMINAL_PERIOD_CYCLES;
+	}
+	isr_ctxInit(isr_getDefault());	//Throw the captured samples away
+	isrProfile_printReport();
+	isrProfile_stats_t total;
+	isrProfile_getStats(ISR_PROFILE_ISR_TOTAL, &total);
+	printf("%s\n", total.callCount == TEST_TICK_COUNT ? "passed" : "FAILED");
+	printf("Completed isrProfile_runTest()\n");
+}
+
+#endif /* ISR_PROFILE_ENABLED */
@@ -0,0 +1,115 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ISRPROFILE_H_
+#define ISRPROFILE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "timebase.h"
+
+// Profiles isr_function(). Every tick function it calls is timed in
+// timebase cycles (the Cortex-A9 PMU cycle counter on the board, nanoseconds
+// on a host) and the time between successive ISR entries is histogrammed
+// against the nominal 10 us period.
+// Build with ISR_PROFILE_ENABLED defined (cmake -DISR_PROFILE=1) to turn it
+// on. Without it the ISR_PROFILE_* macros expand to nothing or to the bare
+// call, and none of the functions below exist.
+
+#define ISR_PROFILE_CYCLES_PER_SECOND TIMEBASE_CYCLES_PER_SECOND
+#define ISR_PROFILE_NOMINAL_PERIOD_CYCLES (ISR_PROFILE_CYCLES_PER_SECOND / 100000)
+
+// One slot per profiled call, plus the whole ISR.
+typedef enum {
+  ISR_PROFILE_TRANSMITTER,
+  ISR_PROFILE_ADC_CAPTURE,
+  ISR_PROFILE_LOCKOUT_TIMER,
+  ISR_PROFILE_HIT_LED_TIMER,
+  ISR_PROFILE_TRIGGER,
+  ISR_PROFILE_SOUND,
+  ISR_PROFILE_ISR_TOTAL,
+  ISR_PROFILE_SLOT_COUNT
+} isrProfile_slot_t;
+
+// Call statistics for one slot, in cycles.
+typedef struct {
+  uint32_t callCount;
+  uint32_t minCycles;
+  uint32_t meanCycles;
+  uint32_t maxCycles;
+  uint32_t p99Cycles; // Upper edge of the histogram bin holding the 99th percentile.
+} isrProfile_stats_t;
+
+// Periods are binned in ISR_PROFILE_PERIOD_BIN_CYCLES steps from 0 to two
+// nominal periods. The last bin holds every longer period, i.e. at least one
+// missed interrupt.
+#define ISR_PROFILE_PERIOD_BIN_COUNT 81
+#define ISR_PROFILE_PERIOD_BIN_CYCLES (ISR_PROFILE_NOMINAL_PERIOD_CYCLES / 40)
+
+// ISR entry-to-entry interval statistics, in cycles.
+typedef struct {
+  uint32_t periodCount;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint32_t bins[ISR_PROFILE_PERIOD_BIN_COUNT];
+} isrProfile_periodStats_t;
+
+#ifdef ISR_PROFILE_ENABLED
+
+// Starts the cycle counter and clears every statistic.
+void isrProfile_init();
+
+// Clears every statistic. The next ISR entry starts a new period measurement.
+void isrProfile_reset();
+
+// Records one call of cycles length against slot.
+void isrProfile_record(isrProfile_slot_t slot, uint32_t cycles);
+
+// Records an ISR entry for the period histogram and returns the entry time.
+uint32_t isrProfile_enterIsr();
+
+// Query API. Fills stats with a snapshot; the ISR may update it while it is
+// copied, so read it with interrupts off if you need an exact snapshot.
+void isrProfile_getStats(isrProfile_slot_t slot, isrProfile_stats_t *stats);
+void isrProfile_getPeriodStats(isrProfile_periodStats_t *stats);
+
+// Returns the printable name of a slot.
+const char *isrProfile_getSlotName(isrProfile_slot_t slot);
+
+// Prints every slot and the period histogram to the console.
+void isrProfile_printReport();
+
+// Shows every slot and the period extremes on the TFT display.
+void isrProfile_displayReport();
+
+// Runs isr_function() on a software-paced 10 us schedule for one second and
+// prints the report. Run it with interrupts disabled.
+void isrProfile_runTest();
+
+// Wrap the body of isr_function() in ISR_PROFILE_ENTER()/ISR_PROFILE_EXIT()
+// and each profiled call in ISR_PROFILE_CALL().
+#define ISR_PROFILE_ENTER() uint32_t isrProfileEntryCycles = isrProfile_enterIsr()
+#define ISR_PROFILE_EXIT()                                                     \
+  isrProfile_record(ISR_PROFILE_ISR_TOTAL,                                     \
+                    timebase_readCycles() - isrProfileEntryCycles)
+#define ISR_PROFILE_CALL(slot, call)                                           \
+  do {                                                                         \
+    uint32_t isrProfileStartCycles = timebase_readCycles();                  \
+    call;                                                                      \
+    isrProfile_record(slot, timebase_readCycles() - isrProfileStartCycles); \
+  } while (0)
+
+#else
+
+#define ISR_PROFILE_ENTER()
+#define ISR_PROFILE_EXIT()
+#define ISR_PROFILE_CALL(slot, call) call
+
+#endif /* ISR_PROFILE_ENABLED */
+
+#endif /* ISRPROFILE_H_ */
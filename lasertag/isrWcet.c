@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include "isrWcet.h"
+#include "isr.h"
+#include "filter.h"
+#include "hitLedTimer.h"
+#include "lockoutTimer.h"
+#include "intervalTimer.h"
+#include "sound.h"
+#include "transmitter.h"
+#include "trigger.h"
+
+#define WCET_TIMER INTERVAL_TIMER_TIMER_2
+#define TIMER_CALIBRATION_COUNT 1000
+#define MICROSECONDS_PER_SECOND 1.0e6
+#define PERCENT 100.0
+#define TICK_SECONDS 10.0e-6
+#define HISTOGRAM_BIN_SECONDS 0.1e-6
+#define HISTOGRAM_BIN_COUNT 201 // 0 to 20 us, the last bin holds every longer tick.
+#define QUANTILE_PARTS 10000 // 99.99th percentile.
+#define QUANTILE_KEPT 9999
+
+// Stimulus periods in milliseconds, co-prime so the transitions they cause
+// line up in every combination during a long run.
+#define TRIGGER_TOGGLE_MS 61 // Longer than the 50 ms debounce.
+#define SOUND_RESTART_MS 37
+#define STRESS_SOUND sound_gunFire_e
+
+static isrWcet_result_t lastResult;
+static uint32_t durationHistogram[HISTOGRAM_BIN_COUNT];
+
+static const char *slowPathNames[ISR_WCET_SLOW_COUNT] = {
+	"none", "lockoutTimer", "hitLedTimer", "trigger"};
+
+// Returns the slow-lane machine the next isr_function() call runs.
+static isrWcet_slowPath_t isrWcet_nextSlowPath(){
+	switch(isr_getSlowLanePhase()){
+		case ISR_SLOW_LANE_LOCKOUT_PHASE:
+			return ISR_WCET_SLOW_LOCKOUT;
+		case ISR_SLOW_LANE_HIT_LED_PHASE:
+			return ISR_WCET_SLOW_HIT_LED;
+		case ISR_SLOW_LANE_TRIGGER_PHASE:
+			return ISR_WCET_SLOW_TRIGGER;
+		default:
+			return ISR_WCET_SLOW_NONE;
+	}
+}
+
+// Packs the running state of every machine, compared across a tick to find
+// its transitions.
+static uint8_t isrWcet_machineStates(){
+	uint8_t states = 0;
+	if(transmitter_running())
+		states |= ISR_WCET_TRANSMITTER_TRANSITION;
+	if(lockoutTimer_running())
+		states |= ISR_WCET_LOCKOUT_TRANSITION;
+	if(hitLedTimer_running())
+		states |= ISR_WCET_HIT_LED_TRANSITION;
+	if(trigger_shotsFired())
+		states |= ISR_WCET_TRIGGER_TRANSITION;
+	if(sound_isBusy())
+		states |= ISR_WCET_SOUND_TRANSITION;
+	return states;
+}
+
+// Restarts whatever has stopped and works the trigger and sound on their
+// periods. Called between ticks at the start of each millisecond.
+static void isrWcet_stimulate(uint32_t ms){
+	if(!transmitter_running())
+		transmitter_run();
+	if(!lockoutTimer_running())
+		lockoutTimer_start();
+	if(!hitLedTimer_running())
+		hitLedTimer_start();
+#ifdef TRIGGER_SIMULATION_ENABLED
+	trigger_setSimulatedPress((ms / TRIGGER_TOGGLE_MS) % 2 == 0);
+#endif
+	if(ms % SOUND_RESTART_MS == 0){	//Restart from an empty FIFO, the longest refill
+		sound_stopSound();
+		sound_playSound(STRESS_SOUND);
+	}
+}
+
+// Returns the shortest time the interval timer reports for an empty
+// start/stop pair, subtracted from every tick.
+static double isrWcet_timerOverhead(){
+	double overhead = 1.0;
+	for(uint32_t i = 0; i < TIMER_CALIBRATION_COUNT; ++i){
+		intervalTimer_reset(WCET_TIMER);
+		intervalTimer_start(WCET_TIMER);
+		intervalTimer_stop(WCET_TIMER);
+		double seconds = intervalTimer_getTotalDurationInSeconds(WCET_TIMER);
+		if(seconds < overhead)
+			overhead = seconds;
+	}
+	return overhead;
+}
+
+// Returns the upper edge of the histogram bin that holds the 99.99th
+// percentile of tickCount ticks.
+static double isrWcet_p9999(uint32_t tickCount){
+	uint64_t needed = ((uint64_t)tickCount * QUANTILE_KEPT + QUANTILE_PARTS - 1) / QUANTILE_PARTS;
+	uint64_t seen = 0;
+	for(uint32_t bin = 0; bin < HISTOGRAM_BIN_COUNT - 1; ++bin){
+		seen += durationHistogram[bin];
+		if(seen >= needed)
+			return (bin + 1) * HISTOGRAM_BIN_SECONDS;
+	}
+	return lastResult.worstSeconds;
+}
+
+// Prints the names of the transitions in a mask.
+static void isrWcet_printTransitions(uint8_t transitions){
+	if(transitions == 0)
+		printf(" none");
+	if(transitions & ISR_WCET_TRANSMITTER_TRANSITION)
+		printf(" transmitter");
+	if(transitions & ISR_WCET_LOCKOUT_TRANSITION)
+		printf(" lockoutTimer");
+	if(transitions & ISR_WCET_HIT_LED_TRANSITION)
+		printf(" hitLedTimer");
+	if(transitions & ISR_WCET_TRIGGER_TRANSITION)
+		printf(" trigger");
+	if(transitions & ISR_WCET_SOUND_TRANSITION)
+		printf(" sound");
+	printf("\n");
+}
+
+// Runs tickCount ticks of the stress mode and prints the worst case.
+bool isrWcet_runStressTest(uint32_t tickCount){
+	isrWcet_result_t *result = &lastResult;
+	isr_t *adc = isr_getDefault();
+	isr_AdcBlockStats_t adcStats;
+	printf("Starting isrWcet_runStressTest()\n");
+#ifndef TRIGGER_SIMULATION_ENABLED
+	printf("The trigger is not pressed: build with -DTRIGGER_SIMULATION=1 to cover it\n");
+#endif
+	memset(result, 0, sizeof(*result));
+	memset(durationHistogram, 0, sizeof(durationHistogram));
+	result->tickCount = tickCount;
+	isr_init();
+	hitLedTimer_enable();
+	trigger_enable();
+	trigger_setRemainingShotCount(UINT16_MAX);
+	transmitter_setFrequencyNumber(FILTER_FREQUENCY_COUNT - 1);	//Highest frequency, the most edges
+	intervalTimer_init(WCET_TIMER);
+	double overhead = isrWcet_timerOverhead();
+	for(uint32_t tick = 0; tick < tickCount; ++tick){
+		isrWcet_slowPath_t slowPath = isrWcet_nextSlowPath();
+		if(isr_getSlowLanePhase() == 0){
+			isrWcet_stimulate(tick / ISR_SLOW_LANE_DIVIDER);
+		}
+		isr_ctxGetAdcBlockStats(adc, &adcStats);
+		uint32_t blocksBefore = adcStats.blocksPublished;
+		uint8_t statesBefore = isrWcet_machineStates();
+		intervalTimer_reset(WCET_TIMER);
+		intervalTimer_start(WCET_TIMER);
+		isr_function();
+		intervalTimer_stop(WCET_TIMER);
+		double seconds = intervalTimer_getTotalDurationInSeconds(WCET_TIMER) - overhead;
+		isr_ctxGetAdcBlockStats(adc, &adcStats);
+		bool publishedBlock = adcStats.blocksPublished != blocksBefore;
+		uint8_t transitions = statesBefore ^ isrWcet_machineStates();
+		if(seconds > result->pathMaxSeconds[slowPath][publishedBlock])
+			result->pathMaxSeconds[slowPath][publishedBlock] = seconds;
+		result->pathTickCount[slowPath][publishedBlock]++;
+		uint32_t bin = (seconds > 0) ? seconds / HISTOGRAM_BIN_SECONDS : 0;
+		durationHistogram[bin < HISTOGRAM_BIN_COUNT ? bin : HISTOGRAM_BIN_COUNT - 1]++;
+		if(seconds > ISR_WCET_BUDGET_SECONDS)
+			result->overBudgetCount++;
+		if(seconds > result->worstSeconds){
+			result->worstSeconds = seconds;
+			result->worstTick = tick;
+			result->worstSlowPath = slowPath;
+			result->worstPublishedBlock = publishedBlock;
+			result->worstTransitions = transitions;
+		}
+		if(publishedBlock){	//Stand in for the detector so the buffer never overruns
+			isr_AdcBlock_t block;
+			while(isr_ctxPeekAdcBlock(adc, &block))
+				isr_ctxReleaseAdcBlock(adc);
+		}
+	}
+#ifdef TRIGGER_SIMULATION_ENABLED
+	trigger_setSimulatedPress(false);
+#endif
+	trigger_disable();
+	sound_stopSound();
+	isr_init();
+	result->p9999Seconds = isrWcet_p9999(tickCount);
+	printf("%u ticks, timer overhead %f us subtracted\n", tickCount, overhead * MICROSECONDS_PER_SECOND);
+	printf("Worst case: %f us (%5.2f%% of the 10 us tick) at tick %u\n", result->worstSeconds * MICROSECONDS_PER_SECOND,
+		PERCENT * result->worstSeconds / TICK_SECONDS, result->worstTick);
+	printf("  slow lane: %s, ADC block published: %s, transitions:", slowPathNames[result->worstSlowPath],
+		result->worstPublishedBlock ? "yes" : "no");
+	isrWcet_printTransitions(result->worstTransitions);
+	printf("Per-path maximum (us):\n");
+	printf("  %-13s %14s %14s\n", "slow lane", "no block", "block");
+	for(uint16_t i = 0; i < ISR_WCET_SLOW_COUNT; ++i){
+		printf("  %-13s %14f %14f\n", slowPathNames[i], result->pathMaxSeconds[i][false] * MICROSECONDS_PER_SECOND,
+			result->pathMaxSeconds[i][true] * MICROSECONDS_PER_SECOND);
+	}
+	printf("99.99th percentile: %f us\n", result->p9999Seconds * MICROSECONDS_PER_SECOND);
+	printf("%u tick(s) over the %f us budget\n", result->overBudgetCount, ISR_WCET_BUDGET_SECONDS * MICROSECONDS_PER_SECOND);
+#ifdef ZYBO_BOARD
+	bool passed = result->overBudgetCount == 0;
+#else
+	bool passed = result->p9999Seconds <= ISR_WCET_BUDGET_SECONDS;	//The host OS preempts a few ticks
+#endif
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed isrWcet_runStressTest()\n");
+	return passed;
+}
+
+// Copies the results of the last stress run into result.
+void isrWcet_getResult(isrWcet_result_t *result){
+	*result = lastResult;
+}
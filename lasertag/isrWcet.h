@@ -0,0 +1,76 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ISRWCET_H_
+#define ISRWCET_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// Worst-case execution time stress mode for isr_function(). The harness calls
+// isr_function() itself, tick after tick, timing each call with the interval
+// timer, while it keeps every state machine the ISR runs busy: the
+// transmitter is restarted whenever it stops, the lockout and hit-LED timers
+// whenever they expire, the trigger is pressed and released through
+// trigger_setSimulatedPress() (test builds only, see TRIGGER_SIMULATION) and
+// the sound is restarted from an empty FIFO.
+// Each of these repeats on its own period, and the periods are co-prime, so
+// over a long run their expensive transitions land on the same millisecond
+// in every combination. Each tick is filed under the path it took: the
+// slow-lane machine that ran and whether an ADC block was published.
+// On the board nothing can interrupt the harness, so the maximum is the worst
+// case. On a host the operating system preempts it now and then, which only
+// shows in the top few ticks, so a host run is judged by the 99.99th
+// percentile instead; that still catches a path that got slower.
+// The emulator build (cmake -DEMU=1) also builds isrWcetHost, which runs it
+// on the host with the board drivers replaced by hostDrivers.c.
+
+#define ISR_WCET_BUDGET_SECONDS 5.0e-6 // Half the 10 us tick, the rest is main's.
+#define ISR_WCET_DEFAULT_TICK_COUNT 10000000 // 100 seconds of interrupts.
+
+// Transitions seen on a tick, or-ed together in isrWcet_result_t.
+#define ISR_WCET_TRANSMITTER_TRANSITION 0x01 // Transmitter burst ended.
+#define ISR_WCET_LOCKOUT_TRANSITION 0x02     // Lockout timer expired.
+#define ISR_WCET_HIT_LED_TRANSITION 0x04     // Hit LED turned off.
+#define ISR_WCET_TRIGGER_TRANSITION 0x08     // Debounced press or release.
+#define ISR_WCET_SOUND_TRANSITION 0x10       // Sound finished.
+
+// Slow-lane machine that ran on a tick, used to index the per-path maxima.
+typedef enum {
+  ISR_WCET_SLOW_NONE,
+  ISR_WCET_SLOW_LOCKOUT,
+  ISR_WCET_SLOW_HIT_LED,
+  ISR_WCET_SLOW_TRIGGER,
+  ISR_WCET_SLOW_COUNT
+} isrWcet_slowPath_t;
+
+// Results of the last stress run.
+typedef struct {
+  uint32_t tickCount;
+  uint32_t overBudgetCount; // Ticks longer than ISR_WCET_BUDGET_SECONDS.
+  double worstSeconds;
+  double p9999Seconds; // Upper edge of the 0.1 us bin holding the 99.99th percentile.
+  uint32_t worstTick;
+  isrWcet_slowPath_t worstSlowPath;
+  bool worstPublishedBlock;
+  uint8_t worstTransitions;
+  double pathMaxSeconds[ISR_WCET_SLOW_COUNT][2]; // [slow path][block published]
+  uint32_t pathTickCount[ISR_WCET_SLOW_COUNT][2];
+} isrWcet_result_t;
+
+// Runs tickCount ticks of the stress mode and prints the worst case, the path
+// that produced it and the maximum for every path. Returns true if no tick
+// took longer than ISR_WCET_BUDGET_SECONDS (on a host, if the 99.99th
+// percentile is within it). Run it with interrupts disabled;
+// it re-initializes everything isr_init() does before and after.
+bool isrWcet_runStressTest(uint32_t tickCount);
+
+// Copies the results of the last stress run into result.
+void isrWcet_getResult(isrWcet_result_t *result);
+
+#endif /* ISRWCET_H_ */
@@ -0,0 +1,30 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host build of the isr_function() stress test, see isrWcet.h.
+//   isrWcetHost [tick count]
+// Links the ISR and its state machines against hostDrivers.c instead of the
+// emulator, and is built with TRIGGER_SIMULATION_ENABLED so the trigger is
+// exercised. Exits with 0 if the test passed.
+// Built with the emulator build (cmake -DEMU=1).
+
+#ifdef main
+#undef main // The emulator build renames main() for its own entry point.
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "isrWcet.h"
+
+int main(int argc, char **argv){
+	uint32_t tickCount = ISR_WCET_DEFAULT_TICK_COUNT;
+	if(argc > 1)
+		tickCount = strtoul(argv[1], NULL, 0);
+	return isrWcet_runStressTest(tickCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,10 +3,31 @@
 #include "intervalTimer.h"
 #include "utils.h"
 #include "lockoutTimer.h"
+#include "fsm.h"
+
+// The lockout timer runs for LOCKOUT_TIMER_EXPIRE_VALUE ticks once started.
+#define LOCKOUT_TIMER_STATES(S) \
+	S(init_st, fsm_noAction) \
+	S(timer_running_st, lockoutTimer_count)
+#define LOCKOUT_TIMER_TRANSITIONS(T) \
+	T(timer_running_st, lockoutTimer_expired, init_st, fsm_noAction)
 
 volatile static uint32_t timer;
 
-enum lockOut_st {init_st, timer_running_st} currentState = init_st;
+FSM_DECLARE_STATES(lockoutTimer_st_t, LOCKOUT_TIMER_STATES);
+static lockoutTimer_st_t currentState = init_st;
+
+// Returns true once the timer has run for LOCKOUT_TIMER_EXPIRE_VALUE ticks.
+static bool lockoutTimer_expired(){
+	return timer >= LOCKOUT_TIMER_EXPIRE_VALUE;
+}
+
+// Counts a tick while running.
+static void lockoutTimer_count(){
+	++timer;
+}
+
+FSM_DEFINE_MACHINE(lockoutTimerMachine, "lockoutTimer", LOCKOUT_TIMER_STATES, LOCKOUT_TIMER_TRANSITIONS);
 
 // Calling this starts the timer.
 void lockoutTimer_start(){
@@ -25,25 +46,18 @@ bool lockoutTimer_running(){
 	return currentState == timer_running_st;
 }
 
+// Returns the number of 1 kHz ticks until the timer expires, 0 if it is not
+// running.
+uint32_t lockoutTimer_getRemainingTicks(){
+	uint32_t ticks = timer;
+	if(!lockoutTimer_running() || ticks >= LOCKOUT_TIMER_EXPIRE_VALUE)
+		return 0;
+	return LOCKOUT_TIMER_EXPIRE_VALUE - ticks;
+}
+
 // Standard tick function.
 void lockoutTimer_tick(){
-	//State updates
-    switch (currentState){
-        case init_st:
-			break;
-        case timer_running_st:
-            if(timer >= LOCKOUT_TIMER_EXPIRE_VALUE){
-				currentState = init_st;
-			}
-    }
-
-	//State actions
-    switch (currentState){
-        case init_st:
-            //do stuff
-        case timer_running_st:
-            ++timer;
-    }
+	FSM_TICK(lockoutTimerMachine, LOCKOUT_TIMER_STATES, LOCKOUT_TIMER_TRANSITIONS, currentState);
 }
 
 // Test function assumes interrupts have been completely enabled and
@@ -10,8 +10,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef LOCKOUTTIMER_H_
 #define LOCKOUTTIMER_H_
 #include <stdbool.h>
+#include <stdint.h>
 
-#define LOCKOUT_TIMER_EXPIRE_VALUE 50000 // Defined in terms of 100 kHz ticks.
+#define LOCKOUT_TIMER_EXPIRE_VALUE 500 // Defined in terms of 1 kHz slow-lane ticks.
 
 // Calling this starts the timer.
 void lockoutTimer_start();
@@ -22,7 +23,11 @@ void lockoutTimer_init();
 // Returns true if the timer is running.
 bool lockoutTimer_running();
 
-// Standard tick function.
+// Returns the number of 1 kHz ticks until the timer expires, 0 if it is not
+// running.
+uint32_t lockoutTimer_getRemainingTicks();
+
+// Standard tick function. Invoked from the 1 kHz slow lane of isr_function().
 void lockoutTimer_tick();
 
 // Test function assumes interrupts have been completely enabled and
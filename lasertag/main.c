@@ -29,19 +29,32 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <assert.h>
 #include <stdio.h>
 
+#include "adcCapture.h"
+#include "adcCaptureCodec.h"
+#include "amp.h"
 #include "buttons.h"
 #include "detector.h"
+#include "detectorTest.h"
+#include "eventLog.h"
 #include "filter.h"
 #include "filterTest.h"
 #include "hitLedTimer.h"
+#include "idle.h"
 #include "interrupts.h"
 #include "isr.h"
+#include "isrProfile.h"
+#include "isrWcet.h"
 #include "lockoutTimer.h"
+#include "queue.h"
+#include "queueTypes.h"
 #include "runningModes.h"
+#include "scheduler.h"
+#include "shotCode.h"
 #include "sound.h"
 #include "switches.h"
 #include "transmitter.h"
 #include "trigger.h"
+#include "virtualTimer.h"
 #include "mio.h"
 #include "leds.h"
 
@@ -60,6 +73,35 @@ int main() {
   // transmitter_runTest(); // M3 T2
   // detector_runTest(); // M3 T3
    //sound_runTest(); // M4
+  // Tests and benchmarks of the performance work, interrupts still off:
+  // queue_runBulkTest();
+  // queue_runBulkBenchmark();
+  // queueTypes_runTest();
+  // queueTypes_runBenchmark();
+  // eventLog_runTest();
+  // virtualTimer_runTest();
+  // shotCode_runTest();
+  // adcCaptureCodec_runTest();
+  // trigger_runLatencyTest(); // Needs -DTRIGGER_SIMULATION=1.
+  // isr_runLaneBenchmark();
+  // isrProfile_runTest(); // Needs -DISR_PROFILE=1.
+  // isrWcet_runStressTest(ISR_WCET_DEFAULT_TICK_COUNT);
+  // detectorTest_runLockoutSuspendTest(); // First, it needs no lockout left over.
+  // detectorTest_runMultiSensorBenchmark();
+  // detectorTest_runDecisionIntervalBenchmark();
+  // detectorTest_runResetBenchmark();
+  // detectorTest_runCacheBenchmark();
+  // detectorTest_runInstanceBenchmark(4);
+  // Emulator builds only, they need threads, a pty or a simulated ADC:
+  // isr_runAdcBufferStressTest();
+  // detectorTest_runBlockHandoffTest();
+  // detectorTest_runShotCodeTest();
+  // transmitter_runDdsTest();
+  // amp_runLoadTest();
+  // adcCapture_runLoopbackTest();
+  // Board only, they need interrupts running (interrupts_initAll() etc.):
+  // idle_runTest();
+  // scheduler_runTest();
 #endif
 
 #ifdef RUNNING_MODE_M3_T2
@@ -112,9 +112,100 @@ void queue_garbageCollect(queue_t *q);
 // for-loop. Trivial to implement this way.
 void queue_print(queue_t *q);
 
+// Bulk and unchecked operations. These are implemented in queueBulk.c, outside
+// the queue library, and rely on the queue_t layout above: data[] has size
+// slots, the oldest element is at indexOut and the next free slot is at
+// indexIn, and both wrap at size.
+
+// A run of elements that are contiguous in a queue's data array.
+typedef struct {
+  const queue_data_t *data;
+  queue_size_t count;
+} queue_span_t;
+
+// The contents of a queue, oldest to newest, as at most two spans: the first
+// runs from the oldest element towards the end of the data array and the
+// second, if the contents wrap, continues from the start of the array.
+// Either span may be empty. The pointers are valid until the queue changes.
+typedef struct {
+  queue_span_t first;
+  queue_span_t second;
+} queue_view_t;
+
+// queue_init() on caller-provided storage of size elements instead of
+// malloc(). Like the library's queue_init(), the capacity is size and data[]
+// has exactly size slots. Never pass such a queue to queue_garbageCollect();
+// re-initializing it just resets it.
+void queue_initStatic(queue_t *q, queue_data_t storage[], queue_size_t size,
+                      const char *name);
+
+// Pushes values[0] to values[count - 1], oldest first, as far as they fit. If
+// they do not all fit, sets the overflowFlag and prints one error message.
+// Returns the number pushed.
+queue_size_t queue_pushN(queue_t *q, const queue_data_t values[],
+                         queue_size_t count);
+
+// Pushes values[0] to values[count - 1], oldest first, overwriting the oldest
+// elements as needed. Leaves the queue as count queue_overwritePush() calls
+// would.
+void queue_overwritePushN(queue_t *q, const queue_data_t values[],
+                          queue_size_t count);
+
+// Pops up to count elements into values, oldest first. If the queue holds
+// fewer, pops them all, sets the underflowFlag and prints one error message.
+// Returns the number popped.
+queue_size_t queue_popN(queue_t *q, queue_data_t values[], queue_size_t count);
+
+// Fills view with the contents of the queue. Returns the element count.
+queue_size_t queue_view(queue_t *q, queue_view_t *view);
+
+// Unchecked accessors for hot loops. They do no bounds or state checking
+// unless the build defines QUEUE_DEBUG_ENABLED (cmake -DQUEUE_DEBUG=1), in
+// which case a bad call prints a message and asserts.
+#ifdef QUEUE_DEBUG_ENABLED
+void queue_debugCheck(bool ok, queue_t *q, const char *message);
+#define QUEUE_DEBUG_CHECK(ok, q, message) queue_debugCheck((ok), (q), (message))
+#else
+#define QUEUE_DEBUG_CHECK(ok, q, message)
+#endif
+
+// queue_readElementAt() without the index check or its error value.
+static inline queue_data_t queue_readElementAtUnchecked(queue_t *q,
+                                                        queue_index_t index) {
+  QUEUE_DEBUG_CHECK(index < q->elementCount, q,
+                    "queue_readElementAtUnchecked(): index out of range");
+  queue_index_t slot = q->indexOut + index;
+  if (slot >= q->size)
+    slot -= q->size;
+  return q->data[slot];
+}
+
+// queue_overwritePush() of a full queue as one step: the oldest element is
+// replaced and the underflowFlag is cleared, as the library does; the
+// overflowFlag is left alone. The queue must be full.
+static inline void queue_overwritePushFullUnchecked(queue_t *q,
+                                                    queue_data_t value) {
+  QUEUE_DEBUG_CHECK(q->elementCount == queue_size(q), q,
+                    "queue_overwritePushFullUnchecked(): queue is not full");
+  q->data[q->indexIn] = value;
+  q->indexIn = (q->indexIn + 1 == q->size) ? 0 : q->indexIn + 1;
+  q->indexOut = (q->indexOut + 1 == q->size) ? 0 : q->indexOut + 1;
+  q->underflowFlag = false;
+}
+
 // Performs a comprehensive test of all queue functions. Returns false if the
 // test fails, true otherwise. Prints out a series of informational messages
 // during the test.
 bool queue_runTest();
 
+// Runs the torture tests of queue_test.c through the bulk and unchecked
+// operations, checking them against the queue library. Returns true if they
+// all pass.
+bool queue_runBulkTest();
+
+// Times per-element queue_overwritePush()/queue_readElementAt() against the
+// bulk and unchecked operations at the filter's queue sizes and prints the
+// speedup.
+void queue_runBulkBenchmark();
+
 #endif /* QUEUE_H_ */
\ No newline at end of file
@@ -0,0 +1,408 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host benchmark of the queue library against other ring buffer designs.
+//   queueBenchmark [JSON file]
+// Times four access patterns at every queue size lasertag uses and writes
+// the results as JSON to the file, or to stdout:
+//   overwritePush  push into a full queue, dropping the oldest element
+//   pushPop        push one, pop one, with the queue one short of full
+//   readElementAt  sweep a full queue oldest to newest
+//   slidingWindow  overwritePush one value, then a dot product over the whole
+//                  queue newest first (the FIR filter); timed per element read
+// Implementations:
+//   queue_t           the queue library, one call per element
+//   queue_t_unchecked queue_overwritePushFullUnchecked(), queue_view() spans
+//                     and queue_readElementAtUnchecked() from queueBulk.c
+//   mask              power-of-two slots, free-running indices, index & mask
+//   mirrored          every element stored twice, so the queue is always one
+//                     contiguous span
+//   spsc              lock-free single-producer single-consumer ring with
+//                     acquire/release indices, as isr.c's ADC blocks use
+// Every implementation must read back the same values, which the JSON reports
+// as checksumsMatch. Each time is the fastest of BENCHMARK_REPEAT_COUNT runs.
+// Built with the emulator build (cmake -DEMU=1), linked to the queue library.
+
+#ifdef main
+#undef main // The emulator build renames main() for its own entry point.
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "queue.h"
+
+#define BENCHMARK_OPERATION_COUNT 4000000 // Per measurement.
+#define BENCHMARK_REPEAT_COUNT 5
+#define BENCHMARK_SAMPLE_MASK 0xFFF // Values look like 12-bit ADC samples.
+#define NANOSECONDS_PER_SECOND 1000000000.0
+#define BENCHMARK_MAX_SIZE 20001
+
+// Queue sizes lasertag uses: the FIR input, the IIR y and z histories, the
+// power windows and the original ADC buffer.
+static const queue_size_t benchmarkSizes[] = {81, 11, 10, 2000, BENCHMARK_MAX_SIZE};
+#define BENCHMARK_SIZE_COUNT (sizeof(benchmarkSizes) / sizeof(benchmarkSizes[0]))
+
+typedef enum {
+	OPERATION_OVERWRITE_PUSH,
+	OPERATION_PUSH_POP,
+	OPERATION_READ_ELEMENT_AT,
+	OPERATION_SLIDING_WINDOW,
+	OPERATION_COUNT
+} queueBenchmark_operation_t;
+
+static const char *operationNames[OPERATION_COUNT] = {
+	[OPERATION_OVERWRITE_PUSH] = "overwritePush",
+	[OPERATION_PUSH_POP] = "pushPop",
+	[OPERATION_READ_ELEMENT_AT] = "readElementAt",
+	[OPERATION_SLIDING_WINDOW] = "slidingWindow",
+};
+
+// What one implementation measured for one operation at one size.
+typedef struct {
+	double nanosecondsPerOperation;
+	double checksum; // Sum of everything read, equal across implementations.
+} queueBenchmark_result_t;
+
+static queue_data_t windowWeights[BENCHMARK_MAX_SIZE]; // Coefficients for slidingWindow.
+
+// Returns a monotonic time in seconds.
+static double queueBenchmark_now(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// Returns the smallest power of two that is at least n.
+static uint32_t queueBenchmark_powerOfTwoAtLeast(uint32_t n){
+	uint32_t p = 1;
+	while(p < n)
+		p <<= 1;
+	return p;
+}
+
+/*********************************************************************************************************
+****************************************** Implementations
+**********************************************************************************************************/
+
+// Every implementation has the same functions: init, free, overwritePush,
+// push (room guaranteed), pop (non-empty guaranteed), readElementAt and
+// window (dot product with windowWeights, newest first).
+
+// The queue library as it is called element by element.
+typedef queue_t queueLib_t;
+
+static void queueLib_init(queueLib_t *q, uint32_t capacity){ queue_init(q, capacity, "benchmark"); }
+static void queueLib_free(queueLib_t *q){ queue_garbageCollect(q); }
+static void queueLib_overwritePush(queueLib_t *q, queue_data_t value){ queue_overwritePush(q, value); }
+static void queueLib_push(queueLib_t *q, queue_data_t value){ queue_push(q, value); }
+static queue_data_t queueLib_pop(queueLib_t *q){ return queue_pop(q); }
+static queue_data_t queueLib_readElementAt(queueLib_t *q, uint32_t index){ return queue_readElementAt(q, index); }
+
+// Dot product the way filter.c computed it before queue_view().
+static queue_data_t queueLib_window(queueLib_t *q){
+	queue_data_t sum = 0.0;
+	uint32_t count = queue_elementCount(q);
+	for(uint32_t k = 0; k < count; ++k)
+		sum += queue_readElementAt(q, count - 1 - k) * windowWeights[k];
+	return sum;
+}
+
+// The queue library through the inline accessors in queue.h.
+typedef queue_t queueUnchecked_t;
+
+static void queueUnchecked_init(queueUnchecked_t *q, uint32_t capacity){ queue_init(q, capacity, "benchmark"); }
+static void queueUnchecked_free(queueUnchecked_t *q){ queue_garbageCollect(q); }
+// The unchecked push needs a full queue; the first pushes fill it.
+static void queueUnchecked_overwritePush(queueUnchecked_t *q, queue_data_t value){
+	if(q->elementCount == queue_size(q))
+		queue_overwritePushFullUnchecked(q, value);
+	else
+		queue_overwritePush(q, value);
+}
+static void queueUnchecked_push(queueUnchecked_t *q, queue_data_t value){ queue_push(q, value); }
+static queue_data_t queueUnchecked_pop(queueUnchecked_t *q){ return queue_pop(q); }
+static queue_data_t queueUnchecked_readElementAt(queueUnchecked_t *q, uint32_t index){ return queue_readElementAtUnchecked(q, index); }
+
+// Dot product the way filter.c computes it, over the spans of queue_view().
+static queue_data_t queueUnchecked_window(queueUnchecked_t *q){
+	queue_view_t view;
+	queue_view(q, &view);
+	queue_data_t sum = 0.0;
+	const queue_data_t *weight = windowWeights;
+	for(uint32_t i = view.second.count; i > 0; i--)
+		sum += view.second.data[i-1] * *weight++;
+	for(uint32_t i = view.first.count; i > 0; i--)
+		sum += view.first.data[i-1] * *weight++;
+	return sum;
+}
+
+// Power-of-two slots; head and the element count never need a compare to wrap.
+typedef struct {
+	queue_data_t *data;
+	uint32_t mask;
+	uint32_t capacity;
+	uint32_t head; // Free-running, the next slot written is head & mask.
+	uint32_t count;
+} maskRing_t;
+
+static void maskRing_init(maskRing_t *r, uint32_t capacity){
+	uint32_t slots = queueBenchmark_powerOfTwoAtLeast(capacity);
+	r->data = calloc(slots, sizeof(queue_data_t));
+	r->mask = slots - 1;
+	r->capacity = capacity;
+	r->head = 0;
+	r->count = 0;
+}
+static void maskRing_free(maskRing_t *r){ free(r->data); }
+static void maskRing_overwritePush(maskRing_t *r, queue_data_t value){
+	r->data[r->head++ & r->mask] = value;
+	if(r->count < r->capacity)
+		r->count++;
+}
+static void maskRing_push(maskRing_t *r, queue_data_t value){
+	r->data[r->head++ & r->mask] = value;
+	r->count++;
+}
+static queue_data_t maskRing_pop(maskRing_t *r){ return r->data[(r->head - r->count--) & r->mask]; }
+static queue_data_t maskRing_readElementAt(maskRing_t *r, uint32_t index){ return r->data[(r->head - r->count + index) & r->mask]; }
+static queue_data_t maskRing_window(maskRing_t *r){
+	queue_data_t sum = 0.0;
+	for(uint32_t k = 0; k < r->count; ++k)
+		sum += r->data[(r->head - 1 - k) & r->mask] * windowWeights[k];
+	return sum;
+}
+
+// Two copies of capacity slots: writing slot i also writes slot i + capacity,
+// so the newest capacity elements are always data[end - count .. end).
+typedef struct {
+	queue_data_t *data;
+	uint32_t capacity;
+	uint32_t next; // The next slot written, below capacity.
+	uint32_t count;
+} mirroredRing_t;
+
+static void mirroredRing_init(mirroredRing_t *r, uint32_t capacity){
+	r->data = calloc(2 * capacity, sizeof(queue_data_t));
+	r->capacity = capacity;
+	r->next = 0;
+	r->count = 0;
+}
+static void mirroredRing_free(mirroredRing_t *r){ free(r->data); }
+// Returns the address of the oldest element.
+static queue_data_t *mirroredRing_oldest(mirroredRing_t *r){ return &r->data[r->next + r->capacity - r->count]; }
+static void mirroredRing_push(mirroredRing_t *r, queue_data_t value){
+	r->data[r->next] = value;
+	r->data[r->next + r->capacity] = value;
+	r->next = (r->next + 1 == r->capacity) ? 0 : r->next + 1;
+	r->count++;
+}
+static void mirroredRing_overwritePush(mirroredRing_t *r, queue_data_t value){
+	if(r->count == r->capacity)
+		r->count--;
+	mirroredRing_push(r, value);
+}
+static queue_data_t mirroredRing_pop(mirroredRing_t *r){
+	queue_data_t value = *mirroredRing_oldest(r);
+	r->count--;
+	return value;
+}
+static queue_data_t mirroredRing_readElementAt(mirroredRing_t *r, uint32_t index){ return mirroredRing_oldest(r)[index]; }
+static queue_data_t mirroredRing_window(mirroredRing_t *r){
+	const queue_data_t *newest = &r->data[r->next + r->capacity - 1];
+	queue_data_t sum = 0.0;
+	for(uint32_t k = 0; k < r->count; ++k)
+		sum += newest[-(int32_t)k] * windowWeights[k];
+	return sum;
+}
+
+// Single-producer single-consumer ring. The producer owns head and the
+// consumer owns tail; each publishes its index with a release store. Pushing
+// into a full ring is a producer-side pop, which real SPSC code cannot do, so
+// overwritePush here stands for a consumer that keeps up.
+typedef struct {
+	queue_data_t *data;
+	uint32_t mask;
+	uint32_t capacity;
+	_Atomic uint32_t head; // Free-running.
+	_Atomic uint32_t tail; // Free-running.
+} spscRing_t;
+
+static void spscRing_init(spscRing_t *r, uint32_t capacity){
+	uint32_t slots = queueBenchmark_powerOfTwoAtLeast(capacity);
+	r->data = calloc(slots, sizeof(queue_data_t));
+	r->mask = slots - 1;
+	r->capacity = capacity;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+}
+static void spscRing_free(spscRing_t *r){ free(r->data); }
+static void spscRing_push(spscRing_t *r, queue_data_t value){
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	r->data[head & r->mask] = value;
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+static queue_data_t spscRing_pop(spscRing_t *r){
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	atomic_load_explicit(&r->head, memory_order_acquire);	//Pairs with the producer's release
+	queue_data_t value = r->data[tail & r->mask];
+	atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+	return value;
+}
+static void spscRing_overwritePush(spscRing_t *r, queue_data_t value){
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	if(head - atomic_load_explicit(&r->tail, memory_order_acquire) == r->capacity)
+		spscRing_pop(r);
+	spscRing_push(r, value);
+}
+static queue_data_t spscRing_readElementAt(spscRing_t *r, uint32_t index){
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	atomic_load_explicit(&r->head, memory_order_acquire);
+	return r->data[(tail + index) & r->mask];
+}
+static queue_data_t spscRing_window(spscRing_t *r){
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	uint32_t count = head - atomic_load_explicit(&r->tail, memory_order_relaxed);
+	queue_data_t sum = 0.0;
+	for(uint32_t k = 0; k < count; ++k)
+		sum += r->data[(head - 1 - k) & r->mask] * windowWeights[k];
+	return sum;
+}
+
+/*********************************************************************************************************
+****************************************** Benchmark
+**********************************************************************************************************/
+
+// Defines queueBenchmark_<prefix>(), which measures every operation of one
+// implementation at one size. It is a macro so every implementation is timed
+// by the same loops with its functions inlined.
+#define QUEUEBENCHMARK_DEFINE(prefix)                                                    \
+static void queueBenchmark_##prefix(uint32_t capacity, queueBenchmark_result_t results[OPERATION_COUNT]){ \
+	prefix##_t r;                                                                        \
+	double start;                                                                        \
+	double sum;                                                                          \
+	uint32_t reads;                                                                      \
+	for(uint32_t op = 0; op < OPERATION_COUNT; ++op)                                     \
+		results[op].nanosecondsPerOperation = 0.0;                                       \
+	for(uint32_t repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; ++repeat){                 \
+		double seconds[OPERATION_COUNT];                                                 \
+		prefix##_init(&r, capacity);                                                     \
+		for(uint32_t i = 0; i < capacity; ++i)                                           \
+			prefix##_overwritePush(&r, 0.0);                                             \
+		start = queueBenchmark_now();                                                    \
+		for(uint32_t i = 0; i < BENCHMARK_OPERATION_COUNT; ++i)                          \
+			prefix##_overwritePush(&r, (queue_data_t)(i & BENCHMARK_SAMPLE_MASK));       \
+		seconds[OPERATION_OVERWRITE_PUSH] = queueBenchmark_now() - start;                \
+		sum = 0.0;                                                                       \
+		for(uint32_t i = 0; i < capacity; ++i)                                           \
+			sum += prefix##_readElementAt(&r, i);                                        \
+		results[OPERATION_OVERWRITE_PUSH].checksum = sum;                                \
+                                                                                         \
+		sum = 0.0;                                                                       \
+		reads = 0;                                                                       \
+		start = queueBenchmark_now();                                                    \
+		while(reads < BENCHMARK_OPERATION_COUNT){	/* Whole sweeps, oldest to newest */ \
+			for(uint32_t i = 0; i < capacity; ++i)                                       \
+				sum += prefix##_readElementAt(&r, i);                                    \
+			reads += capacity;                                                           \
+		}                                                                                \
+		seconds[OPERATION_READ_ELEMENT_AT] = (queueBenchmark_now() - start) * BENCHMARK_OPERATION_COUNT / reads; \
+		results[OPERATION_READ_ELEMENT_AT].checksum = sum;                               \
+                                                                                         \
+		sum = 0.0;                                                                       \
+		reads = 0;                                                                       \
+		start = queueBenchmark_now();                                                    \
+		for(uint32_t i = 0; reads < BENCHMARK_OPERATION_COUNT; ++i){                     \
+			prefix##_overwritePush(&r, (queue_data_t)(i & BENCHMARK_SAMPLE_MASK));       \
+			sum += prefix##_window(&r);                                                  \
+			reads += capacity;                                                           \
+		}                                                                                \
+		seconds[OPERATION_SLIDING_WINDOW] = (queueBenchmark_now() - start) * BENCHMARK_OPERATION_COUNT / reads; \
+		results[OPERATION_SLIDING_WINDOW].checksum = sum;                                \
+                                                                                         \
+		prefix##_pop(&r);	/* One short of full, so every push has room */             \
+		sum = 0.0;                                                                       \
+		start = queueBenchmark_now();                                                    \
+		for(uint32_t i = 0; i < BENCHMARK_OPERATION_COUNT; ++i){                         \
+			prefix##_push(&r, (queue_data_t)(i & BENCHMARK_SAMPLE_MASK));                \
+			sum += prefix##_pop(&r);                                                     \
+		}                                                                                \
+		seconds[OPERATION_PUSH_POP] = queueBenchmark_now() - start;                      \
+		results[OPERATION_PUSH_POP].checksum = sum;                                      \
+		prefix##_free(&r);                                                               \
+                                                                                         \
+		for(uint32_t op = 0; op < OPERATION_COUNT; ++op){                                \
+			double ns = seconds[op] * NANOSECONDS_PER_SECOND / BENCHMARK_OPERATION_COUNT; \
+			if(repeat == 0 || ns < results[op].nanosecondsPerOperation)                  \
+				results[op].nanosecondsPerOperation = ns;                                \
+		}                                                                                \
+	}                                                                                    \
+}
+
+QUEUEBENCHMARK_DEFINE(queueLib)
+QUEUEBENCHMARK_DEFINE(queueUnchecked)
+QUEUEBENCHMARK_DEFINE(maskRing)
+QUEUEBENCHMARK_DEFINE(mirroredRing)
+QUEUEBENCHMARK_DEFINE(spscRing)
+
+// One benchmarked implementation.
+typedef struct {
+	const char *name;
+	void (*benchmark)(uint32_t capacity, queueBenchmark_result_t results[OPERATION_COUNT]);
+} queueBenchmark_entry_t;
+
+static const queueBenchmark_entry_t benchmarkEntries[] = {
+	{"queue_t", queueBenchmark_queueLib},
+	{"queue_t_unchecked", queueBenchmark_queueUnchecked},
+	{"mask", queueBenchmark_maskRing},
+	{"mirrored", queueBenchmark_mirroredRing},
+	{"spsc", queueBenchmark_spscRing},
+};
+#define BENCHMARK_ENTRY_COUNT (sizeof(benchmarkEntries) / sizeof(benchmarkEntries[0]))
+
+// Runs every implementation at every size and writes the JSON report.
+int main(int argc, char *argv[]){
+	FILE *out = stdout;
+	if(argc > 1 && (out = fopen(argv[1], "w")) == NULL){
+		perror(argv[1]);
+		return 1;
+	}
+	for(uint32_t k = 0; k < BENCHMARK_MAX_SIZE; ++k)
+		windowWeights[k] = 1.0 / (k + 1);
+	bool checksumsMatch = true;
+	fprintf(out, "{\n  \"benchmark\": \"queue\",\n  \"operationsPerMeasurement\": %u,\n  \"repeats\": %u,\n  \"results\": [",
+		BENCHMARK_OPERATION_COUNT, BENCHMARK_REPEAT_COUNT);
+	bool first = true;
+	for(uint32_t s = 0; s < BENCHMARK_SIZE_COUNT; ++s){
+		queueBenchmark_result_t reference[OPERATION_COUNT];
+		for(uint32_t e = 0; e < BENCHMARK_ENTRY_COUNT; ++e){
+			queueBenchmark_result_t results[OPERATION_COUNT];
+			fprintf(stderr, "%s, size %u\n", benchmarkEntries[e].name, benchmarkSizes[s]);
+			benchmarkEntries[e].benchmark(benchmarkSizes[s], results);
+			for(uint32_t op = 0; op < OPERATION_COUNT; ++op){
+				if(e == 0)
+					reference[op] = results[op];
+				else if(results[op].checksum != reference[op].checksum){
+					fprintf(stderr, "%s %s at size %u read back different values\n", benchmarkEntries[e].name, operationNames[op], benchmarkSizes[s]);
+					checksumsMatch = false;
+				}
+				fprintf(out, "%s\n    {\"implementation\": \"%s\", \"size\": %u, \"operation\": \"%s\", \"nsPerOperation\": %.3f, \"checksum\": %.17g}",
+					first ? "" : ",", benchmarkEntries[e].name, benchmarkSizes[s], operationNames[op],
+					results[op].nanosecondsPerOperation, results[op].checksum);
+				first = false;
+			}
+		}
+	}
+	fprintf(out, "\n  ],\n  \"checksumsMatch\": %s\n}\n", checksumsMatch ? "true" : "false");
+	if(out != stdout)
+		fclose(out);
+	return checksumsMatch ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "queue.h"
+
+// Copies count values into the queue starting at indexIn, wrapping at the end
+// of the data array, and advances indexIn. The room must already be there.
+static void queueBulk_copyIn(queue_t *q, const queue_data_t values[], queue_size_t count){
+	queue_size_t toEnd = q->size - q->indexIn;
+	queue_size_t firstCount = (count < toEnd) ? count : toEnd;
+	memcpy(&q->data[q->indexIn], values, firstCount * sizeof(queue_data_t));
+	memcpy(q->data, &values[firstCount], (count - firstCount) * sizeof(queue_data_t));
+	q->indexIn = (count < toEnd) ? q->indexIn + count : count - toEnd;
+	q->elementCount += count;
+}
+
+// queue_init() on caller-provided storage instead of malloc().
+void queue_initStatic(queue_t *q, queue_data_t storage[], queue_size_t size, const char *name){
+	q->indexIn = 0;
+	q->indexOut = 0;
+	q->elementCount = 0;
+	q->size = size;
+	q->data = storage;
+	q->underflowFlag = false;
+	q->overflowFlag = false;
+	strncpy(q->name, name, QUEUE_MAX_NAME_SIZE - 1);
+	q->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
+}
+
+// Pushes values[0] to values[count - 1] as far as they fit.
+queue_size_t queue_pushN(queue_t *q, const queue_data_t values[], queue_size_t count){
+	queue_size_t space = queue_size(q) - q->elementCount;
+	queue_size_t pushed = (count < space) ? count : space;
+	if(pushed > 0){
+		queueBulk_copyIn(q, values, pushed);
+		q->underflowFlag = false;
+	}
+	if(pushed < count){
+		q->overflowFlag = true;
+		printf("queue_pushN(): %u of %u values did not fit in queue %s\n", count - pushed, count, q->name);
+	}
+	return pushed;
+}
+
+// Pushes values[0] to values[count - 1], overwriting the oldest elements.
+void queue_overwritePushN(queue_t *q, const queue_data_t values[], queue_size_t count){
+	queue_size_t capacity = queue_size(q);
+	if(count == 0)
+		return;
+	if(count >= capacity){	//Only the newest capacity values survive
+		values += count - capacity;
+		count = capacity;
+		q->indexIn = 0;
+		q->indexOut = 0;
+		q->elementCount = 0;
+	}
+	else if(count > capacity - q->elementCount){	//Drop just enough of the oldest
+		queue_size_t dropped = count - (capacity - q->elementCount);
+		q->indexOut += dropped;
+		if(q->indexOut >= q->size)
+			q->indexOut -= q->size;
+		q->elementCount -= dropped;
+	}
+	queueBulk_copyIn(q, values, count);
+	q->underflowFlag = false;
+}
+
+// Pops up to count elements into values, oldest first.
+queue_size_t queue_popN(queue_t *q, queue_data_t values[], queue_size_t count){
+	queue_size_t popped = (count < q->elementCount) ? count : q->elementCount;
+	queue_view_t view;
+	queue_view(q, &view);
+	queue_size_t firstCount = (popped < view.first.count) ? popped : view.first.count;
+	memcpy(values, view.first.data, firstCount * sizeof(queue_data_t));
+	memcpy(&values[firstCount], view.second.data, (popped - firstCount) * sizeof(queue_data_t));
+	q->indexOut += popped;
+	if(q->indexOut >= q->size)
+		q->indexOut -= q->size;
+	q->elementCount -= popped;
+	if(popped > 0)
+		q->overflowFlag = false;
+	if(popped < count){
+		q->underflowFlag = true;
+		printf("queue_popN(): queue %s held only %u of %u values\n", q->name, popped, count);
+	}
+	return popped;
+}
+
+// Fills view with the contents of the queue, oldest to newest.
+queue_size_t queue_view(queue_t *q, queue_view_t *view){
+	queue_size_t toEnd = q->size - q->indexOut;
+	view->first.data = &q->data[q->indexOut];
+	view->first.count = (q->elementCount < toEnd) ? q->elementCount : toEnd;
+	view->second.data = q->data;
+	view->second.count = q->elementCount - view->first.count;
+	return q->elementCount;
+}
+
+#ifdef QUEUE_DEBUG_ENABLED
+// Reports a failed check in an unchecked accessor.
+void queue_debugCheck(bool ok, queue_t *q, const char *message){
+	if(!ok){
+		printf("%s (queue %s, %u elements)\n", message, q->name, q->elementCount);
+		assert(false);
+	}
+}
+#endif
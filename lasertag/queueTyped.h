@@ -0,0 +1,256 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Template for a queue with a fixed element type. queue_t stores doubles; this
+// stamps out the same queue, with the same API and the same error handling,
+// for any other element type. No include guard: it is included once per type.
+// Define these before including it:
+//   QUEUE_TYPED_PREFIX  name of the new type and its functions, e.g. queueU16
+//                       gives queueU16_t, queueU16_init(), queueU16_pop(), ...
+//   QUEUE_TYPED_DATA    the element type, e.g. uint16_t
+//   QUEUE_TYPED_FORMAT  printf() conversion for one element, e.g. "%d"
+// Included as is, it declares the type and its functions. With
+// QUEUE_TYPED_IMPLEMENTATION also defined, it defines the functions instead,
+// which must be done in exactly one .c file. The parameters are undefined at
+// the end, ready for the next type. queueTypes.h holds the standard variants.
+
+#if !defined(QUEUE_TYPED_PREFIX) || !defined(QUEUE_TYPED_DATA) || !defined(QUEUE_TYPED_FORMAT)
+#error "Define QUEUE_TYPED_PREFIX, QUEUE_TYPED_DATA and QUEUE_TYPED_FORMAT before including queueTyped.h"
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "queue.h"
+
+#ifndef QUEUE_TYPED_NAME
+#define QUEUE_TYPED_CONCATENATE(prefix, suffix) prefix##_##suffix
+#define QUEUE_TYPED_EXPAND(prefix, suffix) QUEUE_TYPED_CONCATENATE(prefix, suffix)
+// Pastes the prefix onto a name: QUEUE_TYPED_NAME(pop) is queueU16_pop.
+#define QUEUE_TYPED_NAME(suffix) QUEUE_TYPED_EXPAND(QUEUE_TYPED_PREFIX, suffix)
+#endif
+
+#define QUEUE_TYPED_T QUEUE_TYPED_NAME(t)
+
+#ifndef QUEUE_TYPED_IMPLEMENTATION
+
+// Same fields as queue_t; only the element type differs.
+typedef struct {
+  queue_index_t indexIn;
+  queue_index_t indexOut;
+  queue_size_t elementCount;
+  // This is the size of the data array. Actual queue capacity is one less.
+  queue_size_t size;
+  QUEUE_TYPED_DATA *data;
+  bool underflowFlag;
+  bool overflowFlag;
+  char name[QUEUE_MAX_NAME_SIZE];
+} QUEUE_TYPED_T;
+
+// Each function behaves exactly like its queue_*() counterpart in queue.h.
+void QUEUE_TYPED_NAME(init)(QUEUE_TYPED_T *q, queue_size_t size, const char *name);
+const char *QUEUE_TYPED_NAME(name)(QUEUE_TYPED_T *q);
+queue_size_t QUEUE_TYPED_NAME(size)(QUEUE_TYPED_T *q);
+bool QUEUE_TYPED_NAME(full)(QUEUE_TYPED_T *q);
+bool QUEUE_TYPED_NAME(empty)(QUEUE_TYPED_T *q);
+void QUEUE_TYPED_NAME(push)(QUEUE_TYPED_T *q, QUEUE_TYPED_DATA value);
+QUEUE_TYPED_DATA QUEUE_TYPED_NAME(pop)(QUEUE_TYPED_T *q);
+void QUEUE_TYPED_NAME(overwritePush)(QUEUE_TYPED_T *q, QUEUE_TYPED_DATA value);
+QUEUE_TYPED_DATA QUEUE_TYPED_NAME(readElementAt)(QUEUE_TYPED_T *q, queue_index_t index);
+queue_size_t QUEUE_TYPED_NAME(elementCount)(QUEUE_TYPED_T *q);
+bool QUEUE_TYPED_NAME(underflow)(QUEUE_TYPED_T *q);
+bool QUEUE_TYPED_NAME(overflow)(QUEUE_TYPED_T *q);
+void QUEUE_TYPED_NAME(garbageCollect)(QUEUE_TYPED_T *q);
+void QUEUE_TYPED_NAME(print)(QUEUE_TYPED_T *q);
+
+// Checks push, pop, overwritePush, readElementAt and the flags on a small
+// queue. Prints what fails; returns true if everything passes.
+bool QUEUE_TYPED_NAME(runTest)();
+
+#else /* QUEUE_TYPED_IMPLEMENTATION */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns index advanced by one slot, wrapping at the end of the data array.
+static inline queue_index_t QUEUE_TYPED_NAME(nextIndex)(QUEUE_TYPED_T *q, queue_index_t index){
+	return (index + 1 == q->size) ? 0 : index + 1;
+}
+
+// Allocates size + 1 slots, so the queue holds size elements.
+void QUEUE_TYPED_NAME(init)(QUEUE_TYPED_T *q, queue_size_t size, const char *name){
+	q->indexIn = 0;
+	q->indexOut = 0;
+	q->elementCount = 0;
+	q->size = size + 1;
+	q->underflowFlag = false;
+	q->overflowFlag = false;
+	q->data = (QUEUE_TYPED_DATA *) malloc(q->size * sizeof(QUEUE_TYPED_DATA));
+	if(q->data == NULL){
+		printf("%s: malloc() of %u elements failed\n", name, size);
+		assert(false);
+	}
+	strncpy(q->name, name, QUEUE_MAX_NAME_SIZE - 1);
+	q->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
+}
+
+// Get the user-assigned name for the queue.
+const char *QUEUE_TYPED_NAME(name)(QUEUE_TYPED_T *q){
+	return q->name;
+}
+
+// Returns the capacity of the queue.
+queue_size_t QUEUE_TYPED_NAME(size)(QUEUE_TYPED_T *q){
+	return q->size - 1;
+}
+
+// Returns true if the queue is full.
+bool QUEUE_TYPED_NAME(full)(QUEUE_TYPED_T *q){
+	return q->elementCount == q->size - 1;
+}
+
+// Returns true if the queue is empty.
+bool QUEUE_TYPED_NAME(empty)(QUEUE_TYPED_T *q){
+	return q->elementCount == 0;
+}
+
+// Pushes value, or sets the overflowFlag and prints an error if full.
+void QUEUE_TYPED_NAME(push)(QUEUE_TYPED_T *q, QUEUE_TYPED_DATA value){
+	if(QUEUE_TYPED_NAME(full)(q)){
+		q->overflowFlag = true;
+		printf("%s: push on a full queue\n", q->name);
+		return;
+	}
+	q->data[q->indexIn] = value;
+	q->indexIn = QUEUE_TYPED_NAME(nextIndex)(q, q->indexIn);
+	q->elementCount++;
+	q->underflowFlag = false;
+}
+
+// Removes and returns the oldest element, or sets the underflowFlag, prints an
+// error and returns QUEUE_RETURN_ERROR_VALUE if empty.
+QUEUE_TYPED_DATA QUEUE_TYPED_NAME(pop)(QUEUE_TYPED_T *q){
+	if(QUEUE_TYPED_NAME(empty)(q)){
+		q->underflowFlag = true;
+		printf("%s: pop on an empty queue\n", q->name);
+		return (QUEUE_TYPED_DATA) QUEUE_RETURN_ERROR_VALUE;
+	}
+	QUEUE_TYPED_DATA value = q->data[q->indexOut];
+	q->indexOut = QUEUE_TYPED_NAME(nextIndex)(q, q->indexOut);
+	q->elementCount--;
+	q->overflowFlag = false;
+	return value;
+}
+
+// Pops the oldest element first if the queue is full, then pushes value.
+void QUEUE_TYPED_NAME(overwritePush)(QUEUE_TYPED_T *q, QUEUE_TYPED_DATA value){
+	if(QUEUE_TYPED_NAME(full)(q))
+		QUEUE_TYPED_NAME(pop)(q);
+	QUEUE_TYPED_NAME(push)(q, value);
+}
+
+// Returns the element index places after the oldest, or prints an error and
+// returns QUEUE_RETURN_ERROR_VALUE if there is no such element.
+QUEUE_TYPED_DATA QUEUE_TYPED_NAME(readElementAt)(QUEUE_TYPED_T *q, queue_index_t index){
+	if(index >= q->elementCount){
+		printf("%s: readElementAt(%u) with %u elements\n", q->name, index, q->elementCount);
+		return (QUEUE_TYPED_DATA) QUEUE_RETURN_ERROR_VALUE;
+	}
+	queue_index_t slot = q->indexOut + index;
+	if(slot >= q->size)
+		slot -= q->size;
+	return q->data[slot];
+}
+
+// Returns a count of the elements currently contained in the queue.
+queue_size_t QUEUE_TYPED_NAME(elementCount)(QUEUE_TYPED_T *q){
+	return q->elementCount;
+}
+
+// Returns true if pop was called on an empty queue since the last push.
+bool QUEUE_TYPED_NAME(underflow)(QUEUE_TYPED_T *q){
+	return q->underflowFlag;
+}
+
+// Returns true if push was called on a full queue since the last pop.
+bool QUEUE_TYPED_NAME(overflow)(QUEUE_TYPED_T *q){
+	return q->overflowFlag;
+}
+
+// Frees the data array.
+void QUEUE_TYPED_NAME(garbageCollect)(QUEUE_TYPED_T *q){
+	free(q->data);
+	q->data = NULL;
+}
+
+// Prints the contents, oldest element first.
+void QUEUE_TYPED_NAME(print)(QUEUE_TYPED_T *q){
+	printf("%s:", q->name);
+	for(queue_index_t i = 0; i < q->elementCount; ++i)
+		printf(" " QUEUE_TYPED_FORMAT, QUEUE_TYPED_NAME(readElementAt)(q, i));
+	printf("\n");
+}
+
+// Checks push, pop, overwritePush, readElementAt and the flags on a small queue.
+bool QUEUE_TYPED_NAME(runTest)(){
+	const queue_size_t capacity = 5;
+	QUEUE_TYPED_T q;
+	bool passed = true;
+	QUEUE_TYPED_NAME(init)(&q, capacity, "runTest");
+	for(queue_size_t i = 0; i < capacity; ++i)
+		QUEUE_TYPED_NAME(push)(&q, (QUEUE_TYPED_DATA)(i + 1));
+	if(!QUEUE_TYPED_NAME(full)(&q) || QUEUE_TYPED_NAME(elementCount)(&q) != capacity){
+		printf("%s: not full after %u pushes\n", q.name, capacity);
+		passed = false;
+	}
+	QUEUE_TYPED_NAME(push)(&q, (QUEUE_TYPED_DATA) 0);	//Prints the overflow error
+	if(!QUEUE_TYPED_NAME(overflow)(&q) || QUEUE_TYPED_NAME(readElementAt)(&q, capacity - 1) != (QUEUE_TYPED_DATA) capacity){
+		printf("%s: push on a full queue did not set overflow, or changed the queue\n", q.name);
+		passed = false;
+	}
+	for(queue_size_t round = 0; round < 2 * capacity; ++round){	//Wraps both indexes twice
+		QUEUE_TYPED_NAME(overwritePush)(&q, (QUEUE_TYPED_DATA)(capacity + round + 1));
+		for(queue_index_t i = 0; i < capacity; ++i){
+			if(QUEUE_TYPED_NAME(readElementAt)(&q, i) != (QUEUE_TYPED_DATA)(round + i + 2)){
+				printf("%s: element %u is wrong after %u overwrites\n", q.name, i, round + 1);
+				passed = false;
+			}
+		}
+	}
+	for(queue_size_t i = 0; i < capacity; ++i){
+		if(QUEUE_TYPED_NAME(pop)(&q) != (QUEUE_TYPED_DATA)(2 * capacity + i + 1)){
+			printf("%s: pop %u returned the wrong element\n", q.name, i);
+			passed = false;
+		}
+	}
+	if(QUEUE_TYPED_NAME(overflow)(&q) || !QUEUE_TYPED_NAME(empty)(&q)){
+		printf("%s: pop did not clear overflow, or the queue is not empty\n", q.name);
+		passed = false;
+	}
+	QUEUE_TYPED_NAME(pop)(&q);	//Prints the underflow error
+	if(!QUEUE_TYPED_NAME(underflow)(&q) || QUEUE_TYPED_NAME(elementCount)(&q) != 0){
+		printf("%s: pop on an empty queue did not set underflow, or changed the queue\n", q.name);
+		passed = false;
+	}
+	QUEUE_TYPED_NAME(push)(&q, (QUEUE_TYPED_DATA) 1);
+	if(QUEUE_TYPED_NAME(underflow)(&q)){
+		printf("%s: push did not clear underflow\n", q.name);
+		passed = false;
+	}
+	QUEUE_TYPED_NAME(garbageCollect)(&q);
+	return passed;
+}
+
+#endif /* QUEUE_TYPED_IMPLEMENTATION */
+
+#undef QUEUE_TYPED_T
+#undef QUEUE_TYPED_PREFIX
+#undef QUEUE_TYPED_DATA
+#undef QUEUE_TYPED_FORMAT
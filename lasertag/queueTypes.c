@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include "queueTypes.h"
+#include "queue.h"
+#include "filterCoefficients.h"
+#include "intervalTimer.h"
+
+// Function bodies of every variant declared in queueTypes.h.
+#define QUEUE_TYPED_IMPLEMENTATION
+#define QUEUE_TYPED_PREFIX queueU16
+#define QUEUE_TYPED_DATA uint16_t
+#define QUEUE_TYPED_FORMAT "%d"
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueI32
+#define QUEUE_TYPED_DATA int32_t
+#define QUEUE_TYPED_FORMAT "%" PRId32
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueF32
+#define QUEUE_TYPED_DATA float
+#define QUEUE_TYPED_FORMAT "%f"
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueF64
+#define QUEUE_TYPED_DATA double
+#define QUEUE_TYPED_FORMAT "%lf"
+#include "queueTyped.h"
+#undef QUEUE_TYPED_IMPLEMENTATION
+
+// The queues filter.c allocates, see X_QUEUE_SIZE and friends there.
+#define X_QUEUE_SIZE FIR_FILTER_TAP_COUNT
+#define Y_QUEUE_SIZE IIR_B_COEFFICIENT_COUNT
+#define Z_QUEUE_SIZE IIR_A_COEFFICIENT_COUNT
+#define OUTPUT_QUEUE_SIZE 2000
+#define FILTER_IIR_FILTER_COUNT 10
+#define BENCHMARK_QUEUE_SIZE_COUNT 4
+
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_2
+#define BENCHMARK_PUSH_COUNT 200000
+#define BENCHMARK_READ_COUNT 1000000
+#define BENCHMARK_SAMPLE_MASK 0xFFF // Pushed values look like 12-bit ADC samples, exact in every type.
+#define BYTES_PER_KILOBYTE 1024.0
+#define OPERATIONS_PER_MILLION 1000000.0
+
+// What the benchmark measured for one queue type at one size.
+typedef struct {
+	uint32_t bytes; // The queue struct plus its data array.
+	double pushesPerSecond;
+	double readsPerSecond;
+	double checksum; // Sum of everything read, equal across types.
+} queueTypes_result_t;
+
+// Defines queueTypes_benchmark_<prefix>(), which measures one queue type. It
+// is a macro so queue_t and every variant go through the same code.
+#define QUEUETYPES_DEFINE_BENCHMARK(prefix, queueType, dataType)                        \
+static void queueTypes_benchmark_##prefix(queue_size_t size, queueTypes_result_t *result){ \
+	queueType q;                                                                          \
+	prefix##_init(&q, size, #prefix);                                                     \
+	for(queue_size_t i = 0; i < size; ++i)                                                \
+		prefix##_overwritePush(&q, (dataType) 0);                                         \
+	intervalTimer_reset(BENCHMARK_TIMER);                                                 \
+	intervalTimer_start(BENCHMARK_TIMER);                                                 \
+	for(uint32_t i = 0; i < BENCHMARK_PUSH_COUNT; ++i)                                    \
+		prefix##_overwritePush(&q, (dataType)(i & BENCHMARK_SAMPLE_MASK));               \
+	intervalTimer_stop(BENCHMARK_TIMER);                                                  \
+	result->pushesPerSecond = BENCHMARK_PUSH_COUNT / intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER); \
+	double sum = 0.0;                                                                     \
+	uint32_t reads = 0;                                                                   \
+	intervalTimer_reset(BENCHMARK_TIMER);                                                 \
+	intervalTimer_start(BENCHMARK_TIMER);                                                 \
+	while(reads < BENCHMARK_READ_COUNT){	/* Whole sweeps, oldest to newest, like the filter */ \
+		for(queue_index_t i = 0; i < size; ++i)                                           \
+			sum += prefix##_readElementAt(&q, i);                                         \
+		reads += size;                                                                    \
+	}                                                                                     \
+	intervalTimer_stop(BENCHMARK_TIMER);                                                  \
+	result->readsPerSecond = reads / intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER); \
+	result->checksum = sum;                                                               \
+	result->bytes = sizeof(queueType) + q.size * sizeof(dataType);                        \
+	prefix##_garbageCollect(&q);                                                          \
+}
+
+QUEUETYPES_DEFINE_BENCHMARK(queue, queue_t, queue_data_t)
+QUEUETYPES_DEFINE_BENCHMARK(queueF64, queueF64_t, double)
+QUEUETYPES_DEFINE_BENCHMARK(queueF32, queueF32_t, float)
+QUEUETYPES_DEFINE_BENCHMARK(queueI32, queueI32_t, int32_t)
+QUEUETYPES_DEFINE_BENCHMARK(queueU16, queueU16_t, uint16_t)
+
+// One benchmarked queue type.
+typedef struct {
+	const char *name;
+	void (*benchmark)(queue_size_t size, queueTypes_result_t *result);
+} queueTypes_benchmarkEntry_t;
+
+static const queueTypes_benchmarkEntry_t benchmarkEntries[] = {
+	{"queue_t", queueTypes_benchmark_queue},
+	{"queueF64_t", queueTypes_benchmark_queueF64},
+	{"queueF32_t", queueTypes_benchmark_queueF32},
+	{"queueI32_t", queueTypes_benchmark_queueI32},
+	{"queueU16_t", queueTypes_benchmark_queueU16},
+};
+#define BENCHMARK_ENTRY_COUNT (sizeof(benchmarkEntries) / sizeof(benchmarkEntries[0]))
+
+// Each filter.c queue size and how many queues of it a filter allocates.
+static const queue_size_t benchmarkSizes[BENCHMARK_QUEUE_SIZE_COUNT] = {X_QUEUE_SIZE, Y_QUEUE_SIZE, Z_QUEUE_SIZE, OUTPUT_QUEUE_SIZE};
+static const uint32_t benchmarkQueueCounts[BENCHMARK_QUEUE_SIZE_COUNT] = {1, 1, FILTER_IIR_FILTER_COUNT, FILTER_IIR_FILTER_COUNT};
+
+// Runs the runTest() of every variant.
+bool queueTypes_runTest(){
+	printf("Starting queueTypes_runTest()\n");
+	bool passed = queueU16_runTest();
+	passed = queueI32_runTest() && passed;
+	passed = queueF32_runTest() && passed;
+	passed = queueF64_runTest() && passed;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed queueTypes_runTest()\n");
+	return passed;
+}
+
+// Prints memory and throughput of every queue type at every filter.c size,
+// then the memory one filter's queues would take in each type.
+void queueTypes_runBenchmark(){
+	printf("Starting queueTypes_runBenchmark()\n");
+	uint32_t filterBytes[BENCHMARK_ENTRY_COUNT] = {0};
+	bool checksumsMatch = true;
+	intervalTimer_init(BENCHMARK_TIMER);
+	printf("%6s %-11s %8s %10s %10s\n", "size", "type", "bytes", "Mpush/s", "Mread/s");
+	for(uint32_t s = 0; s < BENCHMARK_QUEUE_SIZE_COUNT; ++s){
+		double referenceChecksum = 0.0;
+		for(uint32_t e = 0; e < BENCHMARK_ENTRY_COUNT; ++e){
+			queueTypes_result_t result;
+			benchmarkEntries[e].benchmark(benchmarkSizes[s], &result);
+			if(e == 0)
+				referenceChecksum = result.checksum;
+			else if(result.checksum != referenceChecksum)
+				checksumsMatch = false;
+			filterBytes[e] += result.bytes * benchmarkQueueCounts[s];
+			printf("%6u %-11s %8u %10.2f %10.2f\n", benchmarkSizes[s], benchmarkEntries[e].name, result.bytes,
+				result.pushesPerSecond / OPERATIONS_PER_MILLION, result.readsPerSecond / OPERATIONS_PER_MILLION);
+		}
+	}
+	printf("One filter's queues (1 x %u, 1 x %u, %u x %u, %u x %u):\n", X_QUEUE_SIZE, Y_QUEUE_SIZE,
+		FILTER_IIR_FILTER_COUNT, Z_QUEUE_SIZE, FILTER_IIR_FILTER_COUNT, OUTPUT_QUEUE_SIZE);
+	for(uint32_t e = 0; e < BENCHMARK_ENTRY_COUNT; ++e)
+		printf("  %-11s %8.1f KB\n", benchmarkEntries[e].name, filterBytes[e] / BYTES_PER_KILOBYTE);
+	printf("Every type read back the same values: %s\n", checksumsMatch ? "passed" : "FAILED");
+	printf("Completed queueTypes_runBenchmark()\n");
+}
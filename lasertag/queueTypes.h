@@ -0,0 +1,53 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef QUEUETYPES_H_
+#define QUEUETYPES_H_
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Typed queue variants stamped out from queueTyped.h. Each has the queue.h API
+// under its own prefix, e.g. queueU16_init(), queueU16_overwritePush(),
+// queueU16_readElementAt(). queue_t itself is unchanged and still stores
+// doubles.
+//   queueU16_t  uint16_t, e.g. raw 12-bit ADC samples
+//   queueI32_t  int32_t
+//   queueF32_t  float, e.g. single-precision filter state
+//   queueF64_t  double, the same element type as queue_t
+
+#define QUEUE_TYPED_PREFIX queueU16
+#define QUEUE_TYPED_DATA uint16_t
+#define QUEUE_TYPED_FORMAT "%d"
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueI32
+#define QUEUE_TYPED_DATA int32_t
+#define QUEUE_TYPED_FORMAT "%" PRId32
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueF32
+#define QUEUE_TYPED_DATA float
+#define QUEUE_TYPED_FORMAT "%f"
+#include "queueTyped.h"
+
+#define QUEUE_TYPED_PREFIX queueF64
+#define QUEUE_TYPED_DATA double
+#define QUEUE_TYPED_FORMAT "%lf"
+#include "queueTyped.h"
+
+// Runs the runTest() of every variant. Returns true if they all pass.
+bool queueTypes_runTest();
+
+// For each queue size filter.c uses, prints the memory a queue takes and its
+// overwritePush() and readElementAt() throughput, for queue_t and for every
+// variant.
+void queueTypes_runBenchmark();
+
+#endif /* QUEUETYPES_H_ */
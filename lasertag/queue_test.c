@@ -8,6 +8,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 */
 
 #include "queue.h"
+#include "intervalTimer.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -629,3 +630,298 @@ bool queue_runTest() {
   }
   return testResult;
 }
+
+/*********************************************************************************************************
+**************************** Bulk and unchecked operations (queueBulk.c)
+*****************************
+**********************************************************************************************************/
+
+#define BULK_TEST_MAX_CHUNK 37 // Larger than some test queues, smaller than others.
+#define BULK_TEST_SIZES_COUNT 4
+#define BULK_TEST_ROUNDS 2000
+#define BULK_TEST_QUEUE_NAME "bulkQ"
+#define BULK_TEST_REFERENCE_NAME "referenceQ"
+
+// Returns true if fast holds the same elements and flags as reference. The
+// elements of fast are read through queue_view(), those of reference through
+// queue_readElementAt(), so both paths are checked against each other.
+static bool queue_bulkMatches(queue_t *fast, queue_t *reference) {
+  queue_view_t view;
+  queue_size_t count = queue_view(fast, &view);
+  if (count != queue_elementCount(reference) ||
+      queue_overflow(fast) != queue_overflow(reference) ||
+      queue_underflow(fast) != queue_underflow(reference)) {
+    printf("* Error: %s holds %u elements (flags %d %d), %s holds %u (flags "
+           "%d %d)\n",
+           queue_name(fast), count, queue_overflow(fast),
+           queue_underflow(fast), queue_name(reference),
+           queue_elementCount(reference), queue_overflow(reference),
+           queue_underflow(reference));
+    return false;
+  }
+  for (queue_index_t i = 0; i < count; i++) {
+    double viewed = (i < view.first.count)
+                        ? view.first.data[i]
+                        : view.second.data[i - view.first.count];
+    double expected = queue_readElementAt(reference, i);
+    if (viewed != expected ||
+        queue_readElementAtUnchecked(fast, i) != expected) {
+      printf("* Error: element %u of %s is %lf, should be %lf\n", i,
+             queue_name(fast), viewed, expected);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Test 1 of queue_runTest2() through queue_overwritePushN() in random-sized
+// chunks, read back with queue_readElementAtUnchecked().
+static bool queue_bulkArrayTest() {
+  bool success = true;
+  queue_data_t testData[SMALL_QUEUE_SIZE + FILLER];
+  queue_t q;
+  queue_init(&q, SMALL_QUEUE_SIZE, TEST_SMALL_QUEUE_NAME);
+  for (int i = 0; i < SMALL_QUEUE_SIZE + FILLER; i++)
+    testData[i] = (double)rand() / (double)RAND_MAX;
+  for (queue_size_t pushed = 0; pushed < SMALL_QUEUE_SIZE + FILLER;) {
+    queue_size_t chunk = 1 + rand() % BULK_TEST_MAX_CHUNK;
+    if (chunk > SMALL_QUEUE_SIZE + FILLER - pushed)
+      chunk = SMALL_QUEUE_SIZE + FILLER - pushed;
+    queue_overwritePushN(&q, &testData[pushed], chunk);
+    pushed += chunk;
+  }
+  for (int i = 0; i < SMALL_QUEUE_SIZE; i++) {
+    if (queue_readElementAtUnchecked(&q, i) != testData[i + FILLER]) {
+      printf("testData[%d]:%lf != queue_readElementAtUnchecked(&q, %d):%lf\n",
+             i + FILLER, testData[i + FILLER], i,
+             queue_readElementAtUnchecked(&q, i));
+      success = false;
+      break;
+    }
+  }
+  queue_garbageCollect(&q);
+  return success;
+}
+
+// Test 2 of queue_runTest2(): the chain of small queues is shifted with the
+// unchecked accessors and compared with a large queue that uses the checked
+// calls.
+static bool queue_bulkChainTest() {
+  bool success = true;
+  for (int i = 0; i < SMALL_QUEUE_COUNT; i++) {
+    queue_init(&(smallQueue[i]), SMALL_QUEUE_SIZE, TEST_SMALL_QUEUE_NAME);
+    for (int j = 0; j < SMALL_QUEUE_SIZE; j++)
+      queue_overwritePush(&(smallQueue[i]), 0.0);
+  }
+  queue_init(&largeQueue, SMALL_QUEUE_SIZE * SMALL_QUEUE_COUNT,
+             TEST_LARGE_QUEUE_NAME);
+  for (int i = 0; i < SMALL_QUEUE_SIZE * SMALL_QUEUE_COUNT; i++)
+    queue_overwritePush(&largeQueue, 0.0);
+  for (int i = 0; i < TEST_ITERATION_COUNT && success; i++) {
+    double newInput = (double)rand() / (double)RAND_MAX;
+    for (int j = 0; j < SMALL_QUEUE_COUNT - 1; j++)
+      queue_overwritePushFullUnchecked(
+          &(smallQueue[j]), queue_readElementAtUnchecked(&(smallQueue[j + 1]), 0));
+    queue_overwritePushFullUnchecked(&(smallQueue[SMALL_QUEUE_COUNT - 1]),
+                                     newInput);
+    queue_overwritePush(&largeQueue, newInput);
+    success = compareChainOfSmallQueuesWithLargeQueue();
+  }
+  for (int i = 0; i < SMALL_QUEUE_COUNT; i++)
+    queue_garbageCollect(&(smallQueue[i]));
+  queue_garbageCollect(&largeQueue);
+  return success;
+}
+
+// The push/pop test of queue_pushPopTest() with queue_pushN() and
+// queue_popN() in random amounts, including too many, against a reference
+// queue driven one element at a time.
+static bool queue_bulkPushPopTest(queue_size_t size) {
+  bool success = true;
+  queue_data_t values[BULK_TEST_MAX_CHUNK];
+  queue_data_t popped[BULK_TEST_MAX_CHUNK];
+  queue_t fast, reference;
+  queue_init(&fast, size, BULK_TEST_QUEUE_NAME);
+  queue_init(&reference, size, BULK_TEST_REFERENCE_NAME);
+  int round;
+  for (round = 0; round < BULK_TEST_ROUNDS && success; round++) {
+    queue_size_t pushCount = rand() % BULK_TEST_MAX_CHUNK;
+    for (queue_size_t i = 0; i < pushCount; i++)
+      values[i] = (double)rand();
+    queue_size_t space = queue_size(&reference) - queue_elementCount(&reference);
+    for (queue_size_t i = 0; i < pushCount && i <= space; i++)
+      queue_push(&reference, values[i]); // One past space sets overflow.
+    if (queue_pushN(&fast, values, pushCount) !=
+        (pushCount < space ? pushCount : space))
+      success = false;
+    success = success && queue_bulkMatches(&fast, &reference);
+
+    queue_size_t popCount = rand() % BULK_TEST_MAX_CHUNK;
+    queue_size_t available = queue_elementCount(&reference);
+    queue_size_t poppedCount = queue_popN(&fast, popped, popCount);
+    for (queue_size_t i = 0; i < popCount && i <= available; i++) {
+      double expected = queue_pop(&reference); // One past available sets underflow.
+      if (i < poppedCount && popped[i] != expected) {
+        printf("* Error: queue_popN() value %u is %lf, should be %lf\n", i,
+               popped[i], expected);
+        success = false;
+      }
+    }
+    if (poppedCount != (popCount < available ? popCount : available))
+      success = false;
+    success = success && queue_bulkMatches(&fast, &reference);
+
+    queue_size_t overwriteCount = rand() % BULK_TEST_MAX_CHUNK;
+    for (queue_size_t i = 0; i < overwriteCount; i++) {
+      values[i] = (double)rand();
+      queue_overwritePush(&reference, values[i]);
+    }
+    queue_overwritePushN(&fast, values, overwriteCount);
+    success = success && queue_bulkMatches(&fast, &reference);
+  }
+  if (!success)
+    printf("* Error: bulk push/pop test of a %u-element queue failed in "
+           "round %d\n",
+           size, round - 1);
+  queue_garbageCollect(&fast);
+  queue_garbageCollect(&reference);
+  return success;
+}
+
+// Runs the torture tests through the bulk and unchecked operations. The
+// push/pop test prints queue full/empty error messages from both paths.
+bool queue_runBulkTest() {
+  const queue_size_t sizes[BULK_TEST_SIZES_COUNT] = {1, 10, BULK_TEST_MAX_CHUNK, 100};
+  bool testResult = true;
+  printf("Starting queue_runBulkTest()\n");
+  bool tempResult = queue_bulkArrayTest();
+  printf("=== Bulk test 1 %s. Array contents %s queue contents.\n",
+         tempResult ? "passed" : "failed", tempResult ? "match" : "do not match");
+  testResult = tempResult ? testResult : false;
+  tempResult = queue_bulkChainTest();
+  printf("=== Bulk test 2 %s. Unchecked chain of small queues %s the large "
+         "queue.\n",
+         tempResult ? "passed" : "failed", tempResult ? "matches" : "does not match");
+  testResult = tempResult ? testResult : false;
+  for (int i = 0; i < BULK_TEST_SIZES_COUNT; i++) {
+    tempResult = queue_bulkPushPopTest(sizes[i]);
+    printf("=== Bulk push/pop/overwrite test of a %u-element queue %s.\n",
+           sizes[i], tempResult ? "passed" : "failed");
+    testResult = tempResult ? testResult : false;
+  }
+  printf("%s\n", testResult ? "passed" : "FAILED");
+  printf("Completed queue_runBulkTest()\n");
+  return testResult;
+}
+
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_2
+#define BENCHMARK_FIR_SIZE 81        // X_QUEUE_SIZE in filter.c.
+#define BENCHMARK_OUTPUT_SIZE 2000   // OUTPUT_QUEUE_SIZE in filter.c.
+#define BENCHMARK_FIR_CALLS 20000
+#define BENCHMARK_POWER_CALLS 500
+#define BENCHMARK_BLOCK_SIZE 100
+#define BENCHMARK_BLOCK_CALLS 5000
+#define NANOSECONDS_PER_SECOND 1e9
+
+// Returns the seconds the benchmark timer has accumulated and resets it.
+static double queue_takeBenchmarkSeconds() {
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double seconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+  intervalTimer_reset(BENCHMARK_TIMER);
+  return seconds;
+}
+
+// Prints one comparison line and returns the speedup.
+static double queue_printBenchmarkLine(const char *what, uint32_t calls,
+                                       double checkedSeconds,
+                                       double fastSeconds) {
+  double speedup = checkedSeconds / fastSeconds;
+  printf("%-34s %10.1f ns %10.1f ns %6.2fx\n", what,
+         checkedSeconds * NANOSECONDS_PER_SECOND / calls,
+         fastSeconds * NANOSECONDS_PER_SECOND / calls, speedup);
+  return speedup;
+}
+
+// Times the three queue patterns filter.c uses, per element and with the bulk
+// and unchecked operations: an FIR step (push one, read every element), a
+// from-scratch power sum over an output queue, and pushing a block of samples.
+void queue_runBulkBenchmark() {
+  printf("Starting queue_runBulkBenchmark()\n");
+  queue_t q;
+  queue_view_t view;
+  static queue_data_t block[BENCHMARK_BLOCK_SIZE];
+  double checkedSum = 0.0, fastSum = 0.0;
+  intervalTimer_init(BENCHMARK_TIMER);
+  intervalTimer_reset(BENCHMARK_TIMER);
+  printf("%-34s %13s %13s %7s\n", "operation", "per element", "bulk/unchecked",
+         "speedup");
+
+  queue_init(&q, BENCHMARK_FIR_SIZE, "benchmarkFir");
+  for (int i = 0; i < BENCHMARK_FIR_SIZE; i++)
+    queue_overwritePush(&q, (double)i);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_FIR_CALLS; call++) {
+    queue_overwritePush(&q, (double)call);
+    for (int i = 0; i < BENCHMARK_FIR_SIZE; i++)
+      checkedSum += queue_readElementAt(&q, BENCHMARK_FIR_SIZE - 1 - i) * i;
+  }
+  double checkedSeconds = queue_takeBenchmarkSeconds();
+  for (int i = 0; i < BENCHMARK_FIR_SIZE; i++)
+    queue_overwritePush(&q, (double)i); // Same starting contents.
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_FIR_CALLS; call++) {
+    queue_overwritePushFullUnchecked(&q, (double)call);
+    queue_view(&q, &view);
+    int coefficient = BENCHMARK_FIR_SIZE - 1; // Oldest element gets the last.
+    for (queue_size_t i = 0; i < view.first.count; i++)
+      fastSum += view.first.data[i] * coefficient--;
+    for (queue_size_t i = 0; i < view.second.count; i++)
+      fastSum += view.second.data[i] * coefficient--;
+  }
+  double fastSeconds = queue_takeBenchmarkSeconds();
+  queue_printBenchmarkLine("FIR step, 81 taps", BENCHMARK_FIR_CALLS,
+                           checkedSeconds, fastSeconds);
+  queue_garbageCollect(&q);
+
+  queue_init(&q, BENCHMARK_OUTPUT_SIZE, "benchmarkOutput");
+  for (int i = 0; i < BENCHMARK_OUTPUT_SIZE + BENCHMARK_OUTPUT_SIZE / 3; i++)
+    queue_overwritePush(&q, (double)(i % BENCHMARK_FIR_SIZE)); // Wrapped.
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_POWER_CALLS; call++) {
+    for (int i = 0; i < BENCHMARK_OUTPUT_SIZE; i++) {
+      double value = queue_readElementAt(&q, i);
+      checkedSum += value * value;
+    }
+  }
+  checkedSeconds = queue_takeBenchmarkSeconds();
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_POWER_CALLS; call++) {
+    queue_view(&q, &view);
+    for (queue_size_t i = 0; i < view.first.count; i++)
+      fastSum += view.first.data[i] * view.first.data[i];
+    for (queue_size_t i = 0; i < view.second.count; i++)
+      fastSum += view.second.data[i] * view.second.data[i];
+  }
+  fastSeconds = queue_takeBenchmarkSeconds();
+  queue_printBenchmarkLine("power from scratch, 2000 elements",
+                           BENCHMARK_POWER_CALLS, checkedSeconds, fastSeconds);
+
+  for (int i = 0; i < BENCHMARK_BLOCK_SIZE; i++)
+    block[i] = (double)i;
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_BLOCK_CALLS; call++)
+    for (int i = 0; i < BENCHMARK_BLOCK_SIZE; i++)
+      queue_overwritePush(&q, block[i]);
+  checkedSeconds = queue_takeBenchmarkSeconds();
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (int call = 0; call < BENCHMARK_BLOCK_CALLS; call++)
+    queue_overwritePushN(&q, block, BENCHMARK_BLOCK_SIZE);
+  fastSeconds = queue_takeBenchmarkSeconds();
+  queue_printBenchmarkLine("push a 100-sample block", BENCHMARK_BLOCK_CALLS,
+                           checkedSeconds, fastSeconds);
+  queue_garbageCollect(&q);
+
+  printf("Both paths computed the same sums: %s\n",
+         (checkedSum == fastSum) ? "passed" : "FAILED");
+  printf("Completed queue_runBulkBenchmark()\n");
+}
@@ -68,4 +68,7 @@ uint16_t runningModes_getFrequencySetting();
 // A simple test mode that continuously prints out raw ADC values.
 void runningModes_dumpRawAdcValues();
 
+// Streams raw ADC samples over the USB-UART until btn3 is pressed.
+void runningModes_streamRawAdc();
+
 #endif /* RUNNINGMODES_H_ */
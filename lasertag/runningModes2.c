@@ -15,18 +15,20 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "filter.h"
 #include "histogram.h"
 #include "hitLedTimer.h"
+#include "idle.h"
 #include "interrupts.h"
-#include "intervalTimer.h"
 #include "isr.h"
 #include "ledTimer.h"
 #include "leds.h"
 #include "lockoutTimer.h"
 #include "mio.h"
 #include "queue.h"
+#include "scheduler.h"
 #include "sound.h"
 #include "transmitter.h"
 #include "trigger.h"
 #include "utils.h"
+#include "virtualTimer.h"
 #include "xparameters.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -34,14 +36,19 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdlib.h>
 #include <string.h>
 
-#define INVINCIBILITY_TIMER INTERVAL_TIMER_TIMER_2  
-#define HEALTH_REGEN_TIMER INTERVAL_TIMER_TIMER_2
-#define END_SOUND_TIMER INTERVAL_TIMER_TIMER_2 
-#define RELOAD_TIMER INTERVAL_TIMER_TIMER_1  
-#define INVINCIBILITY_DURATION 5
-#define RELOAD_DURATION 3
-#define END_SOUND_DURATION 1
-#define HEALTH_REGEN_DURATION 10
+// The game modes run on the scheduler: every pass runs the detector, then the
+// virtual timers, then the game events, then the tasks below. Nothing in
+// here waits. Sounds that follow one another go through the sound queue,
+// which posts an event when each one ends, and everything that lasts a while
+// (invincibility, reloading, the silence between reminders) is a virtual
+// timer. So the detector runs at least once a pass through the intros and
+// invincibility too, where the old loops stopped calling it.
+
+// Durations in milliseconds. Each gets its own virtual timer.
+#define INVINCIBILITY_DURATION 5000
+#define RELOAD_DURATION 3000
+#define END_SOUND_DURATION 1000
+#define HEALTH_REGEN_DURATION 10000
 
 #define TEAM_A_FREQ 9
 #define TEAM_B_FREQ 6
@@ -49,150 +56,186 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define LIVES 3
 #define AMMO 10
 
-//Two team mode, 3 lives, 5 hits per life
-void runningModes_twoTeams() {
-  uint16_t hitCount = 0;
-  uint16_t lifeCount = LIVES;
-  bool reloadTimerRunning = false;
-  sound_init();
-	
-  interrupts_initAll(true); // Inits all interrupts but does not enable them.
-  interrupts_enableTimerGlobalInts(); // Allows the timer to generate
-                                      // interrupts.
-  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
-  interrupts_enableArmInts(); // The ARM will start seeing interrupts after
-                              // this.
-  runningModes_initAll();
-  
-  sound_setVolume(SOUND_VOLUME_3);
-  sound_playSound(sound_gameStart_e); //Gameboy start sound
-	while(sound_isBusy()){
-		
-	}
-  // sound_startSound();
-  // More initialization...
-  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
-  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
-    ignoredFrequencies[i] = true;
+#define SOUND_QUEUE_LENGTH 4
 
-  if ((switches_read() & SWITCHES_SW0_MASK) == SWITCHES_SW0_MASK) {	//if the switch is up, set it to Team A
-    ignoredFrequencies[TEAM_B_FREQ] = false;
-	transmitter_setFrequencyNumber(TEAM_A_FREQ);
-  }
-  else {	//if the switch is down, set it to Team B
-    ignoredFrequencies[TEAM_A_FREQ] = false;
-	transmitter_setFrequencyNumber(TEAM_B_FREQ);
-  }
-  
-  detector_init(ignoredFrequencies);
-  trigger_enable();         // Makes the trigger state machine responsive to the
-                            // trigger.
-  trigger_setRemainingShotCount(AMMO); // initialize the amount of ammo
+// The status lines on the TFT.
+#define STATUS_TEXT_SIZE 3
+#define STATUS_LINE_HEIGHT (STATUS_TEXT_SIZE * DISPLAY_CHAR_HEIGHT * 2)
+#define STATUS_BUFFER_SIZE 16
+#define STATUS_NOT_SHOWN UINT16_MAX
 
-  lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
-                        // values are essentially 0).
-  // Implement game loop...
-  bool gunShot = false;
-  while(lifeCount > 0) { // Big loop for the game, keeps looping until you lose all 3 lives.
-	  	detector(true);
-		if (trigger_shotsFired() && trigger_getRemainingShotCount() > 0) { //Shoot sound when shooting.
-            if(!gunShot){
-				sound_setSound(sound_gunFire_e);
-				sound_startSound();
-				gunShot = true;
-			}
-			intervalTimer_start(RELOAD_TIMER);
-			reloadTimerRunning = true;
-        }
-			
-        if (!trigger_shotsFired() && trigger_getRemainingShotCount() > 0 && reloadTimerRunning){ //Reset reload timer if force hold is stopped.
-			gunShot = false;
-            intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-			reloadTimerRunning = false;
-        }
-        if (trigger_getRemainingShotCount() == 0 && !reloadTimerRunning) { //Just ran out of ammo, start reload timer.
-            intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-            intervalTimer_start(RELOAD_TIMER);
-			reloadTimerRunning = true;
-        }
-	  	if(triggerPressed() && trigger_getRemainingShotCount() == 0){ //Clicking sound when empty ammo and trying to shoot.
-                sound_setSound(sound_gunClick_e);
-                sound_startSound();
-        }
-		if (intervalTimer_getTotalDurationInSeconds(RELOAD_TIMER) > RELOAD_DURATION && reloadTimerRunning) { //Done reloading, play reload sound.
-            trigger_setRemainingShotCount(AMMO);
-			sound_setSound(sound_gunReload_e);
-            sound_startSound();
-			intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-			reloadTimerRunning = false;
-        }
-	    if(detector_hitDetected()){	//Process a hit
-            ++hitCount;
-            detector_clearHit();
-            sound_setSound(sound_hit_e);
-			sound_startSound();
-            if(hitCount == HEALTH){ //Lost a life, reset hit count, play lose life sound, disable trigger, start invincibility timer
-				--lifeCount;
-				detector_ignoreAllHits(true);
-				detector_clearHit();
-				detector(true);
-				sound_setSound(sound_loseLife_e);
-				sound_startSound();
-      			hitCount = 0;
-      			trigger_disable();
-                intervalTimer_start(INVINCIBILITY_TIMER);
-                while (intervalTimer_getTotalDurationInSeconds(INVINCIBILITY_TIMER) < INVINCIBILITY_DURATION) {
-                    //start 5 sec timer for invincibility
-					detector(true);
-					if(lifeCount == 0)
-						break;
-        		}
-				detector(true);
-				detector_clearHit();
-				detector_ignoreAllHits(false);
-			    trigger_enable();
-                intervalTimer_stop(INVINCIBILITY_TIMER);
-                intervalTimer_reset(INVINCIBILITY_TIMER);
-	        }
-		}
+// What the player is doing.
+typedef enum {
+  game_intro_st,       // Intro sounds playing, hits ignored.
+  game_playing_st,     // Shooting and being shot.
+  game_invincible_st,  // Lost a life, hits ignored until the timer expires.
+  game_respawning_st,  // Team sound playing after invincibility.
+  game_over_st         // Out of lives, told to return to base.
+} game_phase_t;
+
+// Game events, posted by the timers, the sound queue and the rules.
+typedef enum {
+  GAME_EVENT_NONE,               // A queued sound that posts nothing.
+  GAME_EVENT_INTRO_DONE,         // The last intro sound ended.
+  GAME_EVENT_INVINCIBILITY_OVER, // The invincibility timer expired.
+  GAME_EVENT_RESPAWNED,          // The team sound after invincibility ended.
+  GAME_EVENT_HEALTH_REGEN,       // The health regeneration timer expired.
+  GAME_EVENT_GAME_OVER,          // The game over sound ended.
+  GAME_EVENT_RETURN_TO_BASE,     // A return to base reminder ended.
+  GAME_EVENT_SILENCE_OVER        // The silence after a reminder is over.
+} game_event_t;
+
+// A sound waiting in the sound queue.
+typedef struct {
+  sound_sounds_t sound;
+  game_event_t doneEvent; // Posted when the sound ends.
+} queuedSound_t;
+
+static game_phase_t gamePhase;
+static uint16_t hitCount;
+static uint16_t lifeCount;
+static bool livesCounted; // False in the creative mode, which has no lives.
+static bool reloadTimerRunning;
+static trigger_shotsRemaining_t shotCount;
+static sound_sounds_t shotSound; // Played for every shot.
+static sound_sounds_t hitSound;  // Played for every hit.
+static bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+
+static virtualTimer_id_t invincibilityTimer;
+static virtualTimer_id_t reloadTimer;
+static virtualTimer_id_t endSoundTimer;
+static virtualTimer_id_t healthRegenTimer;
+
+static queuedSound_t soundQueue[SOUND_QUEUE_LENGTH];
+static uint8_t soundQueueHead;
+static uint8_t soundQueueCount;
+static bool queuedSoundPlaying;
+static game_event_t playingDoneEvent;
+
+static uint16_t shownLives;
+static uint16_t shownHealth;
+static uint16_t shownAmmo;
+
+// Virtual timer callback, posts the game event passed as the context.
+static void runningModes_postTimerEvent(virtualTimer_id_t id, void *context) {
+  (void)id;
+  scheduler_postEvent((scheduler_event_t)(uintptr_t)context, 0);
+}
+
+// Queues a sound to play once the sounds before it, and any sound started
+// with sound_playSound(), have ended. doneEvent is posted when it ends.
+static void runningModes_queueSound(sound_sounds_t sound, game_event_t doneEvent) {
+  if (soundQueueCount == SOUND_QUEUE_LENGTH)
+    return;
+  queuedSound_t *queued = &soundQueue[(soundQueueHead + soundQueueCount) % SOUND_QUEUE_LENGTH];
+  queued->sound = sound;
+  queued->doneEvent = doneEvent;
+  ++soundQueueCount;
+}
 
+// Sound sequencing task. Once the sound system is idle, posts the event of
+// the queued sound that just ended and starts the next one.
+static void runningModes_soundTask() {
+  if (sound_isBusy())
+    return;
+  if (queuedSoundPlaying) {
+    queuedSoundPlaying = false;
+    if (playingDoneEvent != GAME_EVENT_NONE)
+      scheduler_postEvent(playingDoneEvent, 0);
   }
-  sound_setSound(sound_gameOver_e); //Game over sound
-  sound_startSound();
-  while(sound_isBusy()){	
+  if (soundQueueCount > 0) {
+    queuedSound_t next = soundQueue[soundQueueHead];
+    soundQueueHead = (soundQueueHead + 1) % SOUND_QUEUE_LENGTH;
+    --soundQueueCount;
+    sound_playSound(next.sound);
+    queuedSoundPlaying = true;
+    playingDoneEvent = next.doneEvent;
   }
+}
 
-  hitLedTimer_turnLedOff();    // Save power :-)
-  printf("Two-team mode terminated after detecting %d shots.\n", hitCount);
-
-  while(1){	//Continuously tell the user to return to base until they get annoyed and shut the backpack off
-	sound_setSound(sound_returnToBase_e);
-	sound_startSound();
-	while(sound_isBusy()){	
-	}
-	  
-  	intervalTimer_start(END_SOUND_TIMER);
-	while (intervalTimer_getTotalDurationInSeconds(END_SOUND_TIMER) < END_SOUND_DURATION) {
-		//start 1 sec timer for silence
-	}
-	intervalTimer_stop(END_SOUND_TIMER);
-	intervalTimer_reset(END_SOUND_TIMER);
+// Prints text on the given status line, over what was there.
+static void runningModes_drawStatus(uint16_t line, const char *text) {
+  display_setCursor(0, line * STATUS_LINE_HEIGHT);
+  display_print(text);
+}
 
-	
+// Display task. Redraws at most one status line a pass, the first one that
+// changed, so a pass never waits on more than one line of SPI writes.
+static void runningModes_displayTask() {
+  char buffer[STATUS_BUFFER_SIZE];
+  uint16_t health = HEALTH - hitCount;
+  uint16_t ammo = trigger_getRemainingShotCount();
+  if (livesCounted && lifeCount != shownLives) {
+    shownLives = lifeCount;
+    snprintf(buffer, STATUS_BUFFER_SIZE, "Lives  %2u", lifeCount);
+    runningModes_drawStatus(0, buffer);
+  } else if (health != shownHealth) {
+    shownHealth = health;
+    snprintf(buffer, STATUS_BUFFER_SIZE, "Health %2u", health);
+    runningModes_drawStatus(1, buffer);
+  } else if (ammo != shownAmmo) {
+    shownAmmo = ammo;
+    snprintf(buffer, STATUS_BUFFER_SIZE, "Ammo   %2u", ammo);
+    runningModes_drawStatus(2, buffer);
+  }
+}
 
+// Shot, empty-clip and reload rules shared by both game modes.
+static void runningModes_gunRules() {
+  if (trigger_getRemainingShotCount() < shotCount) { //Shoot sound for every shot, bursts and full auto included.
+    sound_playSound(shotSound);
+  }
+  shotCount = trigger_getRemainingShotCount();
+  if (trigger_shotsFired() && trigger_getRemainingShotCount() > 0 && !reloadTimerRunning) {
+    virtualTimer_startOneShot(reloadTimer, RELOAD_DURATION);
+    reloadTimerRunning = true;
+  }
+  if (!trigger_shotsFired() && trigger_getRemainingShotCount() > 0 && reloadTimerRunning) { //Reset reload timer if force hold is stopped.
+    virtualTimer_stop(reloadTimer);
+    reloadTimerRunning = false;
+  }
+  if (trigger_getRemainingShotCount() == 0 && !reloadTimerRunning) { //Just ran out of ammo, start reload timer.
+    virtualTimer_startOneShot(reloadTimer, RELOAD_DURATION);
+    reloadTimerRunning = true;
   }
+  if (triggerPressed() && trigger_getRemainingShotCount() == 0) { //Clicking sound when empty ammo and trying to shoot.
+    sound_playSound(sound_gunClick_e);
+  }
+  if (virtualTimer_takeExpired(reloadTimer) && reloadTimerRunning) { //Done reloading, play reload sound.
+    trigger_setRemainingShotCount(AMMO);
+    sound_playSound(sound_gunReload_e);
+    reloadTimerRunning = false;
+  }
+}
 
-  interrupts_disableArmInts(); // Done with game loop, disable the interrupts.
+// Lets the player shoot and be shot, at the end of the intro.
+static void runningModes_beginPlay() {
+  detector_clearHit();
+  detector_ignoreAllHits(false);
+  trigger_enable();         // Makes the trigger state machine responsive to the
+                            // trigger.
+  trigger_setRemainingShotCount(AMMO); // initialize the amount of ammo
+  shotCount = AMMO;
+  lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
+                        // values are essentially 0).
+  gamePhase = game_playing_st;
 }
 
-void runningModes_creativeProject() {
-  uint16_t hitCount = 0;
-  bool reloadTimerRunning = false;
+// Lets the player shoot and be shot again after losing a life.
+static void runningModes_respawn() {
+  detector_clearHit();
+  detector_ignoreAllHits(false);
+  trigger_enable();
+  gamePhase = game_playing_st;
+}
+
+// Sets up everything both game modes share and the scheduler that runs them:
+// interrupts, sounds, team, detector, timers, display and tasks. rulesTask
+// runs first each pass; handler gets the game events.
+static void runningModes_startGame(scheduler_task_t rulesTask, scheduler_eventHandler_t handler) {
   sound_init();
-	
+  virtualTimer_init(); // Frees the timers of an earlier game.
+
   interrupts_initAll(true); // Inits all interrupts but does not enable them.
   interrupts_enableTimerGlobalInts(); // Allows the timer to generate
                                       // interrupts.
@@ -200,144 +243,201 @@ void runningModes_creativeProject() {
   interrupts_enableArmInts(); // The ARM will start seeing interrupts after
                               // this.
   runningModes_initAll();
-  
+  invincibilityTimer = virtualTimer_create("invincibility", runningModes_postTimerEvent,
+                                           (void *)(uintptr_t)GAME_EVENT_INVINCIBILITY_OVER);
+  reloadTimer = virtualTimer_create("reload", NULL, NULL);
+  endSoundTimer = virtualTimer_create("endSound", runningModes_postTimerEvent,
+                                      (void *)(uintptr_t)GAME_EVENT_SILENCE_OVER);
+  healthRegenTimer = virtualTimer_create("healthRegen", runningModes_postTimerEvent,
+                                         (void *)(uintptr_t)GAME_EVENT_HEALTH_REGEN);
   sound_setVolume(SOUND_VOLUME_3);
-  sound_playSound(sound_johnCena_e); //Gameboy start sound
-	while(sound_isBusy()){
-		
-	}
-	sound_setSound(sound_oneSecondSilence_e);
-	sound_startSound();
-	while(sound_isBusy()){	
-	}
-  // sound_startSound();
-  // More initialization...
-  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+
   for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
     ignoredFrequencies[i] = true;
-
   if ((switches_read() & SWITCHES_SW0_MASK) == SWITCHES_SW0_MASK) {	//if the switch is up, set it to Team A
     ignoredFrequencies[TEAM_B_FREQ] = false;
-	transmitter_setFrequencyNumber(TEAM_A_FREQ);
-	sound_playSound(sound_teamOne_e);
+    transmitter_setFrequencyNumber(TEAM_A_FREQ);
   }
   else {	//if the switch is down, set it to Team B
     ignoredFrequencies[TEAM_A_FREQ] = false;
-	transmitter_setFrequencyNumber(TEAM_B_FREQ);
-	sound_playSound(sound_teamTwo_e);
-  }
-  while(sound_isBusy()){
-		
+    transmitter_setFrequencyNumber(TEAM_B_FREQ);
   }
-  
+  // The detector drains the ADC buffer from the first pass, but hits only
+  // count once the intro is over.
   detector_init(ignoredFrequencies);
-  trigger_enable();         // Makes the trigger state machine responsive to the
-                            // trigger.
-  trigger_setRemainingShotCount(AMMO); // initialize the amount of ammo
+  detector_ignoreAllHits(true);
 
-  lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
-                        // values are essentially 0).
-  // Implement game loop...
-  bool gunShot = false;
-  while(true) { // Big loop for the game, keeps looping until you lose all 3 lives.
-	  	detector(true);
-		if (trigger_shotsFired() && trigger_getRemainingShotCount() > 0) { //Shoot sound when shooting.
-            if(!gunShot){
-				sound_setSound(sound_newShot_e);
-				sound_startSound();
-				gunShot = true;
-			}
-			intervalTimer_start(RELOAD_TIMER);
-			reloadTimerRunning = true;
-        }
-			
-        if (!trigger_shotsFired() && trigger_getRemainingShotCount() > 0 && reloadTimerRunning){ //Reset reload timer if force hold is stopped.
-			gunShot = false;
-            intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-			reloadTimerRunning = false;
-        }
-        if (trigger_getRemainingShotCount() == 0 && !reloadTimerRunning) { //Just ran out of ammo, start reload timer.
-            intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-            intervalTimer_start(RELOAD_TIMER);
-			reloadTimerRunning = true;
-        }
-	  	if(triggerPressed() && trigger_getRemainingShotCount() == 0){ //Clicking sound when empty ammo and trying to shoot.
-                sound_setSound(sound_gunClick_e);
-                sound_startSound();
-        }
-		if (intervalTimer_getTotalDurationInSeconds(RELOAD_TIMER) > RELOAD_DURATION && reloadTimerRunning) { //Done reloading, play reload sound.
-            trigger_setRemainingShotCount(AMMO);
-			sound_setSound(sound_gunReload_e);
-            sound_startSound();
-			intervalTimer_stop(RELOAD_TIMER);
-            intervalTimer_reset(RELOAD_TIMER);
-			reloadTimerRunning = false;
-        }
-	  	if (intervalTimer_getTotalDurationInSeconds(HEALTH_REGEN_TIMER) > HEALTH_REGEN_DURATION) {
-			if (hitCount > 0) {
-				hitCount--;
-				sound_playSound(sound_gameStart_e); //Gameboy start sound
-				while(sound_isBusy()){
-		
-				}
-			}
-			intervalTimer_stop(HEALTH_REGEN_TIMER);
-            intervalTimer_reset(HEALTH_REGEN_TIMER);
-			intervalTimer_start(HEALTH_REGEN_TIMER);
-		}
-	    if(detector_hitDetected()){	//Process a hit
-			intervalTimer_stop(HEALTH_REGEN_TIMER);
-            intervalTimer_reset(HEALTH_REGEN_TIMER);
-            ++hitCount;
-            detector_clearHit();
-            sound_setSound(sound_robloxOof_e);
-			sound_startSound();
-            if(hitCount == HEALTH){ //Lost a life, reset hit count, play lose life sound, disable trigger, start invincibility timer
-				transmitter_setFrequencyNumber(detector_getFrequencyNumberOfLastHit());
-				for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
-				    ignoredFrequencies[i] = true;
-				if(transmitter_getFrequencyNumber() == TEAM_A_FREQ){
-					ignoredFrequencies[TEAM_B_FREQ] = false;
-					transmitter_setFrequencyNumber(TEAM_A_FREQ); 
-				}
-				else if (transmitter_getFrequencyNumber() == TEAM_B_FREQ){
-					ignoredFrequencies[TEAM_A_FREQ] = false;
-					transmitter_setFrequencyNumber(TEAM_B_FREQ);
-				}
-				detector_init(ignoredFrequencies);
-				detector_ignoreAllHits(true);
-				detector_clearHit();
-				detector(true);
-      			hitCount = 0;
-      			trigger_disable();
-				sound_setSound(sound_loseLife_e);
-				sound_startSound();
-                intervalTimer_start(INVINCIBILITY_TIMER);
-                while (intervalTimer_getTotalDurationInSeconds(INVINCIBILITY_TIMER) < INVINCIBILITY_DURATION) {
-                    //start 5 sec timer for invincibility
-					detector(true);
-        		}
-				if(transmitter_getFrequencyNumber() == TEAM_A_FREQ){
-					sound_playSound(sound_teamOne_e);
-				}
-				else if (transmitter_getFrequencyNumber() == TEAM_B_FREQ){
-					sound_playSound(sound_teamTwo_e);
-				}
-				while(sound_isBusy()){}
-				detector(true);
-				detector_clearHit();
-				detector_ignoreAllHits(false);
-			    trigger_enable();
-                intervalTimer_stop(INVINCIBILITY_TIMER);
-                intervalTimer_reset(INVINCIBILITY_TIMER);
-
-	        }
-			intervalTimer_start(HEALTH_REGEN_TIMER);
-		}
+  gamePhase = game_intro_st;
+  hitCount = 0;
+  reloadTimerRunning = false;
+  soundQueueHead = 0;
+  soundQueueCount = 0;
+  queuedSoundPlaying = false;
+
+  display_fillScreen(DISPLAY_BLACK);
+  display_setTextColorBg(DISPLAY_WHITE, DISPLAY_BLACK);
+  display_setTextSize(STATUS_TEXT_SIZE);
+  shownLives = STATUS_NOT_SHOWN;
+  shownHealth = STATUS_NOT_SHOWN;
+  shownAmmo = STATUS_NOT_SHOWN;
 
+  scheduler_init(true);
+  scheduler_addTask("rules", rulesTask);
+  scheduler_addTask("sound", runningModes_soundTask);
+  scheduler_addTask("display", runningModes_displayTask);
+  scheduler_setEventHandler(handler);
+}
+
+// Two-team rules task: shots, reloads and hits while playing.
+static void runningModes_twoTeamsRulesTask() {
+  if (gamePhase != game_playing_st)
+    return;
+  runningModes_gunRules();
+  if (detector_hitDetected()) {	//Process a hit
+    ++hitCount;
+    detector_clearHit();
+    sound_playSound(hitSound);
+    if (hitCount == HEALTH) { //Lost a life, reset hit count, play lose life sound, disable trigger, start invincibility timer
+      --lifeCount;
+      detector_ignoreAllHits(true);
+      detector_clearHit();
+      sound_playSound(sound_loseLife_e);
+      hitCount = 0;
+      trigger_disable();
+      if (lifeCount > 0) {
+        virtualTimer_startOneShot(invincibilityTimer, INVINCIBILITY_DURATION);
+        gamePhase = game_invincible_st;
+      } else {
+        sound_stopSound(); // Game over sound, right away.
+        runningModes_queueSound(sound_gameOver_e, GAME_EVENT_GAME_OVER);
+        gamePhase = game_over_st;
+      }
+    }
+  }
+}
+
+// Two-team event handler.
+static void runningModes_twoTeamsEvent(scheduler_event_t event, uint32_t argument) {
+  (void)argument;
+  switch (event) {
+  case GAME_EVENT_INTRO_DONE:
+    runningModes_beginPlay();
+    break;
+  case GAME_EVENT_INVINCIBILITY_OVER:
+    runningModes_respawn();
+    break;
+  case GAME_EVENT_GAME_OVER:
+    hitLedTimer_turnLedOff();    // Save power :-)
+    printf("Two-team mode terminated after detecting %d shots.\n", hitCount);
+    scheduler_printReport();
+    //Continuously tell the user to return to base until they get annoyed and shut the backpack off
+    runningModes_queueSound(sound_returnToBase_e, GAME_EVENT_RETURN_TO_BASE);
+    break;
+  case GAME_EVENT_RETURN_TO_BASE:
+    virtualTimer_startOneShot(endSoundTimer, END_SOUND_DURATION); //1 sec of silence
+    break;
+  case GAME_EVENT_SILENCE_OVER:
+    runningModes_queueSound(sound_returnToBase_e, GAME_EVENT_RETURN_TO_BASE);
+    break;
+  default:
+    break;
+  }
+}
+
+//Two team mode, 3 lives, 5 hits per life
+void runningModes_twoTeams() {
+  shotSound = sound_gunFire_e;
+  hitSound = sound_hit_e;
+  lifeCount = LIVES;
+  livesCounted = true;
+  runningModes_startGame(runningModes_twoTeamsRulesTask, runningModes_twoTeamsEvent);
+  runningModes_queueSound(sound_gameStart_e, GAME_EVENT_INTRO_DONE); //Gameboy start sound
+
+  scheduler_run(); // The game, runs until the backpack is shut off.
+
+  interrupts_disableArmInts(); // Done with game loop, disable the interrupts.
+}
+
+// Creative rules task: shots, reloads and hits while playing. Losing all
+// health switches the player to the team of whoever took the last shot.
+static void runningModes_creativeRulesTask() {
+  if (gamePhase != game_playing_st)
+    return;
+  runningModes_gunRules();
+  if (detector_hitDetected()) {	//Process a hit
+    virtualTimer_stop(healthRegenTimer);
+    ++hitCount;
+    detector_clearHit();
+    sound_playSound(hitSound);
+    if (hitCount == HEALTH) { //Lost a life, reset hit count, play lose life sound, disable trigger, start invincibility timer
+      transmitter_setFrequencyNumber(detector_getFrequencyNumberOfLastHit());
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        ignoredFrequencies[i] = true;
+      if (transmitter_getFrequencyNumber() == TEAM_A_FREQ) {
+        ignoredFrequencies[TEAM_B_FREQ] = false;
+        transmitter_setFrequencyNumber(TEAM_A_FREQ);
+      }
+      else if (transmitter_getFrequencyNumber() == TEAM_B_FREQ) {
+        ignoredFrequencies[TEAM_A_FREQ] = false;
+        transmitter_setFrequencyNumber(TEAM_B_FREQ);
+      }
+      detector_init(ignoredFrequencies);
+      detector_ignoreAllHits(true);
+      detector_clearHit();
+      hitCount = 0;
+      trigger_disable();
+      sound_playSound(sound_loseLife_e);
+      virtualTimer_startOneShot(invincibilityTimer, INVINCIBILITY_DURATION);
+      gamePhase = game_invincible_st;
+      scheduler_printReport();
+    } else {
+      virtualTimer_startPeriodic(healthRegenTimer, HEALTH_REGEN_DURATION);
+    }
   }
+}
+
+// Creative event handler.
+static void runningModes_creativeEvent(scheduler_event_t event, uint32_t argument) {
+  (void)argument;
+  switch (event) {
+  case GAME_EVENT_INTRO_DONE:
+    runningModes_beginPlay();
+    break;
+  case GAME_EVENT_HEALTH_REGEN: //Periodic, one hit healed every HEALTH_REGEN_DURATION without a hit
+    if (gamePhase == game_playing_st && hitCount > 0) {
+      hitCount--;
+      sound_playSound(sound_gameStart_e); //Gameboy start sound
+    }
+    break;
+  case GAME_EVENT_INVINCIBILITY_OVER: //Announce the team before coming back
+    if (transmitter_getFrequencyNumber() == TEAM_A_FREQ)
+      runningModes_queueSound(sound_teamOne_e, GAME_EVENT_RESPAWNED);
+    else
+      runningModes_queueSound(sound_teamTwo_e, GAME_EVENT_RESPAWNED);
+    gamePhase = game_respawning_st;
+    break;
+  case GAME_EVENT_RESPAWNED:
+    runningModes_respawn();
+    virtualTimer_startPeriodic(healthRegenTimer, HEALTH_REGEN_DURATION);
+    break;
+  default:
+    break;
+  }
+}
+
+void runningModes_creativeProject() {
+  shotSound = sound_newShot_e;
+  hitSound = sound_robloxOof_e;
+  livesCounted = false;
+  runningModes_startGame(runningModes_creativeRulesTask, runningModes_creativeEvent);
+  runningModes_queueSound(sound_johnCena_e, GAME_EVENT_NONE);
+  runningModes_queueSound(sound_oneSecondSilence_e, GAME_EVENT_NONE);
+  if (transmitter_getFrequencyNumber() == TEAM_A_FREQ)
+    runningModes_queueSound(sound_teamOne_e, GAME_EVENT_INTRO_DONE);
+  else
+    runningModes_queueSound(sound_teamTwo_e, GAME_EVENT_INTRO_DONE);
+
+  scheduler_run(); // The game, runs until the backpack is shut off.
 
   interrupts_disableArmInts(); // Done with game loop, disable the interrupts.
 }
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include "scheduler.h"
+#include "detector.h"
+#include "filter.h"
+#include "idle.h"
+#include "isr.h"
+#include "sound.h"
+#include "timebase.h"
+#include "virtualTimer.h"
+
+#define TICKS_PER_US (TIMEBASE_TICKS_PER_SECOND / 1000000)
+#define TEST_MAX_BACKLOG_FRAMES (2 * ISR_ADC_BLOCK_FRAMES)
+#define TEST_SOUND_DONE_EVENT 0
+
+// One queued event.
+typedef struct {
+	scheduler_event_t event;
+	uint32_t argument;
+} scheduler_queuedEvent_t;
+
+// One task.
+typedef struct {
+	const char *name;
+	scheduler_task_t function;
+} scheduler_taskInfo_t;
+
+static scheduler_taskInfo_t tasks[SCHEDULER_MAX_TASKS];
+static uint8_t taskCount;
+static scheduler_eventHandler_t eventHandler;
+static scheduler_queuedEvent_t eventQueue[SCHEDULER_EVENT_QUEUE_LENGTH];
+static uint8_t eventHead; // Index of the oldest event.
+static uint8_t eventCount;
+static bool detectorInterruptsEnabled;
+static bool stopRequested;
+
+static scheduler_stats_t stats;
+static uint32_t firstOverflowCount; // isr_getAdcOverflowCount() at scheduler_init().
+static uint64_t lastDetectorTicks;
+static bool detectorHasRun;
+
+// Returns the microseconds from start to now.
+static uint32_t scheduler_elapsedUs(uint64_t start, uint64_t now){
+	return (uint32_t)((now - start) / TICKS_PER_US);
+}
+
+// Removes every task, the handler and every queued event, and clears the measurements.
+void scheduler_init(bool interruptsCurrentlyEnabled){
+	taskCount = 0;
+	eventHandler = NULL;
+	eventHead = 0;
+	eventCount = 0;
+	detectorInterruptsEnabled = interruptsCurrentlyEnabled;
+	stopRequested = false;
+	stats = (scheduler_stats_t){0};
+	firstOverflowCount = isr_getAdcOverflowCount();
+	detectorHasRun = false;
+}
+
+// Adds a task, run after the ones already added.
+bool scheduler_addTask(const char *name, scheduler_task_t task){
+	if(taskCount == SCHEDULER_MAX_TASKS)
+		return false;
+	tasks[taskCount].name = name;
+	tasks[taskCount].function = task;
+	++taskCount;
+	return true;
+}
+
+// Sets the function events are handed to.
+void scheduler_setEventHandler(scheduler_eventHandler_t handler){
+	eventHandler = handler;
+}
+
+// Queues an event for the handler.
+bool scheduler_postEvent(scheduler_event_t event, uint32_t argument){
+	if(eventCount == SCHEDULER_EVENT_QUEUE_LENGTH){
+		++stats.droppedEventCount;
+		return false;
+	}
+	scheduler_queuedEvent_t *queued = &eventQueue[(eventHead + eventCount) % SCHEDULER_EVENT_QUEUE_LENGTH];
+	queued->event = event;
+	queued->argument = argument;
+	++eventCount;
+	return true;
+}
+
+// Runs detector() and records how long it has been since the last call and how much it found waiting.
+static void scheduler_serviceDetector(){
+	uint64_t now = timebase_readTicks();
+	if(detectorHasRun){
+		uint32_t interval = scheduler_elapsedUs(lastDetectorTicks, now);
+		if(interval > stats.maxDetectorIntervalUs)
+			stats.maxDetectorIntervalUs = interval;
+	}
+	lastDetectorTicks = now;
+	detectorHasRun = true;
+	uint32_t backlog = isr_adcBufferElementCount();
+	if(backlog > stats.maxAdcBacklogFrames)
+		stats.maxAdcBacklogFrames = backlog;
+	detector(detectorInterruptsEnabled);
+}
+
+// Hands the events queued before this call to the handler. Events the handler posts wait for the next pass.
+static void scheduler_dispatchEvents(){
+	uint8_t count = eventCount;
+	for(uint8_t i = 0; i < count; ++i){
+		scheduler_queuedEvent_t queued = eventQueue[eventHead];
+		eventHead = (eventHead + 1) % SCHEDULER_EVENT_QUEUE_LENGTH;
+		--eventCount;
+		++stats.eventCount;
+		if(eventHandler != NULL)
+			eventHandler(queued.event, queued.argument);
+	}
+}
+
+// Runs every task once and records the longest run of each.
+static void scheduler_runTasks(){
+	for(uint8_t i = 0; i < taskCount; ++i){
+		uint64_t start = timebase_readTicks();
+		tasks[i].function();
+		uint32_t length = scheduler_elapsedUs(start, timebase_readTicks());
+		if(length > stats.maxTaskUs[i])
+			stats.maxTaskUs[i] = length;
+	}
+}
+
+// Runs one pass: detector, timers, events, tasks, then sleep if idle.
+void scheduler_runOnce(){
+	scheduler_serviceDetector();
+	virtualTimer_service();
+	scheduler_dispatchEvents();
+	scheduler_runTasks();
+	++stats.passCount;
+	idle_sleepIfIdle();
+}
+
+// Runs passes until scheduler_stop() is called.
+void scheduler_run(){
+	stopRequested = false;
+	while(!stopRequested)
+		scheduler_runOnce();
+}
+
+// Makes scheduler_run() return at the end of the current pass.
+void scheduler_stop(){
+	stopRequested = true;
+}
+
+// Copies the measurements into stats.
+void scheduler_getStats(scheduler_stats_t *statsOut){
+	*statsOut = stats;
+	statsOut->adcOverflowCount = isr_getAdcOverflowCount() - firstOverflowCount;
+}
+
+// Prints the measurements to the console.
+void scheduler_printReport(){
+	scheduler_stats_t current;
+	scheduler_getStats(&current);
+	printf("scheduler: %lu passes, %lu events, %lu dropped\n", (unsigned long)current.passCount,
+		(unsigned long)current.eventCount, (unsigned long)current.droppedEventCount);
+	printf("detector: at most %lu us between calls, at most %lu frames waiting, %lu frames lost\n",
+		(unsigned long)current.maxDetectorIntervalUs, (unsigned long)current.maxAdcBacklogFrames,
+		(unsigned long)current.adcOverflowCount);
+	for(uint8_t i = 0; i < taskCount; ++i)
+		printf("task %s: at most %lu us\n", tasks[i].name, (unsigned long)current.maxTaskUs[i]);
+}
+
+/********************************** Test ************************************/
+
+static bool testSoundStarted;
+static bool testSoundDone;
+
+// Starts the sound on the first pass and posts an event once it has finished.
+static void scheduler_testSoundTask(){
+	if(!testSoundStarted){
+		sound_playSound(sound_gameStart_e);
+		testSoundStarted = true;
+	}
+	else if(!sound_isBusy() && !testSoundDone){
+		testSoundDone = true;
+		scheduler_postEvent(TEST_SOUND_DONE_EVENT, 0);
+	}
+}
+
+// Stops the scheduler once the sound has finished.
+static void scheduler_testEventHandler(scheduler_event_t event, uint32_t argument){
+	(void)argument;
+	if(event == TEST_SOUND_DONE_EVENT)
+		scheduler_stop();
+}
+
+// Compares busy-waiting on a sound with playing it through the scheduler.
+void scheduler_runTest(){
+	printf("Starting scheduler_runTest()\n");
+	bool ignored[FILTER_FREQUENCY_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+	detector_init(ignored);
+	sound_setVolume(SOUND_VOLUME_0);
+
+	// The old way: nothing runs until the sound is over.
+	uint32_t overflowBefore = isr_getAdcOverflowCount();
+	uint64_t start = timebase_readTicks();
+	detector(true);
+	sound_playSound(sound_gameStart_e);
+	while(sound_isBusy()){
+		idle_sleepUntilInterrupt();
+	}
+	uint32_t backlog = isr_adcBufferElementCount();
+	detector(true);
+	printf("busy-wait: %lu us between detector calls, %lu frames waiting, %lu frames lost\n",
+		(unsigned long)scheduler_elapsedUs(start, timebase_readTicks()), (unsigned long)backlog,
+		(unsigned long)(isr_getAdcOverflowCount() - overflowBefore));
+
+	// The scheduler: the detector runs every pass while the sound plays.
+	scheduler_init(true);
+	testSoundStarted = false;
+	testSoundDone = false;
+	scheduler_addTask("testSound", scheduler_testSoundTask);
+	scheduler_setEventHandler(scheduler_testEventHandler);
+	scheduler_run();
+	scheduler_printReport();
+
+	scheduler_stats_t result;
+	scheduler_getStats(&result);
+	bool passed = result.maxAdcBacklogFrames <= TEST_MAX_BACKLOG_FRAMES && result.adcOverflowCount == 0;
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed scheduler_runTest()\n");
+}
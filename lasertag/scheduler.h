@@ -0,0 +1,96 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cooperative run-to-completion scheduler for the game modes. Every pass of
+// scheduler_runOnce() does the same things in the same order:
+//   1. runs detector(), so the ADC buffer is drained on every pass,
+//   2. runs virtualTimer_service(), whose callbacks may post events,
+//   3. hands each event waiting in the queue to the event handler,
+//   4. runs every task once, in the order they were added,
+//   5. sleeps until the next interrupt if the ADC buffer is empty.
+// Nothing may wait for anything: a task or handler does what it can right now
+// and returns, and anything that has to happen later is a virtual timer or an
+// event. The time between two detector() calls is then one pass, and the
+// scheduler measures it, with the ADC backlog the detector found, so that
+// the guarantee can be checked, see scheduler_printReport().
+//
+// Events are posted from the main loop only (tasks, handlers and virtual
+// timer callbacks), never from the ISR. What an event means is up to the
+// caller; the scheduler only queues it with its argument.
+
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_EVENT_QUEUE_LENGTH 32
+
+typedef uint8_t scheduler_event_t; // Meaning chosen by the caller.
+
+// A task, run once a pass. It must return without waiting.
+typedef void (*scheduler_task_t)();
+
+// Handles one event. It must return without waiting.
+typedef void (*scheduler_eventHandler_t)(scheduler_event_t event,
+                                         uint32_t argument);
+
+// Scheduler measurements since scheduler_init().
+typedef struct {
+  uint32_t passCount;
+  uint32_t eventCount;
+  uint32_t droppedEventCount;         // Posted while the queue was full.
+  uint32_t maxDetectorIntervalUs;     // Longest time between detector() calls.
+  uint32_t maxAdcBacklogFrames;       // Most frames detector() found waiting.
+  uint32_t adcOverflowCount;          // Frames the ISR lost for want of room.
+  uint32_t maxTaskUs[SCHEDULER_MAX_TASKS]; // Longest single run of each task.
+} scheduler_stats_t;
+
+// Removes every task, the handler and every queued event, and clears the
+// measurements. interruptsCurrentlyEnabled is passed on to detector().
+void scheduler_init(bool interruptsCurrentlyEnabled);
+
+// Adds a task, run after the ones already added. name is kept, not copied,
+// and is only used for printing. Returns false if SCHEDULER_MAX_TASKS are
+// already in use.
+bool scheduler_addTask(const char *name, scheduler_task_t task);
+
+// Sets the function events are handed to. NULL drops them.
+void scheduler_setEventHandler(scheduler_eventHandler_t handler);
+
+// Queues an event for the handler, which sees it on this pass if it was
+// posted before step 3, or the next pass otherwise. Returns false, and counts
+// the event as dropped, if the queue is full.
+bool scheduler_postEvent(scheduler_event_t event, uint32_t argument);
+
+// Runs one pass, see above.
+void scheduler_runOnce();
+
+// Runs passes until scheduler_stop() is called from a task or handler.
+void scheduler_run();
+
+// Makes scheduler_run() return at the end of the current pass.
+void scheduler_stop();
+
+// Copies the measurements into stats.
+void scheduler_getStats(scheduler_stats_t *stats);
+
+// Prints the measurements to the console.
+void scheduler_printReport();
+
+// Plays the game start sound twice: once the old way, busy-waiting on
+// sound_isBusy() without running the detector, as the game modes did, and
+// once through the scheduler, with a task that starts it and an event when it
+// ends. Prints the longest detector interval and the ADC backlog and overflow
+// of each. Passes if the scheduler never let more than two blocks of samples
+// wait and lost none. Needs live interrupts, so it is meant for the board;
+// call it with interrupts running.
+void scheduler_runTest();
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,206 @@
+#include <math.h>
+#include <stdio.h>
+#include "shotCode.h"
+#include "testUtils.h"
+
+#define CRC_POLYNOMIAL 0x3 // x^4 + x + 1, the top bit implied.
+#define CRC_TOP_BIT (1 << (SHOTCODE_CRC_BITS - 1))
+#define CRC_MASK ((1 << SHOTCODE_CRC_BITS) - 1)
+#define PLAYER_ID_MASK ((1 << SHOTCODE_PLAYER_ID_BITS) - 1)
+#define DAMAGE_MASK ((1 << SHOTCODE_DAMAGE_BITS) - 1)
+#define LEAD_IN_SNAPSHOTS (SHOTCODE_LEAD_IN_SLOTS * SHOTCODE_SNAPSHOTS_PER_SLOT)
+#define DECODED_SNAPSHOTS (SHOTCODE_FRAME_SNAPSHOTS + SHOTCODE_TAIL_SNAPSHOTS) // From the frame start.
+#define SETTLED_SNAPSHOTS 3 // At the end of the lead-in, averaged for the settled envelope.
+#define EDGE_SMOOTHING 3 // Snapshots averaged to find the lead-in.
+#define EDGE_THRESHOLD 0.3 // Of the strongest smoothed envelope.
+#define EDGE_MARGIN 2 // Snapshots the frame is taken to start before the edge.
+
+#define TEST_PLAYER_COUNT (1 << SHOTCODE_PLAYER_ID_BITS)
+#define TEST_NOISE_ENERGY 0.1 // Up to this per snapshot, against 1 for the settled envelope.
+#define TEST_FRAME_OFFSET 17 // Snapshots from the first to the frame start.
+#define TEST_ENVELOPE_TIME_CONSTANT 4.0 // Snapshots, about what the IIR filters show.
+
+// Returns the CRC-4 of the payload bits, most significant first.
+static uint8_t shotCode_crc(uint8_t payloadBits){
+	uint8_t crc = 0;
+	for(int8_t i = SHOTCODE_PAYLOAD_BITS - 1; i >= 0; --i){
+		bool feedback = ((payloadBits >> i) & 1) ^ ((crc & CRC_TOP_BIT) != 0);
+		crc = (crc << 1) & CRC_MASK;
+		if(feedback)
+			crc ^= CRC_POLYNOMIAL;
+	}
+	return crc;
+}
+
+// Returns the code word of a payload: the payload bits, then the CRC.
+uint16_t shotCode_encode(shotCode_payload_t payload){
+	uint8_t payloadBits = ((payload.playerId & PLAYER_ID_MASK) << SHOTCODE_DAMAGE_BITS) | (payload.damage & DAMAGE_MASK);
+	return ((uint16_t)payloadBits << SHOTCODE_CRC_BITS) | shotCode_crc(payloadBits);
+}
+
+// Returns the slots of a code word as a bit mask, bit k set if slot k is on.
+uint32_t shotCode_getSlotMask(uint16_t word){
+	uint32_t mask = (1 << SHOTCODE_LEAD_IN_SLOTS) - 1;
+	for(uint16_t bit = 0; bit < SHOTCODE_WORD_BITS; ++bit){
+		if((word >> (SHOTCODE_WORD_BITS - 1 - bit)) & 1)
+			mask |= 1 << (SHOTCODE_LEAD_IN_SLOTS + bit);
+	}
+	return mask;
+}
+
+// Turns the power snapshots into the envelope of the IIR output in each
+// snapshot: the square root of the energy received in it. The energy is the
+// rise of the power plus the energy that left the window, which was received a
+// window earlier, and nothing during the quiet window before the first.
+static void shotCode_getEnvelope(const double powerSnapshots[], double envelope[]){
+	double energy[SHOTCODE_DECODE_SNAPSHOTS];
+	for(uint16_t i = 0; i < SHOTCODE_DECODE_SNAPSHOTS; ++i){
+		energy[i] = powerSnapshots[i + 1] - powerSnapshots[i];
+		if(i >= SHOTCODE_WINDOW_SNAPSHOTS)
+			energy[i] += energy[i - SHOTCODE_WINDOW_SNAPSHOTS];
+		envelope[i] = (energy[i] > 0.0) ? sqrt(energy[i]) : 0.0;
+	}
+}
+
+// Returns the snapshot a little before the envelope first reaches
+// EDGE_THRESHOLD of its peak, or -1 if the frame would not fit after it.
+static int16_t shotCode_findFrameStart(const double envelope[]){
+	double smoothed[SHOTCODE_DECODE_SNAPSHOTS - EDGE_SMOOTHING + 1];
+	double peak = 0.0;
+	for(uint16_t i = 0; i + EDGE_SMOOTHING <= SHOTCODE_DECODE_SNAPSHOTS; ++i){
+		smoothed[i] = 0.0;
+		for(uint16_t k = 0; k < EDGE_SMOOTHING; ++k)
+			smoothed[i] += envelope[i + k];
+		if(smoothed[i] > peak)
+			peak = smoothed[i];
+	}
+	for(uint16_t i = EDGE_MARGIN; i + DECODED_SNAPSHOTS <= SHOTCODE_DECODE_SNAPSHOTS + EDGE_MARGIN; ++i){
+		if(smoothed[i] > EDGE_THRESHOLD * peak)
+			return i - EDGE_MARGIN;
+	}
+	return -1;
+}
+
+// Returns the envelope at lag snapshots after a slot turns on and stays on,
+// read off the lead-in.
+static double shotCode_stepResponse(const double step[], int16_t lag){
+	if(lag < 0)
+		return 0.0;
+	return step[(lag < LEAD_IN_SNAPSHOTS) ? lag : LEAD_IN_SNAPSHOTS];
+}
+
+// Returns the envelope of slot alone at snapshot i of the frame.
+static double shotCode_slotResponse(const double step[], int16_t i, uint16_t slot){
+	return shotCode_stepResponse(step, i - slot * SHOTCODE_SNAPSHOTS_PER_SLOT)
+		- shotCode_stepResponse(step, i - (slot + 1) * SHOTCODE_SNAPSHOTS_PER_SLOT);
+}
+
+// Finds the lead-in and decodes the bits after it. The lead-in gives the step
+// response of the IIR envelope; with it, each bit is decided by correlating
+// what the slots decided so far do not explain with the response of the bit's
+// slot, over the slot. Reaching into the next slot lets its bit in as well.
+shotCode_status_t shotCode_decode(const double powerSnapshots[], uint16_t *word, shotCode_payload_t *payload){
+	double envelope[SHOTCODE_DECODE_SNAPSHOTS];
+	shotCode_getEnvelope(powerSnapshots, envelope);
+	int16_t start = shotCode_findFrameStart(envelope);
+	*word = 0;
+	if(start < 0)
+		return shotCode_invalid_e;
+	const double *frame = &envelope[start];
+	double step[LEAD_IN_SNAPSHOTS + 1];	//The last entry holds the settled envelope
+	step[LEAD_IN_SNAPSHOTS] = 0.0;
+	for(uint16_t i = 0; i < LEAD_IN_SNAPSHOTS; ++i){
+		step[i] = frame[i];
+		if(i >= LEAD_IN_SNAPSHOTS - SETTLED_SNAPSHOTS)
+			step[LEAD_IN_SNAPSHOTS] += frame[i] / SETTLED_SNAPSHOTS;
+	}
+	double explained[DECODED_SNAPSHOTS];
+	for(uint16_t i = 0; i < DECODED_SNAPSHOTS; ++i)
+		explained[i] = shotCode_stepResponse(step, i) - shotCode_stepResponse(step, i - LEAD_IN_SNAPSHOTS);
+	uint16_t bits = 0;
+	for(uint16_t slot = SHOTCODE_LEAD_IN_SLOTS; slot < SHOTCODE_SLOT_COUNT; ++slot){
+		uint16_t first = slot * SHOTCODE_SNAPSHOTS_PER_SLOT;
+		double correlation = 0.0;
+		double slotEnergy = 0.0;
+		for(uint16_t i = first; i < first + SHOTCODE_SNAPSHOTS_PER_SLOT; ++i){
+			double response = shotCode_slotResponse(step, i, slot);
+			correlation += (frame[i] - explained[i]) * response;
+			slotEnergy += response * response;
+		}
+		bool on = correlation > slotEnergy / 2;
+		bits = (bits << 1) | on;
+		if(on){
+			for(uint16_t i = first; i < DECODED_SNAPSHOTS; ++i)
+				explained[i] += shotCode_slotResponse(step, i, slot);
+		}
+	}
+	*word = bits;
+	uint8_t payloadBits = bits >> SHOTCODE_CRC_BITS;
+	if(shotCode_crc(payloadBits) != (bits & CRC_MASK))
+		return shotCode_invalid_e;
+	payload->playerId = payloadBits >> SHOTCODE_DAMAGE_BITS;
+	payload->damage = payloadBits & DAMAGE_MASK;
+	return shotCode_valid_e;
+}
+
+// Fills powerSnapshots with the power of a frequency receiving the frame of
+// word from snapshot TEST_FRAME_OFFSET on, its envelope following the slots
+// with TEST_ENVELOPE_TIME_CONSTANT, plus up to TEST_NOISE_ENERGY of noise per
+// snapshot from seed, which also runs in the window before the first.
+static void shotCode_makeTestSnapshots(uint16_t word, uint32_t seed, double powerSnapshots[]){
+	uint32_t mask = shotCode_getSlotMask(word);
+	double received[SHOTCODE_WINDOW_SNAPSHOTS + SHOTCODE_DECODE_SNAPSHOTS + 1];	//Running energy
+	double envelope = 0.0;
+	received[0] = 0.0;
+	for(int16_t i = -SHOTCODE_WINDOW_SNAPSHOTS; i < SHOTCODE_DECODE_SNAPSHOTS; ++i){
+		int16_t slot = (i - TEST_FRAME_OFFSET) / SHOTCODE_SNAPSHOTS_PER_SLOT;
+		bool on = i >= TEST_FRAME_OFFSET && slot < SHOTCODE_SLOT_COUNT && ((mask >> slot) & 1);
+		envelope += ((on ? 1.0 : 0.0) - envelope) / TEST_ENVELOPE_TIME_CONSTANT;
+		double energy = envelope * envelope;
+		if(seed != 0)
+			energy += TEST_NOISE_ENERGY * (testUtils_random(&seed) & 0xFF) / 0xFF;
+		received[i + SHOTCODE_WINDOW_SNAPSHOTS + 1] = received[i + SHOTCODE_WINDOW_SNAPSHOTS] + energy;
+	}
+	for(uint16_t i = 0; i <= SHOTCODE_DECODE_SNAPSHOTS; ++i)
+		powerSnapshots[i] = received[i + SHOTCODE_WINDOW_SNAPSHOTS] - received[i];
+}
+
+// Checks encoding, slot masks and the decoding of ideal and noisy frames.
+bool shotCode_runTest(){
+	printf("Starting shotCode_runTest()\n");
+	bool passed = true;
+	double powerSnapshots[SHOTCODE_DECODE_SNAPSHOTS + 1];
+	for(uint16_t id = 0; id < TEST_PLAYER_COUNT; ++id){
+		for(uint8_t damage = 0; damage <= DAMAGE_MASK; ++damage){
+			shotCode_payload_t sent = {id, damage};
+			shotCode_payload_t received = {0, 0};
+			uint16_t word = shotCode_encode(sent);
+			uint16_t receivedWord;
+			uint32_t mask = shotCode_getSlotMask(word);
+			uint32_t expected = (1 << SHOTCODE_LEAD_IN_SLOTS) - 1;
+			for(uint16_t bit = 0; bit < SHOTCODE_WORD_BITS; ++bit)	//Most significant bit first
+				expected |= ((word >> (SHOTCODE_WORD_BITS - 1 - bit)) & 1) << (SHOTCODE_LEAD_IN_SLOTS + bit);
+			if(mask != expected){
+				printf("slot mask %x of word %x is wrong\n", mask, word);
+				passed = false;
+			}
+			for(uint32_t seed = 0; seed < 2; ++seed){	//Ideal, then noisy
+				shotCode_makeTestSnapshots(word, seed * (word + 1), powerSnapshots);
+				shotCode_status_t status = shotCode_decode(powerSnapshots, &receivedWord, &received);
+				if(status != shotCode_valid_e || receivedWord != word || received.playerId != id || received.damage != damage){
+					printf("player %u damage %u (word %x) decoded as %x\n", id, damage, word, receivedWord);
+					passed = false;
+				}
+			}
+			uint16_t corrupted = word ^ (1 << (id % SHOTCODE_WORD_BITS));	//Any single-bit error is caught by the CRC
+			shotCode_makeTestSnapshots(corrupted, 0, powerSnapshots);
+			if(shotCode_decode(powerSnapshots, &receivedWord, &received) != shotCode_invalid_e){
+				printf("word %x with a flipped bit passed the CRC\n", word);
+				passed = false;
+			}
+		}
+	}
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed shotCode_runTest()\n");
+	return passed;
+}
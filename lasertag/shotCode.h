@@ -0,0 +1,91 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SHOTCODE_H_
+#define SHOTCODE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "filter.h"
+
+// A shot code carries a player ID and damage inside the 200 ms shot, so
+// identity no longer stops at the 10 frequencies. The shot is cut into
+// SHOTCODE_SLOT_COUNT slots, and the transmitter keys its square wave on or off
+// in each slot: SHOTCODE_LEAD_IN_SLOTS slots that are always on, then one slot
+// per bit of the code word, most significant first, on for a 1. The code word
+// is the payload followed by a CRC-4 of it.
+//
+// The detector needs nothing new per sample to receive it. The power of a
+// frequency is the energy of its last 200 ms of IIR output, so the energy
+// received between two snapshots of the power is the rise of the power plus
+// what left the window, which was received a window earlier. The detector
+// snapshots the power of every frequency SHOTCODE_SNAPSHOTS_PER_SLOT times a
+// slot; after a hit, shotCode_decode() turns the snapshots of the hit
+// frequency back into the energy of each snapshot, and its square root into
+// the envelope of the IIR output. The IIR filters are too narrow to follow a
+// slot by themselves (their envelope takes about 25 ms to rise), so the
+// decoder learns their step response from the lead-in and decides the bits in
+// order, taking the response to the slots already decided out of the envelope
+// first (decision feedback).
+
+#define SHOTCODE_PLAYER_ID_BITS 6 // 64 players.
+#define SHOTCODE_DAMAGE_BITS 2
+#define SHOTCODE_PAYLOAD_BITS (SHOTCODE_PLAYER_ID_BITS + SHOTCODE_DAMAGE_BITS)
+#define SHOTCODE_CRC_BITS 4
+#define SHOTCODE_WORD_BITS (SHOTCODE_PAYLOAD_BITS + SHOTCODE_CRC_BITS)
+#define SHOTCODE_LEAD_IN_SLOTS 3 // Long enough for the IIR envelope to settle.
+#define SHOTCODE_SLOT_COUNT (SHOTCODE_LEAD_IN_SLOTS + SHOTCODE_WORD_BITS)
+#define SHOTCODE_SLOT_TICKS 1200 // 12 ms; 15 slots fill 180 ms of the shot.
+
+// Power snapshots per slot, and decimated samples between snapshots.
+#define SHOTCODE_SNAPSHOTS_PER_SLOT 6
+#define SHOTCODE_SNAPSHOT_DECIMATED_SAMPLES 20
+#define SHOTCODE_WINDOW_SNAPSHOTS                                              \
+  (FILTER_INPUT_PULSE_WIDTH / SHOTCODE_SNAPSHOT_DECIMATED_SAMPLES)
+#define SHOTCODE_FRAME_SNAPSHOTS (SHOTCODE_SLOT_COUNT * SHOTCODE_SNAPSHOTS_PER_SLOT)
+// How far before the hit decision the frame may start, in snapshots.
+#define SHOTCODE_SEARCH_SNAPSHOTS 50
+// Snapshots past the end of the frame to wait for the IIR filters to ring out.
+#define SHOTCODE_TAIL_SNAPSHOTS 10
+// Snapshots shotCode_decode() needs: the search range, the frame and its tail.
+#define SHOTCODE_DECODE_SNAPSHOTS                                              \
+  (SHOTCODE_SEARCH_SNAPSHOTS + SHOTCODE_FRAME_SNAPSHOTS + SHOTCODE_TAIL_SNAPSHOTS)
+
+// What a shot carries.
+typedef struct {
+  uint8_t playerId; // Below 1 << SHOTCODE_PLAYER_ID_BITS.
+  uint8_t damage;   // Below 1 << SHOTCODE_DAMAGE_BITS.
+} shotCode_payload_t;
+
+// Where the payload of the last hit stands.
+typedef enum {
+  shotCode_none_e,    // No hit, or shot codes are off.
+  shotCode_pending_e, // The frame has not been received yet.
+  shotCode_valid_e,   // Decoded and the CRC matched.
+  shotCode_invalid_e  // Decoded but the CRC did not match.
+} shotCode_status_t;
+
+// Returns the code word of a payload: the payload bits, then the CRC.
+uint16_t shotCode_encode(shotCode_payload_t payload);
+
+// Returns the slots of a code word as a bit mask, bit k set if slot k is on.
+uint32_t shotCode_getSlotMask(uint16_t word);
+
+// Decodes a frame from SHOTCODE_DECODE_SNAPSHOTS + 1 power snapshots of the
+// hit frequency, oldest first, taken at least SHOTCODE_SEARCH_SNAPSHOTS before
+// the hit was decided and SHOTCODE_FRAME_SNAPSHOTS + SHOTCODE_TAIL_SNAPSHOTS
+// after. The frequency must have been quiet for a power window before the
+// first snapshot. Stores the received code word in *word and, if its CRC
+// matches, the payload in *payload. Returns the status.
+shotCode_status_t shotCode_decode(const double powerSnapshots[], uint16_t *word,
+                                  shotCode_payload_t *payload);
+
+// Checks encoding, slot masks and the decoding of ideal and noisy frames.
+bool shotCode_runTest();
+
+#endif /* SHOTCODE_H_ */
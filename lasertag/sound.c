@@ -8,6 +8,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 */
 
 #include "sound.h"
+#include "eventLog.h"
+#include "fsm.h"
 #include "interrupts.h" // Just for sound_runTest().
 #include "sounds/bcfire01_48k.wav.h"
 #include "sounds/gameBoyStartup.wav.h"
@@ -74,12 +76,23 @@ static uint32_t sound_sampleCount; // Number of samples in this sound.
 // Keep track of the current volume setting.
 static sound_volume_t sound_currentVolume = sound_minimumVolume_e;
 
-// Sound state-machine states.
-typedef enum {
-  sound_init_st, // Waiting for sound_init() to be invoked.
-  sound_wait_st, // Waiting for enable to play sound.
-  sound_play_st  // In the process of playing the sound.
-} sound_st_t;
+// Sound state-machine states: sound_init_st waits for sound_init() to be
+// invoked, sound_wait_st waits for enable to play sound and sound_play_st is
+// in the process of playing the sound. The work is done in the transitions:
+// each tick in sound_play_st adds as many samples as will fit in the FIFO.
+#define SOUND_STATES(S)                                                        \
+  S(sound_init_st, fsm_noAction)                                               \
+  S(sound_wait_st, fsm_noAction)                                               \
+  S(sound_play_st, fsm_noAction)
+#define SOUND_TRANSITIONS(T)                                                   \
+  T(sound_init_st, sound_initialized, sound_wait_st, fsm_noAction)             \
+  T(sound_wait_st, sound_playRequested, sound_play_st, sound_startPlaying)     \
+  T(sound_play_st, sound_fifoFilledToEnd, sound_wait_st, sound_finishPlaying)
+
+FSM_DECLARE_STATES(sound_st_t, SOUND_STATES);
+
+// Next sample of the sound to add to the FIFO.
+static uint32_t sound_arrayIndex = 0;
 
 // Reset the TX FIFO.
 void sound_resetTxFifo() {
@@ -123,8 +136,8 @@ sound_status_t sound_init() {
 // Standard tick function.
 static sound_st_t currentState = sound_init_st;
 
-// This is a debug state print routine. It will print the names of the states
-// each time tick() is called. It only prints states if they are different than
+// This is a debug state print routine. It will log the names of the states
+// (see eventLog.h) each time tick() is called. It only prints states if they are different than
 // the previous state.
 void debugStatePrint() {
   static sound_st_t previousState;
@@ -140,72 +153,63 @@ void debugStatePrint() {
     switch (currentState) { // This prints messages based upon the state that
                             // you were in.
     case sound_init_st:
-      printf("sound_init_st\n");
+      eventLog_write(EVENTLOG_SOUND_INIT_ST, 0, 0);
       break;
     case sound_wait_st:
-      printf("sound_wait_st\n");
+      eventLog_write(EVENTLOG_SOUND_WAIT_ST, 0, 0);
       break;
     case sound_play_st:
-      printf("sound_play_st\n");
+      eventLog_write(EVENTLOG_SOUND_PLAY_ST, 0, 0);
       break;
     }
   }
 }
 
-void sound_tick() {
-  //  debugStatePrint();
-  static uint32_t arrayIndex = 0;
-  // Action switch statement.
-  switch (currentState) {
-  case sound_init_st:
-    // Does nothing.
-    break;
-  case sound_wait_st:
-    // Does nothing.
-    break;
-  case sound_play_st:
-    // Does nothing.
-    break;
+// Returns true once sound_init() has been called.
+static bool sound_initialized() { return sound_initFlag; }
+
+// Returns true if a sound should be played.
+static bool sound_playRequested() { return sound_playSoundFlag; }
+
+// Adds as many samples as will fit in the FIFO. Returns true once the sound
+// data are exhausted.
+static bool sound_fifoFilledToEnd() {
+  if (sound_array == NULL) {
+    eventLog_write(EVENTLOG_SOUND_ARRAY_NOT_SET, 0, 0);
+    return false;
   }
-  // Transistion switch statement.
-  switch (currentState) {
-  case sound_init_st:
-    if (sound_initFlag) {
-      currentState = sound_wait_st;
-    }
-    break;
-  case sound_wait_st:
-    if (sound_playSoundFlag) {
-      arrayIndex = 0;
-      currentState = sound_play_st;
-      sound_resetTxFifo();  // Reset the TX FIFO.
-      sound_enableTxFifo(); // Enable the TX FIFO, disable mute.
-    }
-    break;
-  case sound_play_st:
-    // Each time you enter this state, add as many samples as will fit in the
-    // FIFO.
-    if (sound_array == NULL) {
-      printf("ERROR, sound_tick: sound array has not been set.\n");
-      return;
-    }
-    // This while-loop continues to load sound-data into the FIFOs until it is
-    // full or the sound data are exhausted.
-    while (!(Xil_In32(AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG) &
-             0b0010)) { // while room in FIFO.
-      uint32_t sampleValue =
-          sound_array[arrayIndex] * sound_currentVolume; // Scale by volume.
-      sound_sendDataToBothChannels(
-          sampleValue); // Send the sound data to the left and right channels.
-      arrayIndex++;     // Go to next sample.
-      if (arrayIndex == sound_sampleCount) { // All done?
-        sound_playSoundFlag = false;         // Yes.
-        sound_disableTxFifo();               // Disable the TX FIFO.
-        currentState = sound_wait_st;        // Go back to the wait state.
-      }
-    }
-    break;
+  // This while-loop continues to load sound-data into the FIFOs until it is
+  // full or the sound data are exhausted.
+  while (!(Xil_In32(AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG) &
+           0b0010)) { // while room in FIFO.
+    uint32_t sampleValue =
+        sound_array[sound_arrayIndex] * sound_currentVolume; // Scale by volume.
+    sound_sendDataToBothChannels(
+        sampleValue); // Send the sound data to the left and right channels.
+    if (++sound_arrayIndex == sound_sampleCount) // All done?
+      return true;
   }
+  return false;
+}
+
+// Starts the sound from its first sample.
+static void sound_startPlaying() {
+  sound_arrayIndex = 0;
+  sound_resetTxFifo();  // Reset the TX FIFO.
+  sound_enableTxFifo(); // Enable the TX FIFO, disable mute.
+}
+
+// Done with the sound.
+static void sound_finishPlaying() {
+  sound_playSoundFlag = false; // Done playing.
+  sound_disableTxFifo();       // Disable the TX FIFO.
+}
+
+FSM_DEFINE_MACHINE(soundMachine, "sound", SOUND_STATES, SOUND_TRANSITIONS);
+
+void sound_tick() {
+  //  debugStatePrint();
+  FSM_TICK(soundMachine, SOUND_STATES, SOUND_TRANSITIONS, currentState);
 }
 
 // Returns true if the sound state machine is not back in its initial state.
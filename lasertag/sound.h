@@ -47,7 +47,7 @@ typedef enum {
   sound_loseLife_e,        // Sound made when you are hit enough times.
   sound_gameOver_e,        // Sound made when the game is over.
   sound_returnToBase_e,    // Remind the user that the game is over.
-  sound_oneSecondSilence_e // One second of silence.
+  sound_oneSecondSilence_e, // One second of silence.
 //Custom Sound Files here:
 	sound_teamOne_e,
 	sound_teamTwo_e,
@@ -69,7 +69,11 @@ typedef enum {
 // Must be called before using the sound state machine.
 sound_status_t sound_init();
 
-// Standard tick function.
+// Standard tick function. Invoked from the fast lane of isr_function(), every
+// 10 us tick, so each call only has to top up the I2S TX FIFO with about one
+// stereo sample. Once a millisecond would need 96 words of FIFO at 48 kHz,
+// and the hardware configuration does not say the axi_i2s FIFO holds that
+// many.
 void sound_tick();
 
 // Returns true if the sound state machine is not back in its initial state.
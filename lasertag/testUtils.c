@@ -0,0 +1,70 @@
+#include "testUtils.h"
+#include "filter.h"
+
+// The constants of the example rand() in the C standard.
+#define RANDOM_MULTIPLIER 1103515245
+#define RANDOM_INCREMENT 12345
+#define RANDOM_SHIFT 16
+#define NANOSECONDS_PER_MILLISECOND 1000000
+#define NANOSECONDS_PER_SECOND 1000000000
+
+// Advances the generator and returns its upper 16 bits.
+uint32_t testUtils_random(uint32_t *seed){
+	*seed = *seed * RANDOM_MULTIPLIER + RANDOM_INCREMENT;
+	return *seed >> RANDOM_SHIFT;
+}
+
+// Returns one sample of a noisy square wave on a player frequency.
+isr_AdcValue_t testUtils_squareWaveSample(uint32_t tick, uint16_t frequencyNumber, uint32_t *seed){
+	uint16_t period = filter_frequencyTickTable[frequencyNumber];
+	isr_AdcValue_t sample = ((tick % period) < period / 2) ? TEST_UTILS_HIGH_VALUE : TEST_UTILS_LOW_VALUE;
+	return sample + testUtils_random(seed) % TEST_UTILS_NOISE;
+}
+
+#ifndef ZYBO_BOARD
+// Adds a block of samples every millisecond until the producer is done.
+static void *testUtils_runAdcProducer(void *arg){
+	testUtils_adcProducer_t *producer = arg;
+	uint32_t seed = 1;
+	uint32_t tick = 0;
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	for(uint32_t ms = 0; ms < producer->milliseconds; ++ms){
+		for(uint32_t i = 0; i < ISR_ADC_BLOCK_FRAMES; ++i, ++tick)
+			isr_ctxAddDataToAdcBuffer(producer->adcSource, testUtils_squareWaveSample(tick, producer->frequencyNumber, &seed));
+		testUtils_addMilliseconds(&next, 1);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	atomic_store(&producer->done, true);
+	return NULL;
+}
+
+// Fills in a producer and starts its thread.
+bool testUtils_startAdcProducer(testUtils_adcProducer_t *producer, isr_t *adcSource, uint16_t frequencyNumber,
+		uint32_t milliseconds){
+	producer->adcSource = adcSource;
+	producer->frequencyNumber = frequencyNumber;
+	producer->milliseconds = milliseconds;
+	atomic_init(&producer->done, false);
+	return pthread_create(&producer->thread, NULL, testUtils_runAdcProducer, producer) == 0;
+}
+
+// Returns true once the producer has added all its blocks.
+bool testUtils_adcProducerDone(testUtils_adcProducer_t *producer){
+	return atomic_load(&producer->done);
+}
+
+// Waits for the producer thread to end.
+void testUtils_joinAdcProducer(testUtils_adcProducer_t *producer){
+	pthread_join(producer->thread, NULL);
+}
+
+// Advances a timespec by some milliseconds.
+void testUtils_addMilliseconds(struct timespec *time, uint32_t milliseconds){
+	time->tv_nsec += (long)milliseconds * NANOSECONDS_PER_MILLISECOND;
+	while(time->tv_nsec >= NANOSECONDS_PER_SECOND){
+		time->tv_nsec -= NANOSECONDS_PER_SECOND;
+		time->tv_sec++;
+	}
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TESTUTILS_H_
+#define TESTUTILS_H_
+#include <stdint.h>
+#include "isr.h"
+#ifndef ZYBO_BOARD
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+// Helpers shared by the test and benchmark routines.
+
+// ADC levels of the noisy square waves the tests play into a detector.
+#define TEST_UTILS_HIGH_VALUE 3000
+#define TEST_UTILS_LOW_VALUE 1000
+#define TEST_UTILS_NOISE 200 // Noise is 0 to TEST_UTILS_NOISE - 1.
+
+// Advances the generator in *seed and returns 16 pseudo-random bits. The
+// state belongs to the caller, so a run is repeatable and threads do not
+// share it the way they share rand()'s.
+uint32_t testUtils_random(uint32_t *seed);
+
+// Returns sample number tick of a square wave on player frequencyNumber,
+// between TEST_UTILS_LOW_VALUE and TEST_UTILS_HIGH_VALUE, plus noise drawn
+// from *seed.
+isr_AdcValue_t testUtils_squareWaveSample(uint32_t tick, uint16_t frequencyNumber, uint32_t *seed);
+
+#ifndef ZYBO_BOARD
+// A thread standing in for the 100 kHz timer interrupt: it adds one
+// ISR_ADC_BLOCK_FRAMES block of testUtils_squareWaveSample() values on
+// frequencyNumber to adcSource every millisecond of real time, for
+// milliseconds, then sets done. Host (emulator) builds only.
+typedef struct {
+  isr_t *adcSource;
+  uint16_t frequencyNumber;
+  uint32_t milliseconds;
+  atomic_bool done;
+  pthread_t thread;
+} testUtils_adcProducer_t;
+
+// Fills in a producer and starts its thread. Returns false if the thread
+// could not be started.
+bool testUtils_startAdcProducer(testUtils_adcProducer_t *producer, isr_t *adcSource, uint16_t frequencyNumber,
+                                uint32_t milliseconds);
+
+// Returns true once the producer has added all its blocks.
+bool testUtils_adcProducerDone(testUtils_adcProducer_t *producer);
+
+// Waits for the producer thread to end.
+void testUtils_joinAdcProducer(testUtils_adcProducer_t *producer);
+
+// Advances a CLOCK_MONOTONIC deadline by some milliseconds, for
+// clock_nanosleep(TIMER_ABSTIME) loops.
+void testUtils_addMilliseconds(struct timespec *time, uint32_t milliseconds);
+#endif
+
+#endif /* TESTUTILS_H_ */
@@ -0,0 +1,47 @@
+#include "timebase.h"
+#ifdef ZYBO_BOARD
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#else
+#include <time.h>
+#endif
+
+#define PMCR_ENABLE 0x1 // PMCR.E, enables the counters.
+#define PMCNTEN_CYCLE_COUNTER 0x80000000 // Cycle counter enable bit.
+
+#ifndef ZYBO_BOARD
+// Returns CLOCK_MONOTONIC in nanoseconds.
+static uint64_t timebase_readNanoseconds(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+
+// Starts the PMU cycle counter without resetting it.
+void timebase_init(){
+#ifdef ZYBO_BOARD
+	mtcp(XREG_CP15_PERF_MONITOR_CTRL, mfcp(XREG_CP15_PERF_MONITOR_CTRL) | PMCR_ENABLE);
+	mtcp(XREG_CP15_COUNT_ENABLE_SET, PMCNTEN_CYCLE_COUNTER);
+#endif
+}
+
+// Returns the free-running cycle count.
+uint32_t timebase_readCycles(){
+#ifdef ZYBO_BOARD
+	return mfcp(XREG_CP15_PERF_CYCLE_COUNTER);
+#else
+	return (uint32_t)timebase_readNanoseconds();
+#endif
+}
+
+// Returns the free-running time in TIMEBASE_TICKS_PER_SECOND ticks.
+uint64_t timebase_readTicks(){
+#ifdef ZYBO_BOARD
+	XTime now;
+	XTime_GetTime(&now);
+	return now;
+#else
+	return timebase_readNanoseconds();
+#endif
+}
@@ -0,0 +1,41 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+#include <stdint.h>
+
+// The clocks the profilers and loggers time things with, in one place.
+// Cycles are for short intervals inside the ISR: the Cortex-A9 PMU cycle
+// counter on the board, 32 bits, so they wrap after a few seconds and only
+// differences are meaningful. Ticks are for long intervals: the 64-bit ARM
+// global timer on the board. On a host both are clock_gettime() nanoseconds.
+
+#ifdef ZYBO_BOARD
+#include "xparameters.h"
+#include "xtime_l.h"
+#define TIMEBASE_CYCLES_PER_SECOND XPAR_CPU_CORTEXA9_CORE_CLOCK_FREQ_HZ
+#define TIMEBASE_TICKS_PER_SECOND COUNTS_PER_SECOND // Half the CPU clock.
+#else
+#define TIMEBASE_CYCLES_PER_SECOND 1000000000 // Nanoseconds.
+#define TIMEBASE_TICKS_PER_SECOND 1000000000ULL // Nanoseconds.
+#endif
+
+// Starts the PMU cycle counter without resetting it, so it is safe to call
+// again. Invoked from isr_init().
+void timebase_init();
+
+// Returns the free-running cycle count. Wraps; only differences are
+// meaningful.
+uint32_t timebase_readCycles();
+
+// Returns the free-running time in TIMEBASE_TICKS_PER_SECOND ticks.
+uint64_t timebase_readTicks();
+
+#endif /* TIMEBASE_H_ */
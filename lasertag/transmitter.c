@@ -8,24 +8,59 @@
 #include "transmitter.h"
 #include "filter.h"
 #include "interrupts.h"
+#include "eventLog.h"
+#include "shotCode.h"
+#include "intervalTimer.h"
+#include "fsm.h"
+#ifndef ZYBO_BOARD
+#include <math.h>
+#endif
 
 #define TRANSMITTER_ON_OFF_DURATION 20000
 #define TRANSMITTER_OUTPUT_PIN 13
 #define TRANSMITTER_HIGH_VALUE 1
 #define TRANSMITTER_LOW_VALUE 0
+#define DDS_PHASE_MODULUS 4294967296.0 // 2^32.
+#define DDS_OUTPUT_SHIFT 31 // The output is the accumulator MSB.
+#define DDS_HIGH_PHASE 0x80000000 // Start of the high half of a period.
 
 volatile static bool continuousMode = false;
 volatile static bool startRunning = false;
 volatile static bool testMode = false;
+volatile static bool ddsMode = false;
 static uint16_t transmitterFrequencyNum;
 static uint32_t counter;
 static uint32_t timeCounter;
+static uint32_t ddsPhase; // Phase accumulator, advanced every tick in DDS mode.
+static uint32_t ddsPhaseIncrement; // Of the current frequency.
+static uint8_t outputLevel; // Level of the square wave.
+static uint8_t pinLevel; // Last value written to the pin.
+volatile static bool shotCodeMode = false;
+static uint32_t shotSlotMask; // Slots of the shot code, see shotCode.h.
+volatile static uint32_t nextShotSlotMask; // Taken up at the start of a shot.
+static uint16_t shotSlot; // Slot of the shot code being sent.
+static uint16_t shotSlotTicksRemaining;
 
 // The transmitter state machine generates a square wave output at the chosen
 // frequency as set by transmitter_setFrequencyNumber(). The step counts for the
 // frequencies are provided in filter.h
+// The end of a shot is checked before the half-period edge, so a shot that
+// ends on an edge stops low instead of starting another half period.
+#define TRANSMITTER_STATES(S) \
+	S(init_st, fsm_noAction) \
+	S(off_st, fsm_noAction) \
+	S(high_st, transmitter_countHigh) \
+	S(low_st, transmitter_countLow)
+#define TRANSMITTER_TRANSITIONS(T) \
+	T(init_st, fsm_always, off_st, transmitter_stopOutput) \
+	T(off_st, transmitter_startRequested, high_st, transmitter_startShot) \
+	T(high_st, transmitter_shotOver, off_st, transmitter_stopOutput) \
+	T(high_st, transmitter_highHalfOver, low_st, transmitter_goLow) \
+	T(low_st, transmitter_shotOver, off_st, transmitter_logWaiting) \
+	T(low_st, transmitter_lowHalfOver, high_st, transmitter_goHigh)
 
-enum transmitter_st {init_st, off_st, high_st, low_st} currentState_trans = init_st;
+FSM_DECLARE_STATES(transmitter_st_t, TRANSMITTER_STATES);
+static transmitter_st_t currentState_trans = init_st;
 
 // Standard init function.
 void transmitter_init(){  
@@ -34,18 +69,40 @@ void transmitter_init(){
     timeCounter = 0;
 	startRunning = false;
 	continuousMode = false;
+	ddsPhase = 0;
+	ddsPhaseIncrement = transmitter_ddsPhaseIncrement((double)TRANSMITTER_TICK_RATE_HZ / filter_frequencyTickTable[transmitterFrequencyNum]);
     mio_init(false);  // false disables any debug printing if there is a system failure during init.
     mio_setPinAsOutput(TRANSMITTER_OUTPUT_PIN);  // Configure the signal direction of the pin to be an output.
+    transmitter_setShotPayload(0, 0);
+}
+
+// Writes the square wave to the pin, held low in the off slots of a shot code.
+static void transmitter_writePin(){
+	bool slotOn = !shotCodeMode || ((shotSlotMask >> shotSlot) & 1);
+	pinLevel = slotOn ? outputLevel : TRANSMITTER_LOW_VALUE;
+	mio_writePin(TRANSMITTER_OUTPUT_PIN, pinLevel);
 }
 
 // Write a one to the JF1 pin.
 void transmitter_set_jf1_to_one() {
-	mio_writePin(TRANSMITTER_OUTPUT_PIN, TRANSMITTER_HIGH_VALUE); // Write a '1' to JF-1.
+	outputLevel = TRANSMITTER_HIGH_VALUE;
+	transmitter_writePin(); // Write a '1' to JF-1.
 }
 
 // Write a zero to the JF1 pin.
 void transmitter_set_jf1_to_zero() {
-	mio_writePin(TRANSMITTER_OUTPUT_PIN, TRANSMITTER_LOW_VALUE); // Write a '0' to JF-1.
+	outputLevel = TRANSMITTER_LOW_VALUE;
+	transmitter_writePin(); // Write a '0' to JF-1.
+}
+
+// Moves to the next slot of the shot code at the end of a slot. Continuous
+// mode repeats the code every shot length.
+static void transmitter_advanceShotSlot(){
+	if(shotCodeMode && --shotSlotTicksRemaining == 0){
+		shotSlotTicksRemaining = SHOTCODE_SLOT_TICKS;
+		shotSlot = (shotSlot + 1 == SHOTCODE_SLOT_COUNT) ? 0 : shotSlot + 1;
+		transmitter_writePin();
+	}
 }
 
 // Starts the transmitter.
@@ -64,93 +121,155 @@ bool transmitter_running(){
 void transmitter_setFrequencyNumber(uint16_t frequencyNumber){ 
 	if(continuousMode || currentState_trans == init_st || currentState_trans == off_st){
     	transmitterFrequencyNum = frequencyNumber;
+		ddsPhaseIncrement = transmitter_ddsPhaseIncrement((double)TRANSMITTER_TICK_RATE_HZ / filter_frequencyTickTable[frequencyNumber]);
 	}
 }
 
+// Sends a shot code with the payload in every shot if shotCodeFlag.
+void transmitter_setShotCodeMode(bool shotCodeFlag){
+	shotCodeMode = shotCodeFlag;
+}
+
+// Sets the player ID and damage the shot code carries from the next shot on.
+void transmitter_setShotPayload(uint8_t playerId, uint8_t damage){
+	shotCode_payload_t payload = {playerId, damage};
+	nextShotSlotMask = shotCode_getSlotMask(shotCode_encode(payload));
+}
+
+// Returns the level last written to the output pin.
+uint8_t transmitter_getPinLevel(){
+	return pinLevel;
+}
+
+// Returns the DDS phase increment per tick of a frequency in Hz.
+uint32_t transmitter_ddsPhaseIncrement(double frequencyHz){
+	return (uint32_t)(frequencyHz * DDS_PHASE_MODULUS / TRANSMITTER_TICK_RATE_HZ + 0.5);
+}
+
+// Selects the phase-accumulator mode. Takes effect at the next transmitter_run().
+void transmitter_setDdsMode(bool ddsModeFlag){
+	ddsMode = ddsModeFlag;
+}
+
+// Sets the DDS frequency in Hz, under the same rules as transmitter_setFrequencyNumber().
+void transmitter_setDdsFrequency(double frequencyHz){
+	if(continuousMode || currentState_trans == init_st || currentState_trans == off_st){
+		ddsPhaseIncrement = transmitter_ddsPhaseIncrement(frequencyHz);
+	}
+}
+
+// Returns true if the output must leave level this tick. In DDS mode the
+// output follows the MSB of the accumulator one increment on, which
+// transmitter_count() stores once the tick is decided; otherwise the output
+// changes every half period of whole ticks. Only compares, as a guard must.
+static bool transmitter_halfPeriodElapsed(uint8_t level){
+	if(ddsMode){
+		return ((ddsPhase + ddsPhaseIncrement) >> DDS_OUTPUT_SHIFT) != level;
+	}
+	return counter >= filter_frequencyTickTable[transmitterFrequencyNum] / 2;
+}
+
 // Returns the current frequency setting.
 uint16_t transmitter_getFrequencyNumber(){ 
     return transmitterFrequencyNum;
 }
 
+// Returns true if transmitter_run() has been called since the last shot began.
+static bool transmitter_startRequested(){
+	return startRunning;
+}
+
+// Returns true once a shot has lasted TRANSMITTER_ON_OFF_DURATION ticks,
+// never in continuous mode.
+static bool transmitter_shotOver(){
+	return timeCounter > TRANSMITTER_ON_OFF_DURATION && !continuousMode;
+}
+
+// Returns true if the high half of the period is over.
+static bool transmitter_highHalfOver(){
+	return transmitter_halfPeriodElapsed(TRANSMITTER_HIGH_VALUE);
+}
+
+// Returns true if the low half of the period is over.
+static bool transmitter_lowHalfOver(){
+	return transmitter_halfPeriodElapsed(TRANSMITTER_LOW_VALUE);
+}
+
+// Logs that the transmitter is waiting for a shot.
+static void transmitter_logWaiting(){
+	if(testMode){
+		eventLog_write(EVENTLOG_TRANSMITTER_WAITING, 0, 0);
+	}
+}
+
+// Drives the output low and waits for a shot.
+static void transmitter_stopOutput(){
+	transmitter_set_jf1_to_zero();
+	transmitter_logWaiting();
+}
+
+// Initializes everything for a shot and starts it high.
+static void transmitter_startShot(){
+	startRunning = false;
+	counter = 0;
+	timeCounter = 0;
+	ddsPhase = DDS_HIGH_PHASE - ddsPhaseIncrement;	//transmitter_countHigh() advances it this tick
+	shotSlotMask = nextShotSlotMask;
+	shotSlot = 0;
+	shotSlotTicksRemaining = SHOTCODE_SLOT_TICKS;
+	if(testMode){
+		eventLog_write(EVENTLOG_TRANSMITTER_HIGH_ST, 0, 0);
+	}
+	transmitter_set_jf1_to_one();
+}
+
+// Starts the low half of a period.
+static void transmitter_goLow(){
+	counter = 0;
+	if(testMode){
+		eventLog_write(EVENTLOG_TRANSMITTER_LOW_ST, 0, 0);
+	}
+	transmitter_set_jf1_to_zero();
+}
+
+// Starts the high half of a period.
+static void transmitter_goHigh(){
+	counter = 0;
+	if(testMode){
+		eventLog_write(EVENTLOG_TRANSMITTER_HIGH_ST, 0, 0);
+	}
+	transmitter_set_jf1_to_one();
+}
+
+// Counts a tick of the shot at level and logs the output. In DDS mode also
+// advances the accumulator to the phase of this tick.
+static void transmitter_count(uint8_t level){
+	counter++;
+	timeCounter++;
+	if(ddsMode){
+		ddsPhase += ddsPhaseIncrement;
+	}
+	transmitter_advanceShotSlot();
+	if(testMode){
+		eventLog_write(EVENTLOG_TRANSMITTER_OUTPUT, level, 0);
+	}
+}
+
+// Counts a tick of the high half.
+static void transmitter_countHigh(){
+	transmitter_count(TRANSMITTER_HIGH_VALUE);
+}
+
+// Counts a tick of the low half.
+static void transmitter_countLow(){
+	transmitter_count(TRANSMITTER_LOW_VALUE);
+}
+
+FSM_DEFINE_MACHINE(transmitterMachine, "transmitter", TRANSMITTER_STATES, TRANSMITTER_TRANSITIONS);
+
 // Standard tick function.
-void transmitter_tick(){ 
-    //State updates
-    switch (currentState_trans){
-        case init_st:
-			currentState_trans = off_st;
-			transmitter_set_jf1_to_zero();
-			if(testMode){
-				printf("Waiting to start");
-			}
-            break;
-        case off_st:
-			if(startRunning){	//Initialize everything and transition to high_st
-				currentState_trans = high_st;
-				startRunning = false;
-				counter = 0;
-                timeCounter = 0;
-				if(testMode){
-					printf("\nhigh_st\n");
-				}
-				transmitter_set_jf1_to_one();
-			}
-			break;
-        case high_st:
-			if(timeCounter > TRANSMITTER_ON_OFF_DURATION && !continuousMode){	//If we are in continuous mode and 200 ms has elapsed, turn state machine off
-				currentState_trans = off_st;
-				transmitter_set_jf1_to_zero();
-				if(testMode){
-					printf("Waiting to start");
-				}
-			}
-            if(counter >= filter_frequencyTickTable[transmitterFrequencyNum] / 2){	//If half the cycle has elapsed, transistion to low
-                counter = 0;
-				currentState_trans = low_st;
-				if(testMode){
-					printf("\nlow_st\n");
-				}
-				transmitter_set_jf1_to_zero();
-            }
-            break;
-		case low_st:
-			if(timeCounter > TRANSMITTER_ON_OFF_DURATION && !continuousMode){	//If we are in continuous mode and 200 ms has elapsed, turn state machine off
-				currentState_trans = off_st;
-				if(testMode){
-					printf("Waiting to start");
-				}
-			}
-            if(counter >= filter_frequencyTickTable[transmitterFrequencyNum] / 2){	//If half the cycle has elapsed, transistion to high
-                counter = 0;
-				currentState_trans = high_st;
-				if(testMode){
-					printf("\nhigh_st\n");
-				}
-				transmitter_set_jf1_to_one();
-            }
-			break;         
-    }
-
-	//State actions
-	switch (currentState_trans){
-        case init_st:
-            break;
-        case off_st:
-			break;
-        case high_st:
-            counter++;
-            timeCounter++;
-			if(testMode){
-				printf("1");
-			}
-            break;
-		case low_st:
-            counter++;
-            timeCounter++;
-			if(testMode){
-				printf("0");
-			}
-			break;         
-    }
+void transmitter_tick(){
+	FSM_TICK(transmitterMachine, TRANSMITTER_STATES, TRANSMITTER_TRANSITIONS, currentState_trans);
 }
 
 // Prints out the clock waveform to stdio. Terminates when BTN1 is pressed.
@@ -164,17 +283,22 @@ void transmitter_runTest() {
   	buttons_init();                                         // Using buttons
   	switches_init();                                        // and switches.
   	transmitter_init();                                     // init the transmitter.
+  	eventLog_init();                                        // The tick logs its output,
+  	testMode = true;                                        // printed here after each tick.
   	while (!(buttons_read() & BUTTONS_BTN1_MASK)) {         // Run continuously until BTN1 is pressed.
     	uint16_t switchValue = switches_read() % FILTER_FREQUENCY_COUNT;  // Compute a safe number from the switches.
     	transmitter_setFrequencyNumber(switchValue);          // set the frequency number based upon switch value.
     	transmitter_run();                                    // Start the transmitter.
     	while (transmitter_running()) {                       // Keep ticking until it is done.
       		transmitter_tick();                                 // tick.
+      		eventLog_flush(false);                              // print what the tick logged.
       		utils_msDelay(TRANSMITTER_TEST_TICK_PERIOD_IN_MS);  // short delay between ticks.
     	}
+    	eventLog_flush(false);
     	printf("completed one test period.\n");
         utils_msDelay(DELAY_PERIOD_FOR_SCOPE);
   	}
+  	testMode = false;
   	do {utils_msDelay(BOUNCE_DELAY);} while (buttons_read());
   	printf("exiting transmitter_runTest()\n");
 	interrupts_enableTimerGlobalInts();
@@ -242,4 +366,145 @@ void transmitter_runContinuousTest(){
 	}
 	do {utils_msDelay(BOUNCE_DELAY);} while (buttons_read());
 	printf("Completed runContinuousTest()\n");
-}
\ No newline at end of file
+}
+
+#ifndef ZYBO_BOARD
+#define DDS_TEST_TICK_COUNT TRANSMITTER_TICK_RATE_HZ // One second, so rising edges are Hz.
+#define DDS_TEST_SPECTRUM_TICKS 16384 // 6.1 Hz bins.
+#define DDS_TEST_BAND_HZ 5000.0 // Nyquist of the decimated detector input.
+#define DDS_TEST_LOBE_BINS 6 // Blackman main lobe, excluded around every harmonic.
+#define DDS_TEST_MIN_SFDR_DB 25.0 // A one-bit output puts tick-grid jitter spurs near -30 dBc.
+#define DDS_TEST_MAX_ERROR_HZ 1.0
+#define DDS_TEST_COST_TICKS 1000000
+#define DDS_TEST_TIMER INTERVAL_TIMER_TIMER_2
+#define DDS_TEST_START_TICKS 2 // From transmitter_init() to high_st.
+#define BLACKMAN_A0 0.42
+#define BLACKMAN_A1 0.5
+#define BLACKMAN_A2 0.08
+#define TWO_PI (2.0 * M_PI)
+#define DECIBELS_PER_DECADE 10.0
+static double ddsTestSamples[DDS_TEST_SPECTRUM_TICKS];
+
+// What one run of the transmitter measured.
+typedef struct {
+	double frequencyHz; // Rising edges in one second.
+	double sfdrDb; // Fundamental over the largest other component in the band.
+} transmitter_ddsTestResult_t;
+
+// Returns the power of the windowed samples at frequencyHz (Goertzel).
+static double transmitter_goertzelPower(double frequencyHz){
+	double coefficient = 2.0 * cos(TWO_PI * frequencyHz / TRANSMITTER_TICK_RATE_HZ);
+	double s1 = 0.0;
+	double s2 = 0.0;
+	for(uint32_t i = 0; i < DDS_TEST_SPECTRUM_TICKS; ++i){
+		double s0 = ddsTestSamples[i] + coefficient * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+	return s1 * s1 + s2 * s2 - coefficient * s1 * s2;
+}
+
+// Returns true if frequencyHz is within the main lobe of an odd harmonic of
+// fundamentalHz, which a square wave is made of.
+static bool transmitter_nearOddHarmonic(double frequencyHz, double fundamentalHz, double binHz){
+	for(double harmonic = fundamentalHz; harmonic < DDS_TEST_BAND_HZ + DDS_TEST_LOBE_BINS * binHz; harmonic += 2.0 * fundamentalHz)
+		if(fabs(frequencyHz - harmonic) <= DDS_TEST_LOBE_BINS * binHz)
+			return true;
+	return false;
+}
+
+// Runs the transmitter for one second from transmitter_init() in continuous
+// mode and measures the output. The caller has selected the mode.
+static void transmitter_measureOutput(double expectedHz, transmitter_ddsTestResult_t *result){
+	uint32_t risingEdges = 0;
+	transmitter_run();
+	for(uint32_t i = 0; i < DDS_TEST_START_TICKS; ++i)
+		transmitter_tick();
+	uint8_t previousLevel = outputLevel;
+	for(uint32_t i = 0; i < DDS_TEST_TICK_COUNT; ++i){
+		if(i < DDS_TEST_SPECTRUM_TICKS){
+			double window = BLACKMAN_A0 - BLACKMAN_A1 * cos(TWO_PI * i / (DDS_TEST_SPECTRUM_TICKS - 1)) + BLACKMAN_A2 * cos(2.0 * TWO_PI * i / (DDS_TEST_SPECTRUM_TICKS - 1));
+			ddsTestSamples[i] = (outputLevel == TRANSMITTER_HIGH_VALUE ? 1.0 : -1.0) * window;
+		}
+		if(outputLevel == TRANSMITTER_HIGH_VALUE && previousLevel == TRANSMITTER_LOW_VALUE)
+			risingEdges++;
+		previousLevel = outputLevel;
+		transmitter_tick();
+	}
+	result->frequencyHz = risingEdges;
+	double binHz = (double)TRANSMITTER_TICK_RATE_HZ / DDS_TEST_SPECTRUM_TICKS;
+	double fundamental = 0.0;
+	double spur = 0.0;
+	for(double f = binHz; f < DDS_TEST_BAND_HZ; f += binHz){
+		bool nearFundamental = fabs(f - expectedHz) <= DDS_TEST_LOBE_BINS * binHz;
+		if(!nearFundamental && transmitter_nearOddHarmonic(f, expectedHz, binHz))
+			continue;
+		double power = transmitter_goertzelPower(f);
+		if(nearFundamental && power > fundamental)
+			fundamental = power;
+		else if(!nearFundamental && power > spur)
+			spur = power;
+	}
+	result->sfdrDb = DECIBELS_PER_DECADE * log10(fundamental / spur);
+}
+
+// Returns the seconds per transmitter_tick() of the current mode at the highest
+// player frequency, the most edges.
+static double transmitter_timeTicks(){
+	transmitter_init();
+	transmitter_setContinuousMode(true);
+	transmitter_setFrequencyNumber(FILTER_FREQUENCY_COUNT - 1);
+	transmitter_run();
+	intervalTimer_reset(DDS_TEST_TIMER);
+	intervalTimer_start(DDS_TEST_TIMER);
+	for(uint32_t i = 0; i < DDS_TEST_COST_TICKS; ++i)
+		transmitter_tick();
+	intervalTimer_stop(DDS_TEST_TIMER);
+	return intervalTimer_getTotalDurationInSeconds(DDS_TEST_TIMER) / DDS_TEST_COST_TICKS;
+}
+
+// Runs the transmitter in DDS mode at every player frequency and halfway
+// between them, and in tick-table mode at the player frequencies, and prints
+// the measured frequency, in-band spurious-free dynamic range and tick cost.
+void transmitter_runDdsTest(){
+	printf("Starting transmitter_runDdsTest()\n");
+	interrupts_disableTimerGlobalInts();
+	bool passed = true;
+	transmitter_ddsTestResult_t result;
+	printf("%-10s %12s %12s %10s\n", "mode", "expected Hz", "measured Hz", "SFDR dB");
+	for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; ++i){
+		double playerHz = (double)TRANSMITTER_TICK_RATE_HZ / filter_frequencyTickTable[i];
+		transmitter_init();
+		transmitter_setDdsMode(false);
+		transmitter_setContinuousMode(true);
+		transmitter_setFrequencyNumber(i);
+		transmitter_measureOutput(playerHz, &result);
+		printf("%-10s %12.3f %12.0f %10.1f\n", "tick table", playerHz, result.frequencyHz, result.sfdrDb);
+		for(uint16_t half = 0; half < 2 && (half == 0 || i + 1 < FILTER_FREQUENCY_COUNT); ++half){
+			double ddsHz = half ? (playerHz + (double)TRANSMITTER_TICK_RATE_HZ / filter_frequencyTickTable[i + 1]) / 2.0 : playerHz;
+			transmitter_init();
+			transmitter_setDdsMode(true);
+			transmitter_setContinuousMode(true);
+			transmitter_setDdsFrequency(ddsHz);
+			transmitter_measureOutput(ddsHz, &result);
+			printf("%-10s %12.3f %12.0f %10.1f\n", "DDS", ddsHz, result.frequencyHz, result.sfdrDb);
+			if(fabs(result.frequencyHz - ddsHz) > DDS_TEST_MAX_ERROR_HZ || result.sfdrDb < DDS_TEST_MIN_SFDR_DB){
+				printf("DDS output at %f Hz is off frequency or below %f dB SFDR\n", ddsHz, DDS_TEST_MIN_SFDR_DB);
+				passed = false;
+			}
+		}
+	}
+	intervalTimer_init(DDS_TEST_TIMER);
+	transmitter_setDdsMode(false);
+	double tableSeconds = transmitter_timeTicks();
+	transmitter_setDdsMode(true);
+	double ddsSeconds = transmitter_timeTicks();
+	printf("transmitter_tick(): tick table %f ns, DDS %f ns\n", tableSeconds * 1e9, ddsSeconds * 1e9);
+	transmitter_setDdsMode(false);
+	transmitter_setContinuousMode(false);
+	transmitter_init();
+	interrupts_enableTimerGlobalInts();
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed transmitter_runDdsTest()\n");
+}
+#endif
@@ -12,12 +12,25 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #define TRANSMITTER_OUTPUT_PIN 13     // JF1 (pg. 25 of ZYBO reference manual).
 #define TRANSMITTER_PULSE_WIDTH 20000 // Based on a system tick-rate of 100 kHz.
+#define TRANSMITTER_TICK_RATE_HZ 100000 // transmitter_tick() rate.
 #include <stdbool.h>
 #include <stdint.h>
 
 // The transmitter state machine generates a square wave output at the chosen
 // frequency as set by transmitter_setFrequencyNumber(). The step counts for the
 // frequencies are provided in filter.h
+//
+// In DDS mode (transmitter_setDdsMode()) a 32-bit phase accumulator advances by
+// a phase increment every tick and the output is its MSB, so the frequency is
+// increment * TRANSMITTER_TICK_RATE_HZ / 2^32: any frequency below 50 kHz to
+// within 25 uHz, instead of 100 kHz over an even whole number of ticks. Half
+// periods are then a mix of the two nearest whole tick counts, which averages
+// to the fractional period. The frequency number still selects the tick-table
+// frequency; transmitter_setDdsFrequency() sets any other.
+//
+// In shot-code mode (transmitter_setShotCodeMode()) the square wave is keyed
+// on and off in the slots of a shot code carrying the payload set by
+// transmitter_setShotPayload(), see shotCode.h. Works in either mode above.
 
 // Standard init function.
 void transmitter_init();
@@ -36,7 +49,31 @@ void transmitter_setFrequencyNumber(uint16_t frequencyNumber);
 // Returns the current frequency setting.
 uint16_t transmitter_getFrequencyNumber();
 
-// Standard tick function.
+// Returns the DDS phase increment per tick of a frequency in Hz.
+uint32_t transmitter_ddsPhaseIncrement(double frequencyHz);
+
+// Selects the phase-accumulator (DDS) mode if ddsModeFlag, the tick-table mode
+// otherwise. Takes effect at the next transmitter_run().
+void transmitter_setDdsMode(bool ddsModeFlag);
+
+// Sets the frequency in Hz that DDS mode transmits, overriding the frequency
+// number until the next transmitter_setFrequencyNumber(). Follows the same
+// rules as transmitter_setFrequencyNumber() about when it takes effect.
+void transmitter_setDdsFrequency(double frequencyHz);
+
+// Keys every shot with a shot code if shotCodeFlag. Change it only while the
+// transmitter is stopped.
+void transmitter_setShotCodeMode(bool shotCodeFlag);
+
+// Sets the player ID and damage the shot code carries. A shot in progress
+// keeps the old payload.
+void transmitter_setShotPayload(uint8_t playerId, uint8_t damage);
+
+// Returns the level last written to the output pin.
+uint8_t transmitter_getPinLevel();
+
+// Standard tick function. Stays in the 100 kHz fast lane of isr_function()
+// because the output edges are timed in 100 kHz ticks.
 void transmitter_tick();
 
 // Tests the transmitter.
@@ -71,4 +108,11 @@ void transmitter_runNoncontinuousTest();
 // Test runs until BTN1 is pressed.
 void transmitter_runContinuousTest();
 
+// Runs the transmitter in DDS mode at every player frequency and at the
+// fractional frequencies halfway between them, and in tick-table mode at the
+// player frequencies. Prints the measured frequency, the spurious-free dynamic
+// range within the detector band and the time per tick of each mode. Host
+// (emulator) builds only.
+void transmitter_runDdsTest();
+
 #endif /* TRANSMITTER_H_ */
@@ -6,29 +6,67 @@
 #include "utils.h"
 #include "trigger.h"
 #include "transmitter.h"
+#include "eventLog.h"
+#include "interrupts.h"
+#include "isr.h"
+#include "fsm.h"
+#include "testUtils.h"
 
-// The trigger state machine debounces both the press and release of gun
-// trigger. Ultimately, it will activate the transmitter when a debounced press
-// is detected.
+// The trigger state machine samples the trigger once a millisecond into a
+// shift register. It fires as soon as the press shows in TRIGGER_PRESS_SAMPLES
+// samples in a row and only debounces the release, which must show in
+// TRIGGER_RELEASE_SAMPLES samples in a row.
 #define TRIGGER_GUN_TRIGGER_MIO_PIN 10     // JF-2
 #define GUN_TRIGGER_PRESSED 1
-#define DEBOUNCE_COUNTER_MAX_VALUE 5000
 #define STARTING_SHOTS 10
+#define TRIGGER_PRESS_SAMPLES 2 // One sample of confirmation keeps a single-sample glitch from firing.
+#define TRIGGER_RELEASE_SAMPLES 20
+#define TRIGGER_SAMPLE_MASK(samples) ((1UL << (samples)) - 1)
+#define MILLISECONDS_PER_MINUTE 60000
+#define SHOT_MILLISECONDS (TRANSMITTER_PULSE_WIDTH / ISR_SLOW_LANE_DIVIDER + 1) // The transmitter stops a tick after the pulse.
+#define DEFAULT_ROUNDS_PER_MINUTE 120
+#define DEFAULT_BURST_LENGTH 3
 
 volatile static bool enabled = false;
 volatile static bool shotFired = false;
 volatile static bool ignoreGunInput = false;
 static trigger_shotsRemaining_t shotsRemaining;
-static uint32_t counter;
 static bool debugPrint = true;
+static uint32_t sampleHistory; // Newest sample in bit 0, 1 if pressed.
+volatile static trigger_fireMode_t fireMode = trigger_semiAuto_e;
+volatile static uint16_t burstLength = DEFAULT_BURST_LENGTH;
+volatile static uint16_t shotIntervalTicks = MILLISECONDS_PER_MINUTE / DEFAULT_ROUNDS_PER_MINUTE;
+static uint16_t cooldownTicks; // Until the rate of fire allows the next shot.
+static uint16_t pressShotsLeft; // Shots this press may still fire.
 
-enum trigger_st {init_st, not_pressed_st, debounce_press_st, pressed_st, debounce_release_st} currentState_trig = init_st;
+// Test builds (cmake -DTRIGGER_SIMULATION=1) can press the trigger from
+// software; the game build only reads the gun and BTN0.
+#ifdef TRIGGER_SIMULATION_ENABLED
+volatile static bool simulatedPress = false;
+#define TRIGGER_SIMULATED_PRESS simulatedPress
+#else
+#define TRIGGER_SIMULATED_PRESS false
+#endif
+
+// A disabled trigger goes back to init_st from any state.
+#define TRIGGER_STATES(S) \
+	S(init_st, trigger_clearShotFired) \
+	S(released_st, fsm_noAction) \
+	S(pressed_st, trigger_fireIfReady)
+#define TRIGGER_TRANSITIONS(T) \
+	T(FSM_ANY_STATE, trigger_disabled, init_st, fsm_noAction) \
+	T(init_st, fsm_always, released_st, trigger_clearShotFired) \
+	T(released_st, trigger_pressSettled, pressed_st, trigger_startPress) \
+	T(pressed_st, trigger_releaseSettled, released_st, trigger_endPress)
+
+FSM_DECLARE_STATES(trigger_st_t, TRIGGER_STATES);
+static trigger_st_t currentState_trig = init_st;
 
 // Trigger can be activated by either btn0 or the external gun that is attached to TRIGGER_GUN_TRIGGER_MIO_PIN
 // Gun input is ignored if the gun-input is high when the init() function is invoked.
 bool triggerPressed() {
 	return ((!ignoreGunInput & (mio_readPin(TRIGGER_GUN_TRIGGER_MIO_PIN) == GUN_TRIGGER_PRESSED)) || 
-                (buttons_read() & BUTTONS_BTN0_MASK));
+                (buttons_read() & BUTTONS_BTN0_MASK) || TRIGGER_SIMULATED_PRESS);
 	//return buttons_read() & BUTTONS_BTN0_MASK;
 }
 
@@ -60,6 +98,13 @@ void trigger_disable(){
 	// printf("Trigger disabled\n");
 }
 
+#ifdef TRIGGER_SIMULATION_ENABLED
+// Presses or releases the trigger from software, as if the gun or BTN0 had.
+void trigger_setSimulatedPress(bool pressed){
+	simulatedPress = pressed;
+}
+#endif
+
 // Returns the number of remaining shots.
 trigger_shotsRemaining_t trigger_getRemainingShotCount(){
 	return shotsRemaining;
@@ -70,82 +115,79 @@ void trigger_setRemainingShotCount(trigger_shotsRemaining_t count){
 	shotsRemaining = count;
 }
 
+// Selects what a press fires. burstCount is only used by trigger_burst_e.
+void trigger_setFireMode(trigger_fireMode_t mode, uint16_t burstCount){
+	fireMode = mode;
+	burstLength = (burstCount == 0) ? 1 : burstCount;
+}
+
+// Sets the most shots per minute, at most one per transmitter pulse.
+void trigger_setRoundsPerMinute(uint16_t roundsPerMinute){
+	uint16_t interval = (roundsPerMinute == 0) ? UINT16_MAX : MILLISECONDS_PER_MINUTE / roundsPerMinute;
+	shotIntervalTicks = (interval < SHOT_MILLISECONDS) ? SHOT_MILLISECONDS : interval;
+}
+
+// Fires one shot if the press still has shots and the rate of fire allows it.
+static void trigger_fireIfReady(){
+	if(pressShotsLeft == 0 || cooldownTicks > 0 || shotsRemaining == 0){
+		return;
+	}
+	transmitter_run();
+	--shotsRemaining;
+	cooldownTicks = shotIntervalTicks;
+	if(fireMode != trigger_fullAuto_e){
+		--pressShotsLeft;
+	}
+	if(debugPrint){
+		eventLog_write(EVENTLOG_TRIGGER_PRESSED, shotsRemaining, 0);
+	}
+}
+
+// Returns true if the trigger state machine is disabled.
+static bool trigger_disabled(){
+	return !enabled;
+}
+
+// Returns true if the press shows in TRIGGER_PRESS_SAMPLES samples in a row
+// and there are shots left. Fires on the press, no waiting.
+static bool trigger_pressSettled(){
+	return (sampleHistory & TRIGGER_SAMPLE_MASK(TRIGGER_PRESS_SAMPLES)) == TRIGGER_SAMPLE_MASK(TRIGGER_PRESS_SAMPLES) && shotsRemaining > 0;
+}
+
+// Returns true if the release shows in TRIGGER_RELEASE_SAMPLES samples in a
+// row, long enough to be past the bounce.
+static bool trigger_releaseSettled(){
+	return (sampleHistory & TRIGGER_SAMPLE_MASK(TRIGGER_RELEASE_SAMPLES)) == 0;
+}
+
+// Clears the pressed flag.
+static void trigger_clearShotFired(){
+	shotFired = false;
+}
+
+// Starts a press with the shots the fire mode allows it.
+static void trigger_startPress(){
+	shotFired = true;
+	pressShotsLeft = (fireMode == trigger_burst_e) ? burstLength : 1;
+}
+
+// Ends a press.
+static void trigger_endPress(){
+	shotFired = false;
+	if(debugPrint){
+		eventLog_write(EVENTLOG_TRIGGER_RELEASED, shotsRemaining, 0);
+	}
+}
+
+FSM_DEFINE_MACHINE(triggerMachine, "trigger", TRIGGER_STATES, TRIGGER_TRANSITIONS);
+
 // Standard tick function.
 void trigger_tick(){
-	//State updates
-	if(!enabled){
-		currentState_trig = init_st;
+	sampleHistory = (sampleHistory << 1) | triggerPressed();
+	if(cooldownTicks > 0){
+		--cooldownTicks;
 	}
-    switch (currentState_trig){
-        case init_st:
-      		shotFired = false;
-			if(enabled){
-				currentState_trig = not_pressed_st;
-			}
-            break;
-        case not_pressed_st:
-			// printf("not_pressed_st\n");
-			//If the trigger is pressed, reset the debounce counter and transistion to debounce state
-			if(triggerPressed() && shotsRemaining > 0){
-				counter = 0;
-				currentState_trig = debounce_press_st;
-			}
-			break;
-        case debounce_press_st:
-			// printf("debounce_press_st\n");
-            if(!triggerPressed()){
-				currentState_trig = not_pressed_st;
-			}
-			else if(counter > DEBOUNCE_COUNTER_MAX_VALUE){
-				currentState_trig = pressed_st;
-        		shotFired = true;
-				transmitter_run();
-				if(debugPrint){
-					printf(" D \n");
-				}
-			}
-            break;
-        case pressed_st:
-            // printf("pressed_st\n");
-			//If the trigger is released, reset the debounce counter and transistion to debounce state
-			if(!triggerPressed()){
-				currentState_trig = debounce_release_st;
-				counter = 0;
-			}
-			break;
-        case debounce_release_st:
-            // printf("debounce_release_st\n");
-			if(triggerPressed()){
-				currentState_trig = pressed_st;
-			}
-			else if(counter > DEBOUNCE_COUNTER_MAX_VALUE){	//Transistion to not_pressed_st and decrement shotsRemaining
-				currentState_trig = not_pressed_st;
-        		shotFired = false;
-				--shotsRemaining;
-				if(debugPrint){
-					printf(" U \n");
-				}
-			}
-			break;           
-    }
-
-	//State actions
-    switch (currentState_trig){
-        case init_st:
-            counter = 0;
-			break;
-        case not_pressed_st:
-			break;
-        case debounce_press_st:
-            ++counter;
-            break;
-        case pressed_st:
-			break;
-        case debounce_release_st:
-            ++counter;
-			break;
-        }
-	
+	FSM_TICK(triggerMachine, TRIGGER_STATES, TRIGGER_TRANSITIONS, currentState_trig);
 }
 
 //Returns true if the trigger state machine is in the pressed state
@@ -163,10 +205,127 @@ void trigger_runTest(){
     trigger_init();
     trigger_enable();
 	trigger_setRemainingShotCount(STARTING_SHOTS);
+	eventLog_init();
 	debugPrint = true;
-	while(!(buttons_read() & BUTTONS_BTN1_MASK)){}
+	while(!(buttons_read() & BUTTONS_BTN1_MASK)){
+		eventLog_flush(false);	//The tick runs in the ISR, so it logs rather than prints
+	}
 	trigger_disable();
 	debugPrint = false;
+	eventLog_flush(false);
 	do {utils_msDelay(BOUNCE_DELAY);} while (buttons_read());
 	printf("Completed trigger_runTest()\n");
 }
+
+#ifdef TRIGGER_SIMULATION_ENABLED
+// Presses the trigger from software LATENCY_TEST_PRESS_COUNT times, with
+// contact bounce on the press and the release, while ticking the trigger in
+// the slow lane and the transmitter every fast tick the way isr_function()
+// does. Each press starts at a random point of the millisecond.
+#define LATENCY_TEST_PRESS_COUNT 20
+#define LATENCY_TEST_BOUNCE_TICKS 300 // 3 ms of contact bounce.
+#define LATENCY_TEST_BOUNCE_STEP 20 // Fast ticks between bounce samples.
+#define LATENCY_TEST_REST_TICKS 100000 // Released for 1 s between presses.
+#define LATENCY_TEST_SHORT_HOLD_TICKS 10000 // 100 ms.
+#define LATENCY_TEST_LONG_HOLD_TICKS 100000 // 1 s.
+#define LATENCY_TEST_ROUNDS_PER_MINUTE 300
+#define LATENCY_TEST_SHOTS 1000
+typedef struct {
+	uint32_t shots;
+	uint32_t minTicks;
+	uint32_t maxTicks;
+	uint32_t totalTicks;
+} trigger_latencyResult_t;
+
+// The old state machine on the same presses, recorded before it was removed:
+// the press and the release each had to be stable for 50 ms, and the shot went
+// out at the end of the press debounce.
+static const trigger_latencyResult_t counterDebounceResult = {20, 5103, 5489, 107265};
+
+// Runs the presses through trigger_tick() and the transmitter.
+static void trigger_runPresses(uint32_t holdTicks, trigger_latencyResult_t *result){
+	uint32_t seed = 1;
+	*result = (trigger_latencyResult_t){0, UINT32_MAX, 0, 0};
+	trigger_setRemainingShotCount(LATENCY_TEST_SHOTS);
+	for(uint16_t press = 0; press < LATENCY_TEST_PRESS_COUNT; ++press){
+		uint32_t pressTick = LATENCY_TEST_REST_TICKS + testUtils_random(&seed) % ISR_SLOW_LANE_DIVIDER;
+		uint32_t releaseTick = pressTick + holdTicks;
+		bool transmitted = false;
+		bool wasRunning = transmitter_running();
+		for(uint32_t tick = 0; tick < releaseTick + LATENCY_TEST_REST_TICKS; ++tick){
+			bool contact = tick >= pressTick && tick < releaseTick;
+			if((tick > pressTick && tick < pressTick + LATENCY_TEST_BOUNCE_TICKS) || (tick >= releaseTick && tick < releaseTick + LATENCY_TEST_BOUNCE_TICKS)){
+				if(tick % LATENCY_TEST_BOUNCE_STEP == 0)
+					testUtils_random(&seed);
+				contact = (seed >> 16) & 1;
+			}
+			trigger_setSimulatedPress(contact);
+			if(tick % ISR_SLOW_LANE_DIVIDER == ISR_SLOW_LANE_TRIGGER_PHASE){
+				trigger_tick();
+			}
+			transmitter_tick();
+			if(transmitter_running() && !wasRunning)
+				result->shots++;
+			wasRunning = transmitter_running();
+			if(!transmitted && tick >= pressTick && transmitter_getPinLevel()){	//First light out of the gun
+				uint32_t latency = tick - pressTick;
+				result->totalTicks += latency;
+				result->minTicks = (latency < result->minTicks) ? latency : result->minTicks;
+				result->maxTicks = (latency > result->maxTicks) ? latency : result->maxTicks;
+				transmitted = true;
+			}
+		}
+	}
+}
+
+// Prints the trigger-to-transmit latency of one way of debouncing.
+static void trigger_printLatency(const char *name, const trigger_latencyResult_t *result){
+	printf("%-14s latency min %5.2f ms, mean %5.2f ms, max %5.2f ms, %u shots from %u presses\n", name,
+		result->minTicks / 100.0, result->totalTicks / (100.0 * LATENCY_TEST_PRESS_COUNT), result->maxTicks / 100.0,
+		result->shots, LATENCY_TEST_PRESS_COUNT);
+}
+
+// Measures the trigger-to-transmit latency of the shift register against the
+// recorded one of the old counter debounce, and checks the shots each fire
+// mode fires.
+void trigger_runLatencyTest(){
+	printf("Starting trigger_runLatencyTest()\n");
+	interrupts_disableTimerGlobalInts();
+	trigger_init();
+	transmitter_init();
+	transmitter_setContinuousMode(false);
+	trigger_enable();
+	debugPrint = false;
+	bool passed = true;
+	trigger_latencyResult_t result;
+	trigger_printLatency("counter", &counterDebounceResult);
+	trigger_setFireMode(trigger_semiAuto_e, 1);
+	trigger_runPresses(LATENCY_TEST_SHORT_HOLD_TICKS, &result);
+	trigger_printLatency("shift register", &result);
+	passed = passed && result.shots == LATENCY_TEST_PRESS_COUNT && result.maxTicks < counterDebounceResult.minTicks;
+	trigger_setRoundsPerMinute(LATENCY_TEST_ROUNDS_PER_MINUTE);
+	trigger_setFireMode(trigger_burst_e, DEFAULT_BURST_LENGTH);
+	trigger_runPresses(LATENCY_TEST_LONG_HOLD_TICKS, &result);
+	trigger_printLatency("burst", &result);
+	passed = passed && result.shots == DEFAULT_BURST_LENGTH * LATENCY_TEST_PRESS_COUNT;
+	trigger_setFireMode(trigger_fullAuto_e, 1);
+	trigger_runPresses(LATENCY_TEST_LONG_HOLD_TICKS, &result);
+	trigger_printLatency("full auto", &result);
+	uint32_t heldTicks = LATENCY_TEST_LONG_HOLD_TICKS / ISR_SLOW_LANE_DIVIDER + TRIGGER_RELEASE_SAMPLES - TRIGGER_PRESS_SAMPLES;	//Slow ticks from the first shot to the release
+	passed = passed && result.shots == (1 + (heldTicks - 1) / shotIntervalTicks) * LATENCY_TEST_PRESS_COUNT;
+	trigger_setFireMode(trigger_semiAuto_e, 1);
+	trigger_setRoundsPerMinute(DEFAULT_ROUNDS_PER_MINUTE);
+	trigger_setSimulatedPress(false);
+	trigger_disable();
+	interrupts_enableTimerGlobalInts();
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed trigger_runLatencyTest()\n");
+}
+#else
+// Needs trigger_setSimulatedPress(), so only a test build runs it.
+void trigger_runLatencyTest(){
+	printf("Starting trigger_runLatencyTest()\n");
+	printf("Skipped: build with -DTRIGGER_SIMULATION=1 to press the trigger from software\n");
+	printf("Completed trigger_runLatencyTest()\n");
+}
+#endif
@@ -10,14 +10,24 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef TRIGGER_H_
 #define TRIGGER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
-// The trigger state machine debounces both the press and release of gun
-// trigger. Ultimately, it will activate the transmitter when a debounced press
-// is detected.
+// The trigger state machine samples the trigger once a millisecond into a
+// shift register. It fires as soon as two samples in a row show the press, and
+// only debounces the release, which must show for 20 ms. What a press fires
+// depends on the fire mode, and shots are never closer together than the rate
+// of fire allows. Every shot takes one from the remaining shot count.
 
 typedef uint16_t trigger_shotsRemaining_t;
 
+// What one press of the trigger fires.
+typedef enum {
+  trigger_semiAuto_e, // One shot.
+  trigger_burst_e,    // A burst of shots, see trigger_setFireMode().
+  trigger_fullAuto_e  // Shots until the trigger is released.
+} trigger_fireMode_t;
+
 // Init trigger data-structures.
 // Determines whether the trigger switch of the gun is connected (see discussion
 // in lab web pages). Initializes the mio subsystem.
@@ -31,19 +41,44 @@ void trigger_enable();
 // Disable the trigger state machine so that trigger presses are ignored.
 void trigger_disable();
 
+// Presses or releases the trigger from software, as if the gun or BTN0 had.
+// Test code uses this to drive the state machine without hardware. Only in
+// test builds, see TRIGGER_SIMULATION in CMakeLists.txt.
+#ifdef TRIGGER_SIMULATION_ENABLED
+void trigger_setSimulatedPress(bool pressed);
+#endif
+
+// Selects the fire mode; burstCount is the length of a burst in
+// trigger_burst_e. Semi-auto by default.
+void trigger_setFireMode(trigger_fireMode_t mode, uint16_t burstCount);
+
+// Sets the rate of fire, 120 rounds per minute by default. Shots cannot be
+// closer than one transmitter pulse, so rates above 298 are limited to that.
+// At that rate shots follow each other without a gap, which shot codes (see
+// shotCode.h) cannot decode.
+void trigger_setRoundsPerMinute(uint16_t roundsPerMinute);
+
 // Returns the number of remaining shots.
 trigger_shotsRemaining_t trigger_getRemainingShotCount();
 
 // Sets the number of remaining shots.
 void trigger_setRemainingShotCount(trigger_shotsRemaining_t count);
 
-// Standard tick function.
+// Standard tick function. Invoked from the 1 kHz slow lane of isr_function().
 void trigger_tick();
 
 // Runs the test continuously until BTN1 is pressed.
 // The test just prints out a 'D' when the trigger or BTN0
 // is pressed, and a 'U' when the trigger or BTN0 is released.
 void trigger_runTest();
+
+// Presses the trigger from software, with contact bounce, and prints the time
+// from the first contact to the first transmitter output with the shift
+// register, next to the recorded time of the old 50 ms counter debounce on the
+// same presses, then checks the shots fired in each fire mode. Ticks the
+// trigger and transmitter itself with interrupts disabled. Without
+// TRIGGER_SIMULATION it only prints that it was skipped.
+void trigger_runLatencyTest();
 
 //Returns true if the trigger state machine is in the pressed state
 bool trigger_shotsFired();
@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "intervalTimer.h"
+#include "virtualTimer.h"
+
+#define NOT_QUEUED 0xFFFF // heapIndex of a timer that is not running.
+#define TEST_TIMER INTERVAL_TIMER_TIMER_2
+#define TEST_RANDOM_TIMER_COUNT 200
+#define TEST_BENCHMARK_LOOPS 1000000
+#define TEST_NANOSECONDS_PER_SECOND 1e9
+
+// One virtual timer. deadline is in counter milliseconds, period is 0 for a
+// one-shot timer.
+typedef struct {
+	const char *name;
+	virtualTimer_callback_t callback;
+	void *context;
+	uint32_t deadline;
+	uint32_t period;
+	uint16_t heapIndex;
+	uint16_t expiryCount; // Expiries not yet taken.
+	bool inUse;
+} virtualTimer_t;
+
+static virtualTimer_t timers[VIRTUAL_TIMER_MAX_TIMERS];
+// Min-heap of the running timers, by deadline. heap[0] expires first.
+static virtualTimer_id_t heap[VIRTUAL_TIMER_MAX_TIMERS];
+static uint16_t heapCount;
+static volatile uint32_t now;
+
+// Returns true if deadline a comes before deadline b, across wraparound.
+static bool virtualTimer_before(uint32_t a, uint32_t b){
+	return (int32_t)(a - b) < 0;
+}
+
+// Puts timer id at position index of the heap.
+static void virtualTimer_place(uint16_t index, virtualTimer_id_t id){
+	heap[index] = id;
+	timers[id].heapIndex = index;
+}
+
+// Moves the timer at index up the heap until its parent is due no later.
+static void virtualTimer_siftUp(uint16_t index){
+	virtualTimer_id_t id = heap[index];
+	while(index > 0){
+		uint16_t parent = (index - 1) / 2;
+		if(!virtualTimer_before(timers[id].deadline, timers[heap[parent]].deadline))
+			break;
+		virtualTimer_place(index, heap[parent]);
+		index = parent;
+	}
+	virtualTimer_place(index, id);
+}
+
+// Moves the timer at index down the heap until its children are due no
+// earlier.
+static void virtualTimer_siftDown(uint16_t index){
+	virtualTimer_id_t id = heap[index];
+	while(true){
+		uint16_t child = 2 * index + 1;
+		if(child >= heapCount)
+			break;
+		if(child + 1 < heapCount && virtualTimer_before(timers[heap[child + 1]].deadline, timers[heap[child]].deadline))
+			++child;
+		if(!virtualTimer_before(timers[heap[child]].deadline, timers[id].deadline))
+			break;
+		virtualTimer_place(index, heap[child]);
+		index = child;
+	}
+	virtualTimer_place(index, id);
+}
+
+// Adds a stopped timer to the heap.
+static void virtualTimer_insert(virtualTimer_id_t id){
+	heap[heapCount] = id;
+	virtualTimer_siftUp(heapCount++);
+}
+
+// Takes a running timer out of the heap.
+static void virtualTimer_remove(virtualTimer_id_t id){
+	uint16_t index = timers[id].heapIndex;
+	timers[id].heapIndex = NOT_QUEUED;
+	if(index == --heapCount)
+		return;
+	virtualTimer_id_t moved = heap[heapCount];	//Fill the hole with the last timer
+	virtualTimer_place(index, moved);
+	virtualTimer_siftUp(index);
+	if(timers[moved].heapIndex == index)
+		virtualTimer_siftDown(index);
+}
+
+// Returns true if id is a timer handed out by virtualTimer_create() and not
+// yet destroyed.
+static bool virtualTimer_isValid(virtualTimer_id_t id){
+	return id < VIRTUAL_TIMER_MAX_TIMERS && timers[id].inUse;
+}
+
+// Frees every timer and resets the counter.
+void virtualTimer_init(){
+	for(uint16_t i = 0; i < VIRTUAL_TIMER_MAX_TIMERS; ++i){
+		timers[i].inUse = false;
+		timers[i].heapIndex = NOT_QUEUED;
+	}
+	heapCount = 0;
+	now = 0;
+}
+
+// Returns a stopped timer, or VIRTUAL_TIMER_INVALID_ID if all are in use.
+virtualTimer_id_t virtualTimer_create(const char *name, virtualTimer_callback_t callback, void *context){
+	for(virtualTimer_id_t id = 0; id < VIRTUAL_TIMER_MAX_TIMERS; ++id){
+		if(!timers[id].inUse){
+			timers[id].name = name;
+			timers[id].callback = callback;
+			timers[id].context = context;
+			timers[id].period = 0;
+			timers[id].expiryCount = 0;
+			timers[id].heapIndex = NOT_QUEUED;
+			timers[id].inUse = true;
+			return id;
+		}
+	}
+	printf("virtualTimer_create(): no timer left for %s\n", name);
+	return VIRTUAL_TIMER_INVALID_ID;
+}
+
+// Stops the timer and gives it back.
+void virtualTimer_destroy(virtualTimer_id_t id){
+	if(!virtualTimer_isValid(id))
+		return;
+	virtualTimer_stop(id);
+	timers[id].inUse = false;
+}
+
+// (Re)starts the timer with the given first delay and period.
+static void virtualTimer_start(virtualTimer_id_t id, uint32_t milliseconds, uint32_t period){
+	if(!virtualTimer_isValid(id))
+		return;
+	if(timers[id].heapIndex != NOT_QUEUED)
+		virtualTimer_remove(id);
+	timers[id].deadline = now + milliseconds;
+	timers[id].period = period;
+	timers[id].expiryCount = 0;
+	virtualTimer_insert(id);
+}
+
+// (Re)starts the timer to expire once, milliseconds from now.
+void virtualTimer_startOneShot(virtualTimer_id_t id, uint32_t milliseconds){
+	virtualTimer_start(id, milliseconds, 0);
+}
+
+// (Re)starts the timer to expire every periodMilliseconds.
+void virtualTimer_startPeriodic(virtualTimer_id_t id, uint32_t periodMilliseconds){
+	virtualTimer_start(id, periodMilliseconds, periodMilliseconds);
+}
+
+// Stops the timer and drops any expiry not yet taken.
+void virtualTimer_stop(virtualTimer_id_t id){
+	if(!virtualTimer_isValid(id))
+		return;
+	if(timers[id].heapIndex != NOT_QUEUED)
+		virtualTimer_remove(id);
+	timers[id].expiryCount = 0;
+}
+
+// Returns true if the timer is waiting to expire.
+bool virtualTimer_isRunning(virtualTimer_id_t id){
+	return virtualTimer_isValid(id) && timers[id].heapIndex != NOT_QUEUED;
+}
+
+// Returns true, once per expiry, if the timer has expired.
+bool virtualTimer_takeExpired(virtualTimer_id_t id){
+	if(!virtualTimer_isValid(id) || timers[id].expiryCount == 0)
+		return false;
+	--timers[id].expiryCount;
+	return true;
+}
+
+// Returns the milliseconds until the timer expires, 0 if it is not running.
+uint32_t virtualTimer_getRemainingMilliseconds(virtualTimer_id_t id){
+	uint32_t current = now;
+	if(!virtualTimer_isRunning(id) || !virtualTimer_before(current, timers[id].deadline))
+		return 0;
+	return timers[id].deadline - current;
+}
+
+// Returns the name the timer was created with.
+const char *virtualTimer_getName(virtualTimer_id_t id){
+	if(!virtualTimer_isValid(id))
+		return NULL;
+	return timers[id].name;
+}
+
+// Returns the free-running millisecond counter.
+uint32_t virtualTimer_getMilliseconds(){
+	return now;
+}
+
+// Expires every timer whose deadline has passed.
+void virtualTimer_service(){
+	uint32_t current = now;	//One reading, so a tick during the loop waits for the next call
+	while(heapCount > 0 && !virtualTimer_before(current, timers[heap[0]].deadline)){
+		virtualTimer_id_t id = heap[0];
+		virtualTimer_t *timer = &timers[id];
+		if(timer->period == 0){
+			virtualTimer_remove(id);
+		}
+		else{
+			timer->deadline += timer->period;
+			if(!virtualTimer_before(current, timer->deadline))	//Fell a period behind, skip ahead
+				timer->deadline = current + timer->period;
+			virtualTimer_siftDown(0);
+		}
+		if(timer->expiryCount < UINT16_MAX)
+			++timer->expiryCount;
+		if(timer->callback != NULL)
+			timer->callback(id, timer->context);	//May restart or stop any timer
+	}
+}
+
+// Advances the counter by a millisecond.
+void virtualTimer_tick(){
+	++now;
+}
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+// Advances the counter by milliseconds, servicing after every tick.
+static void virtualTimer_runFor(uint32_t milliseconds){
+	for(uint32_t i = 0; i < milliseconds; ++i){
+		virtualTimer_tick();
+		virtualTimer_service();
+	}
+}
+
+// Counts the calls of a test callback.
+static void virtualTimer_countCallback(virtualTimer_id_t id, void *context){
+	(void)id;
+	++*(uint32_t *)context;
+}
+
+// Stops the timer passed as context, to check that callbacks may change the heap.
+static void virtualTimer_stopCallback(virtualTimer_id_t id, void *context){
+	(void)id;
+	virtualTimer_stop(*(virtualTimer_id_t *)context);
+}
+
+// Reports a failed check.
+static bool virtualTimer_check(bool ok, const char *message){
+	if(!ok)
+		printf("virtualTimer_runTest(): %s\n", message);
+	return ok;
+}
+
+// Checks the timers, then prints the cost of virtualTimer_service().
+bool virtualTimer_runTest(){
+	printf("Starting virtualTimer_runTest()\n");
+	bool passed = true;
+	uint32_t callbackCount = 0;
+	virtualTimer_init();
+	virtualTimer_id_t oneShot = virtualTimer_create("oneShot", NULL, NULL);
+	virtualTimer_id_t periodic = virtualTimer_create("periodic", virtualTimer_countCallback, &callbackCount);
+	virtualTimer_id_t stopper = virtualTimer_create("stopper", virtualTimer_stopCallback, &periodic);
+
+	//One-shot: expires once, on time
+	virtualTimer_startOneShot(oneShot, 10);
+	virtualTimer_runFor(9);
+	passed &= virtualTimer_check(!virtualTimer_takeExpired(oneShot) && virtualTimer_getRemainingMilliseconds(oneShot) == 1, "one-shot expired early");
+	virtualTimer_runFor(1);
+	passed &= virtualTimer_check(virtualTimer_takeExpired(oneShot) && !virtualTimer_isRunning(oneShot), "one-shot did not expire");
+	virtualTimer_runFor(20);
+	passed &= virtualTimer_check(!virtualTimer_takeExpired(oneShot), "one-shot expired twice");
+
+	//Periodic: an expiry and a callback per period, stopped by another timer's callback
+	virtualTimer_startPeriodic(periodic, 7);
+	virtualTimer_startOneShot(stopper, 70);
+	virtualTimer_runFor(69);
+	uint32_t expiries = 0;
+	while(virtualTimer_takeExpired(periodic))
+		++expiries;
+	passed &= virtualTimer_check(expiries == 9 && callbackCount == 9, "periodic timer missed a period");
+	virtualTimer_runFor(1);
+	passed &= virtualTimer_check(!virtualTimer_isRunning(periodic) && !virtualTimer_takeExpired(periodic), "callback did not stop the periodic timer");
+
+	//A late service expires a periodic timer once and skips ahead
+	virtualTimer_startPeriodic(periodic, 5);
+	for(uint16_t i = 0; i < 23; ++i)
+		virtualTimer_tick();
+	virtualTimer_service();
+	passed &= virtualTimer_check(virtualTimer_takeExpired(periodic) && !virtualTimer_takeExpired(periodic) && virtualTimer_getRemainingMilliseconds(periodic) == 5, "late periodic timer did not skip ahead");
+	virtualTimer_stop(periodic);
+
+	//Many one-shots with random delays expire in deadline order, across wraparound
+	virtualTimer_init();
+	now = UINT32_MAX - 500;
+	virtualTimer_id_t ids[TEST_RANDOM_TIMER_COUNT];
+	uint32_t delays[TEST_RANDOM_TIMER_COUNT];
+	srand(1);
+	for(uint16_t i = 0; i < TEST_RANDOM_TIMER_COUNT; ++i){
+		ids[i] = virtualTimer_create("random", NULL, NULL);
+		delays[i] = 1 + rand() % 1000;
+		virtualTimer_startOneShot(ids[i], delays[i]);
+	}
+	for(uint16_t i = 0; i < TEST_RANDOM_TIMER_COUNT; i += 3)	//Stop some from the middle of the heap
+		virtualTimer_stop(ids[i]);
+	bool inOrder = true;
+	for(uint32_t t = 1; t <= 1000; ++t){
+		virtualTimer_runFor(1);
+		for(uint16_t i = 0; i < TEST_RANDOM_TIMER_COUNT; ++i){
+			bool due = (i % 3 != 0) && delays[i] == t;
+			if(virtualTimer_takeExpired(ids[i]) != due)
+				inOrder = false;
+		}
+	}
+	passed &= virtualTimer_check(inOrder && heapCount == 0, "timers expired out of order");
+	passed &= virtualTimer_check(virtualTimer_create("one too many", NULL, NULL) != VIRTUAL_TIMER_INVALID_ID, "create failed with timers free");
+
+	//Ids that were never handed out, or were given back, are ignored
+	virtualTimer_destroy(ids[1]);
+	virtualTimer_startOneShot(ids[1], 1);
+	virtualTimer_startOneShot(VIRTUAL_TIMER_INVALID_ID, 1);
+	virtualTimer_stop(VIRTUAL_TIMER_INVALID_ID);
+	virtualTimer_destroy(VIRTUAL_TIMER_INVALID_ID);
+	passed &= virtualTimer_check(heapCount == 0 && !virtualTimer_isRunning(VIRTUAL_TIMER_INVALID_ID) && !virtualTimer_takeExpired(VIRTUAL_TIMER_INVALID_ID)
+		&& virtualTimer_getRemainingMilliseconds(VIRTUAL_TIMER_INVALID_ID) == 0 && virtualTimer_getName(ids[1]) == NULL, "an invalid id was used");
+
+	//Cost of a loop with every timer running and none due
+	virtualTimer_init();
+	for(uint16_t i = 0; i < VIRTUAL_TIMER_MAX_TIMERS; ++i)
+		virtualTimer_startPeriodic(virtualTimer_create("benchmark", NULL, NULL), 1000 + i);
+	passed &= virtualTimer_check(virtualTimer_create("one too many", NULL, NULL) == VIRTUAL_TIMER_INVALID_ID, "create did not fail with every timer in use");
+	intervalTimer_init(TEST_TIMER);
+	intervalTimer_init(INTERVAL_TIMER_TIMER_1);
+	intervalTimer_reset(TEST_TIMER);
+	intervalTimer_start(TEST_TIMER);
+	for(uint32_t i = 0; i < TEST_BENCHMARK_LOOPS; ++i)
+		virtualTimer_service();
+	intervalTimer_stop(TEST_TIMER);
+	double serviceSeconds = intervalTimer_getTotalDurationInSeconds(TEST_TIMER);
+	volatile double sink = 0;
+	intervalTimer_reset(TEST_TIMER);
+	intervalTimer_start(TEST_TIMER);
+	for(uint32_t i = 0; i < TEST_BENCHMARK_LOOPS; ++i)
+		sink += intervalTimer_getTotalDurationInSeconds(INTERVAL_TIMER_TIMER_1);
+	intervalTimer_stop(TEST_TIMER);
+	double pollSeconds = intervalTimer_getTotalDurationInSeconds(TEST_TIMER);
+	printf("virtualTimer_service() with %d timers: %.1f ns, intervalTimer_getTotalDurationInSeconds(): %.1f ns\n",
+		VIRTUAL_TIMER_MAX_TIMERS, serviceSeconds * TEST_NANOSECONDS_PER_SECOND / TEST_BENCHMARK_LOOPS,
+		pollSeconds * TEST_NANOSECONDS_PER_SECOND / TEST_BENCHMARK_LOOPS);
+	virtualTimer_init();
+
+	printf("%s\n", passed ? "passed" : "FAILED");
+	printf("Completed virtualTimer_runTest()\n");
+	return passed;
+}
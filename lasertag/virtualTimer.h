@@ -0,0 +1,99 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef VIRTUALTIMER_H_
+#define VIRTUALTIMER_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// Virtual timers give the game code as many one-shot and periodic timers as it
+// needs from a single free-running millisecond counter, which the 1 kHz slow
+// lane of isr_function() advances. Nothing else runs in the interrupt: running
+// timers sit in a min-heap ordered by deadline, and virtualTimer_service(),
+// called from the main loop, only looks at the top of the heap unless a timer
+// has expired. An expired timer latches an expiry for virtualTimer_takeExpired()
+// and, if it has one, calls its callback from virtualTimer_service(). Periodic
+// timers are then put back in the heap one period later.
+//
+// Times are whole milliseconds. The counter wraps after 49 days; deadlines are
+// compared through their difference, so that is harmless as long as no timer
+// is set more than 24 days ahead.
+//
+// Every call that takes an id ignores one that virtualTimer_create() did not
+// hand out, or that was destroyed since: the commands do nothing and the
+// queries answer as for a stopped timer.
+
+#define VIRTUAL_TIMER_MAX_TIMERS 256
+#define VIRTUAL_TIMER_INVALID_ID 0xFFFF // Returned when every timer is in use.
+
+typedef uint16_t virtualTimer_id_t;
+
+// Called from virtualTimer_service() each time the timer expires.
+typedef void (*virtualTimer_callback_t)(virtualTimer_id_t id, void *context);
+
+// Frees every timer and resets the counter. Call it once before creating the
+// timers, not from isr_init(), so re-initializing the ISR leaves the game's
+// timers alone.
+void virtualTimer_init();
+
+// Returns a stopped timer, or VIRTUAL_TIMER_INVALID_ID if all
+// VIRTUAL_TIMER_MAX_TIMERS are in use. name is kept, not copied, and is only
+// used for printing. callback may be NULL.
+virtualTimer_id_t virtualTimer_create(const char *name,
+                                      virtualTimer_callback_t callback,
+                                      void *context);
+
+// Stops the timer and gives it back.
+void virtualTimer_destroy(virtualTimer_id_t id);
+
+// (Re)starts the timer to expire once, milliseconds from now.
+void virtualTimer_startOneShot(virtualTimer_id_t id, uint32_t milliseconds);
+
+// (Re)starts the timer to expire every periodMilliseconds, starting one period
+// from now.
+void virtualTimer_startPeriodic(virtualTimer_id_t id,
+                                uint32_t periodMilliseconds);
+
+// Stops the timer and drops any expiry not yet taken.
+void virtualTimer_stop(virtualTimer_id_t id);
+
+// Returns true if the timer is waiting to expire.
+bool virtualTimer_isRunning(virtualTimer_id_t id);
+
+// Returns true, once per expiry, if the timer has expired since it was started
+// or since the last call. Expiries are found by virtualTimer_service().
+bool virtualTimer_takeExpired(virtualTimer_id_t id);
+
+// Returns the milliseconds until the timer expires, 0 if it is not running.
+uint32_t virtualTimer_getRemainingMilliseconds(virtualTimer_id_t id);
+
+// Returns the name the timer was created with, NULL for an invalid id.
+const char *virtualTimer_getName(virtualTimer_id_t id);
+
+// Returns the free-running millisecond counter.
+uint32_t virtualTimer_getMilliseconds();
+
+// Expires every timer whose deadline has passed, calls their callbacks and
+// puts periodic timers back in the heap. A periodic timer that fell more than
+// a period behind expires once and skips the periods it missed. Call it from
+// the main loop; it only reads the top of the heap when nothing has expired.
+void virtualTimer_service();
+
+// Advances the counter by a millisecond. Invoked from the 1 kHz slow lane of
+// isr_function().
+void virtualTimer_tick();
+
+// Checks one-shot, periodic and callback timers, heap order with many timers
+// and counter wraparound, then prints the cost of virtualTimer_service() with
+// VIRTUAL_TIMER_MAX_TIMERS timers running against polling an interval timer.
+// Ticks the counter itself, so run it with interrupts disabled.
+// Returns true if it passes.
+bool virtualTimer_runTest();
+
+#endif /* VIRTUALTIMER_H_ */
@@ -10,14 +10,17 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "runningModes.h"
 #include "detector.h"
 #include "display.h"
+#include "adcCapture.h"
 #include "buttons.h"
 #include "switches.h"
 #include "filter.h"
 #include "histogram.h"
 #include "hitLedTimer.h"
+#include "idle.h"
 #include "interrupts.h"
 #include "intervalTimer.h"
 #include "isr.h"
+#include "isrProfile.h"
 #include "ledTimer.h"
 #include "leds.h"
 #include "lockoutTimer.h"
@@ -107,6 +110,22 @@ void runningModes_printRunTimeStatistics() {
   display_print("Unprocessed elements in ADC queue:");
   uint32_t remainingElementCount = isr_adcBufferElementCount();
   display_printlnDecimalInt(remainingElementCount);
+  // Print out the ADC buffer overflow counters.
+  isr_AdcBlockStats_t adcStats;
+  isr_getAdcBlockStats(&adcStats);
+  display_print("ADC overflows: ");
+  display_printDecimalInt(adcStats.overrunCount);
+  display_print(" (");
+  display_printDecimalInt(adcStats.droppedFrameCount);
+  display_println(" samples dropped)");
+  display_print("ADC high-water mark: ");
+  display_printDecimalInt(adcStats.highWaterBlocks);
+  display_print(" of ");
+  display_printDecimalInt(ISR_ADC_BLOCK_COUNT);
+  display_println(" blocks");
+  display_print("Longest detector stall: ");
+  display_printDecimalInt(adcStats.longestStallFrames / ISR_ADC_BLOCK_FRAMES);
+  display_println(" ms");
   display_printChar('\n');
   double runningSeconds, isrRunningSeconds, mainLoopRunningSeconds;
   runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
@@ -141,6 +160,14 @@ void runningModes_printRunTimeStatistics() {
   display_print("Total interrupts:            ");
   display_printlnDecimalInt(interruptCount);
   display_printChar('\n');
+  idle_stats_t idleStats;
+  idle_getStats(&idleStats);
+  // Print out the CPU duty cycle, the time main was not asleep on WFI.
+  display_print("CPU duty cycle: ");
+  sprintf(sprintfBuffer, "%5.2f", idleStats.dutyCyclePercent);
+  display_print(sprintfBuffer);
+  display_println("%");
+  display_printChar('\n');
   display_print("Detector invocation count: ");
   // Print out detector invocations per second.
   display_printlnDecimalInt(detectorInvocationCount);
@@ -169,6 +196,9 @@ void runningModes_printRunTimeStatistics() {
     display_printDecimalInt(SUGGESTED_REMAINING_ELEMENT_COUNT);
     display_println(" elements.");
   }
+#ifdef ISR_PROFILE_ENABLED
+  isrProfile_printReport(); // Per-function ISR cycles go to the console.
+#endif
 }
 
 // Group all of the inits together to reduce visual clutter.
@@ -223,6 +253,7 @@ void runningModes_continuous() {
       MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
   intervalTimer_start(
       TOTAL_RUNTIME_TIMER);            // Start measuring total execution time.
+  idle_init(); // Duty-cycle accounting starts with the run-time timer.
   transmitter_setContinuousMode(true); // Run the transmitter continuously.
   interrupts_enableArmInts();  // The ARM will start seeing interrupts after
                                // this.
@@ -250,6 +281,7 @@ void runningModes_continuous() {
       histogramSystemTicks =
           0; // Reset the tick count and wait for the next update time.
     }
+    idle_sleepIfIdle(); // Sleep until the next interrupt if no block is waiting.
   }
   interrupts_disableArmInts();           // Stop interrupts.
   runningModes_printRunTimeStatistics(); // Print the run-time statistics.
@@ -284,6 +316,7 @@ void runningModes_shooter() {
       MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
   intervalTimer_start(
       TOTAL_RUNTIME_TIMER);   // Start measuring total execution time.
+  idle_init(); // Duty-cycle accounting starts with the run-time timer.
   interrupts_enableArmInts(); // The ARM will start seeing interrupts after
                               // this.
   lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
@@ -310,6 +343,7 @@ void runningModes_shooter() {
     }
     intervalTimer_stop(
         MAIN_CUMULATIVE_TIMER); // All done with actual processing.
+    idle_sleepIfIdle(); // Sleep until the next interrupt if no block is waiting.
   }
   interrupts_disableArmInts(); // Done with loop, disable the interrupts.
   hitLedTimer_turnLedOff();    // Save power :-)
@@ -337,3 +371,37 @@ void runningModes_dumpRawAdcValues() {
     printf("raw ADC value: %d\n", signExtendedValue);
   }
 }
+
+// This mode streams raw ADC samples over the USB-UART for offline analysis
+// until btn3 is pressed. The detector keeps running so its buffer never backs
+// up. Run adcCaptureDecode on the host to turn the stream into a capture
+// file; the UART runs at ADC_CAPTURE_BAUD_RATE from here on.
+void runningModes_streamRawAdc() {
+  runningModes_initAll();
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    ignoredFrequencies[i] = false;
+  detector_init(ignoredFrequencies);
+  interrupts_initAll(true); // Inits all interrupts but does not enable them.
+  interrupts_enableTimerGlobalInts(); // Allows the timer to generate
+                                      // interrupts.
+  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
+  if (!adcCapture_openPort(NULL))     // The board always uses the USB-UART.
+    return;
+  adcCapture_start();         // The ISR starts filling the capture ring.
+  interrupts_enableArmInts(); // The ARM will start seeing interrupts after
+                              // this.
+  while (!(buttons_read() & BUTTONS_BTN3_MASK)) {
+    detector(INTERRUPTS_CURRENTLY_ENABLED); // Keep the ADC buffer drained.
+    adcCapture_service(); // Send every full packet in the capture ring.
+  }
+  adcCapture_stop();
+  adcCapture_service(); // Send the last, partly filled packet.
+  interrupts_disableArmInts();
+  adcCapture_stats_t stats;
+  adcCapture_getStats(&stats);
+  printf("Captured %u samples in %u packets (%u bytes, %5.2f bits/sample), "
+         "%u samples dropped.\n",
+         stats.capturedSamples, stats.packetsSent, stats.bytesSent,
+         stats.bitsPerSample, stats.droppedSamples);
+}